@@ -72,6 +72,9 @@ public:
   gboolean provide_mapping{FALSE};
   gboolean req_styles{FALSE};
   int group{0};
+  int summary_bins{0};  // if > 0, summarised sources (bigWig, BAM coverage) give about this many features per request
+  gboolean coverage{FALSE};  // if true, read sources (BAM) give their depth as a graph, not the reads
+  int tile_size{0};  // if > 0, regions longer than this are requested in tiles of this many bases
   bool recent{false};
 
   ZMapConfigSourceStruct* parent{NULL} ;
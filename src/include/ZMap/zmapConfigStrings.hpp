@@ -235,6 +235,9 @@
 
 #define ZMAPSTANZA_APP_MAX_FEATURES      "max-features"     /* max number of features to allow
                                                              * zmap to load */
+#define ZMAPSTANZA_APP_THREAD_POOL       "thread-pool-size" /* max number of worker threads for
+                                                             * loading sources, 0 => one thread
+                                                             * per source */
 
 
 
@@ -298,6 +301,7 @@
 #define ZMAPSTANZA_LOG_SHOW_TIME     "show-time"
 #define ZMAPSTANZA_LOG_CATCH_GLIB    "catch-glib"
 #define ZMAPSTANZA_LOG_ECHO_GLIB     "echo-glib"
+#define ZMAPSTANZA_LOG_ASYNC         "async"
 
 
 /*! @addtogroup config_stanzas
@@ -440,6 +444,9 @@
 #define ZMAPSTANZA_SOURCE_FORMAT         "format"
 #define ZMAPSTANZA_SOURCE_DELAYED        "delayed"
 #define ZMAPSTANZA_SOURCE_GROUP          "group"
+#define ZMAPSTANZA_SOURCE_SUMMARY_BINS   "summary-bins"
+#define ZMAPSTANZA_SOURCE_COVERAGE       "coverage"
+#define ZMAPSTANZA_SOURCE_TILE_SIZE      "tile-size"
 
 #define ZMAPSTANZA_SOURCE_GROUP_NEVER      "never"
 #define ZMAPSTANZA_SOURCE_GROUP_START      "start"
@@ -119,4 +119,18 @@ GList *zMapDNAFindAllMatches(char *dna, char *query, ZMapStrand strand, int from
 			     int max_errors, int max_Ns, gboolean return_matches) ;
 void zMapDNAReverseComplement(char *sequence, int length) ;
 
+
+/* Packed dna, see zmapDNAPacked.cpp. Coords are zero-based and on the reverse strand when
+ * revcomp is TRUE. */
+typedef struct ZMapPackedDNAStructType *ZMapPackedDNA ;
+
+ZMapPackedDNA zMapPackedDNACreate(const char *dna, int length) ;
+ZMapPackedDNA zMapPackedDNARef(ZMapPackedDNA packed) ;
+void zMapPackedDNAUnref(ZMapPackedDNA packed) ;
+int zMapPackedDNALength(ZMapPackedDNA packed) ;
+gboolean zMapPackedDNADecode(ZMapPackedDNA packed, int start, int length, gboolean revcomp, char *buf) ;
+char *zMapPackedDNAGetString(ZMapPackedDNA packed, int start, int length, gboolean revcomp) ;
+char zMapPackedDNAGetBase(ZMapPackedDNA packed, int pos, gboolean revcomp) ;
+gsize zMapPackedDNAGetMemUsage(ZMapPackedDNA packed) ;
+
 #endif /* ZMAP_DNA_H */
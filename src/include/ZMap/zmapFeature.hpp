@@ -31,6 +31,8 @@
 #define ZMAP_FEATURE_H
 
 #include <gdk/gdkcolor.h>
+#include <atomic>
+#include <map>
 #include <mutex>
 
 #include <ZMap/zmapConfigStyleDefaults.hpp>
@@ -340,9 +342,26 @@ typedef struct ZMapFeatureContextMergeStatsStructType
 {
   int features_added ;                                       /* Number of new features added to context. */
 
+  int featuresets_moved ;                                    /* Featuresets new to the context, or
+                                                              * empty in it, taken over whole. */
+  int featuresets_merged ;                                   /* Featuresets merged feature by feature. */
+
+  double merge_secs ;                                        /* Time taken by the merge. */
+
 } ZMapFeatureContextMergeStatsStruct, *ZMapFeatureContextMergeStats ;
 
 
+/* Counts of the feature unique ids interned since startup, see zMapFeatureCreateID(). */
+typedef struct ZMapFeatureIDStatsStructType
+{
+  gint64 num_ids ;                                           /* Distinct ids. */
+  gint64 lookups ;                                           /* Ids requested. */
+  gint64 string_bytes ;                                      /* Memory held by the id strings. */
+  gint64 table_bytes ;                                       /* Estimate of the table overhead. */
+
+} ZMapFeatureIDStatsStruct, *ZMapFeatureIDStats ;
+
+
 
 
 
@@ -397,6 +416,7 @@ typedef struct ZMapFeatureContextMergeStatsStructType
 typedef struct ZMapFeatureAlignmentStructType *ZMapFeatureAlignment ;
 typedef struct ZMapFeatureAnyStructType *ZMapFeatureAny ;
 typedef struct ZMapFeatureStructType *ZMapFeature ;
+typedef struct ZMapPackedDNAStructType *ZMapPackedDNA ;             /* See ZMap/zmapDNA.hpp */
 
 
 
@@ -539,9 +559,14 @@ typedef struct ZMapFeatureBlockStructType
                                                               sequence, n.b. this feature set may only
                                                               span part of the sequence. */
 
-  ZMapSequenceStruct sequence ;                            /* DNA sequence for this block,
+  ZMapSequenceStruct sequence ;                            /* Type and length of the DNA for this
+                                                              block, the bases are in packed_dna,
                                                               n.b. there may not be any dna. */
 
+  ZMapPackedDNA packed_dna ;                               /* The forward strand of the dna packed,
+                                                              decoded as needed, NULL if there is
+                                                              no dna. */
+
   gboolean revcomped;                                      /* block RevComp'd relative to the window */
 
   /*  int features_start, features_end ; */                  /* coord limits for fetching features. */
@@ -551,6 +576,22 @@ typedef struct ZMapFeatureBlockStructType
 
 
 
+/* Opaque index of the features in a featureset, see zmapFeatureSetIndex.cpp */
+typedef struct ZMapFeatureSetIndexStructType *ZMapFeatureSetIndex ;
+
+/* Opaque slab allocator for the features of a featureset, see zmapFeatureSlab.cpp */
+typedef struct ZMapFeatureSlabStructType *ZMapFeatureSlab ;
+
+/* Heads each list of same name features in ZMapFeatureSet->masker_sorted_features,
+ * see zmapFeatureMask.cpp */
+typedef struct ZMapFeatureMaskSetStructType
+{
+  GQuark id ;
+  Coord x1, x2 ;
+  gboolean masked ;                                         /* by self */
+} ZMapFeatureMaskSetStruct, *ZMapFeatureMaskSet ;
+
+
 /*!\struct ZMapFeatureSetStructType
  * \brief a set of ZMapFeature structs.
  * Holds a set of ZMapFeature structs, note that the id for the set is by default the same name
@@ -576,6 +617,8 @@ typedef struct ZMapFeatureSetStructType
 
   /* NB we don't expect to use both these on the same featureset but play safe... */
   GList *masker_sorted_features;                           /* or NULL if not sorted */
+  guint masker_sorted_n_features ;                         /* Size of features hash when sorted,
+                                                            * used to catch changes. */
 
   GList *loaded;                                           /* strand and end coordinate pairs in numerical order
                                                             * of start coord we use ZMapSpanStruct (x1,x2) to
@@ -584,9 +627,37 @@ typedef struct ZMapFeatureSetStructType
   ZMapConfigSource source ;                                /* The source this featureset was
                                                             * loaded from */
 
+  ZMapFeatureSetIndex index ;                              /* Coord/name index of features, built
+                                                            * on demand, NULL if not built or
+                                                            * invalidated by a change to the set. */
+
+  ZMapFeatureSlab slab ;                                   /* Features created by
+                                                            * zMapFeatureCreateEmptyFromSet() are
+                                                            * allocated from here, NULL if none. */
+
+  gboolean revcomp_pending ;                               /* The context has been reverse
+                                                            * complemented but these features have
+                                                            * not been yet, they are done when
+                                                            * first used, see
+                                                            * zMapFeatureSetRevCompResolve(). */
+  ZMapSpanStruct revcomp_span ;                            /* Sequence span to revcomp them over. */
+
 } ZMapFeatureSetStruct, *ZMapFeatureSet ;
 
 
+/* Memory used by the features of a featureset, see zMapFeatureSetGetMemUsage(). */
+typedef struct ZMapFeatureSetMemUsageStructType
+{
+  int num_features ;
+  gsize feature_bytes ;                                    /* Feature structs. */
+  gsize subpart_bytes ;                                    /* Strings, gap/exon arrays etc. */
+  gsize slab_bytes ;                                       /* Reserved by the set's slab. */
+  int slab_features ;                                      /* Features allocated from the slab,
+                                                            * may include features merged into
+                                                            * other sets. */
+} ZMapFeatureSetMemUsageStruct, *ZMapFeatureSetMemUsage ;
+
+
 
 
 /*
@@ -769,6 +840,12 @@ typedef struct ZMapFeatureStructType
     unsigned int squashed_start: 1 ;                       /* alignments only */
     unsigned int squashed_end: 1 ;	                        /* alignments only */
     unsigned int joined: 1;                                /* alignments only */
+
+    unsigned int slab_alloc: 1 ;                           /* struct is from a featureset slab. */
+
+    /* feature is the mean of a summary bin of a long region, it is replaced when the features
+     * of a shorter region covering it are loaded. */
+    unsigned int summary_bin: 1 ;
   } flags ;
 
 
@@ -1076,9 +1153,20 @@ typedef gboolean (*ZMapFeatureDumpFeatureFunc)(ZMapFeatureAny feature_any,
 
 // Singleton class to keep count of, and limit, the number of features loaded in zmap.
 // Use via the instance function e.g. ZMapFeatureCount::instance().hitLimit(error)
+//
+// Features are created by many loading threads at once so each thread reserves a batch of the
+// allowed features at a time and counts against its own batch, the shared count is only touched
+// when a batch runs out. Reservations never take the total over the limit.
 class ZMapFeatureCount
 {
 public:
+  // Features created by one source, see beginSource()
+  struct SourceStats
+  {
+    int num_features ;
+    double secs ;         // time spent creating them, num_features / secs gives the rate
+  } ;
+
   // Delete the methods we don't want
   ZMapFeatureCount(ZMapFeatureCount const&) = delete ;
   ZMapFeatureCount& operator=(ZMapFeatureCount const&) = delete ;
@@ -1095,18 +1183,33 @@ public:
   void operator--() ;
 
   // Set/query the limit and count
-  int getCount() const ;
+  int getCount() ;
   int getLimit() const ;
   void setLimit(const int max_features) ;
   bool hitLimit(GError **error)  ;
 
+  // Features created by the calling thread between these calls are counted against source_name.
+  void beginSource(const char *source_name) ;
+  void endSource() ;
+  std::map<GQuark, SourceStats> getSourceStats() ;
+
 private:
+  struct ThreadCount ;
+
   // Private constructor
   ZMapFeatureCount() ;
 
-  int max_features_ ;     // max number of allowed features
-  int loaded_features_ ;  // total features in memory
-  std::mutex mutex_ ;
+  ThreadCount &threadCount() ;
+  bool reserve(ThreadCount &thread_count) ;
+  void addThread(ThreadCount *thread_count) ;
+  void removeThread(ThreadCount *thread_count) ;
+
+  std::atomic<int> max_features_ ;       // max number of allowed features
+  std::atomic<int> reserved_features_ ;  // features in memory plus threads' unused reservations
+
+  std::mutex mutex_ ;                    // protects the lists below
+  GList *threads_ ;
+  std::map<GQuark, SourceStats> source_stats_ ;
 } ;
 
 
@@ -1151,8 +1254,10 @@ GQuark zMapFeatureCreateID(ZMapStyleMode feature_type,
 			   ZMapStrand strand,
                            int start, int end,
 			   int query_start, int query_end) ;
+void zMapFeatureIDGetStats(ZMapFeatureIDStats stats_out) ;
 bool zMapFeatureErrorIsFatal(GError **error) ;
 ZMapFeature zMapFeatureCreateEmpty(GError **error = NULL) ;
+ZMapFeature zMapFeatureCreateEmptyFromSet(ZMapFeatureSet feature_set, GError **error = NULL) ;
 ZMapFeature zMapFeatureCreateFromStandardData(const char *name, const char *sequence, const char *ontology,
 					      ZMapStyleMode feature_type,
                                               ZMapFeatureTypeStyle *style,
@@ -1221,6 +1326,9 @@ gboolean zMapFeatureAlignmentString2Gaps(ZMapFeatureAlignFormat align_format,
 					 ZMapStrand ref_strand, int ref_start, int ref_end,
 					 ZMapStrand match_strand, int match_start, int match_end,
 					 char *align_string, GArray **gaps_out) ;
+gboolean zMapFeatureAlignmentBAMCigar2Gaps(ZMapStrand ref_strand, int ref_start, int ref_end,
+                                           ZMapStrand match_strand, int match_start, int match_end,
+                                           const guint32 *cigar, int n_cigar, GArray **gaps_out) ;
 gboolean zMapFeatureAlignmentString2ExonsGaps(ZMapFeatureAlignFormat align_format,
                                               ZMapStrand ref_strand, int ref_start, int ref_end,
                                               ZMapStrand match_strand, int match_start, int match_end,
@@ -1252,6 +1360,9 @@ void zMapFeature2BlockCoords(ZMapFeatureBlock block, int *x1_inout, int *x2_inou
 void zMapBlock2FeatureCoords(ZMapFeatureBlock block, int *x1_inout, int *x2_inout) ;
 
 void zMapFeatureContextReverseComplement(ZMapFeatureContext context) ;
+void zMapFeatureSetRevCompResolve(ZMapFeatureSet feature_set) ;
+void zMapFeatureAnyRevCompResolve(ZMapFeatureAny feature_any) ;
+void zMapFeatureContextPostProcess(ZMapFeatureContext context) ;
 void zMapFeatureReverseComplement(ZMapFeatureContext context, ZMapFeature feature) ;
 void zMapFeatureReverseComplementCoords(ZMapFeatureContext context, int *start_inout, int *end_inout) ;
 
@@ -1297,6 +1408,15 @@ char *zMapFeatureSetGetName(ZMapFeatureSet feature_set) ;
 GList *zMapFeatureSetGetRangeFeatures(ZMapFeatureSet feature_set, int start, int end) ;
 GList *zMapFeatureSetGetNamedFeatures(ZMapFeatureSet feature_set, GQuark original_id) ;
 GList *zMapFeatureSetGetNamedFeaturesForStrand(ZMapFeatureSet feature_set, GQuark original_id, ZMapStrand strand) ;
+GList *zMapFeatureSetGetOverlapFeatures(ZMapFeatureSet feature_set, int start, int end) ;
+void zMapFeatureSetForeachOverlap(ZMapFeatureSet feature_set, int start, int end,
+                                  GFunc func, gpointer user_data) ;
+void zMapFeatureSetIndexInvalidate(ZMapFeatureSet feature_set) ;
+void zMapFeatureSetMaskerSort(ZMapFeatureSet feature_set) ;
+gboolean zMapFeatureSetMaskerIsSorted(ZMapFeatureSet feature_set) ;
+void zMapFeatureSetMaskerFree(ZMapFeatureSet feature_set) ;
+gsize zMapFeatureSetGetMemUsage(ZMapFeatureSet feature_set, ZMapFeatureSetMemUsage usage_out) ;
+void zMapFeatureContextLogMemUsage(ZMapFeatureContext context) ;
 
 GList* zMapStyleGetFeaturesetsIDs(ZMapFeatureTypeStyle style, ZMapFeatureAny feature_any) ;
 GList* zMapStyleGetFeaturesets(ZMapFeatureTypeStyle style, ZMapFeatureAny feature_any) ;
@@ -1304,6 +1424,7 @@ GList* zMapStyleGetFeaturesets(ZMapFeatureTypeStyle style, ZMapFeatureAny featur
 ZMapFeatureSet zMapFeatureSetCopy(ZMapFeatureSet feature_set);
 
 gboolean zMapFeatureSetIsLoadedInRange(ZMapFeatureBlock block, GQuark unique_id,int start, int end);
+gboolean zMapFeatureSetIsLoadedInSpan(ZMapFeatureSet feature_set, int start, int end) ;
 
 
 /*
@@ -1330,6 +1451,7 @@ void zMapFeatureBlockDestroy(ZMapFeatureBlock block, gboolean free_data) ;
 
 gboolean zMapFeatureBlockDNA(ZMapFeatureBlock block,
                              char **seq_name, int *seq_len, char **sequence) ;
+gboolean zMapFeatureBlockDNADecode(ZMapFeatureBlock block, int start, int length, char *buf) ;
 
 
 /*
@@ -1382,6 +1504,7 @@ ZMapFeatureTypeStyle zMapFeatureContextFindStyle(ZMapFeatureContext context, cha
 void zMapFeatureContextDestroy(ZMapFeatureContext context, gboolean free_data) ;
 
 gboolean zMapFeatureContextGetDNAStatus(ZMapFeatureContext context);
+void zMapFeatureContextLogDNAMemUsage(ZMapFeatureContext context) ;
 
 void zMapPrintContextFeaturesets(ZMapFeatureContext context);
 
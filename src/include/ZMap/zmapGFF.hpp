@@ -209,6 +209,8 @@ ZMapGFFVersion zMapGFFDumpVersionGet() ;
 gboolean zMapGFFDump(ZMapFeatureAny dump_set, ZMapStyleTree &styles, GIOChannel *file, GError **error_out);
 gboolean zMapGFFDumpRegion(ZMapFeatureAny dump_set, ZMapStyleTree &styles,
   ZMapSpan region_span, GIOChannel *file, GError **error_out) ;
+gboolean zMapGFFDumpRegionParallel(ZMapFeatureAny dump_set, ZMapStyleTree &styles,
+  ZMapSpan region_span, GIOChannel *file, GError **error_out) ;
 gboolean zMapGFFDumpList(GList *dump_list, ZMapStyleTree &styles, char *sequence,
   GIOChannel *file, GString *text_out, GError **error_out) ;
 gboolean zMapGFFDumpFeatureSets(ZMapFeatureAny, ZMapStyleTree &, GList*, ZMapSpan,
@@ -45,6 +45,18 @@
 #include <glib.h>
 
 
+/*
+ * A view of part of a string; used by the body line tokenizer so that no
+ * copying or allocation is needed to split a line into columns. NB the
+ * span is _not_ null terminated.
+ */
+typedef struct ZMapGFFStringSpanStruct_
+{
+  const char *sStart ;
+  unsigned int iLength ;
+} ZMapGFFStringSpanStruct, *ZMapGFFStringSpan ;
+
+
 /*
  * Some string utilities.
  */
@@ -56,6 +68,12 @@ gboolean zMapGFFStringUtilsSubstringReplace(const char * const, const char * con
 char* zMapGFFEscape(const char * const sInput ) ;
 char* zMapGFFUnescape(const char * const sInput ) ;
 
+unsigned int zMapGFFStringUtilsSpanTokenizer(char, const char * const, gboolean, ZMapGFFStringSpanStruct *, unsigned int) ;
+char *zMapGFFStringUtilsSpanCopy(const ZMapGFFStringSpanStruct * const, char *) ;
+gboolean zMapGFFStringUtilsSpanEquals(const ZMapGFFStringSpanStruct * const, const char * const) ;
+gboolean zMapGFFStringUtilsSpanToInt(const ZMapGFFStringSpanStruct * const, int *) ;
+gboolean zMapGFFStringUtilsSpanToDouble(const ZMapGFFStringSpanStruct * const, double *) ;
+
 
 
 #endif
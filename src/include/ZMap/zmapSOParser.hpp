@@ -78,6 +78,8 @@ const char * zMapSOSetIsIDPresent(ZMapSOSetInUse , unsigned int ) ;
 ZMapStyleMode zMapSOSetGetStyleModeFromID(ZMapSOSetInUse, unsigned int ) ;
 ZMapHomolType zMapSOSetGetHomolFromID(ZMapSOSetInUse, unsigned int ) ;
 ZMapStyleMode zMapSOSetGetStyleModeFromName(ZMapSOSetInUse, const char * const ) ;
+gboolean zMapSOSetGetDataFromName(ZMapSOSetInUse, const char * const, unsigned int *, ZMapStyleMode *, ZMapHomolType *) ;
+gboolean zMapSOSetGetDataFromID(ZMapSOSetInUse, unsigned int, const char **, ZMapStyleMode *, ZMapHomolType *) ;
 ZMapSOIDData zMapSOIDDataCreate() ;
 ZMapSOIDData zMapSOIDDataCC(ZMapSOIDData) ;
 ZMapSOIDData zMapSOIDDataCreateFromData(unsigned int, const char * const, ZMapStyleMode , ZMapHomolType ) ;
@@ -62,8 +62,10 @@ typedef void (*ZMapThreadPollSlaveUserReplyFunc)(void *func_data) ;
     // why public ??
     static bool sourceCheck(ThreadSource &thread_source) ;
 
+    // pooled is false for sources that may block indefinitely, they get a thread of their own
+    // so that they can be cancelled.
     bool ThreadStart(ZMapThreadPollSlaveUserReplyFunc user_reply_func,
-                     void *user_reply_func_data) ;
+                     void *user_reply_func_data, bool pooled) ;
 
     bool SendRequest(void *request) ;
 
@@ -86,7 +88,7 @@ typedef void (*ZMapThreadPollSlaveUserReplyFunc)(void *func_data) ;
                  ZMapSlaveTerminateHandlerFunc terminate_handler_func,
                  ZMapSlaveDestroyHandlerFunc destroy_handler_func) ;
 
-    bool ThreadStart() ;
+    bool ThreadStart(bool pooled) ;
     //-------------------------------------------------------------
 
 
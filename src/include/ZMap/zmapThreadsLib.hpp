@@ -106,6 +106,39 @@ typedef struct _ZMapThreadStruct *ZMapThread ;
 typedef void *(*ZMapThreadCreateFunc)(void *func_data) ;
 
 
+/* Wakes the master thread's main loop when a slave sets a reply, an opaque private type.
+ * The func is called from the default main context, return FALSE to stop being called. */
+typedef struct ZMapThreadNotifyStructType *ZMapThreadNotify ;
+
+typedef gboolean (*ZMapThreadNotifyFunc)(void *func_data) ;
+
+
+/* A bounded pool of worker threads that run tasks in priority order, an opaque private type.
+ * Threads can be started "pooled" in which case their requests are run as pool tasks
+ * instead of in a pthread of their own. */
+typedef struct ZMapThreadPoolStructType *ZMapThreadPool ;
+
+typedef void (*ZMapThreadPoolTaskFunc)(void *task_data) ;
+
+enum class ZMapThreadPriority {LOW, NORMAL, HIGH, URGENT} ;
+
+typedef struct ZMapThreadPoolStatsStructType
+{
+  int max_workers ;
+  int num_workers ;                                         /* Workers started. */
+  int num_busy ;                                            /* Workers running a task. */
+  int queue_depth ;                                         /* Tasks waiting. */
+  int max_queue_depth ;                                     /* High water mark of queue_depth. */
+  unsigned long num_submitted ;
+  unsigned long num_completed ;
+} ZMapThreadPoolStatsStruct, *ZMapThreadPoolStats ;
+
+/* Slave side of a pooled thread: run one request (EXECUTE or TERMINATE) or clean up after
+ * the thread has been killed, both must finish by calling the slave's usual reply routines. */
+typedef void (*ZMapThreadPoolRequestFunc)(ZMapThread thread, ZMapThreadRequest request_type, void *request) ;
+typedef void (*ZMapThreadPoolKillFunc)(ZMapThread thread) ;
+
+
 
 //temp....
 char *zmapThreadGetDebugPrefix(ZMapThreadType caller_thread_type, ZMapThread caller_thread,
@@ -123,6 +156,10 @@ ZMapThread zMapThreadCreate(bool new_interface,
                             ZMapSlaveTerminateHandlerFunc terminate_handler_func,
                             ZMapSlaveDestroyHandlerFunc destroy_handler_func) ;
 bool zMapThreadStart(ZMapThread thread, ZMapThreadCreateFunc create_func) ;
+bool zMapThreadStartPooled(ZMapThread thread, ZMapThreadPool pool,
+                           ZMapThreadPoolRequestFunc request_func, ZMapThreadPoolKillFunc kill_func) ;
+void zMapThreadSetPriority(ZMapThread thread, ZMapThreadPriority priority) ;
+bool zMapThreadIsPooled(ZMapThread thread) ;
 
 bool zMapThreadRequest(ZMapThread thread, void *request) ;
 bool zMapThreadGetReply(ZMapThread thread, ZMapThreadReply *state) ;
@@ -139,6 +176,22 @@ bool zMapThreadStop(ZMapThread thread) ;
 void zMapThreadKill(ZMapThread thread) ;
 bool zMapThreadDestroy(ZMapThread thread) ;
 
+ZMapThreadNotify zMapThreadNotifyCreate(ZMapThreadNotifyFunc notify_func, void *notify_func_data) ;
+void zMapThreadNotifySignal(ZMapThreadNotify notify) ;
+void zMapThreadNotifyDestroy(ZMapThreadNotify notify) ;
+bool zMapThreadSetNotify(ZMapThread thread, ZMapThreadNotify notify) ;
+
+ZMapThreadPool zMapThreadPoolCreate(int max_workers) ;
+bool zMapThreadPoolSubmit(ZMapThreadPool pool, ZMapThreadPoolTaskFunc func, void *task_data,
+                          ZMapThreadPriority priority) ;
+int zMapThreadPoolCancel(ZMapThreadPool pool, ZMapThreadPoolTaskFunc func, void *task_data) ;
+void zMapThreadPoolSetSize(ZMapThreadPool pool, int max_workers) ;
+void zMapThreadPoolGetStats(ZMapThreadPool pool, ZMapThreadPoolStats stats_out) ;
+void zMapThreadPoolDestroy(ZMapThreadPool pool) ;
+ZMapThreadPool zMapThreadPoolGetDefault() ;
+void zMapThreadPoolSetDefaultSize(int max_workers) ;
+bool zMapThreadPoolInWorker() ;
+
 
 ZMAP_ENUM_AS_EXACT_STRING_DEC(zMapThreadRequest2ExactStr, ZMapThreadRequest) ;
 ZMAP_ENUM_AS_EXACT_STRING_DEC(zMapThreadReply2ExactStr, ZMapThreadReply) ;
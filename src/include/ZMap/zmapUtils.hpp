@@ -185,7 +185,7 @@ typedef struct
 gboolean zMapLogCreate(char *logname) ;
 gboolean zMapLogConfigure(gboolean logging, gboolean log_to_file,
 			  gboolean show_process, gboolean show_code, gboolean show_time,
-			  gboolean catch_glib, gboolean echo_glib,
+			  gboolean catch_glib, gboolean echo_glib, gboolean async,
                           char *logfile_path, GError **error) ;
 void zMapWriteStartMsg(void) ;
 void zMapWriteStopMsg(void) ;
@@ -257,6 +257,9 @@ gboolean zMapUtilsSpawnAsyncWithPipes(char *argv[], GIOFunc stdin_writer, GIOFun
 gboolean zMapLaunchWebBrowser(char *link, GError **error) ;
 
 char *zMapUtilsSysGetSysName(void) ;
+int zMapUtilsSysGetNumThreads(int num_items, int min_items_per_thread, int max_threads) ;
+int zMapUtilsSysReserveThreads(int num_threads) ;
+void zMapUtilsSysReleaseThreads(int num_threads) ;
 
 void zMapUtilsUserInit(void) ;
 gboolean zMapUtilsUserIsDeveloper(void) ;
@@ -634,6 +634,7 @@ PangoFontDescription *zMapWindowZoomGetFixedWidthFontInfo(ZMapWindow window,
 
 void zMapWindowGetVisible(ZMapWindow window, double *top_out, double *bottom_out) ;
 gboolean zMapWindowGetVisibleSeq(ZMapWindow window, FooCanvasItem *focus, int *top_out, int *bottom_out) ;
+gboolean zMapWindowGetVisibleSpan(ZMapWindow window, int *start_out, int *end_out) ;
 FooCanvasItem *zMapWindowFindFeatureItemByItem(ZMapWindow window, FooCanvasItem *item) ;
 
 void zMapWindowColumnList(ZMapWindow window) ;
@@ -631,7 +631,7 @@ static gboolean configureLog(char *config_file, char *config_dir, GError **error
     {
       GError *g_error = NULL ;
       ZMapConfigIniContext context ;
-      gboolean logging, log_to_file, show_process, show_code, show_time, catch_glib, echo_glib ;
+      gboolean logging, log_to_file, show_process, show_code, show_time, catch_glib, echo_glib, async ;
       char *log_name, *logfile_path = NULL ;
 
       /* ZMap's default values (as opposed to the logging packages...). */
@@ -642,6 +642,7 @@ static gboolean configureLog(char *config_file, char *config_dir, GError **error
       show_time = FALSE ;
       catch_glib = TRUE ;
       echo_glib = TRUE ;
+      async = FALSE ;
 
       /* if we run config free we use .ZMap, creating it if necessary */
       log_name = g_strdup(ZMAPLOG_FILENAME) ;
@@ -694,6 +695,12 @@ static gboolean configureLog(char *config_file, char *config_dir, GError **error
                                              ZMAPSTANZA_LOG_ECHO_GLIB, &tmp_bool))
             echo_glib = tmp_bool;
 
+          /* write the log from a separate thread so logging doesn't hold up the caller */
+          if (zMapConfigIniContextGetBoolean(context, ZMAPSTANZA_LOG_CONFIG,
+                                             ZMAPSTANZA_LOG_CONFIG,
+                                             ZMAPSTANZA_LOG_ASYNC, &tmp_bool))
+            async = tmp_bool;
+
           /* See if there is a user-specified directory to use for logfile path */
           if (zMapConfigIniContextGetFilePath(context, ZMAPSTANZA_LOG_CONFIG,
                                               ZMAPSTANZA_LOG_CONFIG,
@@ -764,7 +771,7 @@ static gboolean configureLog(char *config_file, char *config_dir, GError **error
         {
           result = zMapLogConfigure(logging, log_to_file,
                                     show_process, show_code, show_time,
-                                    catch_glib, echo_glib,
+                                    catch_glib, echo_glib, async,
                                     logfile_path, &g_error) ;
         }
 
@@ -1833,6 +1833,7 @@ static ZMapConfigIniContextKeyEntry get_app_group_data(const char **stanza_name,
     { ZMAPSTANZA_APP_HIGHLIGHT_FILTERED, G_TYPE_BOOLEAN, NULL, FALSE },
     { ZMAPSTANZA_APP_ENABLE_ANNOTATION,  G_TYPE_BOOLEAN, NULL, FALSE },
     { ZMAPSTANZA_APP_MAX_FEATURES,       G_TYPE_INT,     NULL, FALSE },
+    { ZMAPSTANZA_APP_THREAD_POOL,        G_TYPE_INT,     NULL, FALSE },
     {NULL}
   };
   static const char *name = ZMAPSTANZA_APP_CONFIG;
@@ -1890,6 +1891,7 @@ static ZMapConfigIniContextKeyEntry get_logging_group_data(const char **stanza_n
     { ZMAPSTANZA_LOG_FILENAME,     G_TYPE_STRING,  NULL, FALSE },
     { ZMAPSTANZA_LOG_CATCH_GLIB,   G_TYPE_BOOLEAN, NULL, FALSE },
     { ZMAPSTANZA_LOG_ECHO_GLIB,    G_TYPE_BOOLEAN, NULL, FALSE },
+    { ZMAPSTANZA_LOG_ASYNC,        G_TYPE_BOOLEAN, NULL, FALSE },
     {NULL}
   };
 
@@ -2318,6 +2320,9 @@ static ZMapConfigIniContextKeyEntry get_source_group_data(const char **stanza_na
     { ZMAPSTANZA_SOURCE_DELAYED,       G_TYPE_BOOLEAN, source_set_property, FALSE },
     { ZMAPSTANZA_SOURCE_MAPPING,       G_TYPE_BOOLEAN, source_set_property, FALSE },
     { ZMAPSTANZA_SOURCE_GROUP,           G_TYPE_STRING,  source_set_property, FALSE },
+    { ZMAPSTANZA_SOURCE_SUMMARY_BINS,  G_TYPE_INT,     source_set_property, FALSE },
+    { ZMAPSTANZA_SOURCE_COVERAGE,      G_TYPE_BOOLEAN, source_set_property, FALSE },
+    { ZMAPSTANZA_SOURCE_TILE_SIZE,     G_TYPE_INT,     source_set_property, FALSE },
     {NULL}
   };
 
@@ -2370,6 +2375,12 @@ gpointer parent_data, GValue *property_value)
         bool_ptr = &(config_source->delayed) ;
       else if (g_ascii_strcasecmp(key, ZMAPSTANZA_SOURCE_MAPPING) == 0)
         bool_ptr = &(config_source->provide_mapping) ;
+      else if (g_ascii_strcasecmp(key, ZMAPSTANZA_SOURCE_SUMMARY_BINS) == 0)
+        int_ptr = &(config_source->summary_bins) ;
+      else if (g_ascii_strcasecmp(key, ZMAPSTANZA_SOURCE_COVERAGE) == 0)
+        bool_ptr = &(config_source->coverage) ;
+      else if (g_ascii_strcasecmp(key, ZMAPSTANZA_SOURCE_TILE_SIZE) == 0)
+        int_ptr = &(config_source->tile_size) ;
       else if (g_ascii_strcasecmp(key, ZMAPSTANZA_SOURCE_GROUP) == 0)
         {
           const char *value = "";
@@ -101,7 +101,8 @@ namespace ZMapDataSource
   // Start polling, if this means we do too much polling we can have a function to start or do it
   // as part of the SendRequest....though that might induce some timing problems.
   //
-  if (!(thread_.ThreadStart(ReplyCallbackFunc, this)))
+  // Only local files are read in the pool, anything else may hang and must stay cancellable.
+  if (!(thread_.ThreadStart(ReplyCallbackFunc, this, (url_obj_->scheme == SCHEME_FILE))))
     throw runtime_error("Could not start slave polling.") ;
 
   state_ = DataSourceState::INIT ;
@@ -36,6 +36,7 @@
 #include <glib.h>
 
 #include <ZMap/zmapGLibUtils.hpp>
+#include <ZMap/zmapUrl.hpp>
 #include <ZMap/zmapServerProtocol.hpp>
 #include <ZMap/zmapThreadSource.hpp>
 
@@ -191,13 +192,25 @@ ZMapNewDataSource zMapServerCreateViewConnection(ZMapNewDataSource view_con,
       ZMapSlaveTerminateHandlerFunc terminate_handler_func = NULL ;
       ZMapSlaveDestroyHandlerFunc destroy_handler_func = NULL ;
       ThreadSource *new_thread = NULL ;
+      ZMapURL url ;
+      int url_parse_error ;
+      bool pooled = false ;
+
+      // Only local files are read in the worker pool, a request running in the pool can't be
+      // cancelled so network and pipe sources, which may hang, get a thread of their own.
+      if ((url = url_parse(server_url, &url_parse_error)))
+        {
+          pooled = (url->scheme == SCHEME_FILE) ;
+
+          url_free(url) ;
+        }
 
       // Create and start a new thread to fetch the data.
       zMapOldGetHandlers(&req_handler_func, &terminate_handler_func, &destroy_handler_func) ;
 
       new_thread = new ThreadSource(false, req_handler_func, terminate_handler_func, destroy_handler_func) ;
 
-      if (!(new_thread->ThreadStart()))
+      if (!(new_thread->ThreadStart(pooled)))
         {
           delete new_thread ;
         }
@@ -54,6 +54,10 @@
 // this but otherwise at the moment zmap will continue loading features until it falls over.
 #define ZMAP_MAX_FEATURES_HARD_LIMIT 1000000000
 
+// Number of features each thread reserves from the limit at a time, threads hold on to at most
+// twice this many unused.
+#define ZMAP_FEATURE_COUNT_BATCH 256
+
 
 /*
  * Some error types for use in the view
@@ -95,6 +99,9 @@ typedef struct
 } DataListLengthStruct, *DataListLength ;
 
 
+static ZMapFeature createEmptyFeature(ZMapFeatureSlab slab, GError **error) ;
+
+
 
 
 // 
@@ -108,33 +115,86 @@ typedef struct
  */
 
 
+// Per thread part of the count.
+struct ZMapFeatureCount::ThreadCount
+{
+  ThreadCount()
+    : unused(0), source(0), source_features(0), source_timer(NULL)
+  {
+    ZMapFeatureCount::instance().addThread(this) ;
+  }
+
+  ~ThreadCount()
+  {
+    ZMapFeatureCount::instance().removeThread(this) ;
+
+    if (source_timer)
+      g_timer_destroy(source_timer) ;
+  }
+
+  std::atomic<int> unused ;  // reserved but not yet used, only changed by the owning thread
+  GQuark source ;            // set by beginSource()
+  int source_features ;
+  GTimer *source_timer ;
+} ;
+
+
 // Constructor
 ZMapFeatureCount::ZMapFeatureCount()
   : max_features_(ZMAP_MAX_FEATURES_HARD_LIMIT),
-    loaded_features_(0)
+    reserved_features_(0),
+    threads_(NULL)
 {
 }
 
-// Increment/decrement operators change the number of loaded features
+// Increment/decrement operators change the number of loaded features, normally this just
+// changes the calling thread's reservation.
 void ZMapFeatureCount::operator++()
 {
-  mutex_.lock() ;
-  ++loaded_features_ ;
-  mutex_.unlock() ;
+  ThreadCount &thread_count = threadCount() ;
+  int unused = thread_count.unused.load(std::memory_order_relaxed) ;
+
+  if (unused > 0)
+    thread_count.unused.store(unused - 1, std::memory_order_relaxed) ;
+  else
+    reserved_features_.fetch_add(1, std::memory_order_relaxed) ;
+
+  if (thread_count.source)
+    thread_count.source_features++ ;
 }
 
 void ZMapFeatureCount::operator--()
 {
-  mutex_.lock() ;
-  --loaded_features_ ;
-  mutex_.unlock() ;
+  ThreadCount &thread_count = threadCount() ;
+  int unused = thread_count.unused.load(std::memory_order_relaxed) + 1 ;
+
+  // Don't hang on to more than we need.
+  if (unused > ZMAP_FEATURE_COUNT_BATCH * 2)
+    {
+      reserved_features_.fetch_sub(ZMAP_FEATURE_COUNT_BATCH, std::memory_order_relaxed) ;
+      unused -= ZMAP_FEATURE_COUNT_BATCH ;
+    }
+
+  thread_count.unused.store(unused, std::memory_order_relaxed) ;
 }
 
 
 // Get the number of loaded features
-int ZMapFeatureCount::getCount() const
+int ZMapFeatureCount::getCount()
 {
-  return loaded_features_ ;
+  int count ;
+  GList *l ;
+
+  mutex_.lock() ;
+
+  count = reserved_features_.load(std::memory_order_relaxed) ;
+
+  for (l = threads_ ; l ; l = l->next)
+    count -= ((ThreadCount *)(l->data))->unused.load(std::memory_order_relaxed) ;
+
+  mutex_.unlock() ;
+
+  return count ;
 }
 
 // Get the limit
@@ -146,9 +206,7 @@ int ZMapFeatureCount::getLimit() const
 // Set the limit
 void ZMapFeatureCount::setLimit(const int max_features)
 {
-  mutex_.lock() ;
   max_features_ = max_features ;
-  mutex_.unlock() ;
 }
 
 
@@ -156,21 +214,135 @@ void ZMapFeatureCount::setLimit(const int max_features)
 bool ZMapFeatureCount::hitLimit(GError **error) 
 {
   bool result = false ;
+  ThreadCount &thread_count = threadCount() ;
 
-  mutex_.lock() ;
-  result = loaded_features_ >= max_features_ ;
+  if (thread_count.unused.load(std::memory_order_relaxed) <= 0 && !reserve(thread_count))
+    {
+      result = true ;
 
-  if (result && error)
+      if (error)
+        g_set_error(error, ZMAP_FEATURE_ERROR, ZMAPFEATURE_ERROR_FEATURE_LIMIT,
+                    "Exceeded maximum number of features (%d)! Further features will not be loaded until some are removed first.", 
+                    max_features_.load()) ;
+    }
+
+  return result ;
+}
+
+
+// Start counting features created by this thread against source_name.
+void ZMapFeatureCount::beginSource(const char *source_name)
+{
+  ThreadCount &thread_count = threadCount() ;
+
+  if (thread_count.source)
+    endSource() ;
+
+  thread_count.source = g_quark_from_string(source_name) ;
+  thread_count.source_features = 0 ;
+
+  if (thread_count.source_timer)
+    g_timer_start(thread_count.source_timer) ;
+  else
+    thread_count.source_timer = g_timer_new() ;
+}
+
+// Add this thread's counts to its source's stats.
+void ZMapFeatureCount::endSource()
+{
+  ThreadCount &thread_count = threadCount() ;
+
+  if (thread_count.source)
     {
-      g_set_error(error, ZMAP_FEATURE_ERROR, ZMAPFEATURE_ERROR_FEATURE_LIMIT,
-                  "Exceeded maximum number of features (%d)! Further features will not be loaded until some are removed first.", 
-                  max_features_) ;
+      double secs = g_timer_elapsed(thread_count.source_timer, NULL) ;
+
+      mutex_.lock() ;
+
+      SourceStats &stats = source_stats_[thread_count.source] ;
+      stats.num_features += thread_count.source_features ;
+      stats.secs += secs ;
+
+      mutex_.unlock() ;
+
+      thread_count.source = 0 ;
+      thread_count.source_features = 0 ;
     }
+}
 
+// Returns a copy of the stats for all sources so far.
+std::map<GQuark, ZMapFeatureCount::SourceStats> ZMapFeatureCount::getSourceStats()
+{
+  std::map<GQuark, SourceStats> source_stats ;
+
+  mutex_.lock() ;
+  source_stats = source_stats_ ;
   mutex_.unlock() ;
+
+  return source_stats ;
+}
+
+
+// Returns the calling thread's count, which is created on first use and handed back when the
+// thread exits.
+ZMapFeatureCount::ThreadCount &ZMapFeatureCount::threadCount()
+{
+  static thread_local ThreadCount thread_count ;
+
+  return thread_count ;
+}
+
+// Reserve the next batch for the thread, the batch gets smaller as we near the limit so one
+// thread can't hold on to the last of the features. Returns false if there are none left.
+bool ZMapFeatureCount::reserve(ThreadCount &thread_count)
+{
+  bool result = false ;
+  int reserved = reserved_features_.load(std::memory_order_relaxed) ;
+  int available, batch = 0 ;
+
+  do
+    {
+      if ((available = max_features_.load(std::memory_order_relaxed) - reserved) <= 0)
+        break ;
+
+      batch = MIN(ZMAP_FEATURE_COUNT_BATCH, MAX(1, available / 16)) ;
+    } while (!reserved_features_.compare_exchange_weak(reserved, reserved + batch, std::memory_order_relaxed)) ;
+
+  if (available > 0)
+    {
+      thread_count.unused.fetch_add(batch, std::memory_order_relaxed) ;
+      result = true ;
+    }
+
   return result ;
 }
 
+void ZMapFeatureCount::addThread(ThreadCount *thread_count)
+{
+  mutex_.lock() ;
+  threads_ = g_list_prepend(threads_, thread_count) ;
+  mutex_.unlock() ;
+}
+
+// Called as a thread exits, hands back what it had reserved.
+void ZMapFeatureCount::removeThread(ThreadCount *thread_count)
+{
+  mutex_.lock() ;
+
+  if (thread_count->source)
+    {
+      SourceStats &stats = source_stats_[thread_count->source] ;
+      stats.num_features += thread_count->source_features ;
+      stats.secs += g_timer_elapsed(thread_count->source_timer, NULL) ;
+    }
+
+  reserved_features_.fetch_sub(thread_count->unused.load(std::memory_order_relaxed), std::memory_order_relaxed) ;
+  thread_count->unused = 0 ;
+
+  threads_ = g_list_remove(threads_, thread_count) ;
+
+  mutex_.unlock() ;
+}
+
 
 
 
@@ -203,24 +375,21 @@ bool zMapFeatureErrorIsFatal(GError **error)
 /* Returns a single feature correctly initialised to be a "NULL" feature. */
 ZMapFeature zMapFeatureCreateEmpty(GError **error)
 {
-  ZMapFeature feature = NULL ;
+  return createEmptyFeature(NULL, error) ;
+}
 
-  if (!ZMapFeatureCount::instance().hitLimit(error))
-    {
-      feature = (ZMapFeature)zmapFeatureAnyCreateFeature(ZMAPFEATURE_STRUCT_FEATURE, NULL,
-                                                         ZMAPFEATURE_NULLQUARK, ZMAPFEATURE_NULLQUARK,
-                                                         NULL) ;
 
-      ++ZMapFeatureCount::instance() ;
-    }
+/* As zMapFeatureCreateEmpty() but the feature is allocated from the featureset's slab, use
+ * this when loading large numbers of features into a set. The feature is not added to the
+ * set, it can be added to any set. */
+ZMapFeature zMapFeatureCreateEmptyFromSet(ZMapFeatureSet feature_set, GError **error)
+{
+  zMapReturnValIfFail(feature_set, NULL) ;
 
-  if (feature)
-    {
-      feature->db_id = ZMAPFEATUREID_NULL ;
-      feature->mode = ZMAPSTYLE_MODE_INVALID ;
-    }
+  if (!feature_set->slab)
+    feature_set->slab = zmapFeatureSlabCreate() ;
 
-  return feature ;
+  return createEmptyFeature(feature_set->slab, error) ;
 }
 
 
@@ -687,6 +856,31 @@ void zmapFeatureBasicDestroyFeature(ZMapFeature feature)
 
 
 
+/* Allocate a "NULL" feature, from the slab if there is one. */
+static ZMapFeature createEmptyFeature(ZMapFeatureSlab slab, GError **error)
+{
+  ZMapFeature feature = NULL ;
+
+  if (!ZMapFeatureCount::instance().hitLimit(error))
+    {
+      feature = (ZMapFeature)zmapFeatureAnyCreateFeature(ZMAPFEATURE_STRUCT_FEATURE, NULL,
+                                                         ZMAPFEATURE_NULLQUARK, ZMAPFEATURE_NULLQUARK,
+                                                         NULL, slab) ;
+
+      if (feature)
+        ++ZMapFeatureCount::instance() ;
+    }
+
+  if (feature)
+    {
+      feature->db_id = ZMAPFEATUREID_NULL ;
+      feature->mode = ZMAPSTYLE_MODE_INVALID ;
+    }
+
+  return feature ;
+}
+
+
 /* A GHashTableForeachFunc() to add a mode to the styles for all features in a set, note that
  * this is not efficient as we go through all features but we would need more information
  * stored in the feature set to avoid this as there may be several different types of
@@ -857,6 +1051,9 @@ ZMapFeatureSet zMapFeatureSetShallowCopy(ZMapFeatureSet src)
   ZMapFeatureSet dest = NULL;
   zMapReturnValIfFail(src, dest) ;
 
+  /* The features are shared so must be put the right way round for both sets. */
+  zMapFeatureSetRevCompResolve(src) ;
+
   dest = zMapFeatureSetIDCreate(src->original_id, src->unique_id, src->style, src->features, src->source) ;
 
 #ifdef FEATURES_NEED_MAGIC
@@ -865,6 +1062,7 @@ ZMapFeatureSet zMapFeatureSetShallowCopy(ZMapFeatureSet src)
 
   dest->parent = src->parent ;
   dest->description = src->description ;
+  dest->masker_sorted_n_features = src->masker_sorted_n_features ;
   dest->masker_sorted_features = src->masker_sorted_features ;
   dest->loaded = src->loaded;
 
@@ -344,10 +344,11 @@ static gboolean feature3FrameTranslationPopulate(ZMapFeatureSet feature_set, ZMa
 {
   gboolean result = FALSE ;
   ZMapFeatureBlock feature_block;
+  char *dna = NULL ;
 
   feature_block = (ZMapFeatureBlock)zMapFeatureGetParentGroup((ZMapFeatureAny)feature_set, ZMAPFEATURE_STRUCT_BLOCK) ;
 
-  if ((feature_block->sequence.sequence))
+  if (zMapFeatureBlockDNA(feature_block, NULL, NULL, &dna))
     {
       char *sequence_name;
 
@@ -357,9 +358,11 @@ static gboolean feature3FrameTranslationPopulate(ZMapFeatureSet feature_set, ZMa
                                feature_set,
                                style,
                                sequence_name,
-                               feature_block->sequence.sequence,
+                               dna,
                                block_start, block_end) ;
 
+      g_free(dna) ;
+
       result = TRUE ;
     }
 
@@ -502,10 +505,11 @@ static gboolean showTranslationPopulate(ZMapFeatureSet feature_set, ZMapFeatureT
 {
   gboolean result = FALSE ;
   ZMapFeatureBlock feature_block ;
+  char *dna = NULL ;
 
   feature_block = (ZMapFeatureBlock)zMapFeatureGetParentGroup((ZMapFeatureAny)feature_set, ZMAPFEATURE_STRUCT_BLOCK) ;
 
-  if ((feature_block->sequence.sequence))
+  if (zMapFeatureBlockDNA(feature_block, NULL, NULL, &dna))
     {
       char *sequence_name;
 
@@ -515,9 +519,11 @@ static gboolean showTranslationPopulate(ZMapFeatureSet feature_set, ZMapFeatureT
                           feature_set,
                           style,
                           sequence_name,
-                          feature_block->sequence.sequence,
+                          dna,
                           block_start, block_end) ;
 
+      g_free(dna) ;
+
       result = TRUE ;
     }
 
@@ -226,6 +226,9 @@ static const char *operators_cigar_ensembl   = "MID" ;
 static const char *operators_gffv3_gap       = "MID" ;
 static const char *operators_cigar_bam       = "MIDN" ;
 
+/* BAM packed cigar op codes index into this (as htslib's BAM_CIGAR_STR). */
+static const char *operators_bam_packed      = "MIDNSHP=X" ;
+
 
 
 
@@ -464,6 +467,79 @@ gboolean zMapFeatureAlignmentString2Gaps(ZMapFeatureAlignFormat align_format,
 }
 
 
+/* Constructs a gaps array directly from the packed operators of a BAM record (as returned
+ * by htslib's bam_get_cigar()), i.e. each operator is (length << 4 | op_code). This gives
+ * the same result as formatting the operators as a ZMAPALIGN_FORMAT_CIGAR_BAM string and
+ * calling zMapFeatureAlignmentString2Gaps() but without the text round trip which is
+ * significant when loading deep BAM regions.
+ *
+ * Returns TRUE on success with the gaps array returned in gaps_out. The array
+ * should be free'd with g_array_free when finished with.
+ */
+gboolean zMapFeatureAlignmentBAMCigar2Gaps(ZMapStrand ref_strand, int ref_start, int ref_end,
+                                           ZMapStrand match_strand, int match_start, int match_end,
+                                           const guint32 *cigar, int n_cigar, GArray **align_out)
+{
+  gboolean result = FALSE ;
+  AlignStrCanonical canon = NULL ;
+  GArray *align = NULL ;
+  GError *error = NULL ;
+  const guint32 n_op_codes = (guint32)strlen(operators_bam_packed) ;
+  int i ;
+
+  zMapReturnValIfFail(cigar && n_cigar > 0 && align_out, result) ;
+
+  canon = alignStrCanonicalCreate(ZMAPALIGN_FORMAT_CIGAR_BAM) ;
+
+  /* Same conversions as bamCigar2Canon(): X (and =, which the string parser can't see)
+   * become M, operators we can't represent (S, H, P) are dropped. */
+  for (i = 0 ; i < n_cigar ; i++)
+    {
+      guint32 op_code = cigar[i] & 0xf ;
+      AlignStrOpStruct align_op ;
+
+      if (op_code >= n_op_codes)
+        {
+          zMapLogWarning("Invalid BAM cigar operator code %u", op_code) ;
+          continue ;
+        }
+
+      align_op.op = operators_bam_packed[op_code] ;
+      align_op.first_length = (int)(cigar[i] >> 4) ;
+      align_op.second_length = 0 ;
+
+      if (align_op.op == 'X' || align_op.op == '=')
+        align_op.op = 'M' ;
+
+      if (strchr(operators_cigar_bam, align_op.op))
+        alignStrCanonicalAddOperator(canon, &align_op) ;
+    }
+
+  /* Even numbers of operators are tolerated as for strings, see alignStrMakeCanonical(). */
+  if (!parse_canon_valid(canon, &error)
+      && g_ascii_strcasecmp(error->message, ALIGN_EVEN_OPERATORS) != 0)
+    {
+      zMapLogWarning("Error processing BAM cigar: %s", error->message) ;
+    }
+  else if (!(result = alignStrCigarCanon2Homol(canon, ref_strand, match_strand,
+                                               ref_start, ref_end,
+                                               match_start, match_end,
+                                               &align)))
+    {
+      zMapLogWarning("%s", "Cannot convert BAM cigar to align array") ;
+    }
+
+  if (error)
+    g_error_free(error) ;
+
+  alignStrCanonicalDestroy(&canon) ;
+
+  *align_out = (result ? align : NULL) ;
+
+  return result ;
+}
+
+
 /* Constructs an exons array and also an array of aligns arrays for each exon
  * from a VULGAR string (no other alignment strings are currently supported).
  * 
@@ -37,6 +37,7 @@
 
 #include <string.h>
 #include <glib.h>
+#include <ZMap/zmapDNA.hpp>
 
 #include <zmapFeature_P.hpp>
 
@@ -59,6 +60,7 @@ typedef struct _FeatureSearchStruct
 static void destroyContextSubparts(ZMapFeatureContext context) ;
 static void destroyFeature(ZMapFeature feature) ;
 static void destroyFeatureAnyShallow(gpointer data) ;
+static void freeFeatureAnyStruct(ZMapFeatureAny feature_any, gulong nbytes) ;
 static gboolean withdrawFeatureAny(gpointer key, gpointer value, gpointer user_data) ;
 
 static void logMemCalls(gboolean alloc, ZMapFeatureAny feature_any) ;
@@ -135,8 +137,15 @@ ZMapFeatureAny zMapFeatureParentGetFeatureByID(ZMapFeatureAny feature_parent, GQ
   ZMapFeatureAny feature = NULL ;
   zMapReturnValIfFail(feature_parent, feature) ;
 
+  /* The feature, or the features of a set, must be the right way round for our caller. */
+  if (feature_parent->struct_type == ZMAPFEATURE_STRUCT_FEATURESET)
+    zMapFeatureSetRevCompResolve((ZMapFeatureSet)feature_parent) ;
+
   feature = (ZMapFeatureAny)g_hash_table_lookup(feature_parent->children, GINT_TO_POINTER(feature_id)) ;
 
+  if (feature && feature->struct_type == ZMAPFEATURE_STRUCT_FEATURESET)
+    zMapFeatureSetRevCompResolve((ZMapFeatureSet)feature) ;
+
   return feature ;
 }
 
@@ -174,6 +183,9 @@ gboolean zMapFeatureAnyRemoveFeature(ZMapFeatureAny feature_parent, ZMapFeatureA
       result = g_hash_table_steal(feature_parent->children, zmapFeature2HashKey(feature)) ;
       feature->parent = NULL;
 
+      if (feature_parent->struct_type == ZMAPFEATURE_STRUCT_FEATURESET)
+        zMapFeatureSetIndexInvalidate((ZMapFeatureSet)feature_parent) ;
+
       switch(feature->struct_type)
         {
         case ZMAPFEATURE_STRUCT_CONTEXT:
@@ -255,6 +267,10 @@ gboolean zmapFeatureAnyAddFeature(ZMapFeatureAny feature_any, ZMapFeatureAny fea
 {
   gboolean result = FALSE ;
 
+  /* A new feature is the right way round so the set's features must be too. */
+  if (feature_any->struct_type == ZMAPFEATURE_STRUCT_FEATURESET)
+    zMapFeatureSetRevCompResolve((ZMapFeatureSet)feature_any) ;
+
   if (!zMapFeatureAnyFindFeature(feature_any, feature))
     {
       g_hash_table_insert(feature_any->children, zmapFeature2HashKey(feature), feature) ;
@@ -272,6 +288,8 @@ gboolean zmapFeatureAnyAddFeature(ZMapFeatureAny feature_any, ZMapFeatureAny fea
         ZMapFeature feat = (ZMapFeature) feature;
         ZMapFeatureSet feature_set = (ZMapFeatureSet) feature_any;
         feat->style = & feature_set->style;
+
+        zMapFeatureSetIndexInvalidate(feature_set) ;
         }
 
       result = TRUE ;
@@ -291,11 +309,12 @@ void zmapFeatureAnyAddToDestroyList(ZMapFeatureContext context, ZMapFeatureAny f
 }
 
 
-/* Allocate a feature structure of the requested type, filling in the feature any fields. */
+/* Allocate a feature structure of the requested type, filling in the feature any fields.
+ * If slab is given features are allocated from it. */
 ZMapFeatureAny zmapFeatureAnyCreateFeature(ZMapFeatureLevelType struct_type,
                                            ZMapFeatureAny parent,
                                            GQuark original_id, GQuark unique_id,
-                                           GHashTable *children)
+                                           GHashTable *children, ZMapFeatureSlab slab)
 {
   ZMapFeatureAny feature_any = NULL ;
   gulong nbytes = 0 ;
@@ -324,7 +343,12 @@ ZMapFeatureAny zmapFeatureAnyCreateFeature(ZMapFeatureLevelType struct_type,
 
   if (nbytes > 0)
     {
-      if (USE_SLICE_ALLOC)
+      if (slab && struct_type == ZMAPFEATURE_STRUCT_FEATURE)
+        {
+          if (!(feature_any = (ZMapFeatureAny)zmapFeatureSlabAlloc(slab)))
+            return feature_any ;
+        }
+      else if (USE_SLICE_ALLOC)
         feature_any = (ZMapFeatureAny)g_slice_alloc0(nbytes) ;
       else
         feature_any = (ZMapFeatureAny)g_malloc0(nbytes) ;
@@ -371,6 +395,11 @@ ZMapFeatureAny zmapFeatureAnyCopy(ZMapFeatureAny orig_feature_any, GDestroyNotif
 
   guint bytes = 0 ;
 
+  /* Copy the feature the right way round. */
+  if (orig_feature_any->struct_type == ZMAPFEATURE_STRUCT_FEATURE
+      && orig_feature_any->parent && orig_feature_any->parent->struct_type == ZMAPFEATURE_STRUCT_FEATURESET)
+    zMapFeatureSetRevCompResolve((ZMapFeatureSet)(orig_feature_any->parent)) ;
+
   /* Copy the original struct and set common fields. */
   switch(orig_feature_any->struct_type)
     {
@@ -442,6 +471,7 @@ ZMapFeatureAny zmapFeatureAnyCopy(ZMapFeatureAny orig_feature_any, GDestroyNotif
         new_block->sequence.type = ZMAPSEQUENCE_NONE ;
         new_block->sequence.length = 0 ;
         new_block->sequence.sequence = NULL ;
+        new_block->packed_dna = NULL ;
 
         break;
       }
@@ -466,6 +496,19 @@ ZMapFeatureAny zmapFeatureAnyCopy(ZMapFeatureAny orig_feature_any, GDestroyNotif
 
         new_set->loaded = copy_list;
 
+        /* The index refers to the original's features. */
+        new_set->index = NULL ;
+
+        /* The copy's features are not allocated from the original's slab. */
+        new_set->slab = NULL ;
+
+        /* The masker lists are of the original's features. */
+        new_set->masker_sorted_features = NULL ;
+        new_set->masker_sorted_n_features = 0 ;
+
+        /* The copy has no features yet, any added will be the right way round. */
+        new_set->revcomp_pending = FALSE ;
+
         break;
       }
     case ZMAPFEATURE_STRUCT_FEATURE:
@@ -473,6 +516,8 @@ ZMapFeatureAny zmapFeatureAnyCopy(ZMapFeatureAny orig_feature_any, GDestroyNotif
         ZMapFeature new_feature = (ZMapFeature)new_feature_any,
           orig_feature = (ZMapFeature)orig_feature_any ;
 
+        new_feature->flags.slab_alloc = FALSE ;
+
         zmapFeatureBasicCopyFeature(orig_feature, new_feature) ;
 
         if (new_feature->mode == ZMAPSTYLE_MODE_ALIGNMENT)
@@ -523,6 +568,7 @@ void zmapDestroyFeatureAny(gpointer data)
       nbytes = sizeof(ZMapFeatureAlignmentStruct) ;
       break ;
     case ZMAPFEATURE_STRUCT_BLOCK:
+      zMapPackedDNAUnref(((ZMapFeatureBlock)feature_any)->packed_dna) ;
       nbytes = sizeof(ZMapFeatureBlockStruct) ;
       break ;
     case ZMAPFEATURE_STRUCT_FEATURESET:
@@ -530,9 +576,9 @@ void zmapDestroyFeatureAny(gpointer data)
         ZMapFeatureSet feature_set = (ZMapFeatureSet) feature_any;
         GList *l;
 
-        if(feature_set->masker_sorted_features)
-          g_list_free(feature_set->masker_sorted_features);
-        feature_set->masker_sorted_features = NULL;
+        zMapFeatureSetMaskerFree(feature_set) ;
+
+        zMapFeatureSetIndexInvalidate(feature_set) ;
 
         if(feature_set->loaded)
           {
@@ -563,22 +609,15 @@ void zmapDestroyFeatureAny(gpointer data)
       g_hash_table_destroy(feature_any->children) ;
     }
 
+  /* The set's features have gone so the slab can go too unless some features have been
+   * merged into other sets. */
+  if (feature_any->struct_type == ZMAPFEATURE_STRUCT_FEATURESET && ((ZMapFeatureSet)feature_any)->slab)
+    zmapFeatureSlabUnref(((ZMapFeatureSet)feature_any)->slab) ;
 
-  logMemCalls(FALSE, feature_any) ;
 
-  /* nbytes is zero if we were given an invalid struct type - shouldn't
-   * happen but check anyway */
-  if (nbytes)
-    {
-      memset(feature_any, 0, nbytes) ;    /* Make sure mem for struct is useless. */
-      if (USE_SLICE_ALLOC)
-        g_slice_free1(nbytes, feature_any) ;
-    }
+  logMemCalls(FALSE, feature_any) ;
 
-  if (!USE_SLICE_ALLOC)
-    {
-      g_free(feature_any) ;
-    }
+  freeFeatureAnyStruct(feature_any, nbytes) ;
 
   return ;
 }
@@ -599,6 +638,9 @@ gboolean zmapDestroyFeatureAnyWithChildren(ZMapFeatureAny feature_any, gboolean
     {
       /* splice out the feature_any from parent */
       result = g_hash_table_steal(feature_any->parent->children, zmapFeature2HashKey(feature_any)) ;
+
+      if (feature_any->parent->struct_type == ZMAPFEATURE_STRUCT_FEATURESET)
+        zMapFeatureSetIndexInvalidate((ZMapFeatureSet)(feature_any->parent)) ;
     }
 
   /* If we have children but they should not be freed, then remove them before destroying the
@@ -708,16 +750,33 @@ static void destroyFeatureAnyShallow(gpointer data)
 
   logMemCalls(FALSE, feature_any) ;
 
+  freeFeatureAnyStruct(feature_any, nbytes) ;
+
+  return ;
+}
+
+
+/* Free the struct itself, the struct's resources must already have been freed. */
+static void freeFeatureAnyStruct(ZMapFeatureAny feature_any, gulong nbytes)
+{
+  gboolean slab_alloc = FALSE ;
+
+  if (feature_any->struct_type == ZMAPFEATURE_STRUCT_FEATURE)
+    slab_alloc = ((ZMapFeature)feature_any)->flags.slab_alloc ;
+
   /* nbytes is zero if we were given an invalid struct type - shouldn't
    * happen but check anyway */
   if (nbytes)
     {
       memset(feature_any, 0, nbytes) ;    /* Make sure mem for struct is useless. */
-      if (USE_SLICE_ALLOC)
+
+      if (slab_alloc)
+        zmapFeatureSlabFree((ZMapFeature)feature_any) ;
+      else if (USE_SLICE_ALLOC)
         g_slice_free1(nbytes, feature_any) ;
     }
 
-  if (!USE_SLICE_ALLOC)
+  if (!USE_SLICE_ALLOC && !slab_alloc)
     {
       g_free(feature_any) ;
     }
@@ -1,4 +1,4 @@
-/*  File: zmapViewFeatureCollapse.c
+/*  File: zmapFeatureCollapse.cpp
  *  Author: Malcolm Hinsley (mh17@sanger.ac.uk)
  *  Copyright (c) 2006-2017: Genome Research Ltd.
  *-------------------------------------------------------------------
@@ -27,6 +27,15 @@
  *                NOTE see BAM.html
  *                sets flags in the context per feature to say  collapsed or not
  *
+ *                This is done by the source's thread on the context it has
+ *                just loaded, before it is merged into the view, so the
+ *                main thread never sees uncollapsed data. Featuresets are
+ *                shared out between threads, each one only ever changes
+ *                the featureset it is given. Sets that will be masked
+ *                are sorted for masking at the same time, see
+ *                zmapFeatureMask.cpp.
+ *
+ * Exported functions: See ZMap/zmapFeature.hpp
  *-------------------------------------------------------------------
  */
 
@@ -35,10 +44,11 @@
 #include <stdio.h>
 #include <string.h>
 #include <glib.h>
+#include <vector>
 
 #include <ZMap/zmapGLibUtils.hpp>
 #include <ZMap/zmapUtils.hpp>
-#include <zmapView_P.hpp>
+#include <zmapFeature_P.hpp>
 
 
 
@@ -78,10 +88,16 @@
 #define MAX_WOBBLE	4	/* unlucky mismatched bases 1 chance in 16 */
 
 
+/* Below this many features it's not worth starting threads. */
+#define POSTPROCESS_MIN_THREADED_FEATURES 20000
+
 
 
-static ZMapFeatureContextExecuteStatus collapseNewFeatureset(GQuark key, gpointer data, gpointer user_data,
-							     char **error_out);
+static ZMapFeatureContextExecuteStatus getPostProcessSetsCB(GQuark key, gpointer data, gpointer user_data,
+							    char **error_out) ;
+static void postProcessFeatureSetCB(gpointer data, gpointer user_data_unused) ;
+static gboolean getCollapseOptions(ZMapFeatureTypeStyle style, gboolean *squash, gboolean *collapse, int *join) ;
+static void collapseFeatureSet(ZMapFeatureSet feature_set) ;
 static int makeConcensusSequence(ZMapFeature composite) ;
 static void addCompositeFeature(GHashTable *ghash, ZMapFeature composite, ZMapFeature feature,
 				int y1, int y2, int len) ;
@@ -102,17 +118,29 @@ static void dumpFeaturesCB(gpointer data, gpointer user_data_unused) ;
 
 
 
-/* collapse squash and join simple reads into composite features where these overlap meaningfully */
-gboolean zMapViewCollapseFeatureSets(ZMapView view, ZMapFeatureContext diff_context)
+/* Run by the source's thread on a newly loaded context: collapse, squash and join simple reads
+ * into composite features where these overlap meaningfully and sort featuresets that will be
+ * masked ready for zmapView, both as configured by the featuresets' styles. */
+void zMapFeatureContextPostProcess(ZMapFeatureContext context)
 {
-  gboolean result = TRUE ;
+  GList *feature_sets = NULL ;
 
-  zMapFeatureContextExecute((ZMapFeatureAny) diff_context,
+  zMapReturnIfFail(context) ;
+
+  zMapFeatureContextExecute((ZMapFeatureAny)context,
 			    ZMAPFEATURE_STRUCT_FEATURESET,
-			    collapseNewFeatureset,
-			    NULL) ;
+			    getPostProcessSetsCB,
+			    &feature_sets) ;
 
-  return result ;
+  if (feature_sets)
+    {
+      zmapFeatureSetsForEachThreaded(feature_sets, POSTPROCESS_MIN_THREADED_FEATURES,
+                                     postProcessFeatureSetCB, NULL) ;
+
+      g_list_free(feature_sets) ;
+    }
+
+  return ;
 }
 
 
@@ -133,98 +161,115 @@ So i guess this means that the match starts on the 5th base in the sequence at g
 
 
 
-// collaspe similar features into one
-static ZMapFeatureContextExecuteStatus collapseNewFeatureset(GQuark key,
-							     gpointer data,
-							     gpointer user_data,
-							     char **error_out)
+/* Collects the featuresets that need collapsing or masking. */
+static ZMapFeatureContextExecuteStatus getPostProcessSetsCB(GQuark key,
+							    gpointer data,
+							    gpointer user_data,
+							    char **error_out)
 {
-  ZMapFeatureAny feature_any = (ZMapFeatureAny)data;
-  ZMapFeatureContextExecuteStatus status = ZMAP_CONTEXT_EXEC_STATUS_OK;
+  ZMapFeatureAny feature_any = (ZMapFeatureAny)data ;
+  GList **feature_sets = (GList **)user_data ;
+  ZMapFeatureContextExecuteStatus status = ZMAP_CONTEXT_EXEC_STATUS_OK ;
 
-  ZMapFeatureTypeStyle style;
-  GList *features = NULL, *fl;
+  if (feature_any->struct_type == ZMAPFEATURE_STRUCT_FEATURESET)
+    {
+      ZMapFeatureSet feature_set = (ZMapFeatureSet)feature_any ;
+      gboolean squash, collapse ;
+      int join ;
+
+      if (feature_set->style
+          && (getCollapseOptions(feature_set->style, &squash, &collapse, &join)
+              || zMapStyleGetMaskList(feature_set->style)))
+        *feature_sets = g_list_prepend(*feature_sets, feature_set) ;
+    }
 
-  zMapReturnValIfFail((feature_any && zMapFeatureIsValid(feature_any)), ZMAP_CONTEXT_EXEC_STATUS_ERROR) ;
+  return status ;
+}
 
-  switch(feature_any->struct_type)
-    {
-    case ZMAPFEATURE_STRUCT_ALIGN:
-      {
-        break;
-      }
 
-    case ZMAPFEATURE_STRUCT_BLOCK:
-      {
-        break;
-      }
+/* A GFunc() run by zmapFeatureSetsForEachThreaded(), possibly in parallel with other sets. */
+static void postProcessFeatureSetCB(gpointer data, gpointer user_data_unused)
+{
+  ZMapFeatureSet feature_set = (ZMapFeatureSet)data ;
 
-    case ZMAPFEATURE_STRUCT_FEATURESET:
-      {
-	ZMapFeatureSet feature_set = NULL;
-	gboolean collapse, squash;
-	int join;
+  collapseFeatureSet(feature_set) ;
 
-	feature_set = (ZMapFeatureSet)feature_any;
-	style = feature_set->style;
+  /* After collapsing so composite features are included. */
+  if (zMapStyleGetMaskList(feature_set->style))
+    zMapFeatureSetMaskerSort(feature_set) ;
+
+  return ;
+}
 
-	if(!style || zMapStyleGetMode(style) != ZMAPSTYLE_MODE_ALIGNMENT)
-	  break;
 
-	squash = zMapStyleIsSquash(style);
-	join =  zMapStyleJoinOverlap(style);
-	collapse = join ? FALSE : zMapStyleIsCollapse(style);
+/* Returns TRUE if the style asks for any of squash, collapse or join. */
+static gboolean getCollapseOptions(ZMapFeatureTypeStyle style, gboolean *squash, gboolean *collapse, int *join)
+{
+  gboolean result = FALSE ;
+
+  if (style && zMapStyleGetMode(style) == ZMAPSTYLE_MODE_ALIGNMENT)
+    {
+      *squash = zMapStyleIsSquash(style);
+      *join =  zMapStyleJoinOverlap(style);
+      *collapse = *join ? FALSE : zMapStyleIsCollapse(style);
 
 #if SQUASH_DEBUG
-	zMapLogMessage("join squash collapse: %d %d %d\n",join,squash,collapse);
+      zMapLogMessage("join squash collapse: %d %d %d\n",*join,*squash,*collapse);
 #endif
 
-	if(!collapse && !squash && !join)
-	  break;
+      result = (*collapse || *squash || *join) ;
+    }
 
+  return result ;
+}
 
-	zMapLogMessage("NEW FEATURE SET: \"%s\"", g_quark_to_string(feature_set->original_id)) ;
 
+// collaspe similar features into one
+static void collapseFeatureSet(ZMapFeatureSet feature_set)
+{
+  GList *features = NULL, *fl;
+  gboolean collapse, squash;
+  int join;
 
-	zMap_g_hash_table_get_data(&features, feature_set->features) ;
+  if (!getCollapseOptions(feature_set->style, &squash, &collapse, &join))
+    return ;
 
-	features = fl = g_list_sort(features, featureGapCompare) ;
-	/* debug...check the sorting..... */
-	zMapLogMessage("%s", "After sort by featureGapCompare") ;
-	g_list_foreach(features, dumpFeaturesCB, NULL) ;
 
+  zMapLogMessage("NEW FEATURE SET: \"%s\"", g_quark_to_string(feature_set->original_id)) ;
 
+  zMapFeatureSetRevCompResolve(feature_set) ;
 
-	/*
-	 * features are sorted first by strand so we do the compositing in two stages
-	 * not two passes: one scan of the data with a break at half time
-	 * each part does squash first to get splice coordinates, then join and/or collapse
-	 */
 
-	/* NOTE the idea was to do a single scan of the list of features
-	 * the the code might be clearer if coded explicitly as an automaton
-	 * with an explict state variable
-	 * oh well.... next time maybe
-	 */
-	fl = compressStrand(fl, feature_set->features, squash, collapse, join);
-	compressStrand(fl, feature_set->features, squash, collapse, join);
+  zMap_g_hash_table_get_data(&features, feature_set->features) ;
 
-	if(features)
-	  g_list_free(features);
+  features = fl = g_list_sort(features, featureGapCompare) ;
+  /* debug...check the sorting..... */
+  zMapLogMessage("%s", "After sort by featureGapCompare") ;
+  g_list_foreach(features, dumpFeaturesCB, NULL) ;
 
-	break;
-      }
 
-    case ZMAPFEATURE_STRUCT_FEATURE:
-    case ZMAPFEATURE_STRUCT_INVALID:
-    default:
-      {
-        zMapWarnIfReached() ;
-	break;
-      }
-    }
 
-  return status;
+  /*
+   * features are sorted first by strand so we do the compositing in two stages
+   * not two passes: one scan of the data with a break at half time
+   * each part does squash first to get splice coordinates, then join and/or collapse
+   */
+
+  /* NOTE the idea was to do a single scan of the list of features
+   * the the code might be clearer if coded explicitly as an automaton
+   * with an explict state variable
+   * oh well.... next time maybe
+   */
+  fl = compressStrand(fl, feature_set->features, squash, collapse, join);
+  compressStrand(fl, feature_set->features, squash, collapse, join);
+
+  if(features)
+    g_list_free(features);
+
+  /* composite features have been added. */
+  zMapFeatureSetIndexInvalidate(feature_set) ;
+
+  return ;
 }
 
 
@@ -840,9 +885,10 @@ static int makeConcensusSequence(ZMapFeature composite)
     {
       int n_seq ;
       enum {N_ALPHABET = 5} ;
-      static int *bases = NULL, *bp;
-      static int n_bases = 0;
-      static char index[256] = { 0 };
+      /* per thread as featuresets are collapsed in parallel. */
+      static thread_local char index[256] = { 0 };
+      std::vector<int> bases ;
+      int *bp;
       ZMapFeature f;
       int i;
       char *seq;
@@ -888,17 +934,7 @@ static int makeConcensusSequence(ZMapFeature composite)
 	  index[(unsigned char)'t'] = index[(unsigned char)'T'] = 4;
 	}
 
-      if(n_bases < n_seq)
-	{
-	  if(bases)
-	    g_free(bases);
-
-	  n_bases = n_seq + 10;	/* prevent petty re-alloc's */
-
-	  bases = (int *)g_malloc(sizeof(int) * n_bases * N_ALPHABET);
-	}
-
-      memset(bases, 0, sizeof(int) * n_bases * N_ALPHABET);
+      bases.assign(n_seq * N_ALPHABET, 0) ;
 
       for(fl = composite->children; fl ; fl = fl->next)
 	{
@@ -948,7 +984,7 @@ static int makeConcensusSequence(ZMapFeature composite)
 
       /* must not free old sequence as it's copied from a real feature */
       composite->feature.homol.sequence = seq = (char *)g_malloc(n_seq + 1);
-      for(bp = bases, i = 0; i < n_seq; i++)
+      for(bp = bases.data(), i = 0; i < n_seq; i++)
 	{
 	  int base_ind, max, j;
 	  base_ind = max = 0;
@@ -81,6 +81,10 @@ typedef struct
   /* don't know if it matters if we flag featuresets */
   int feature_count;/* this is a count of the new features */
 
+  int featuresets_moved ;                                   /* whole featuresets taken over from
+                                                               the new context. */
+  int featuresets_merged ;                                  /* featuresets merged feature by feature. */
+
 } MergeContextDataStruct, *MergeContextData;
 
 
@@ -105,6 +109,7 @@ typedef struct
   unsigned int          use_remove : 1;
   unsigned int          use_steal  : 1;
   unsigned int          catch_hash : 1;
+  unsigned int          no_revcomp_resolve : 1;            /* Leave pending revcomps alone. */
   ZMapFeatureContextExecuteStatus status;
 }ContextExecuteStruct, *ContextExecute;
 
@@ -119,8 +124,21 @@ typedef struct
 } RevCompDataStruct, *RevCompData ;
 
 
+/* Below this many features it's not worth starting threads to resolve featureset revcomps. */
+#define REVCOMP_MIN_THREADED_FEATURES 50000
+
+
 
 static void revCompFeature(ZMapFeature feature, int start_coord, int end_coord);
+static void revCompContextExecute(ZMapFeatureAny feature_any, ZMapFeatureLevelType stop,
+                                  ZMapGDataRecurseFunc callback, gpointer data) ;
+static ZMapFeatureContextExecuteStatus getRevCompPendingCB(GQuark key,
+                                                           gpointer data,
+                                                           gpointer user_data,
+                                                           char **error_out) ;
+static void revCompResolveSetCB(gpointer data, gpointer user_data) ;
+static void revCompFeatureSetCB(gpointer data, gpointer user_data) ;
+static void revCompSetFeatureCB(gpointer key, gpointer value, gpointer user_data) ;
 static ZMapFeatureContextExecuteStatus revCompFeaturesCB(GQuark key,
                                                          gpointer data,
                                                          gpointer user_data,
@@ -147,6 +165,7 @@ static ZMapFeatureContextExecuteStatus addEmptySets(GQuark key,
                                                     char **err_out);
 
 static void mergeFeatureSetLoaded(ZMapFeatureSet view_set, ZMapFeatureSet new_set) ;
+static int mergeStealFeatureSetFeatures(ZMapFeatureSet view_set, ZMapFeatureSet new_set) ;
 static ZMapFeatureContextExecuteStatus destroyIfEmptyContextCB(GQuark key,
                                                                gpointer data,
                                                                gpointer user_data,
@@ -311,10 +330,13 @@ ZMapFeatureContextMergeCode zMapFeatureContextMerge(ZMapFeatureContext *merged_c
   ZMapFeatureContextMergeCode status = ZMAPFEATURE_CONTEXT_ERROR ;
   ZMapFeatureContext current_context, new_context, diff_context = NULL ;
   MergeContextDataStruct merge_data = {NULL} ;
+  GTimer *timer ;
 
   if (!merged_context_inout || !new_context_inout || !diff_context_out)
     return status ;
 
+  timer = g_timer_new() ;
+
   current_context = *merged_context_inout ;
   new_context = *new_context_inout ;
 
@@ -465,10 +487,15 @@ ZMapFeatureContextMergeCode zMapFeatureContextMerge(ZMapFeatureContext *merged_c
 
       merge_stats = g_new0(ZMapFeatureContextMergeStatsStruct, 1) ;
       merge_stats->features_added = merge_data.feature_count ;
+      merge_stats->featuresets_moved = merge_data.featuresets_moved ;
+      merge_stats->featuresets_merged = merge_data.featuresets_merged ;
+      merge_stats->merge_secs = g_timer_elapsed(timer, NULL) ;
 
       *merge_stats_out = merge_stats ;
     }
 
+  g_timer_destroy(timer) ;
+
   return status ;
 }
 
@@ -579,6 +606,11 @@ void zMapFeatureContextDestroy(ZMapFeatureContext feature_context, gboolean free
  * what about blocks ??? they also need doing... and in fact there are the alignment
  * mappings etc.....needs some thought and effort....
  *
+ * Ordinary featuresets (i.e. not the dna, translations or ORFs which are made from each other)
+ * are only flagged as needing a revcomp so this is O(featuresets), their features are done
+ * the first time they are used, see zMapFeatureSetRevCompResolve(). A set revcomp'd again
+ * before it has been used costs nothing.
+ *
  */
 void zMapFeatureContextReverseComplement(ZMapFeatureContext context)
 {
@@ -594,19 +626,62 @@ void zMapFeatureContextReverseComplement(ZMapFeatureContext context)
   //zMapLogWarning("rev comp, parent span = %d -> %d",context->parent_span.x1,context->parent_span.x2);
 
   /* Because this doesn't allow for execution at context level ;( */
-  zMapFeatureContextExecute((ZMapFeatureAny)context,
-                            ZMAPFEATURE_STRUCT_FEATURE,
-                            revCompFeaturesCB,
-                            &cb_data);
-
+  revCompContextExecute((ZMapFeatureAny)context,
+                        ZMAPFEATURE_STRUCT_FEATURE,
+                        revCompFeaturesCB,
+                        &cb_data);
 
   //GQuark featureset_id = g_quark_from_string(ZMAP_FIXED_STYLE_ORF_NAME);
   //zMapFeatureAnyGetFeatureByID(context, featureset_id) ;
 
-  zMapFeatureContextExecute((ZMapFeatureAny)context,
-                            ZMAPFEATURE_STRUCT_FEATURE,
-                            revCompORFFeaturesCB,
-                            &cb_data);
+  revCompContextExecute((ZMapFeatureAny)context,
+                        ZMAPFEATURE_STRUCT_FEATURE,
+                        revCompORFFeaturesCB,
+                        &cb_data);
+
+  return ;
+}
+
+
+/* Does the reverse complement of a featureset's features if it was deferred by
+ * zMapFeatureContextReverseComplement(), this must be done before any of the set's features
+ * are looked at. The featureset functions and the context execute functions do this so it's
+ * only needed by code that goes to feature_set->features directly. */
+void zMapFeatureSetRevCompResolve(ZMapFeatureSet feature_set)
+{
+  if (feature_set && feature_set->revcomp_pending)
+    {
+      /* Unset first, the masker sort done by the revcomp resolves too. */
+      feature_set->revcomp_pending = FALSE ;
+
+      revCompFeatureSetCB(feature_set, &(feature_set->revcomp_span)) ;
+    }
+
+  return ;
+}
+
+
+/* Resolves all the pending reverse complements in feature_any and its children, big sets are
+ * done in parallel. Use this before going through all of a context, e.g. to draw it, rather
+ * than having each featureset done as it is reached. */
+void zMapFeatureAnyRevCompResolve(ZMapFeatureAny feature_any)
+{
+  GList *feature_sets = NULL ;
+
+  zMapReturnIfFail(feature_any) ;
+
+  if (feature_any->struct_type == ZMAPFEATURE_STRUCT_FEATURESET)
+    {
+      zMapFeatureSetRevCompResolve((ZMapFeatureSet)feature_any) ;
+    }
+  else if (feature_any->struct_type != ZMAPFEATURE_STRUCT_FEATURE)
+    {
+      revCompContextExecute(feature_any, ZMAPFEATURE_STRUCT_FEATURESET, getRevCompPendingCB, &feature_sets) ;
+
+      zmapFeatureSetsForEachThreaded(feature_sets, REVCOMP_MIN_THREADED_FEATURES, revCompResolveSetCB, NULL) ;
+
+      g_list_free(feature_sets) ;
+    }
 
   return ;
 }
@@ -961,6 +1036,9 @@ ZMapFeatureAny zMapFeatureContextFindFeatureFromFeature(ZMapFeatureContext conte
           break;
         }
 
+      if (feature_ptr->struct_type == ZMAPFEATURE_STRUCT_FEATURESET)
+        zMapFeatureSetRevCompResolve((ZMapFeatureSet)feature_ptr) ;
+
       if(current)
         feature_ptr = (ZMapFeatureAny)g_hash_table_lookup(feature_ptr->children,
                                                           zmapFeature2HashKey(current));
@@ -1082,11 +1160,7 @@ static ZMapFeatureContextExecuteStatus revCompFeaturesCB(GQuark key,
         cb_data->block_end = feature_block->block_to_sequence.block.x2 ;
 
 
-        /* Complement the dna. */
-        if (feature_block->sequence.sequence)
-          {
-            zMapDNAReverseComplement(feature_block->sequence.sequence, feature_block->sequence.length) ;
-          }
+        /* The dna is held packed as the forward strand and decoded according to revcomped. */
 
         zmapFeatureRevComp(cb_data->start, cb_data->end,
                            &feature_block->block_to_sequence.block.x1,
@@ -1103,13 +1177,20 @@ static ZMapFeatureContextExecuteStatus revCompFeaturesCB(GQuark key,
 
         feature_set = (ZMapFeatureSet)feature_any;
 
-        /* need to rev comp the loaded regions list */
+        /* all the feature coords are about to change. */
+        zMapFeatureSetIndexInvalidate(feature_set) ;
+
+        /* need to rev comp the loaded regions list, reversing it keeps it in coord order. */
         for (l = feature_set->loaded;l;l = l->next)
           {
             span = (ZMapSpan) l->data;
-            zmapFeatureRevComp(cb_data->start, cb_data->end, &span->x1, &span->x2) ;
+
+            if (span->x2)                                   /* 0 means all loaded, not a coord. */
+              zmapFeatureRevComp(cb_data->start, cb_data->end, &span->x1, &span->x2) ;
           }
 
+        feature_set->loaded = g_list_reverse(feature_set->loaded) ;
+
 
         /* OK...THIS IS CRAZY....SHOULD BE PART OF THE FEATURE REVCOMP....FIX THIS.... */
         /* Now redo the 3 frame translations from the dna (if they exist). */
@@ -1118,6 +1199,23 @@ static ZMapFeatureContextExecuteStatus revCompFeaturesCB(GQuark key,
             cb_data->translation_fs = feature_set;
             zmapFeature3FrameTranslationSetRevComp(feature_set, cb_data->block_start, cb_data->block_end) ;
           }
+        else if (feature_set->unique_id != zMapStyleCreateID(ZMAP_FIXED_STYLE_DNA_NAME)
+                 && feature_set->unique_id != zMapStyleCreateID(ZMAP_FIXED_STYLE_SHOWTRANSLATION_NAME)
+                 && feature_set->original_id != g_quark_from_string(ZMAP_FIXED_STYLE_ORF_NAME))
+          {
+            /* Features in ordinary sets don't depend on anything else so they are left until
+             * they are needed, sets like the dna and translations still need to be done now
+             * and in order. A set already waiting to be done is now the right way round. */
+            if (feature_set->revcomp_pending
+                && (feature_set->revcomp_span.x1 != cb_data->start || feature_set->revcomp_span.x2 != cb_data->end))
+              zMapFeatureSetRevCompResolve(feature_set) ;
+
+            feature_set->revcomp_pending = !(feature_set->revcomp_pending) ;
+            feature_set->revcomp_span.x1 = cb_data->start ;
+            feature_set->revcomp_span.x2 = cb_data->end ;
+
+            status = ZMAP_CONTEXT_EXEC_STATUS_DONT_DESCEND ;
+          }
 
         break;
       }
@@ -1211,6 +1309,84 @@ static void revcompSpan(GArray *spans, int seq_start, int seq_end)
 }
 
 
+/* As zMapFeatureContextExecute() but without resolving pending revcomps on the way down, used
+ * by the revcomp code itself. */
+static void revCompContextExecute(ZMapFeatureAny feature_any, ZMapFeatureLevelType stop,
+                                  ZMapGDataRecurseFunc callback, gpointer data)
+{
+  ContextExecuteStruct full_data = {0} ;
+
+  full_data.start_callback = callback ;
+  full_data.callback_data = data ;
+  full_data.stop = stop ;
+  full_data.stopped_at = ZMAPFEATURE_STRUCT_INVALID ;
+  full_data.status = ZMAP_CONTEXT_EXEC_STATUS_OK ;
+  full_data.catch_hash = catch_hash_abuse_G ;
+  full_data.no_revcomp_resolve = TRUE ;
+
+  /* As for zMapFeatureContextExecute() the callback isn't called for the context itself. */
+  if (feature_any->struct_type == ZMAPFEATURE_STRUCT_CONTEXT)
+    g_hash_table_foreach(((ZMapFeatureContext)feature_any)->alignments, (GHFunc)executeDataForeachFunc, &full_data) ;
+  else
+    executeDataForeachFunc(GINT_TO_POINTER(feature_any->unique_id), feature_any, &full_data) ;
+
+  postExecuteProcess(&full_data) ;
+
+  return ;
+}
+
+/* Collects the featuresets waiting for a revcomp. */
+static ZMapFeatureContextExecuteStatus getRevCompPendingCB(GQuark key,
+                                                           gpointer data,
+                                                           gpointer user_data,
+                                                           char **error_out)
+{
+  ZMapFeatureAny feature_any = (ZMapFeatureAny)data ;
+  GList **feature_sets_ptr = (GList **)user_data ;
+
+  if (feature_any->struct_type == ZMAPFEATURE_STRUCT_FEATURESET && ((ZMapFeatureSet)feature_any)->revcomp_pending)
+    *feature_sets_ptr = g_list_prepend(*feature_sets_ptr, feature_any) ;
+
+  return ZMAP_CONTEXT_EXEC_STATUS_OK ;
+}
+
+/* A GFunc() run by zmapFeatureSetsForEachThreaded(), possibly in parallel with other sets,
+ * which is safe as each only changes its own set and features. */
+static void revCompResolveSetCB(gpointer data, gpointer user_data)
+{
+  zMapFeatureSetRevCompResolve((ZMapFeatureSet)data) ;
+
+  return ;
+}
+
+/* Reverse complements all the features of a featureset, span is the sequence span to do it
+ * over. */
+static void revCompFeatureSetCB(gpointer data, gpointer user_data)
+{
+  ZMapFeatureSet feature_set = (ZMapFeatureSet)data ;
+
+  g_hash_table_foreach(feature_set->features, revCompSetFeatureCB, user_data) ;
+
+  /* The masker lists are in coord order with coords in their headers so must be redone,
+   * they may have been made by the source thread before the context was revcomped. */
+  if (feature_set->masker_sorted_features)
+    zMapFeatureSetMaskerSort(feature_set) ;
+
+  return ;
+}
+
+static void revCompSetFeatureCB(gpointer key, gpointer value, gpointer user_data)
+{
+  ZMapFeature feature = (ZMapFeature)value ;
+  ZMapSpan span = (ZMapSpan)user_data ;
+
+  if (feature && zMapFeatureIsValid((ZMapFeatureAny)feature))
+    revCompFeature(feature, span->x1, span->x2) ;
+
+  return ;
+}
+
+
 static void revCompFeature(ZMapFeature feature, int start_coord, int end_coord)
 {
   if (!feature)
@@ -1293,9 +1469,9 @@ static void revCompFeature(ZMapFeature feature, int start_coord, int end_coord)
       if(feature->feature.homol.sequence && *feature->feature.homol.sequence)/* eg if provided in GFF (BAM) */
         {
           if (feature->feature.homol.length != (int)strlen(feature->feature.homol.sequence))
-            printf("%s: seq lengths differ: %d, %zd\n",
-                   g_quark_to_string(feature->original_id), feature->feature.homol.length,
-                   strlen(feature->feature.homol.sequence));
+            zMapLogWarning("%s: seq lengths differ: %d, %zd",
+                           g_quark_to_string(feature->original_id), feature->feature.homol.length,
+                           strlen(feature->feature.homol.sequence)) ;
 
           zMapDNAReverseComplement(feature->feature.homol.sequence, feature->feature.homol.length) ;
         }
@@ -1411,6 +1587,11 @@ static gboolean  executeDataForeachFunc(gpointer key_ptr, gpointer data, gpointe
     {
       feature_type = feature_any->struct_type;
 
+      /* Features must be the right way round before we go down to them. */
+      if (feature_type == ZMAPFEATURE_STRUCT_FEATURESET && full_data->stop != ZMAPFEATURE_STRUCT_FEATURESET
+          && !(full_data->no_revcomp_resolve))
+        zMapFeatureSetRevCompResolve((ZMapFeatureSet)feature_any) ;
+
       if(full_data->start_callback)
         full_data->status = (full_data->start_callback)(key, data,
                                                         full_data->callback_data,
@@ -2050,12 +2231,39 @@ static ZMapFeatureContextExecuteStatus mergePreCB(GQuark key,
 
                 /* Not descending to feature level so need to record number of features. */
                 if (feature_any->struct_type == ZMAPFEATURE_STRUCT_FEATURESET)
-                  merge_data->feature_count += g_hash_table_size(feature_any->children) ;
+                  {
+                    merge_data->feature_count += g_hash_table_size(feature_any->children) ;
+                    merge_data->featuresets_moved++ ;
+                  }
+
+              }
+            else if (feature_any->struct_type == ZMAPFEATURE_STRUCT_FEATURESET
+                     && !g_hash_table_size((*view_path_ptr)->children))
+              {
+                /* The view has the featureset but no features in it, typically an empty set
+                 * recorded for an earlier request, so rather than merge feature by feature we
+                 * take over all the new features in one go and treat the set as new. */
+                merge_data->new_features = have_new = TRUE ;
+
+                merge_data->feature_count += mergeStealFeatureSetFeatures((ZMapFeatureSet)(*view_path_ptr),
+                                                                          (ZMapFeatureSet)feature_any) ;
+                merge_data->featuresets_moved++ ;
+
+                /* The diff points at the view's set as for a new set, the new set is now empty
+                 * and goes when the diff context does. */
+                diff_feature_any = *view_path_ptr ;
 
+                zmapFeatureAnyAddToDestroyList(merge_data->diff_context, feature_any) ;
+
+                status |= ZMAP_CONTEXT_EXEC_STATUS_DONT_DESCEND ;
               }
             else
               {
                 have_new = FALSE;/* Nothing new here */
+
+                if (feature_any->struct_type == ZMAPFEATURE_STRUCT_FEATURESET)
+                  merge_data->featuresets_merged++ ;
+
                 /* If the feature is there we need to copy it and then recurse down until
                  * we get to the individual feature level. */
                 diff_feature_any = zmapFeatureAnyCopy(feature_any, NULL);
@@ -2108,10 +2316,12 @@ static ZMapFeatureContextExecuteStatus mergePreCB(GQuark key,
                 // by analogy with the above we need to copy the sequence too, in fact any Block only data
                 // sequence contains a pointer to a (long) string - can we just copy it?
                 // seems to work without double frees...
-                if(!vptr->sequence.sequence)      // let's keep the first one, should be the same
+                if(!vptr->packed_dna && feat->packed_dna)      // let's keep the first one, should be the same
                   {
                     //                memcpy(&vptr->block_to_sequence,&feat->block_to_sequence,sizeof(ZMapMapBlockStruct));
                     memcpy(&vptr->sequence,&feat->sequence,sizeof(ZMapSequenceStruct));
+
+                    vptr->packed_dna = zMapPackedDNARef(feat->packed_dna) ;
                   }
               }
 #endif
@@ -2124,7 +2334,10 @@ static ZMapFeatureContextExecuteStatus mergePreCB(GQuark key,
             /* we get only featuresest with data from the server */
             /* and record empty ones with a seq region list of requested ranges in the features context */
             zmapFeatureBlockAddEmptySets((ZMapFeatureBlock) feature_any, (ZMapFeatureBlock)(*diff_path_ptr), merge_data->req_featuresets);
-            zmapFeatureBlockAddEmptySets((ZMapFeatureBlock) feature_any, (ZMapFeatureBlock)(*view_path_ptr), merge_data->req_featuresets);
+
+            /* A new block is the same in the view and the diff so has already been done. */
+            if (*view_path_ptr != *diff_path_ptr)
+              zmapFeatureBlockAddEmptySets((ZMapFeatureBlock) feature_any, (ZMapFeatureBlock)(*view_path_ptr), merge_data->req_featuresets);
           }
 
         if (feature_any->struct_type == ZMAPFEATURE_STRUCT_FEATURESET)
@@ -2215,6 +2428,81 @@ static ZMapFeatureContextExecuteStatus mergePreCB(GQuark key,
 
 
 
+/* Moves all the features of new_set into view_set, which must be empty, by swapping their
+ * feature tables so there are no per-feature hash lookups or inserts. Returns the number
+ * of features moved. */
+static int mergeStealFeatureSetFeatures(ZMapFeatureSet view_set, ZMapFeatureSet new_set)
+{
+  GHashTable *tmp_features ;
+  ZMapFeatureSlab tmp_slab ;
+  GList *tmp_sorted ;
+  guint tmp_n_sorted ;
+  gboolean tmp_pending ;
+  ZMapSpanStruct tmp_span ;
+  GHashTableIter iter ;
+  gpointer key, value ;
+  int num_features ;
+
+  /* If the view set had no loaded list it takes over new_set's, otherwise the span is copied
+   * and new_set's list is freed along with new_set. */
+  mergeFeatureSetLoaded(view_set, new_set) ;
+
+  if (view_set->loaded == new_set->loaded)
+    new_set->loaded = NULL ;
+
+  tmp_features = view_set->features ;
+  view_set->features = new_set->features ;
+  new_set->features = tmp_features ;
+
+  /* The slab goes with the features so memory use is reported against the right set. */
+  tmp_slab = view_set->slab ;
+  view_set->slab = new_set->slab ;
+  new_set->slab = tmp_slab ;
+
+  /* The masker sort done in the source thread lists the same features. */
+  tmp_sorted = view_set->masker_sorted_features ;
+  view_set->masker_sorted_features = new_set->masker_sorted_features ;
+  new_set->masker_sorted_features = tmp_sorted ;
+
+  tmp_n_sorted = view_set->masker_sorted_n_features ;
+  view_set->masker_sorted_n_features = new_set->masker_sorted_n_features ;
+  new_set->masker_sorted_n_features = tmp_n_sorted ;
+
+  /* So does any revcomp they are waiting for. */
+  tmp_pending = view_set->revcomp_pending ;
+  view_set->revcomp_pending = new_set->revcomp_pending ;
+  new_set->revcomp_pending = tmp_pending ;
+
+  tmp_span = view_set->revcomp_span ;
+  view_set->revcomp_span = new_set->revcomp_span ;
+  new_set->revcomp_span = tmp_span ;
+
+  zMapFeatureSetIndexInvalidate(view_set) ;
+  zMapFeatureSetIndexInvalidate(new_set) ;
+
+  if (!view_set->style)
+    view_set->style = new_set->style ;
+
+  if (!view_set->source)
+    view_set->source = new_set->source ;
+
+  /* features reach their style through their parent set so both need resetting,
+   * see zmapFeatureAnyAddFeature(). */
+  g_hash_table_iter_init(&iter, view_set->features) ;
+  while (g_hash_table_iter_next(&iter, &key, &value))
+    {
+      ZMapFeature feature = (ZMapFeature)value ;
+
+      feature->parent = (ZMapFeatureAny)view_set ;
+      feature->style = &(view_set->style) ;
+    }
+
+  num_features = g_hash_table_size(view_set->features) ;
+
+  return num_features ;
+}
+
+
 static void mergeFeatureSetLoaded(ZMapFeatureSet view_set, ZMapFeatureSet new_set)
 {
   GList *view_list,*new_list;
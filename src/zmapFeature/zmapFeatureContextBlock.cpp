@@ -276,6 +276,33 @@ gboolean zMapFeatureSetIsLoadedInRange(ZMapFeatureBlock block,  GQuark unique_id
 }
 
 
+/* Returns TRUE if all of start to end is covered by the featureset's loaded spans, these
+ * are kept merged and in order by zMapFeatureContextMerge(). */
+gboolean zMapFeatureSetIsLoadedInSpan(ZMapFeatureSet feature_set, int start, int end)
+{
+  gboolean result = FALSE ;
+  GList *l ;
+
+  zMapReturnValIfFail(feature_set, result) ;
+
+  for (l = feature_set->loaded ; l && !result ; l = l->next)
+    {
+      ZMapSpan span = (ZMapSpan)(l->data) ;
+
+      if (!span->x2)                                        /* not real coordinates */
+        result = TRUE ;
+      else if (span->x1 > start)
+        break ;
+      else if (span->x2 >= end)
+        result = TRUE ;
+      else if (span->x2 >= start)
+        start = span->x2 + 1 ;
+    }
+
+  return result ;
+}
+
+
 
 
 void zMapFeatureBlockDestroy(ZMapFeatureBlock block, gboolean free_data)
@@ -35,24 +35,28 @@
 
 #include <ZMap/zmap.hpp>
 
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <ZMap/zmapUtils.hpp>
 #include <zmapFeature_P.hpp>
 
 
+/* Featuresets to be processed by one thread in zmapFeatureSetsForEachThreaded(). */
 typedef struct
 {
-  GQuark original_id ;
-  int start, end ;
-  GList *feature_list ;
-  ZMapStrand strand ;
-} FindFeaturesRangeStruct, *FindFeaturesRange ;
+  GList *feature_sets ;
+  int num_features ;
+  GFunc set_func ;
+  gpointer user_data ;
+} SetsThreadDataStruct, *SetsThreadData ;
 
 
 static void copy_to_new_featureset(gpointer key, gpointer hash_data, gpointer user_data) ;
 
-static void findFeaturesRangeCB(gpointer key, gpointer value, gpointer user_data) ;
-static void findFeaturesNameCB(gpointer key, gpointer value, gpointer user_data) ;
-static void findFeaturesNameStrandCB(gpointer key, gpointer value, gpointer user_data) ;
 static void update_style_from_feature(gpointer key, gpointer hash_data, gpointer user_data) ;
+static void featureSetsThread(SetsThreadData sets_data) ;
 
 
 
@@ -162,6 +166,8 @@ ZMapFeatureSet zMapFeatureSetCopy(ZMapFeatureSet feature_set)
 {
   ZMapFeatureSet new_feature_set = NULL;
 
+  zMapFeatureSetRevCompResolve(feature_set) ;
+
   new_feature_set = (ZMapFeatureSet)zMapFeatureAnyCopy((ZMapFeatureAny)feature_set);
 
   g_hash_table_foreach(feature_set->features, copy_to_new_featureset, new_feature_set);
@@ -215,19 +221,13 @@ gboolean zMapFeatureSetRemoveFeature(ZMapFeatureSet feature_set, ZMapFeature fea
 
 
 
+/* Return all features whose start coord lies within start -> end, see also
+ * zMapFeatureSetGetOverlapFeatures() for features overlapping a range. */
 GList *zMapFeatureSetGetRangeFeatures(ZMapFeatureSet feature_set, int start, int end)
 {
   GList *feature_list = NULL ;
-  FindFeaturesRangeStruct find_data ;
-
-  find_data.start = start ;
-  find_data.end = end ;
-  find_data.feature_list = NULL ;
-  find_data.strand = ZMAPSTRAND_NONE ;
-
-  g_hash_table_foreach(feature_set->features, findFeaturesRangeCB, &find_data) ;
 
-  feature_list = find_data.feature_list ;
+  feature_list = zmapFeatureSetIndexGetStartFeatures(feature_set, start, end) ;
 
   return feature_list ;
 }
@@ -235,15 +235,8 @@ GList *zMapFeatureSetGetRangeFeatures(ZMapFeatureSet feature_set, int start, int
 GList *zMapFeatureSetGetNamedFeatures(ZMapFeatureSet feature_set, GQuark original_id)
 {
   GList *feature_list = NULL ;
-  FindFeaturesRangeStruct find_data = {0} ;
 
-  find_data.original_id = original_id ;
-  find_data.feature_list = NULL ;
-  find_data.strand = ZMAPSTRAND_NONE ;
-
-  g_hash_table_foreach(feature_set->features, findFeaturesNameCB, &find_data) ;
-
-  feature_list = find_data.feature_list ;
+  feature_list = zmapFeatureSetIndexGetNamedFeatures(feature_set, original_id, FALSE, ZMAPSTRAND_NONE) ;
 
   return feature_list ;
 }
@@ -253,15 +246,8 @@ GList *zMapFeatureSetGetNamedFeatures(ZMapFeatureSet feature_set, GQuark origina
 GList *zMapFeatureSetGetNamedFeaturesForStrand(ZMapFeatureSet feature_set, GQuark original_id, ZMapStrand strand)
 {
   GList *feature_list = NULL ;
-  FindFeaturesRangeStruct find_data = {0} ;
-
-  find_data.original_id = original_id ;
-  find_data.feature_list = NULL ;
-  find_data.strand = strand ;
-
-  g_hash_table_foreach(feature_set->features, findFeaturesNameStrandCB, &find_data) ;
 
-  feature_list = find_data.feature_list ;
+  feature_list = zmapFeatureSetIndexGetNamedFeatures(feature_set, original_id, TRUE, strand) ;
 
   return feature_list ;
 }
@@ -282,63 +268,128 @@ void zMapFeatureSetDestroyFeatures(ZMapFeatureSet feature_set)
   if (!feature_set)
     return ;
 
+  zMapFeatureSetIndexInvalidate(feature_set) ;
+
   g_hash_table_destroy(feature_set->features) ;
   feature_set->features = NULL ;
 
+  /* All the features have gone so give back the slab's memory in one go. */
+  if (feature_set->slab)
+    zmapFeatureSlabTrim(feature_set->slab) ;
+
   return ;
 }
 
 
 // 
-//                Internal routines
+//                Package routines
 //    
 
-
-static void copy_to_new_featureset(gpointer key, gpointer hash_data, gpointer user_data)
+/* Calls set_func(feature_set, user_data) for every set in feature_sets, big lists of sets are
+ * shared out between threads so set_func must only change the set it is given and its features.
+ * This is called from the source threads too so the extra threads come from the process-wide
+ * budget, see zMapUtilsSysReserveThreads(), and the calling thread does a share itself. */
+void zmapFeatureSetsForEachThreaded(GList *feature_sets, int min_threaded_features,
+                                    GFunc set_func, gpointer user_data)
 {
-  ZMapFeatureSet feature_set = (ZMapFeatureSet)user_data;
-  ZMapFeature    new_feature;
+  std::vector<SetsThreadDataStruct> sets_data ;
+  GList *l ;
+  int num_features = 0, num_threads, i ;
 
-  new_feature = (ZMapFeature)zMapFeatureAnyCopy((ZMapFeatureAny)hash_data);
+  if (!feature_sets || !set_func)
+    return ;
 
-  zMapFeatureSetAddFeature(feature_set, new_feature);
+  for (l = feature_sets ; l ; l = l->next)
+    num_features += g_hash_table_size(((ZMapFeatureSet)(l->data))->features) ;
 
-  return ;
-}
+  num_threads = zMapUtilsSysGetNumThreads(num_features, min_threaded_features,
+                                          (int)g_list_length(feature_sets)) ;
 
-/* A GHFunc() to add a feature to a list if it within a given range */
-static void findFeaturesRangeCB(gpointer key, gpointer value, gpointer user_data)
-{
-  FindFeaturesRange find_data = (FindFeaturesRange)user_data ;
-  ZMapFeature feature = (ZMapFeature)value ;
+  if (num_threads > 1)
+    num_threads = zMapUtilsSysReserveThreads(num_threads) ;
+
+  sets_data.resize(num_threads, SetsThreadDataStruct{NULL, 0, set_func, user_data}) ;
+
+  /* Give each set to the thread with the fewest features so far. */
+  for (l = feature_sets ; l ; l = l->next)
+    {
+      ZMapFeatureSet feature_set = (ZMapFeatureSet)(l->data) ;
+      SetsThreadData least = &(sets_data[0]) ;
+
+      for (i = 1 ; i < num_threads ; i++)
+        {
+          if (sets_data[i].num_features < least->num_features)
+            least = &(sets_data[i]) ;
+        }
 
-  if (feature->x1 >= find_data->start && feature->x1 <= find_data->end)
-    find_data->feature_list = g_list_append(find_data->feature_list, feature) ;
+      least->feature_sets = g_list_prepend(least->feature_sets, feature_set) ;
+      least->num_features += g_hash_table_size(feature_set->features) ;
+    }
+
+  if (num_threads == 1)
+    {
+      featureSetsThread(&(sets_data[0])) ;
+    }
+  else
+    {
+      std::vector<std::thread> threads ;
+
+      threads.reserve(num_threads - 1) ;
+
+      for (i = 1 ; i < num_threads ; i++)
+        {
+          try
+            {
+              threads.push_back(std::thread(featureSetsThread, &(sets_data[i]))) ;
+            }
+          catch (const std::system_error &err)
+            {
+              zMapLogWarning("Could not start thread, processing featuresets in this one: %s", err.what()) ;
+
+              break ;
+            }
+        }
+
+      /* Do our own share and those of any threads that could not be started. */
+      featureSetsThread(&(sets_data[0])) ;
+
+      for (i = (int)threads.size() + 1 ; i < num_threads ; i++)
+        featureSetsThread(&(sets_data[i])) ;
+
+      for (auto &thread : threads)
+        thread.join() ;
+
+      zMapUtilsSysReleaseThreads(num_threads) ;
+    }
+
+  for (auto &thread_data : sets_data)
+    g_list_free(thread_data.feature_sets) ;
 
   return ;
 }
 
 
-/* A GHFunc() to add a feature to a list if it has the given name */
-static void findFeaturesNameCB(gpointer key, gpointer value, gpointer user_data)
-{
-  FindFeaturesRange find_data = (FindFeaturesRange)user_data ;
-  ZMapFeature feature = (ZMapFeature)value ;
 
-  if (feature->original_id == find_data->original_id)
-    find_data->feature_list = g_list_append(find_data->feature_list, feature) ;
+// 
+//                Internal routines
+//    
+
+static void featureSetsThread(SetsThreadData sets_data)
+{
+  g_list_foreach(sets_data->feature_sets, sets_data->set_func, sets_data->user_data) ;
 
   return ;
 }
 
-/* A GHFunc() to add a feature to a list if it has the given name and strand */
-static void findFeaturesNameStrandCB(gpointer key, gpointer value, gpointer user_data)
+
+static void copy_to_new_featureset(gpointer key, gpointer hash_data, gpointer user_data)
 {
-  FindFeaturesRange find_data = (FindFeaturesRange)user_data ;
-  ZMapFeature feature = (ZMapFeature)value ;
+  ZMapFeatureSet feature_set = (ZMapFeatureSet)user_data;
+  ZMapFeature    new_feature;
 
-  if (feature->original_id == find_data->original_id && feature->strand == find_data->strand)
-    find_data->feature_list = g_list_append(find_data->feature_list, feature) ;
+  new_feature = (ZMapFeature)zMapFeatureAnyCopy((ZMapFeatureAny)hash_data);
+
+  zMapFeatureSetAddFeature(feature_set, new_feature);
 
   return ;
 }
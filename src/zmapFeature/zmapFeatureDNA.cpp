@@ -45,6 +45,7 @@ typedef struct FeatureSeqFetcherStructType
    * but start/end must be inside the assembly start/end. */
   char *dna_in;
   int dna_start ;
+  int dna_len ;
   int start, end ;
   GList *variations ;
 
@@ -65,10 +66,12 @@ typedef struct BlockHasDNAStructType
 static gboolean hasFeatureBlockDNA(ZMapFeatureAny feature_any) ;
 static char *getFeatureBlockDNA(ZMapFeatureAny feature_any, int start_in, int end_in, gboolean revcomp) ;
 static void fetch_exon_sequence(gpointer exon_data, gpointer user_data);
-static char *fetchBlockDNAPtr(ZMapFeatureAny feature, ZMapFeatureBlock *block_out) ;
-static char *getDNA(char *dna, int start, int end, gboolean revcomp) ;
+static gboolean fetchBlockWithDNA(ZMapFeatureAny feature, ZMapFeatureBlock *block_out) ;
+static char *getDNA(ZMapFeatureBlock block, int start, int end, gboolean revcomp) ;
 static gboolean coordsInBlock(ZMapFeatureBlock block, int *start_out, int *end_out) ;
 static gboolean strupDNA(char *string_arg, int length) ;
+static ZMapFeatureContextExecuteStatus logBlockDNAUsageCB(GQuark key, gpointer data, gpointer user_data,
+                                                          char **error_out) ;
 
 
 
@@ -337,19 +340,21 @@ char *zMapFeatureGetTranscriptDNA(ZMapFeature transcript, gboolean spliced, gboo
       if (transcript->strand == ZMAPSTRAND_REVERSE)
         revcomp = TRUE ;
 
-      if ((block_dna = fetchBlockDNAPtr((ZMapFeatureAny)transcript, &block))
+      if (fetchBlockWithDNA((ZMapFeatureAny)transcript, &block)
           && coordsInBlock(block, &start, &end)
           && (dna = getFeatureBlockDNA((ZMapFeatureAny)transcript, start, end, revcomp)))
         {
+          int span_start = start ;
+
           /* If the transcript has any variations, apply them now to the dna string */
           zmapFeatureDNAApplyVariations(&dna, start, end, transcript->feature.transcript.variations) ;
 
-          block_dna = g_strdup(block_dna) ;
+          /* Exons are fetched from the forward dna of the transcript's span, not a copy of the
+           * whole block's dna. */
+          if (!(block_dna = getFeatureBlockDNA((ZMapFeatureAny)transcript, start, end, FALSE)))
+            block_dna = g_strdup("") ;
 
-          zmapFeatureDNAApplyVariations(&block_dna,
-                                        block->block_to_sequence.block.x1,
-                                        block->block_to_sequence.block.x2,
-                                        transcript->feature.transcript.variations) ;
+          zmapFeatureDNAApplyVariations(&block_dna, start, end, transcript->feature.transcript.variations) ;
 
           dna_save = block_dna ;
 
@@ -408,7 +413,8 @@ char *zMapFeatureGetTranscriptDNA(ZMapFeature transcript, gboolean spliced, gboo
                   int seq_length = 0 ;
 
                   seq_fetcher.dna_in  = block_dna ;
-                  seq_fetcher.dna_start = block->block_to_sequence.block.x1 ;
+                  seq_fetcher.dna_start = span_start ;
+                  seq_fetcher.dna_len = strlen(block_dna) ;
                   seq_fetcher.start = start ;
                   seq_fetcher.end = end ;
                   seq_fetcher.variations = transcript->feature.transcript.variations ;
@@ -442,7 +448,8 @@ char *zMapFeatureGetTranscriptDNA(ZMapFeature transcript, gboolean spliced, gboo
 
 
 /*!
- * A Blocks DNA
+ * A Blocks DNA, the block only holds it packed so if sequence_out is given the whole of the
+ * dna is decoded into a string in the block's current orientation which must be g_free'd.
  */
 gboolean zMapFeatureBlockDNA(ZMapFeatureBlock block,
                              char **seq_name_out, int *seq_len_out, char **sequence_out)
@@ -453,7 +460,7 @@ gboolean zMapFeatureBlockDNA(ZMapFeatureBlock block,
   if ( !block )
     return result ;
 
-  if(block->sequence.sequence &&
+  if(block->packed_dna &&
      block->sequence.type != ZMAPSEQUENCE_NONE &&
      block->sequence.type == ZMAPSEQUENCE_DNA  &&
      (context = (ZMapFeatureContext)zMapFeatureGetParentGroup((ZMapFeatureAny)block,
@@ -464,13 +471,29 @@ gboolean zMapFeatureBlockDNA(ZMapFeatureBlock block,
       if(seq_len_out)
         *seq_len_out  = block->sequence.length ;
       if(sequence_out)
-        *sequence_out = block->sequence.sequence ;
+        *sequence_out = zMapPackedDNAGetString(block->packed_dna, 0, block->sequence.length, block->revcomped) ;
       result = TRUE ;
     }
 
   return result;
 }
 
+
+/*!
+ * Decodes length bases of the block's dna from start (zero-based, in the block's current
+ * orientation) into buf, which is not null terminated. Use this rather than
+ * zMapFeatureBlockDNA() to read long dna a piece at a time.
+ */
+gboolean zMapFeatureBlockDNADecode(ZMapFeatureBlock block, int start, int length, char *buf)
+{
+  gboolean result = FALSE ;
+
+  if (block && block->packed_dna)
+    result = zMapPackedDNADecode(block->packed_dna, start, length, block->revcomped, buf) ;
+
+  return result ;
+}
+
 /* Free return when finished! */
 char *zMapFeatureDNAFeatureName(ZMapFeatureBlock block)
 {
@@ -545,6 +568,8 @@ void zMapFeatureDNAAddSequenceData(ZMapFeature dna_feature, char *dna_str, int s
   return ;
 }
 
+/* dna_str is held packed by the block and is freed, the dna feature has no string of its own,
+ * its dna is decoded from the block when it is needed. */
 ZMapFeature zMapFeatureDNACreateFeature(ZMapFeatureBlock block, ZMapFeatureTypeStyle style,
                                         char *dna_str, int sequence_length)
 {
@@ -570,7 +595,7 @@ ZMapFeature zMapFeatureDNACreateFeature(ZMapFeatureBlock block, ZMapFeatureTypeS
 
       dna_id = zMapFeatureDNAFeatureID(block);;
 
-      if (block->sequence.sequence)
+      if (block->packed_dna)
         {
           /* hmm, we've already got dna */
 
@@ -605,13 +630,19 @@ ZMapFeature zMapFeatureDNACreateFeature(ZMapFeatureBlock block, ZMapFeatureTypeS
           if (dna_feature)
             {
               zMapFeatureSequenceSetType(dna_feature, ZMAPSEQUENCE_DNA) ;
-              zMapFeatureDNAAddSequenceData(dna_feature, dna_str, sequence_length);
+              zMapFeatureDNAAddSequenceData(dna_feature, NULL, sequence_length);
 
               zMapFeatureSetAddFeature(dna_feature_set, dna_feature);
 
-              block->sequence.sequence = dna_feature->feature.sequence.sequence;
+              block->sequence.sequence = NULL ;
               block->sequence.type     = dna_feature->feature.sequence.type;
               block->sequence.length   = dna_feature->feature.sequence.length;
+
+              /* The packed dna is always of the forward strand, see getDNA(). */
+              if (block->revcomped)
+                zMapDNAReverseComplement(dna_str, sequence_length) ;
+
+              block->packed_dna = zMapPackedDNACreate(dna_str, sequence_length) ;
             }
 
           if (g_error)
@@ -625,6 +656,7 @@ ZMapFeature zMapFeatureDNACreateFeature(ZMapFeatureBlock block, ZMapFeatureTypeS
         g_free(feature_name);
     }
 
+  g_free(dna_str) ;
 
   return dna_feature;
 }
@@ -693,6 +725,18 @@ gboolean zMapFeatureContextGetDNAStatus(ZMapFeatureContext context)
 }
 
 
+/* Logs the size of each block's dna and the memory its packed form takes. */
+void zMapFeatureContextLogDNAMemUsage(ZMapFeatureContext context)
+{
+  zMapReturnIfFail(context) ;
+
+  zMapFeatureContextExecute((ZMapFeatureAny)context, ZMAPFEATURE_STRUCT_BLOCK,
+                            logBlockDNAUsageCB, NULL) ;
+
+  return ;
+}
+
+
 
 
 /*
@@ -714,14 +758,14 @@ static void fetch_exon_sequence(gpointer exon_data, gpointer user_data)
   if (zMapCoordsClamp(seq_fetcher->start, seq_fetcher->end, &start, &end))
     {
       /* If there are any variations in this exon they may affect its length */
-      variation_diff1 = zmapFeatureDNACalculateVariationDiff(1, start, seq_fetcher->variations) ;
+      variation_diff1 = zmapFeatureDNACalculateVariationDiff(seq_fetcher->dna_start, start, seq_fetcher->variations) ;
       variation_diff2 = zmapFeatureDNACalculateVariationDiff(start, end, seq_fetcher->variations) ;
 
       offset = start - seq_fetcher->dna_start + variation_diff1 ;
       length = end - start + 1 + variation_diff2 ;
 
       if (seq_fetcher->dna_in)
-        dna_len = strlen(seq_fetcher->dna_in) ;
+        dna_len = seq_fetcher->dna_len ;
 
       if (dna_len > offset)
         {
@@ -745,7 +789,7 @@ static gboolean hasFeatureBlockDNA(ZMapFeatureAny feature_any)
   gboolean has_dna = FALSE ;
   ZMapFeatureBlock block ;
 
-  if (fetchBlockDNAPtr(feature_any, &block))
+  if (fetchBlockWithDNA(feature_any, &block))
     has_dna = TRUE ;
 
   return has_dna ;
@@ -763,52 +807,63 @@ static char *getFeatureBlockDNA(ZMapFeatureAny feature_any, int start_in, int en
   end = end_in ;
 
   /* Can only get dna if there is dna for the block and the coords lie within the block. */
-  if (fetchBlockDNAPtr(feature_any, &block) && coordsInBlock(block, &start, &end))
+  if (fetchBlockWithDNA(feature_any, &block) && coordsInBlock(block, &start, &end))
     {
       /* Transform block coords to 1-based for fetching sequence. */
       zMapFeature2BlockCoords(block, &start, &end) ;
-      dna = getDNA(block->sequence.sequence, start, end, revcomp) ;
+      dna = getDNA(block, start, end, revcomp) ;
     }
 
   return dna ;
 }
 
 
-/* If we can get the block and it has dna then return a pointer to the dna and optionally to the block. */
-static char *fetchBlockDNAPtr(ZMapFeatureAny feature_any, ZMapFeatureBlock *block_out)
+/* If we can get the block and it has dna then return TRUE and optionally the block. */
+static gboolean fetchBlockWithDNA(ZMapFeatureAny feature_any, ZMapFeatureBlock *block_out)
 {
-  char *dna = NULL ;
+  gboolean result = FALSE ;
   ZMapFeatureBlock block = NULL;
 
   if ((block = (ZMapFeatureBlock)zMapFeatureGetParentGroup(feature_any, ZMAPFEATURE_STRUCT_BLOCK))
-      && block->sequence.sequence)
+      && block->packed_dna)
     {
-      dna = block->sequence.sequence ;
+      result = TRUE ;
 
       if (block_out)
         *block_out = block ;
     }
 
-  return dna ;
+  return result ;
 }
 
 
 
-static char *getDNA(char *dna_sequence, int start, int end, gboolean revcomp)
+/* start/end are 1-based in the block's current orientation. The packed dna is always the
+ * forward strand so if the block has been revcomp'd the coords are on its reverse strand. */
+static char *getDNA(ZMapFeatureBlock block, int start, int end, gboolean revcomp)
 {
   char *dna = NULL ;
   int length ;
   int dna_len ;
 
   length = end - start + 1 ;
-  dna_len = strlen(dna_sequence) ;
+
+  dna_len = zMapPackedDNALength(block->packed_dna) ;
 
   if (start + length - 1 <= dna_len)
     {
-      dna = g_strndup((dna_sequence + start - 1), length) ;
-
-      if (revcomp)
-        zMapDNAReverseComplement(dna, length) ;
+      if (!block->revcomped)
+        {
+          dna = zMapPackedDNAGetString(block->packed_dna, start - 1, length, revcomp) ;
+        }
+      else if (!revcomp)
+        {
+          dna = zMapPackedDNAGetString(block->packed_dna, start - 1, length, TRUE) ;
+        }
+      else
+        {
+          dna = zMapPackedDNAGetString(block->packed_dna, dna_len - (start - 1) - length, length, FALSE) ;
+        }
     }
   else
     {
@@ -885,3 +940,20 @@ static gboolean strupDNA(char *string_arg, int length)
 }
 
 
+static ZMapFeatureContextExecuteStatus logBlockDNAUsageCB(GQuark key, gpointer data, gpointer user_data,
+                                                          char **error_out)
+{
+  ZMapFeatureAny feature_any = (ZMapFeatureAny)data ;
+
+  if (feature_any->struct_type == ZMAPFEATURE_STRUCT_BLOCK)
+    {
+      ZMapFeatureBlock block = (ZMapFeatureBlock)feature_any ;
+
+      if (block->packed_dna)
+        zMapLogMessage("DNA memory: block \"%s\" dna %d bases, %" G_GSIZE_FORMAT " bytes packed",
+                       g_quark_to_string(block->original_id),
+                       zMapPackedDNALength(block->packed_dna), zMapPackedDNAGetMemUsage(block->packed_dna)) ;
+    }
+
+  return ZMAP_CONTEXT_EXEC_STATUS_OK ;
+}
@@ -0,0 +1,150 @@
+/*  File: zmapFeatureIDs.cpp
+ *  Copyright (c) 2006-2017: Genome Research Ltd.
+ *-------------------------------------------------------------------
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------
+ * This file is part of the ZMap genome database package
+ * originally written by:
+ *
+ *      Ed Griffiths (Sanger Institute, UK) edgrif@sanger.ac.uk
+ *        Roy Storey (Sanger Institute, UK) rds@sanger.ac.uk
+ *   Malcolm Hinsley (Sanger Institute, UK) mh17@sanger.ac.uk
+ *       Gemma Guest (Sanger Institute, UK) gb10@sanger.ac.uk
+ *      Steve Miller (Sanger Institute, UK) sm23@sanger.ac.uk
+ *
+ * Description: Sharded interning of feature unique ids.
+ *
+ *              Feature ids are GQuarks, they are compared between
+ *              contexts when merging and turned back into strings with
+ *              g_quark_to_string() all over zmap. g_quark_from_string()
+ *              takes glib's single global quark lock though, so the
+ *              loading threads all serialise on it. Here ids are looked
+ *              up first in one of a set of shards chosen by the id's
+ *              hash, each with its own lock, and glib is only called
+ *              for an id the first time it is seen. The shards hold
+ *              glib's own copy of the string so they add no string
+ *              memory, and they count the ids and the string memory
+ *              held by them for the session stats.
+ *
+ * Exported functions: See ZMap/zmapFeature.hpp
+ *-------------------------------------------------------------------
+ */
+
+#include <ZMap/zmap.hpp>
+
+#include <string.h>
+#include <mutex>
+
+#include <ZMap/zmapUtils.hpp>
+#include <zmapFeature_P.hpp>
+
+
+
+/* Must be a power of 2, enough that the loading threads rarely want the same shard. */
+#define ID_NUM_SHARDS 64
+
+
+typedef struct IDShardStructType
+{
+  std::mutex mutex ;
+
+  GHashTable *ids ;                                         /* id string -> quark, the key is
+                                                               glib's string so is never freed. */
+
+  /* Counts, only changed with the mutex held. */
+  gint64 lookups ;
+  gint64 bytes ;
+
+} IDShardStruct, *IDShard ;
+
+
+static IDShardStruct id_shards_G[ID_NUM_SHARDS] ;
+
+
+
+
+/*
+ *                    External interface routines
+ */
+
+
+/* Fills in stats_out with the counts for all the ids interned since startup. */
+void zMapFeatureIDGetStats(ZMapFeatureIDStats stats_out)
+{
+  int i ;
+
+  zMapReturnIfFail(stats_out) ;
+
+  memset(stats_out, 0, sizeof(ZMapFeatureIDStatsStruct)) ;
+
+  for (i = 0 ; i < ID_NUM_SHARDS ; i++)
+    {
+      IDShard shard = &id_shards_G[i] ;
+      std::lock_guard<std::mutex> lock(shard->mutex) ;
+
+      if (shard->ids)
+        stats_out->num_ids += g_hash_table_size(shard->ids) ;
+
+      stats_out->lookups += shard->lookups ;
+      stats_out->string_bytes += shard->bytes ;
+    }
+
+  /* Roughly what glib's and our tables cost per id on top of the strings. */
+  stats_out->table_bytes = stats_out->num_ids * (gint64)(4 * sizeof(gpointer) + sizeof(guint)) ;
+
+  return ;
+}
+
+
+
+/*
+ *                    Package routines
+ */
+
+
+/* Returns the quark for a feature's unique name, as g_quark_from_string() would. */
+GQuark zmapFeatureInternID(const char *unique_name)
+{
+  GQuark quark = 0 ;
+  IDShard shard ;
+  gpointer key = NULL, value = NULL ;
+
+  zMapReturnValIfFail(unique_name, quark) ;
+
+  shard = &id_shards_G[g_str_hash(unique_name) & (ID_NUM_SHARDS - 1)] ;
+
+  {
+    std::lock_guard<std::mutex> lock(shard->mutex) ;
+
+    shard->lookups++ ;
+
+    if (!(shard->ids))
+      shard->ids = g_hash_table_new(g_str_hash, g_str_equal) ;
+
+    if (g_hash_table_lookup_extended(shard->ids, unique_name, &key, &value))
+      {
+        quark = GPOINTER_TO_UINT(value) ;
+      }
+    else
+      {
+        /* Only the first time this id is seen takes glib's lock. */
+        quark = g_quark_from_string(unique_name) ;
+
+        g_hash_table_insert(shard->ids, (gpointer)g_quark_to_string(quark), GUINT_TO_POINTER(quark)) ;
+
+        shard->bytes += strlen(unique_name) + 1 ;
+      }
+  }
+
+  return quark ;
+}
@@ -0,0 +1,231 @@
+/*  File: zmapFeatureMask.cpp
+ *  Copyright (c) 2006-2017: Genome Research Ltd.
+ *-------------------------------------------------------------------
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------
+ * This file is part of the ZMap genome database package
+ * originally written by:
+ *
+ *      Ed Griffiths (Sanger Institute, UK) edgrif@sanger.ac.uk
+ *        Roy Storey (Sanger Institute, UK) rds@sanger.ac.uk
+ *   Malcolm Hinsley (Sanger Institute, UK) mh17@sanger.ac.uk
+ *       Gemma Guest (Sanger Institute, UK) gb10@sanger.ac.uk
+ *      Steve Miller (Sanger Institute, UK) sm23@sanger.ac.uk
+ *
+ * Description: Sorts a featureset into the lists of same name
+ *              alignments used for masking ESTs with mRNAs, see
+ *              zmapView/zmapViewFeatureMask.cpp and EST_mRNA.html.
+ *
+ *              The sort only needs the featureset so it's done in
+ *              the source's thread when the features are loaded,
+ *              the masking itself needs the merged view context.
+ *
+ * Exported functions: See ZMap/zmapFeature.hpp
+ *-------------------------------------------------------------------
+ */
+
+#include <ZMap/zmap.hpp>
+
+#include <ZMap/zmapGLibUtils.hpp>
+#include <ZMap/zmapUtils.hpp>
+#include <zmapFeature_P.hpp>
+
+
+
+static gint nameOrderCB(gconstpointer a, gconstpointer b) ;
+static gint fsetStartOrderCB(gconstpointer a, gconstpointer b) ;
+static gint fsetListOrderCB(gconstpointer a, gconstpointer b) ;
+
+
+
+
+/*
+ *                    External interface routines
+ */
+
+
+/* related alignments have the same name but are distinct features
+ * so we sort by name  and make lists of these
+ * then we prepend an item to hold the start and end coord for the whole list
+ *   using a noddy structure (can't get at the list end thanks to glib)
+ * then we sort these into start coord then end coord reversed order
+ *
+ * The result replaces fset->masker_sorted_features.
+ */
+void zMapFeatureSetMaskerSort(ZMapFeatureSet fset)
+{
+  GList *l = NULL,*l_out = NULL;
+  GList *gl_start, *gl_end;
+  ZMapFeatureMaskSet align_set;
+  ZMapFeature f_start,f_end,f;
+
+  zMapReturnIfFail(fset) ;
+
+  zMapFeatureSetRevCompResolve(fset) ;
+
+  zMapFeatureSetMaskerFree(fset) ;
+
+  /* get pointers to all the features grouped according to name */
+  zMap_g_hash_table_get_data(&l, fset->features);
+  l = g_list_sort(l,nameOrderCB);
+
+  /* chop this list into lists per name group and strand
+   * sorted by start coordinate
+   * with a little header struct at the front
+   * then add to another list,
+   */
+
+  for(gl_start = l;gl_start;)
+    {
+      f_start = (ZMapFeature) gl_start->data;
+
+      for(gl_end = gl_start;gl_end;gl_end = gl_end->next)
+        {
+          f_end = (ZMapFeature) gl_end->data;
+          if(f_end->strand != f_start->strand)
+            break;
+          if(f_end->original_id != f_start->original_id)
+            break;
+        }
+
+      if(gl_end)
+        {
+          gl_end->prev->next = NULL;
+          gl_end->prev = NULL;
+        }
+
+      gl_start = g_list_sort(gl_start,fsetStartOrderCB);
+
+      align_set = g_new0(ZMapFeatureMaskSetStruct,1);
+      f = (ZMapFeature) gl_start->data;
+      align_set->id = f->original_id;
+      align_set->x1 = f->x1;
+
+      l_out = g_list_prepend(l_out, g_list_prepend(gl_start,align_set));
+      for(;gl_start;gl_start = gl_start->next)
+        {
+          f = (ZMapFeature) gl_start->data;
+          align_set->x2 = f->x2;
+        }
+
+      gl_start = gl_end;
+    }
+
+  /* order these lists by start coord and end coord reversed,
+   * merge sort is faster for this data+key combo than radix sort */
+  l_out = g_list_sort(l_out,fsetListOrderCB);
+
+  fset->masker_sorted_features = l_out ;
+  fset->masker_sorted_n_features = g_hash_table_size(fset->features) ;
+
+  return ;
+}
+
+
+/* Returns TRUE if the featureset has been sorted for masking and hasn't had features added
+ * or removed since. */
+gboolean zMapFeatureSetMaskerIsSorted(ZMapFeatureSet fset)
+{
+  gboolean result = FALSE ;
+
+  /* Lists made before a revcomp that is still pending have the old coords. */
+  if (fset && fset->masker_sorted_features && !fset->revcomp_pending
+      && fset->masker_sorted_n_features == g_hash_table_size(fset->features))
+    result = TRUE ;
+
+  return result ;
+}
+
+
+/* Frees the list of lists made by zMapFeatureSetMaskerSort(), the features are not touched. */
+void zMapFeatureSetMaskerFree(ZMapFeatureSet fset)
+{
+  GList *l ;
+
+  zMapReturnIfFail(fset) ;
+
+  if(fset->masker_sorted_features)
+    {
+      for(l = fset->masker_sorted_features;l;l = l->next)
+        {
+          GList *same_name = (GList *) l->data ;
+
+          g_free(same_name->data) ;                         /* the header */
+          g_list_free(same_name);
+        }
+      g_list_free(fset->masker_sorted_features);
+      fset->masker_sorted_features = NULL;
+    }
+
+  fset->masker_sorted_n_features = 0 ;
+
+  return ;
+}
+
+
+
+
+/*
+ *                    Internal routines
+ */
+
+
+/* order features by start coord then end coord reversed */
+/* regardless of strand this still works */
+static gint fsetListOrderCB(gconstpointer a, gconstpointer b)
+{
+  GList *la = (GList *) a;
+  GList *lb = (GList *) b;
+  ZMapFeatureMaskSet sa = (ZMapFeatureMaskSet) la->data;
+  ZMapFeatureMaskSet sb = (ZMapFeatureMaskSet) lb->data;
+
+  if(sa->x1 < sb->x1)
+    return(-1);
+  if(sa->x1 > sb->x1)
+    return(1);
+
+  if(sa->x2 > sb->x2)
+    return(-1);
+  if(sa->x2 < sb->x2)
+    return(1);
+  return(0);
+}
+
+
+/* order feature by start coord */
+static gint fsetStartOrderCB(gconstpointer a, gconstpointer b)
+{
+  ZMapFeature fa = (ZMapFeature) a;
+  ZMapFeature fb = (ZMapFeature) b;
+
+  if(fa->x1 < fb->x1)
+    return(-1);
+  if(fa->x1 > fb->x1)
+    return(1);
+  return(0);
+}
+
+
+/* sort features in random name order using thier id quarks
+ * we just want features with the same name to be together
+ */
+static gint nameOrderCB(gconstpointer a, gconstpointer b)
+{
+  ZMapFeature fa = (ZMapFeature) a;
+  ZMapFeature fb = (ZMapFeature) b;
+
+  if(fa->strand != fb->strand)
+    return((gint) fa->strand - (gint) fb->strand);
+
+  return ((gint) fa->original_id - (gint) fb->original_id);
+}
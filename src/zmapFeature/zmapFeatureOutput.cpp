@@ -668,10 +668,12 @@ static gboolean simple_context_print_cb(ZMapFeatureAny feature_any,
         if (feature_block->sequence.length > 0)
           {
             char *dna ;
+            int dna_len ;
 
-            dna = g_strndup(feature_block->sequence.sequence,
-                            (feature_block->sequence.length > MAX_DNA_LEN
-                             ? MAX_DNA_LEN : feature_block->sequence.length)) ;
+            dna_len = (feature_block->sequence.length > MAX_DNA_LEN
+                       ? MAX_DNA_LEN : feature_block->sequence.length) ;
+            dna = g_new0(char, dna_len + 1) ;
+            zMapFeatureBlockDNADecode(feature_block, 0, dna_len, dna) ;
 
             g_string_append_printf(dump_string_in_out,
                                    "          \t\"%s%s\"\n",
@@ -0,0 +1,414 @@
+/*  File: zmapFeatureSetIndex.cpp
+ *  Copyright (c) 2006-2017: Genome Research Ltd.
+ *-------------------------------------------------------------------
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------
+ * This file is part of the ZMap genome database package
+ * originally written by:
+ *
+ *      Ed Griffiths (Sanger Institute, UK) edgrif@sanger.ac.uk
+ *        Roy Storey (Sanger Institute, UK) rds@sanger.ac.uk
+ *   Malcolm Hinsley (Sanger Institute, UK) mh17@sanger.ac.uk
+ *       Gemma Guest (Sanger Institute, UK) gb10@sanger.ac.uk
+ *      Steve Miller (Sanger Institute, UK) sm23@sanger.ac.uk
+ *
+ * Description: Coordinate and name index for the features in a
+ *              featureset. The index is built the first time it is
+ *              needed and thrown away whenever the featureset is
+ *              changed so it costs nothing for sets that are never
+ *              queried.
+ *
+ *              The coordinate index is an implicit augmented interval
+ *              tree: the features are held in an array sorted by start
+ *              coord and each element also records the maximum end coord
+ *              of the subtree rooted at it, where the tree is laid out
+ *              in-order over the array (element i is at level k where k
+ *              is the number of trailing 1 bits in i). This gives
+ *              O(log n + k) overlap queries with no per-node allocation.
+ *
+ * Exported functions: See ZMap/zmapFeature.hpp
+ *-------------------------------------------------------------------
+ */
+
+#include <ZMap/zmap.hpp>
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include <zmapFeature_P.hpp>
+
+
+/* One entry per feature, coords are held half open, i.e. [start, end) so
+ * that start == x1, end == x2 + 1. */
+typedef struct IndexIntervalStructType
+{
+  int start ;
+  int end ;
+  int max ;                                                 /* max end in this subtree. */
+  ZMapFeature feature ;
+} IndexIntervalStruct, *IndexInterval ;
+
+
+/* The index itself, hung off the featureset. */
+typedef struct ZMapFeatureSetIndexStructType
+{
+  guint n_features ;                                        /* Size of features hash when built,
+                                                               used to catch unnotified changes. */
+  int max_level ;                                           /* Level of the root of the tree. */
+  std::vector<IndexIntervalStruct> intervals ;
+
+  gboolean names_built ;
+  std::unordered_map<GQuark, std::vector<ZMapFeature> > names ;
+} ZMapFeatureSetIndexStruct ;
+
+
+typedef struct
+{
+  GFunc func ;
+  gpointer user_data ;
+} ForeachDataStruct, *ForeachData ;
+
+
+static ZMapFeatureSetIndex getIndex(ZMapFeatureSet feature_set) ;
+static void buildNameIndex(ZMapFeatureSetIndex index) ;
+static bool intervalStartCmp(const IndexIntervalStruct &a, const IndexIntervalStruct &b) ;
+static int indexIntervals(std::vector<IndexIntervalStruct> &intervals) ;
+static void overlapSearch(ZMapFeatureSetIndex index, int start, int end, GFunc func, gpointer user_data) ;
+static void addToListCB(gpointer data, gpointer user_data) ;
+
+
+
+
+//
+//                External interface routines
+//
+
+
+/* Throw away the index, it will be rebuilt on the next query. Must be called by
+ * anything that adds/removes features or changes their coords in place. */
+void zMapFeatureSetIndexInvalidate(ZMapFeatureSet feature_set)
+{
+  if (!feature_set || !feature_set->index)
+    return ;
+
+  delete feature_set->index ;
+  feature_set->index = NULL ;
+
+  return ;
+}
+
+
+/* Call func for every feature in the featureset that overlaps start -> end (inclusive),
+ * features are visited in ascending order of their start coord. */
+void zMapFeatureSetForeachOverlap(ZMapFeatureSet feature_set, int start, int end,
+                                  GFunc func, gpointer user_data)
+{
+  ZMapFeatureSetIndex index ;
+
+  zMapReturnIfFail(feature_set && func) ;
+
+  if (start > end || !(index = getIndex(feature_set)))
+    return ;
+
+  overlapSearch(index, start, end, func, user_data) ;
+
+  return ;
+}
+
+
+/* Return a list of all features overlapping start -> end (inclusive) in ascending start
+ * order, the list should be freed with g_list_free(). Use zMapFeatureGetOverlapFeatures()
+ * on the result to restrict the type of overlap. */
+GList *zMapFeatureSetGetOverlapFeatures(ZMapFeatureSet feature_set, int start, int end)
+{
+  GList *feature_list = NULL ;
+
+  zMapFeatureSetForeachOverlap(feature_set, start, end, addToListCB, &feature_list) ;
+
+  feature_list = g_list_reverse(feature_list) ;
+
+  return feature_list ;
+}
+
+
+
+
+//
+//                Package routines
+//
+
+
+/* Return all features whose _start_ coord lies within start -> end (inclusive). */
+GList *zmapFeatureSetIndexGetStartFeatures(ZMapFeatureSet feature_set, int start, int end)
+{
+  GList *feature_list = NULL ;
+  ZMapFeatureSetIndex index ;
+
+  if (!(index = getIndex(feature_set)))
+    return feature_list ;
+
+  IndexIntervalStruct key ;
+  std::vector<IndexIntervalStruct>::iterator iter ;
+
+  key.start = start ;
+  iter = std::lower_bound(index->intervals.begin(), index->intervals.end(), key, intervalStartCmp) ;
+
+  for ( ; iter != index->intervals.end() && iter->start <= end ; ++iter)
+    feature_list = g_list_prepend(feature_list, iter->feature) ;
+
+  feature_list = g_list_reverse(feature_list) ;
+
+  return feature_list ;
+}
+
+
+/* Return all features with the given original_id, optionally restricted to a strand
+ * (pass ZMAPSTRAND_NONE for any strand). */
+GList *zmapFeatureSetIndexGetNamedFeatures(ZMapFeatureSet feature_set, GQuark original_id,
+                                           gboolean check_strand, ZMapStrand strand)
+{
+  GList *feature_list = NULL ;
+  ZMapFeatureSetIndex index ;
+
+  if (!(index = getIndex(feature_set)))
+    return feature_list ;
+
+  if (!index->names_built)
+    buildNameIndex(index) ;
+
+  std::unordered_map<GQuark, std::vector<ZMapFeature> >::iterator names_iter = index->names.find(original_id) ;
+
+  if (names_iter != index->names.end())
+    {
+      std::vector<ZMapFeature> &features = names_iter->second ;
+
+      for (std::vector<ZMapFeature>::reverse_iterator iter = features.rbegin() ; iter != features.rend() ; ++iter)
+        {
+          if (!check_strand || (*iter)->strand == strand)
+            feature_list = g_list_prepend(feature_list, *iter) ;
+        }
+    }
+
+  return feature_list ;
+}
+
+
+
+
+//
+//                Internal routines
+//
+
+
+/* Return the index for the featureset, building it if necessary. */
+static ZMapFeatureSetIndex getIndex(ZMapFeatureSet feature_set)
+{
+  ZMapFeatureSetIndex index = NULL ;
+  GHashTableIter iter ;
+  gpointer key, value ;
+
+  if (!feature_set || !feature_set->features)
+    return index ;
+
+  /* The index is built from the feature coords so they must be the right way round. */
+  zMapFeatureSetRevCompResolve(feature_set) ;
+
+  /* Belt and braces, catch additions/removals that went directly to the hash. */
+  if (feature_set->index && feature_set->index->n_features != g_hash_table_size(feature_set->features))
+    zMapFeatureSetIndexInvalidate(feature_set) ;
+
+  if (!(index = feature_set->index))
+    {
+      index = new ZMapFeatureSetIndexStruct ;
+      index->n_features = g_hash_table_size(feature_set->features) ;
+      index->names_built = FALSE ;
+      index->intervals.reserve(index->n_features) ;
+
+      g_hash_table_iter_init(&iter, feature_set->features) ;
+      while (g_hash_table_iter_next(&iter, &key, &value))
+        {
+          ZMapFeature feature = (ZMapFeature)value ;
+          IndexIntervalStruct interval ;
+
+          interval.start = feature->x1 ;
+          interval.end = feature->x2 + 1 ;
+          interval.max = interval.end ;
+          interval.feature = feature ;
+
+          index->intervals.push_back(interval) ;
+        }
+
+      std::stable_sort(index->intervals.begin(), index->intervals.end(), intervalStartCmp) ;
+
+      index->max_level = indexIntervals(index->intervals) ;
+
+      feature_set->index = index ;
+    }
+
+  return index ;
+}
+
+
+/* Names are only indexed when first asked for as many sets are only ever queried by coord. */
+static void buildNameIndex(ZMapFeatureSetIndex index)
+{
+  for (std::vector<IndexIntervalStruct>::iterator iter = index->intervals.begin() ;
+       iter != index->intervals.end() ; ++iter)
+    {
+      index->names[iter->feature->original_id].push_back(iter->feature) ;
+    }
+
+  index->names_built = TRUE ;
+
+  return ;
+}
+
+
+static bool intervalStartCmp(const IndexIntervalStruct &a, const IndexIntervalStruct &b)
+{
+  return a.start < b.start ;
+}
+
+
+/* Fill in the max end coord for each node of the implicit tree, the intervals must
+ * already be sorted by start. Returns the level of the root node or -1 if there are no
+ * intervals. */
+static int indexIntervals(std::vector<IndexIntervalStruct> &intervals)
+{
+  size_t n = intervals.size() ;
+  size_t i, last_i = 0 ;
+  int last = 0, k ;
+
+  if (!n)
+    return -1 ;
+
+  /* leaves (level 0) are at even indices. */
+  for (i = 0 ; i < n ; i += 2)
+    {
+      last_i = i ;
+      last = intervals[i].max = intervals[i].end ;
+    }
+
+  for (k = 1 ; ((size_t)1 << k) <= n ; ++k)
+    {
+      size_t x = (size_t)1 << (k - 1), i0 = (x << 1) - 1, step = x << 2 ;
+
+      for (i = i0 ; i < n ; i += step)
+        {
+          int el = intervals[i - x].max ;                              /* left child. */
+          int er = (i + x < n) ? intervals[i + x].max : last ;         /* right child. */
+          int e = intervals[i].end ;
+
+          e = (e > el ? e : el) ;
+          e = (e > er ? e : er) ;
+          intervals[i].max = e ;
+        }
+
+      /* the last node at this level may have a right subtree that falls off the end of the
+       * array so we carry its max along with us. */
+      last_i = ((last_i >> k) & 1) ? last_i - x : last_i + x ;
+      if (last_i < n && intervals[last_i].max > last)
+        last = intervals[last_i].max ;
+    }
+
+  return k - 1 ;
+}
+
+
+/* Visit all intervals overlapping [start, end] in ascending start order. */
+static void overlapSearch(ZMapFeatureSetIndex index, int start, int end, GFunc func, gpointer user_data)
+{
+  typedef struct
+  {
+    size_t x ;                                              /* node index */
+    int k ;                                                 /* node level */
+    gboolean visited ;                                      /* left child already done */
+  } StackItemStruct ;
+
+  std::vector<IndexIntervalStruct> &intervals = index->intervals ;
+  size_t n = intervals.size() ;
+  StackItemStruct stack[64] ;
+  int t = 0 ;
+  int query_start = start, query_end = end + 1 ;            /* half open */
+
+  if (!n)
+    return ;
+
+  stack[t].x = ((size_t)1 << index->max_level) - 1 ;
+  stack[t].k = index->max_level ;
+  stack[t].visited = FALSE ;
+  ++t ;
+
+  while (t)
+    {
+      StackItemStruct z = stack[--t] ;
+
+      if (z.k <= 3)
+        {
+          /* Small subtree, just scan it. */
+          size_t i, i0 = z.x >> z.k << z.k, i1 = i0 + ((size_t)1 << (z.k + 1)) - 1 ;
+
+          if (i1 >= n)
+            i1 = n ;
+
+          for (i = i0 ; i < i1 && intervals[i].start < query_end ; ++i)
+            {
+              if (query_start < intervals[i].end)
+                func(intervals[i].feature, user_data) ;
+            }
+        }
+      else if (!z.visited)
+        {
+          /* First visit, push ourselves back and then the left child if it can overlap. */
+          size_t y = z.x - ((size_t)1 << (z.k - 1)) ;
+
+          stack[t].x = z.x ;
+          stack[t].k = z.k ;
+          stack[t].visited = TRUE ;
+          ++t ;
+
+          if (y >= n || intervals[y].max > query_start)
+            {
+              stack[t].x = y ;
+              stack[t].k = z.k - 1 ;
+              stack[t].visited = FALSE ;
+              ++t ;
+            }
+        }
+      else if (z.x < n && intervals[z.x].start < query_end)
+        {
+          /* Left child done, now this node and then the right child. */
+          if (query_start < intervals[z.x].end)
+            func(intervals[z.x].feature, user_data) ;
+
+          stack[t].x = z.x + ((size_t)1 << (z.k - 1)) ;
+          stack[t].k = z.k - 1 ;
+          stack[t].visited = FALSE ;
+          ++t ;
+        }
+    }
+
+  return ;
+}
+
+
+/* A GFunc() to prepend features to a list. */
+static void addToListCB(gpointer data, gpointer user_data)
+{
+  GList **feature_list = (GList **)user_data ;
+
+  *feature_list = g_list_prepend(*feature_list, data) ;
+
+  return ;
+}
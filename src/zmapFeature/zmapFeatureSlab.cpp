@@ -0,0 +1,455 @@
+/*  File: zmapFeatureSlab.cpp
+ *  Copyright (c) 2006-2017: Genome Research Ltd.
+ *-------------------------------------------------------------------
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------
+ * This file is part of the ZMap genome database package
+ * originally written by:
+ *
+ *      Ed Griffiths (Sanger Institute, UK) edgrif@sanger.ac.uk
+ *        Roy Storey (Sanger Institute, UK) rds@sanger.ac.uk
+ *   Malcolm Hinsley (Sanger Institute, UK) mh17@sanger.ac.uk
+ *       Gemma Guest (Sanger Institute, UK) gb10@sanger.ac.uk
+ *      Steve Miller (Sanger Institute, UK) sm23@sanger.ac.uk
+ *
+ * Description: Slab allocator for the feature structs of a featureset
+ *              and accounting of the memory used by featuresets.
+ *
+ *              Loaders of large sets (e.g. bam reads) create their
+ *              features from the set's slab, this packs the features
+ *              of a set together and avoids a malloc per feature. The
+ *              slab is made of fixed size blocks aligned on their size
+ *              so the block (and hence slab) of any feature can be found
+ *              from the feature's address, features can therefore be
+ *              moved to other sets (e.g. by a context merge) and still
+ *              be freed individually. A slab is freed when its set has
+ *              gone and all of its features have been freed.
+ *
+ * Exported functions: See ZMap/zmapFeature.hpp
+ *-------------------------------------------------------------------
+ */
+
+#include <ZMap/zmap.hpp>
+
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+
+#include <ZMap/zmapUtils.hpp>
+#include <zmapFeature_P.hpp>
+
+
+
+/* Blocks are allocated aligned on their size, must be a power of 2. */
+#define SLAB_BLOCK_SIZE   (64 * 1024)
+
+/* Feature slots are rounded up to keep them pointer aligned. */
+#define SLAB_SLOT_SIZE    ((sizeof(ZMapFeatureStruct) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+
+/* Header at the start of every block, the feature slots follow it. */
+typedef struct SlabBlockStructType
+{
+  ZMapFeatureSlab slab ;
+  struct SlabBlockStructType *next ;
+} SlabBlockStruct, *SlabBlock ;
+
+#define SLAB_HEADER_SIZE  ((sizeof(SlabBlockStruct) + 63) & ~((size_t)63))
+
+
+/* Freed slots are chained through their first word. */
+typedef struct SlabFreeSlotStructType
+{
+  struct SlabFreeSlotStructType *next ;
+} SlabFreeSlotStruct, *SlabFreeSlot ;
+
+
+typedef struct ZMapFeatureSlabStructType
+{
+  std::mutex mutex ;                                        /* Features are allocated by the
+                                                               loading thread but may be freed
+                                                               by any thread. */
+
+  SlabBlock blocks ;                                        /* Newest first. */
+  int num_blocks ;
+
+  char *next_slot ;                                         /* Unused part of the newest block. */
+  char *end_slot ;
+
+  SlabFreeSlot free_slots ;
+
+  int num_live ;                                            /* Features allocated and not freed. */
+  int ref_count ;                                           /* Owners, i.e. featuresets. */
+} ZMapFeatureSlabStruct ;
+
+
+static void releaseBlocks(ZMapFeatureSlab slab) ;
+static bool addBlock(ZMapFeatureSlab slab) ;
+static gsize featureSubpartBytes(ZMapFeature feature) ;
+static gsize arrayBytes(GArray *array) ;
+static void addFeatureUsageCB(gpointer key, gpointer data, gpointer user_data) ;
+static ZMapFeatureContextExecuteStatus logSetUsageCB(GQuark key, gpointer data, gpointer user_data,
+                                                     char **error_out) ;
+
+
+
+
+/*
+ *                    External interface routines
+ */
+
+
+/* Returns the number of bytes used by the set's features, if usage_out is given then the
+ * figures are broken down. The figures do not include malloc overheads. */
+gsize zMapFeatureSetGetMemUsage(ZMapFeatureSet feature_set, ZMapFeatureSetMemUsage usage_out)
+{
+  ZMapFeatureSetMemUsageStruct usage = {0} ;
+
+  zMapReturnValIfFail(feature_set, 0) ;
+
+  if (feature_set->features)
+    g_hash_table_foreach(feature_set->features, addFeatureUsageCB, &usage) ;
+
+  if (feature_set->slab)
+    zmapFeatureSlabGetStats(feature_set->slab, &(usage.slab_bytes), &(usage.slab_features)) ;
+
+  if (usage_out)
+    *usage_out = usage ;
+
+  return usage.feature_bytes + usage.subpart_bytes ;
+}
+
+
+/* Logs the memory usage of every featureset in the context. */
+void zMapFeatureContextLogMemUsage(ZMapFeatureContext context)
+{
+  gsize total = 0 ;
+
+  zMapReturnIfFail(context) ;
+
+  zMapFeatureContextExecute((ZMapFeatureAny)context, ZMAPFEATURE_STRUCT_FEATURESET,
+                            logSetUsageCB, &total) ;
+
+  zMapLogMessage("Feature memory: total %" G_GSIZE_FORMAT " bytes", total) ;
+
+  return ;
+}
+
+
+
+/*
+ *                    Package routines
+ */
+
+
+ZMapFeatureSlab zmapFeatureSlabCreate()
+{
+  ZMapFeatureSlab slab ;
+
+  slab = new ZMapFeatureSlabStruct ;
+
+  slab->blocks = NULL ;
+  slab->num_blocks = 0 ;
+  slab->next_slot = slab->end_slot = NULL ;
+  slab->free_slots = NULL ;
+  slab->num_live = 0 ;
+  slab->ref_count = 1 ;
+
+  return slab ;
+}
+
+
+/* The slab is only freed once all its features have been freed as well. */
+void zmapFeatureSlabUnref(ZMapFeatureSlab slab)
+{
+  bool destroy ;
+
+  {
+    std::lock_guard<std::mutex> lock(slab->mutex) ;
+
+    slab->ref_count-- ;
+
+    destroy = (!slab->ref_count && !slab->num_live) ;
+  }
+
+  if (destroy)
+    {
+      releaseBlocks(slab) ;
+
+      delete slab ;
+    }
+
+  return ;
+}
+
+
+/* Returns a zeroed feature struct with flags.slab_alloc set or NULL if memory could not be
+ * allocated. */
+ZMapFeature zmapFeatureSlabAlloc(ZMapFeatureSlab slab)
+{
+  ZMapFeature feature = NULL ;
+  std::lock_guard<std::mutex> lock(slab->mutex) ;
+
+  if (slab->free_slots)
+    {
+      feature = (ZMapFeature)(slab->free_slots) ;
+      slab->free_slots = slab->free_slots->next ;
+    }
+  else if (slab->next_slot + SLAB_SLOT_SIZE <= slab->end_slot || addBlock(slab))
+    {
+      feature = (ZMapFeature)(slab->next_slot) ;
+      slab->next_slot += SLAB_SLOT_SIZE ;
+    }
+
+  if (feature)
+    {
+      memset(feature, 0, sizeof(ZMapFeatureStruct)) ;
+      feature->flags.slab_alloc = TRUE ;
+
+      slab->num_live++ ;
+    }
+
+  return feature ;
+}
+
+
+/* Return a feature allocated by zmapFeatureSlabAlloc() to its slab, the feature's own
+ * resources must already have been freed. */
+void zmapFeatureSlabFree(ZMapFeature feature)
+{
+  SlabBlock block = (SlabBlock)((guintptr)feature & ~((guintptr)SLAB_BLOCK_SIZE - 1)) ;
+  ZMapFeatureSlab slab = block->slab ;
+  SlabFreeSlot slot = (SlabFreeSlot)feature ;
+  bool destroy ;
+
+  {
+    std::lock_guard<std::mutex> lock(slab->mutex) ;
+
+    slot->next = slab->free_slots ;
+    slab->free_slots = slot ;
+
+    slab->num_live-- ;
+
+    destroy = (!slab->ref_count && !slab->num_live) ;
+  }
+
+  if (destroy)
+    {
+      releaseBlocks(slab) ;
+
+      delete slab ;
+    }
+
+  return ;
+}
+
+
+/* Give the slab's memory back en bloc if all its features have been freed, e.g. after
+ * the featureset's features have been destroyed. */
+void zmapFeatureSlabTrim(ZMapFeatureSlab slab)
+{
+  std::lock_guard<std::mutex> lock(slab->mutex) ;
+
+  if (!slab->num_live)
+    releaseBlocks(slab) ;
+
+  return ;
+}
+
+
+void zmapFeatureSlabGetStats(ZMapFeatureSlab slab, gsize *bytes_out, int *num_live_out)
+{
+  std::lock_guard<std::mutex> lock(slab->mutex) ;
+
+  if (bytes_out)
+    *bytes_out = (gsize)(slab->num_blocks) * SLAB_BLOCK_SIZE ;
+
+  if (num_live_out)
+    *num_live_out = slab->num_live ;
+
+  return ;
+}
+
+
+
+
+/*
+ *                    Internal routines
+ */
+
+
+/* Must be called with the slab locked (or when no-one else can see it). */
+static void releaseBlocks(ZMapFeatureSlab slab)
+{
+  SlabBlock block, next ;
+
+  for (block = slab->blocks ; block ; block = next)
+    {
+      next = block->next ;
+
+      free(block) ;
+    }
+
+  slab->blocks = NULL ;
+  slab->num_blocks = 0 ;
+  slab->next_slot = slab->end_slot = NULL ;
+  slab->free_slots = NULL ;
+
+  return ;
+}
+
+
+/* Must be called with the slab locked. */
+static bool addBlock(ZMapFeatureSlab slab)
+{
+  bool result = false ;
+  void *mem = NULL ;
+  int status ;
+
+  if ((status = posix_memalign(&mem, SLAB_BLOCK_SIZE, SLAB_BLOCK_SIZE)) != 0)
+    {
+      zMapLogCriticalSysErr(status, "%s", "Could not allocate feature slab block") ;
+    }
+  else
+    {
+      SlabBlock block = (SlabBlock)mem ;
+
+      block->slab = slab ;
+      block->next = slab->blocks ;
+      slab->blocks = block ;
+      slab->num_blocks++ ;
+
+      slab->next_slot = (char *)block + SLAB_HEADER_SIZE ;
+      slab->end_slot = (char *)block + SLAB_BLOCK_SIZE ;
+
+      result = true ;
+    }
+
+  return result ;
+}
+
+
+static void addFeatureUsageCB(gpointer key, gpointer data, gpointer user_data)
+{
+  ZMapFeature feature = (ZMapFeature)data ;
+  ZMapFeatureSetMemUsage usage = (ZMapFeatureSetMemUsage)user_data ;
+
+  usage->num_features++ ;
+  usage->feature_bytes += sizeof(ZMapFeatureStruct) ;
+  usage->subpart_bytes += featureSubpartBytes(feature) ;
+
+  return ;
+}
+
+
+/* Bytes held by the feature outside of its struct. */
+static gsize featureSubpartBytes(ZMapFeature feature)
+{
+  gsize bytes = 0 ;
+
+  if (feature->description)
+    bytes += strlen(feature->description) + 1 ;
+  if (feature->url)
+    bytes += strlen(feature->url) + 1 ;
+
+  bytes += g_list_length(feature->children) * sizeof(GList) ;
+
+  switch (feature->mode)
+    {
+    case ZMAPSTYLE_MODE_BASIC:
+      {
+        if (feature->feature.basic.variation_str)
+          bytes += strlen(feature->feature.basic.variation_str) + 1 ;
+
+        break ;
+      }
+    case ZMAPSTYLE_MODE_ALIGNMENT:
+      {
+        if (feature->feature.homol.sequence)
+          bytes += strlen(feature->feature.homol.sequence) + 1 ;
+
+        bytes += arrayBytes(feature->feature.homol.align) ;
+
+        break ;
+      }
+    case ZMAPSTYLE_MODE_TRANSCRIPT:
+      {
+        GArray *exon_aligns = feature->feature.transcript.exon_aligns ;
+
+        bytes += arrayBytes(feature->feature.transcript.exons) ;
+        bytes += arrayBytes(feature->feature.transcript.introns) ;
+
+        if (exon_aligns)
+          {
+            guint i ;
+
+            bytes += arrayBytes(exon_aligns) ;
+
+            for (i = 0 ; i < exon_aligns->len ; i++)
+              bytes += arrayBytes(g_array_index(exon_aligns, GArray *, i)) ;
+          }
+
+        break ;
+      }
+    case ZMAPSTYLE_MODE_ASSEMBLY_PATH:
+      {
+        bytes += arrayBytes(feature->feature.assembly_path.path) ;
+
+        break ;
+      }
+    default:
+      {
+        break ;
+      }
+    }
+
+  return bytes ;
+}
+
+
+/* Bytes in use by an array, GArray does not tell us how much it has reserved. */
+static gsize arrayBytes(GArray *array)
+{
+  gsize bytes = 0 ;
+
+  if (array)
+    bytes = sizeof(GArray) + (gsize)(array->len) * g_array_get_element_size(array) ;
+
+  return bytes ;
+}
+
+
+static ZMapFeatureContextExecuteStatus logSetUsageCB(GQuark key, gpointer data, gpointer user_data,
+                                                     char **error_out)
+{
+  ZMapFeatureAny feature_any = (ZMapFeatureAny)data ;
+  gsize *total = (gsize *)user_data ;
+
+  if (feature_any->struct_type == ZMAPFEATURE_STRUCT_FEATURESET)
+    {
+      ZMapFeatureSet feature_set = (ZMapFeatureSet)feature_any ;
+      ZMapFeatureSetMemUsageStruct usage ;
+      gsize bytes ;
+
+      bytes = zMapFeatureSetGetMemUsage(feature_set, &usage) ;
+      *total += bytes ;
+
+      zMapLogMessage("Feature memory: \"%s\" %d features, %" G_GSIZE_FORMAT " bytes"
+                     " (structs %" G_GSIZE_FORMAT ", subparts %" G_GSIZE_FORMAT
+                     ", slab %" G_GSIZE_FORMAT " for %d features)",
+                     g_quark_to_string(feature_set->original_id), usage.num_features, bytes,
+                     usage.feature_bytes, usage.subpart_bytes, usage.slab_bytes, usage.slab_features) ;
+    }
+
+  return ZMAP_CONTEXT_EXEC_STATUS_OK ;
+}
@@ -770,6 +770,8 @@ ZMapFeatureContextExecuteStatus zMapFeatureContextTranscriptSortExons(GQuark key
         if(!style || zMapStyleGetMode(style) != ZMAPSTYLE_MODE_TRANSCRIPT)
           break;
 
+        zMapFeatureSetRevCompResolve(feature_set) ;
+
         zMap_g_hash_table_get_data(&features, feature_set->features);
 
         for ( ; features; features = g_list_delete_link(features, features))
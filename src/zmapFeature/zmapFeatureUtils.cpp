@@ -580,7 +580,7 @@ GQuark zMapFeatureCreateID(ZMapStyleMode feature_type,
   if ((feature_name = zMapFeatureCreateName(feature_type, feature, strand, start, end,
     query_start, query_end)))
     {
-      feature_id = g_quark_from_string(feature_name) ;
+      feature_id = zmapFeatureInternID(feature_name) ;
       g_free(feature_name) ;
     }
 
@@ -52,7 +52,7 @@ typedef struct
 ZMapFeatureAny zmapFeatureAnyCreateFeature(ZMapFeatureLevelType feature_type,
                                            ZMapFeatureAny parent,
                                            GQuark original_id, GQuark unique_id,
-                                           GHashTable *children) ;
+                                           GHashTable *children, ZMapFeatureSlab slab = NULL) ;
 ZMapFeatureAny zmapFeatureAnyCopy(ZMapFeatureAny orig_feature_any, GDestroyNotify destroy_cb) ;
 void zmapDestroyFeatureAny(gpointer data) ;
 gboolean zmapFeatureAnyAddFeature(ZMapFeatureAny feature_any, ZMapFeatureAny feature) ;
@@ -68,8 +68,23 @@ void zmapPrintFeatureContext(ZMapFeatureContext context) ;
 
 
 
+void zmapFeatureSetsForEachThreaded(GList *feature_sets, int min_threaded_features,
+                                    GFunc set_func, gpointer user_data) ;
 void zmapFeatureBlockAddEmptySets(ZMapFeatureBlock ref, ZMapFeatureBlock block, GList *feature_set_names) ;
 
+ZMapFeatureSlab zmapFeatureSlabCreate() ;
+void zmapFeatureSlabUnref(ZMapFeatureSlab slab) ;
+ZMapFeature zmapFeatureSlabAlloc(ZMapFeatureSlab slab) ;
+void zmapFeatureSlabFree(ZMapFeature feature) ;
+void zmapFeatureSlabTrim(ZMapFeatureSlab slab) ;
+void zmapFeatureSlabGetStats(ZMapFeatureSlab slab, gsize *bytes_out, int *num_live_out) ;
+
+GQuark zmapFeatureInternID(const char *unique_name) ;
+
+GList *zmapFeatureSetIndexGetStartFeatures(ZMapFeatureSet feature_set, int start, int end) ;
+GList *zmapFeatureSetIndexGetNamedFeatures(ZMapFeatureSet feature_set, GQuark original_id,
+                                           gboolean check_strand, ZMapStrand strand) ;
+
 
 
 void zmapFeature3FrameTranslationSetRevComp(ZMapFeatureSet feature_set, int block_start, int block_end) ;
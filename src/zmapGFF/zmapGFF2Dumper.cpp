@@ -34,6 +34,12 @@
 
 #include <string.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include <ZMap/zmapUtils.hpp>
 #include <ZMap/zmapFeature.hpp>
 #include <ZMap/zmapSO.hpp>
@@ -90,7 +96,7 @@ static ZMapFeatureContextExecuteStatus get_type_seq_header_cb(GQuark key, gpoint
   gpointer user_data, char **err_out) ;
 static ZMapFeatureContextExecuteStatus get_featuresets_from_ids_cb(GQuark key, gpointer data,
   gpointer user_data, char **err_out) ;
-static void add_feature_to_list_cb(gpointer key, gpointer value, gpointer user_data) ;
+static void add_feature_to_array_cb(gpointer key, gpointer value, gpointer user_data) ;
 
 
 /*
@@ -107,7 +113,7 @@ static void deleteFeaturesetSearch(FeaturesetSearch *) ;
 
 typedef struct FeatureSearchStruct_
   {
-    GList *results ;
+    GPtrArray *results ;
     ZMapSpan region_span ;
   } FeatureSearchStruct, *FeatureSearch ;
 static FeatureSearch createFeatureSearch() ;
@@ -125,6 +131,45 @@ static gboolean dump_gff_cb(ZMapFeatureAny feature_any, ZMapStyleTree  *styles,
 
 static void formatGap2GFF(GString *attribute, GArray *gaps, ZMapStrand q_strand, ZMapSequenceType match_seq_type) ;
 
+static gboolean isDumpedFeatureset(ZMapFeatureSet featureset) ;
+static gboolean formatFeature(ZMapFeature feature, ZMapGFFFormatData format_data, GString *line) ;
+
+
+/*
+ * Parallel dumping. The features to be dumped are put in an array in output order
+ * and split into chunks, threads take the next chunk and format it into their own
+ * buffer while the calling thread writes the finished chunks to file in order.
+ * Threads can only get so far ahead of the writer so memory use is bounded.
+ */
+#define DUMP_CHUNK_FEATURES 4096
+#define DUMP_MIN_THREADED_FEATURES 20000
+#define DUMP_CHUNKS_AHEAD_PER_THREAD 4
+
+typedef struct ParallelDumpStruct_
+{
+  GPtrArray *features ;                                     /* In output order. */
+
+  int num_chunks ;
+  int max_ahead ;
+  std::atomic<int> next_chunk ;                             /* Next one for a thread to format. */
+
+  std::mutex mutex ;                                        /* Protects everything below. */
+  std::condition_variable chunk_formatted ;
+  std::condition_variable chunk_written ;
+  std::vector<GString *> chunks ;                           /* NULL until formatted. */
+  std::vector<char> chunk_ok ;
+  int chunks_written ;
+  std::atomic<bool> failed ;                                /* Also read by threads while formatting. */
+
+} ParallelDumpStruct, *ParallelDump ;
+
+static gboolean dumpFeaturesetsParallel(ZMapFeatureAny feature_any, GList *featuresets,
+                                        ZMapSpan region_span, gboolean empty_ok,
+                                        GIOChannel *file, GError **error_out) ;
+static ZMapFeatureContextExecuteStatus get_dumped_featuresets_cb(GQuark key, gpointer data,
+                                                                 gpointer user_data, char **err_out) ;
+static void formatChunksThread(ParallelDump dump_data) ;
+
 
 
 //
@@ -168,7 +213,7 @@ gboolean zMapGFFDump(ZMapFeatureAny dump_set, ZMapStyleTree &styles, GIOChannel
 {
   gboolean result = TRUE;
 
-  result = zMapGFFDumpRegion(dump_set, styles, NULL, file, error_out);
+  result = zMapGFFDumpRegionParallel(dump_set, styles, NULL, file, error_out);
 
   return result;
 }
@@ -217,6 +262,43 @@ gboolean zMapGFFDumpRegion(ZMapFeatureAny dump_set, ZMapStyleTree &styles,
 
 
 
+/*
+ * Same output as zMapGFFDumpRegion() but for large contexts the features are formatted
+ * by several threads and written out in big blocks rather than a line at a time.
+ * Works from a block or above, anything lower goes to zMapGFFDumpRegion().
+ */
+gboolean zMapGFFDumpRegionParallel(ZMapFeatureAny dump_set, ZMapStyleTree &styles,
+                                   ZMapSpan region_span, GIOChannel *file, GError **error_out)
+{
+  gboolean result = FALSE ;
+  GList *featuresets = NULL ;
+
+  zMapReturnValIfFail(   file && dump_set
+                      && (dump_set->struct_type != ZMAPFEATURE_STRUCT_INVALID)
+                      && error_out,
+                                  result) ;
+
+  if (dump_set->struct_type > ZMAPFEATURE_STRUCT_BLOCK)
+    {
+      result = zMapGFFDumpRegion(dump_set, styles, region_span, file, error_out) ;
+    }
+  else
+    {
+      zMapFeatureContextExecuteSubset(dump_set, ZMAPFEATURE_STRUCT_FEATURESET,
+                                      get_dumped_featuresets_cb, &featuresets) ;
+
+      featuresets = g_list_reverse(featuresets) ;
+
+      result = dumpFeaturesetsParallel(dump_set, featuresets, region_span, TRUE, file, error_out) ;
+
+      g_list_free(featuresets) ;
+    }
+
+  return result ;
+}
+
+
+
 /*
  * Dumps a list of featuresets in a given region.
  *
@@ -228,11 +310,7 @@ gboolean zMapGFFDumpFeatureSets(ZMapFeatureAny feature_any, ZMapStyleTree &style
   GList* featuresets, ZMapSpan region_span, GIOChannel *file, GError **error_out)
 {
   gboolean result = FALSE ;
-  char *sequence = NULL ;
-  GList *list_pos = NULL ;
   FeaturesetSearch fs_data = NULL ;
-  FeatureSearch f_data = NULL ;
-  ZMapFeatureSet featureset = NULL ;
 
   zMapReturnValIfFail(    feature_any
                        && (feature_any->struct_type == ZMAPFEATURE_STRUCT_CONTEXT)
@@ -264,44 +342,19 @@ gboolean zMapGFFDumpFeatureSets(ZMapFeatureAny feature_any, ZMapStyleTree &style
     }
 
   /*
-   * Now add all of the features from our hard-won search results to
-   * the features_list GList. This section will set result = FALSE if
-   * no features were found.
+   * Now dump the features from our hard-won search results to file,
+   * this fails if there are no features to dump.
    */
   if (result)
     {
-      f_data = createFeatureSearch() ;
-      if (f_data)
-        {
-          f_data->region_span = region_span ;
-          for (list_pos = fs_data->results; list_pos != NULL; list_pos = list_pos->next)
-            {
-              featureset = (ZMapFeatureSet) list_pos->data ;
-              g_hash_table_foreach(featureset->features, add_feature_to_list_cb, f_data);
-            }
-
-          if (!f_data->results || !g_list_length(f_data->results))
-            result = FALSE ;
-        }
-    }
+      fs_data->results = g_list_reverse(fs_data->results) ;
 
-  if (!result)
-    {
-      *error_out = g_error_new(g_quark_from_string("ERROR in zMapGFFDumpFeatureSets(); "),
-                                   (gint)0, " no features found.") ;
-    }
-
-  /*
-   * Now dump the features to file.
-   */
-  if (result)
-    {
-      result = zMapGFFDumpList(f_data->results, styles, sequence, file, NULL, error_out) ;
+      result = dumpFeaturesetsParallel(feature_any, fs_data->results, region_span, FALSE, file, error_out) ;
       if (!result)
         {
           if (*error_out)
             {
-              g_prefix_error(error_out, "Error in zMapGFFDumpFeatureSets() calling zMapGFFDumpList(); ") ;
+              g_prefix_error(error_out, "Error in zMapGFFDumpFeatureSets() calling dumpFeaturesetsParallel(); ") ;
             }
         }
     }
@@ -310,7 +363,6 @@ gboolean zMapGFFDumpFeatureSets(ZMapFeatureAny feature_any, ZMapStyleTree &style
    * Clear up on finish.
    */
   deleteFeaturesetSearch(&fs_data) ;
-  deleteFeatureSearch(&f_data) ;
 
   return result ;
 }
@@ -480,12 +532,12 @@ static ZMapFeatureContextExecuteStatus
  * This is a callback used in the call of g_hash_foreach() on a featureset->features
  * hash table. We take search data from an instance of FeatureSearchStruct; first
  * check that we have a valid feature, check that the feature overlaps the ZMapSpan
- * and then add the feature to the associated GList of results.
+ * and then add the feature to the associated array of results.
  *
  * FeatureSearchStruct.region_span      ZMapSpan; if valid check features against this
- * FeatureSearchStruct.results          GList* of feature pointer (if any found)
+ * FeatureSearchStruct.results          GPtrArray* of feature pointer (if any found)
  */
-static void add_feature_to_list_cb(gpointer key, gpointer value, gpointer user_data)
+static void add_feature_to_array_cb(gpointer key, gpointer value, gpointer user_data)
 {
   ZMapFeatureAny feature_any = NULL ;
   ZMapFeature feature = NULL ;
@@ -509,7 +561,7 @@ static void add_feature_to_list_cb(gpointer key, gpointer value, gpointer user_d
         }
       if (include_feature)
         {
-          f_data->results = g_list_prepend(f_data->results, (gpointer)feature_any) ;
+          g_ptr_array_add(f_data->results, (gpointer)feature_any) ;
         }
     }
 }
@@ -598,58 +650,8 @@ static gboolean dump_gff_cb(ZMapFeatureAny feature_any,
           /*
            * some sources to be skipped
            */
-          GQuark gqFeatureset = featureset->original_id ;
-          if(   (gqFeatureset == g_quark_from_string("Locus"))
-             || (gqFeatureset == g_quark_from_string("Show Translation"))
-             || (gqFeatureset == g_quark_from_string("3 Frame Translation"))
-             || (gqFeatureset == g_quark_from_string("Annotation"))
-             || (gqFeatureset == g_quark_from_string("ORF"))
-             || (gqFeatureset == g_quark_from_string("DNA"))   )
-            break;
-
-          /*
-           * Now switch upon ZMapStyleMode and do attributes
-           */
-          switch(feature->mode)
-            {
-              case ZMAPSTYLE_MODE_BASIC:
-                {
-                  result = zMapGFFFormatAttributeSetBasic(format_data->attribute_flags)
-                        && zMapGFFWriteFeatureBasic(feature, format_data->attribute_flags,
-                                                    line, format_data->flags.over_write) ;
-                }
-                break;
-              case ZMAPSTYLE_MODE_TRANSCRIPT:
-                {
-                  result = zMapGFFFormatAttributeSetTranscript(format_data->attribute_flags)
-                        && zMapGFFWriteFeatureTranscript(feature, format_data->attribute_flags,
-                                                         line, format_data->flags.over_write) ;
-                }
-                break;
-              case ZMAPSTYLE_MODE_ALIGNMENT:
-                {
-                  result = zMapGFFFormatAttributeSetAlignment(format_data->attribute_flags)
-                        && zMapGFFWriteFeatureAlignment(feature, format_data->attribute_flags,
-                                                        line, format_data->flags.over_write, NULL) ;
-                }
-                break;
-              case ZMAPSTYLE_MODE_TEXT:
-                {
-                  result = zMapGFFFormatAttributeSetText(format_data->attribute_flags)
-                        && zMapGFFWriteFeatureText(feature, format_data->attribute_flags,
-                                                   line, format_data->flags.over_write ) ;
-                }
-                break;
-              case ZMAPSTYLE_MODE_GRAPH:
-                {
-                  result = zMapGFFFormatAttributeSetGraph(format_data->attribute_flags)
-                        && zMapGFFWriteFeatureGraph(feature, format_data->attribute_flags,
-                                                    line, format_data->flags.over_write ) ;
-                }
-                break;
-              default:
-                break;
-            }
+          if (isDumpedFeatureset(featureset))
+            result = formatFeature(feature, format_data, line) ;
           }
         break;
       default:
@@ -660,6 +662,303 @@ static gboolean dump_gff_cb(ZMapFeatureAny feature_any,
   return result;
 }
 
+
+/*
+ * Some sources are not dumped, they are zmap's own or made from the dna.
+ */
+static gboolean isDumpedFeatureset(ZMapFeatureSet featureset)
+{
+  static GQuark skipped_ids[6] ;
+  static gsize skipped_init = 0 ;
+  gboolean result = TRUE ;
+  unsigned int i ;
+
+  if (g_once_init_enter(&skipped_init))
+    {
+      skipped_ids[0] = g_quark_from_string("Locus") ;
+      skipped_ids[1] = g_quark_from_string("Show Translation") ;
+      skipped_ids[2] = g_quark_from_string("3 Frame Translation") ;
+      skipped_ids[3] = g_quark_from_string("Annotation") ;
+      skipped_ids[4] = g_quark_from_string("ORF") ;
+      skipped_ids[5] = g_quark_from_string("DNA") ;
+
+      g_once_init_leave(&skipped_init, 1) ;
+    }
+
+  for (i = 0 ; result && i < G_N_ELEMENTS(skipped_ids) ; i++)
+    {
+      if (featureset->original_id == skipped_ids[i])
+        result = FALSE ;
+    }
+
+  return result ;
+}
+
+
+/*
+ * Format one feature into line, the attributes output are chosen from the feature's
+ * mode and recorded in format_data->attribute_flags so each thread formatting
+ * features must have its own format_data.
+ */
+static gboolean formatFeature(ZMapFeature feature, ZMapGFFFormatData format_data, GString *line)
+{
+  gboolean result = TRUE ;
+
+  /*
+   * Now switch upon ZMapStyleMode and do attributes
+   */
+  switch(feature->mode)
+    {
+      case ZMAPSTYLE_MODE_BASIC:
+        {
+          result = zMapGFFFormatAttributeSetBasic(format_data->attribute_flags)
+                && zMapGFFWriteFeatureBasic(feature, format_data->attribute_flags,
+                                            line, format_data->flags.over_write) ;
+        }
+        break;
+      case ZMAPSTYLE_MODE_TRANSCRIPT:
+        {
+          result = zMapGFFFormatAttributeSetTranscript(format_data->attribute_flags)
+                && zMapGFFWriteFeatureTranscript(feature, format_data->attribute_flags,
+                                                 line, format_data->flags.over_write) ;
+        }
+        break;
+      case ZMAPSTYLE_MODE_ALIGNMENT:
+        {
+          result = zMapGFFFormatAttributeSetAlignment(format_data->attribute_flags)
+                && zMapGFFWriteFeatureAlignment(feature, format_data->attribute_flags,
+                                                line, format_data->flags.over_write, NULL) ;
+        }
+        break;
+      case ZMAPSTYLE_MODE_TEXT:
+        {
+          result = zMapGFFFormatAttributeSetText(format_data->attribute_flags)
+                && zMapGFFWriteFeatureText(feature, format_data->attribute_flags,
+                                           line, format_data->flags.over_write ) ;
+        }
+        break;
+      case ZMAPSTYLE_MODE_GRAPH:
+        {
+          result = zMapGFFFormatAttributeSetGraph(format_data->attribute_flags)
+                && zMapGFFWriteFeatureGraph(feature, format_data->attribute_flags,
+                                            line, format_data->flags.over_write ) ;
+        }
+        break;
+      default:
+        break;
+    }
+
+  return result ;
+}
+
+
+/*
+ * Collects the featuresets to be dumped in the order zMapFeatureContextExecuteSubset()
+ * visits them, the list is built backwards.
+ */
+static ZMapFeatureContextExecuteStatus get_dumped_featuresets_cb(GQuark key, gpointer data,
+                                                                 gpointer user_data, char **err_out)
+{
+  ZMapFeatureContextExecuteStatus status = ZMAP_CONTEXT_EXEC_STATUS_OK ;
+  ZMapFeatureAny feature_any = (ZMapFeatureAny)data ;
+  GList **featuresets_inout = (GList **)user_data ;
+
+  if (feature_any->struct_type == ZMAPFEATURE_STRUCT_FEATURESET
+      && isDumpedFeatureset((ZMapFeatureSet)feature_any))
+    *featuresets_inout = g_list_prepend(*featuresets_inout, feature_any) ;
+
+  return status ;
+}
+
+
+/*
+ * Dump the features of the featuresets, that overlap region_span if it's given, to file
+ * with a header for feature_any's block, it's an error if there are no features unless
+ * empty_ok is TRUE. Features are dumped in featureset order and
+ * then in the order they are held in the featureset so the output is the same however
+ * many threads are used.
+ */
+static gboolean dumpFeaturesetsParallel(ZMapFeatureAny feature_any, GList *featuresets,
+                                        ZMapSpan region_span, gboolean empty_ok,
+                                        GIOChannel *file, GError **error_out)
+{
+  gboolean result = FALSE ;
+  ZMapGFFFormatData format_data = NULL ;
+  FeatureSearch f_data = NULL ;
+  GList *l ;
+  int num_threads = 0, i ;
+
+  if ((format_data = createGFFFormatData()))
+    {
+      format_data->sequence = NULL ;
+      format_data->flags.cont       = TRUE;
+      format_data->flags.status     = TRUE;
+      format_data->flags.over_write = TRUE ;
+      result = dump_full_header(feature_any, file, format_data, error_out) ;
+
+      deleteGFFFormatData(&format_data) ;
+    }
+
+  if (result)
+    {
+      f_data = createFeatureSearch() ;
+      f_data->region_span = region_span ;
+
+      for (l = featuresets ; l ; l = l->next)
+        {
+          ZMapFeatureSet featureset = (ZMapFeatureSet)(l->data) ;
+
+          if (isDumpedFeatureset(featureset))
+            {
+              zMapFeatureSetRevCompResolve(featureset) ;
+
+              g_hash_table_foreach(featureset->features, add_feature_to_array_cb, f_data) ;
+            }
+        }
+
+      if (!f_data->results->len && !empty_ok)
+        {
+          result = FALSE ;
+          *error_out = g_error_new(g_quark_from_string("ERROR in dumpFeaturesetsParallel(); "),
+                                   (gint)0, " no features found.") ;
+        }
+    }
+
+  if (result && f_data->results->len)
+    {
+      ParallelDumpStruct dump_data ;
+      std::vector<std::thread> threads ;
+      char *error_msg = NULL ;
+
+      dump_data.features = f_data->results ;
+      dump_data.num_chunks = (f_data->results->len + DUMP_CHUNK_FEATURES - 1) / DUMP_CHUNK_FEATURES ;
+      dump_data.next_chunk = 0 ;
+      dump_data.chunks.resize(dump_data.num_chunks, NULL) ;
+      dump_data.chunk_ok.resize(dump_data.num_chunks, TRUE) ;
+      dump_data.chunks_written = 0 ;
+      dump_data.failed = false ;
+
+      /* Small dumps get one thread to format while this one writes. */
+      num_threads = zMapUtilsSysGetNumThreads((int)f_data->results->len, DUMP_MIN_THREADED_FEATURES,
+                                              dump_data.num_chunks) ;
+      dump_data.max_ahead = num_threads * DUMP_CHUNKS_AHEAD_PER_THREAD ;
+
+      for (i = 0 ; i < num_threads ; i++)
+        threads.push_back(std::thread(formatChunksThread, &dump_data)) ;
+
+      /* Write the chunks out in order as they are finished. */
+      for (i = 0 ; result && i < dump_data.num_chunks ; i++)
+        {
+          GString *chunk ;
+          std::unique_lock<std::mutex> lock(dump_data.mutex) ;
+
+          dump_data.chunk_formatted.wait(lock, [&dump_data, i] { return dump_data.chunks[i] != NULL ; }) ;
+
+          chunk = dump_data.chunks[i] ;
+          dump_data.chunks[i] = NULL ;
+
+          if (!dump_data.chunk_ok[i])
+            {
+              result = FALSE ;
+              *error_out = g_error_new(g_quark_from_string("ERROR in dumpFeaturesetsParallel(); "),
+                                       (gint)0, " could not format features.") ;
+            }
+
+          lock.unlock() ;
+
+          if (result && chunk->len)
+            {
+              result = zMapGFFOutputWriteLineToGIO(file, &error_msg, chunk, FALSE) ;
+
+              if (error_msg)
+                {
+                  *error_out = g_error_new(g_quark_from_string("ERROR in dumpFeaturesetsParallel()"),
+                                           (gint)0, "message was '%s'", error_msg ) ;
+                  g_free(error_msg) ;
+                  error_msg = NULL ;
+                }
+            }
+
+          g_string_free(chunk, TRUE) ;
+
+          lock.lock() ;
+
+          dump_data.chunks_written++ ;
+          if (!result)
+            dump_data.failed = true ;
+
+          dump_data.chunk_written.notify_all() ;
+        }
+
+      for (auto &thread : threads)
+        thread.join() ;
+
+      /* Anything formatted after a failure. */
+      for (auto chunk : dump_data.chunks)
+        {
+          if (chunk)
+            g_string_free(chunk, TRUE) ;
+        }
+
+      if (result && g_io_channel_flush(file, error_out) != G_IO_STATUS_NORMAL)
+        result = FALSE ;
+    }
+
+  deleteFeatureSearch(&f_data) ;
+
+  return result ;
+}
+
+
+/*
+ * Format chunks of features until there are none left, not getting too far ahead of the
+ * chunks that have been written.
+ */
+static void formatChunksThread(ParallelDump dump_data)
+{
+  ZMapGFFFormatData format_data ;
+  int chunk ;
+
+  format_data = createGFFFormatData() ;
+  format_data->flags.over_write = FALSE ;
+
+  while ((chunk = dump_data->next_chunk++) < dump_data->num_chunks)
+    {
+      GString *text ;
+      gboolean ok = TRUE ;
+      guint first, last, i ;
+
+      {
+        std::unique_lock<std::mutex> lock(dump_data->mutex) ;
+
+        dump_data->chunk_written.wait(lock, [dump_data, chunk]
+                                      { return (dump_data->failed
+                                                || chunk < dump_data->chunks_written + dump_data->max_ahead) ; }) ;
+      }
+
+      first = chunk * DUMP_CHUNK_FEATURES ;
+      last = MIN(first + DUMP_CHUNK_FEATURES, dump_data->features->len) ;
+
+      text = g_string_sized_new((last - first) * 128) ;
+
+      for (i = first ; ok && i < last && !dump_data->failed ; i++)
+        ok = formatFeature((ZMapFeature)g_ptr_array_index(dump_data->features, i), format_data, text) ;
+
+      {
+        std::lock_guard<std::mutex> lock(dump_data->mutex) ;
+
+        dump_data->chunks[chunk] = text ;
+        dump_data->chunk_ok[chunk] = ok ;
+
+        dump_data->chunk_formatted.notify_all() ;
+      }
+    }
+
+  deleteGFFFormatData(&format_data) ;
+
+  return ;
+}
+
 /*
  * These functions select the attributes to output for features
  * of the specified ZMapStyleMode.
@@ -1685,13 +1984,13 @@ static FeatureSearch createFeatureSearch()
   if (result)
     {
       result->region_span = NULL ;
-      result->results = NULL ;
+      result->results = g_ptr_array_new() ;
     }
   return result ;
 }
 
 /*
- * Note that this object only has ownership of the results GList.
+ * Note that this object only has ownership of the results array, not the features.
  */
 static void deleteFeatureSearch(FeatureSearch *p_feature_search)
 {
@@ -1700,7 +1999,7 @@ static void deleteFeatureSearch(FeatureSearch *p_feature_search)
   FeatureSearch feature_search = *p_feature_search ;
   if (feature_search->results)
     {
-      g_list_free(feature_search->results) ;
+      g_ptr_array_free(feature_search->results, TRUE) ;
     }
   memset(feature_search, 0, sizeof(FeatureSearchStruct)) ;
   g_free(feature_search) ;
@@ -145,6 +145,17 @@ typedef struct ZMapGFF3ParserStruct_
 
     GHashTable *composite_features ;
 
+    /*
+     * SO data for the type of the last body line, consecutive lines
+     * mostly have the same type so we can often skip the lookup.
+     */
+    char *sLastSOType ;
+    gboolean bLastSOValid ;
+    unsigned int iLastSOID ;
+    const char *sLastSOIDName ;
+    ZMapStyleMode cLastSOStyleMode ;
+    ZMapHomolType cLastSOHomol ;
+
 } ZMapGFF3ParserStruct, *ZMapGFF3Parser ;
 
 
@@ -112,6 +112,7 @@ static gboolean compositeFeaturesInsert(ZMapGFF3Parser const pParser, GQuark fea
  * See comments with function.
  */
 static gboolean hack_SpecialColumnToSOTerm(const char * const, char * const ) ;
+static gboolean lookupSOType(ZMapGFF3Parser const, const char * const) ;
 
 /*
  * These alternatives are in place temporarily until we have
@@ -312,6 +313,9 @@ void zMapGFFDestroyParser_V3(ZMapGFFParser pParserBase)
   if (pParser->composite_features)
     g_hash_table_destroy(pParser->composite_features) ;
 
+  if (pParser->sLastSOType)
+    g_free(pParser->sLastSOType) ;
+
   g_free(pParser) ;
 
   return ;
@@ -2159,13 +2163,12 @@ gboolean zMapGFFGetLogWarnings(ZMapGFFParser pParserBase )
  */
 static gboolean parseBodyLine_V3(ZMapGFFParser pParserBase, const char * const sLine)
 {
-  static const unsigned int
-    iTokenLimit                       = 1000
+  int
+    iStart                            = 0,
+    iEnd                              = 0
   ;
 
   unsigned int
-    iStart                            = 0,
-    iEnd                              = 0,
     iLineLength                       = 0,
     iFields                           = 0,
     nAttributes                       = 0,
@@ -2180,8 +2183,7 @@ static gboolean parseBodyLine_V3(ZMapGFFParser pParserBase, const char * const s
     *sStrand                          = NULL,
     *sPhase                           = NULL,
     *sAttributes                      = NULL,
-    *sErrText                         = NULL,
-    **sTokens                         = NULL ;
+    *sErrText                         = NULL ;
 
   const char *sSOIDName               = NULL ;
 
@@ -2191,6 +2193,7 @@ static gboolean parseBodyLine_V3(ZMapGFFParser pParserBase, const char * const s
 
   gboolean
     bResult                           = TRUE,
+    bHasCoords                        = FALSE,
     bHasScore                         = FALSE,
     bIncludeEmpty                     = FALSE,
     bRemoveQuotes                     = FALSE,
@@ -2221,6 +2224,9 @@ static gboolean parseBodyLine_V3(ZMapGFFParser pParserBase, const char * const s
   ZMapSOIDData
     pSOIDData                         = NULL
   ;
+  ZMapGFFStringSpanStruct
+    pSpans[ZMAPGFF_MANDATORY_FIELDS+1]
+  ;
 
 #ifdef DUMP_GFF_TO_FILE
   if (pFile == NULL)
@@ -2317,21 +2323,13 @@ static gboolean parseBodyLine_V3(ZMapGFFParser pParserBase, const char * const s
 
 
   /*
-   * Zero out buffers before use.
-   */
-  memset(sSequence,       0,    pParser->buffer_length) ;
-  memset(sSource,         0,    pParser->buffer_length) ;
-  memset(sType,           0,    pParser->buffer_length) ;
-  memset(sScore,          0,    pParser->buffer_length) ;
-  memset(sStrand,         0,    pParser->buffer_length) ;
-  memset(sPhase,          0,    pParser->buffer_length) ;
-  memset(sAttributes,     0,    pParser->buffer_length) ;
-
-  /*
-   * Tokenize input line. Don't have to worry about quoted delimiter characters here.
+   * Tokenize input line into spans (pointer/length views of the line); this
+   * does no allocation or copying. Don't have to worry about quoted delimiter
+   * characters here. We only ask for one more span than we can use so that we
+   * can detect lines with too many fields.
    */
-  sTokens = zMapGFFStringUtilsTokenizer(pParser->cDelimBodyLine, sLine, &iFields, bIncludeEmpty,
-                                 iTokenLimit, g_malloc, g_free, pParser->buffers[ZMAPGFF_BUF_TMP]) ;
+  iFields = zMapGFFStringUtilsSpanTokenizer(pParser->cDelimBodyLine, sLine, bIncludeEmpty,
+                                            pSpans, ZMAPGFF_MANDATORY_FIELDS+1) ;
 
   /*
    * Check number of tokens found.
@@ -2349,28 +2347,6 @@ static gboolean parseBodyLine_V3(ZMapGFFParser pParserBase, const char * const s
       bResult = FALSE ;
       goto return_point ;
     }
-
-  /*
-   * Parse each of these into the parser buffers.
-   * We are using strcpy() here because some of these strings may
-   * contain whitespace which makes use of sscanf() awkward.
-   */
-  if (iFields >= ZMAPGFF_MANDATORY_FIELDS)
-    {
-      strcpy(sSequence,    sTokens[0]) ;
-      strcpy(sSource,      sTokens[1]) ;
-      strcpy(sType,        sTokens[2]) ;
-      sscanf(sTokens[3],   "%i", &iStart) ;
-      sscanf(sTokens[4],   "%i", &iEnd) ;
-      strcpy(sScore,       sTokens[5]) ;
-      strcpy(sStrand,      sTokens[6]) ;
-      strcpy(sPhase,       sTokens[7]) ;
-
-    }
-  if (iFields == ZMAPGFF_MANDATORY_FIELDS+1)
-    {
-      strcpy(sAttributes, sTokens[ZMAPGFF_MANDATORY_FIELDS]) ;
-    }
   if (iFields > ZMAPGFF_MANDATORY_FIELDS+1)
     {
       if (pParser->error)
@@ -2385,6 +2361,26 @@ static gboolean parseBodyLine_V3(ZMapGFFParser pParserBase, const char * const s
       goto return_point ;
     }
 
+  /*
+   * Copy the string columns into the parser buffers; these are all at least
+   * as long as the line so cannot overflow and only the bytes of each column
+   * are written so there is no need to clear them first. Start and end are
+   * parsed directly from the line.
+   */
+  zMapGFFStringUtilsSpanCopy(&pSpans[ZMAPGFF_FDA_SEQ], sSequence) ;
+  zMapGFFStringUtilsSpanCopy(&pSpans[ZMAPGFF_FDA_SOU], sSource) ;
+  zMapGFFStringUtilsSpanCopy(&pSpans[ZMAPGFF_FDA_TYP], sType) ;
+  zMapGFFStringUtilsSpanCopy(&pSpans[ZMAPGFF_FDA_SCO], sScore) ;
+  zMapGFFStringUtilsSpanCopy(&pSpans[ZMAPGFF_FDA_STR], sStrand) ;
+  zMapGFFStringUtilsSpanCopy(&pSpans[ZMAPGFF_FDA_PHA], sPhase) ;
+  bHasCoords = zMapGFFStringUtilsSpanToInt(&pSpans[ZMAPGFF_FDA_STA], &iStart)
+    && zMapGFFStringUtilsSpanToInt(&pSpans[ZMAPGFF_FDA_END], &iEnd) ;
+
+  if (iFields == ZMAPGFF_MANDATORY_FIELDS+1)
+    zMapGFFStringUtilsSpanCopy(&pSpans[ZMAPGFF_MANDATORY_FIELDS], sAttributes) ;
+  else
+    *sAttributes = '\0' ;
+
   /*
    * Ignore any lines with a different sequence name.
    */
@@ -2411,9 +2407,14 @@ static gboolean parseBodyLine_V3(ZMapGFFParser pParserBase, const char * const s
     sErrText = g_strdup("sType cannot be '.'") ;
   else if (!zMapFeatureFormatType(pParser->SO_compliant, pParser->default_to_basic, sType, &cType))
     sErrText = g_strdup_printf("feature_type not recognised: %s", sType) ;
+  else if (!bHasCoords)
+    sErrText = g_strdup_printf("start/end format not recognised: %.*s %.*s",
+                               (int)pSpans[ZMAPGFF_FDA_STA].iLength, pSpans[ZMAPGFF_FDA_STA].sStart,
+                               (int)pSpans[ZMAPGFF_FDA_END].iLength, pSpans[ZMAPGFF_FDA_END].sStart) ;
   else if (iStart > iEnd)
     sErrText = g_strdup_printf("start > end, start = %d, end = %d", iStart, iEnd) ;
-  else if (!zMapFeatureFormatScore(sScore, &bHasScore, &dScore))
+  else if (!(bHasScore = zMapGFFStringUtilsSpanToDouble(&pSpans[ZMAPGFF_FDA_SCO], &dScore))
+           && !zMapFeatureFormatScore(sScore, &bHasScore, &dScore))
     sErrText = g_strdup_printf("score format not recognised: %s", sScore) ;
   else if (!zMapFeatureFormatStrand(sStrand, &cStrand))
     sErrText = g_strdup_printf("strand format not recognised: %s", sStrand) ;
@@ -2465,25 +2466,17 @@ static gboolean parseBodyLine_V3(ZMapGFFParser pParserBase, const char * const s
    *
    * If the string is not of the form SO:XXXXXXX then check to see if it is
    * a name present in the same set. If either of these are true then we
-   * have a valid SO term.
+   * have a valid SO term. The result for the last type is kept in the parser.
    *
    */
-  if ((iSOID = zMapSOIDParseString(sType)) != ZMAPSO_ID_UNK) /* we have something of the form SO:XXXXXXX */
-    {
-      if ((sSOIDName = zMapSOSetIsIDPresent(pParser->cSOSetInUse, iSOID)) != NULL) /* that is present in the SO set */
-        {
-          bIsValidSOID = TRUE ;
-          cType = zMapSOSetGetStyleModeFromID(pParser->cSOSetInUse, iSOID) ;
-          cHomol = zMapSOSetGetHomolFromID(pParser->cSOSetInUse, iSOID) ;
-          pSOIDData = zMapSOIDDataCreateFromData(iSOID, sSOIDName, cType, cHomol ) ;
-        }
-    }
-  else if ((iSOID = zMapSOSetIsNamePresent(pParser->cSOSetInUse, sType)) != ZMAPSO_ID_UNK) /* we have sType is a name in the set */
+  if (lookupSOType(pParser, sType))
     {
       bIsValidSOID = TRUE ;
-      cType = zMapSOSetGetStyleModeFromName(pParser->cSOSetInUse, sType ) ;
-      cHomol = zMapSOSetGetHomolFromID(pParser->cSOSetInUse, iSOID) ;
-      pSOIDData = zMapSOIDDataCreateFromData(iSOID, sType, cType, cHomol ) ;
+      iSOID = pParser->iLastSOID ;
+      sSOIDName = pParser->sLastSOIDName ;
+      cType = pParser->cLastSOStyleMode ;
+      cHomol = pParser->cLastSOHomol ;
+      pSOIDData = zMapSOIDDataCreateFromData(iSOID, sSOIDName, cType, cHomol ) ;
     }
 
   /*
@@ -2552,10 +2545,6 @@ static gboolean parseBodyLine_V3(ZMapGFFParser pParserBase, const char * const s
       pAttributes = zMapGFFAttributeParseList(pParserBase, sAttributes, &nAttributes, bRemoveQuotes) ;
     }
 
-#ifdef OUTPUT_V3_DATA
-  writeBodyLine(sTokens, iFields, pAttributes, nAttributes) ;
-#endif
-
   /*
    * Fill in ZMapGFFFeatureData object here with the data parsed out so far.
    */
@@ -2635,7 +2624,6 @@ return_point:
   /*
    * Clean up dynamically allocated data.
    */
-  zMapGFFStringUtilsArrayDelete(sTokens, iFields, g_free) ;
   zMapGFFAttributeDestroyList(pAttributes, nAttributes) ;
   zMapGFFFeatureDataDestroy(pFeatureData) ;
 
@@ -2913,7 +2901,7 @@ static ZMapFeature makeFeatureTranscript(ZMapGFF3Parser const pParser,
        * This is a new feature, so we must create from scratch and add standard data.
        */
       GError *g_error = NULL ;
-      pFeature = zMapFeatureCreateEmpty(&g_error) ;
+      pFeature = zMapFeatureCreateEmptyFromSet(pFeatureSet, &g_error) ;
 
       if (g_error)
         {
@@ -3079,7 +3067,7 @@ static ZMapFeature makeFeatureTranscript(ZMapGFF3Parser const pParser,
                   if (!zMapFeatureTranscriptAddSubparts(pFeature, exons, introns)
                       || !zMapFeatureTranscriptAddAlignparts(pFeature,
                                                              iTargetStart, iTargetEnd, cTargetStrand,
-                                                             exon_aligns, pAttributeVulgar->sTemp))
+                                                             exon_aligns, zMapGFFAttributeGetTempstring(pAttributeVulgar)))
                     {
                       *psError = g_strdup("unable to add exons/introns/exon_aligns derived from vulgar string") ;
                     }
@@ -3449,7 +3437,7 @@ static ZMapFeature makeFeatureAlignment(ZMapGFF3Parser const pParser,
        * Create a new feature.
        */
       GError *g_error = NULL ;
-      pFeature = zMapFeatureCreateEmpty(&g_error) ;
+      pFeature = zMapFeatureCreateEmptyFromSet(pFeatureSet, &g_error) ;
       if (pFeature)
         {
           bNewFeatureCreated = TRUE ;
@@ -3664,7 +3652,7 @@ static ZMapFeature makeFeatureDefault(ZMapGFF3Parser const pParser, ZMapGFFFeatu
    * Create our new feature object
    */
   GError *g_error = NULL ;
-  pFeature = zMapFeatureCreateEmpty(&g_error) ;
+  pFeature = zMapFeatureCreateEmptyFromSet(pFeatureSet, &g_error) ;
   if (!pFeature)
     {
       if (g_error)
@@ -3946,6 +3934,47 @@ static gboolean hack_SpecialColumnToSOTerm(const char * const sSource, char * co
 
 
 
+/*
+ * Look up sType in the SO set in use, as either an accession number or a
+ * name, and keep the result in the parser. If sType is the same as for the
+ * last line then the previous result is used without looking it up again.
+ * Returns TRUE if sType is a valid SO term.
+ */
+static gboolean lookupSOType(ZMapGFF3Parser const pParser, const char * const sType)
+{
+  unsigned int iSOID = ZMAPSO_ID_UNK ;
+
+  zMapReturnValIfFail(pParser && sType, FALSE) ;
+
+  if (!pParser->sLastSOType || strcmp(pParser->sLastSOType, sType))
+    {
+      if (pParser->sLastSOType)
+        g_free(pParser->sLastSOType) ;
+      pParser->sLastSOType = g_strdup(sType) ;
+
+      if ((iSOID = zMapSOIDParseString(sType)) != ZMAPSO_ID_UNK) /* we have something of the form SO:XXXXXXX */
+        {
+          pParser->bLastSOValid = zMapSOSetGetDataFromID(pParser->cSOSetInUse, iSOID,
+                                                         &pParser->sLastSOIDName,
+                                                         &pParser->cLastSOStyleMode,
+                                                         &pParser->cLastSOHomol) ;
+          pParser->iLastSOID = iSOID ;
+        }
+      else
+        {
+          pParser->bLastSOValid = zMapSOSetGetDataFromName(pParser->cSOSetInUse, sType,
+                                                           &pParser->iLastSOID,
+                                                           &pParser->cLastSOStyleMode,
+                                                           &pParser->cLastSOHomol) ;
+          pParser->sLastSOIDName = pParser->sLastSOType ;
+        }
+    }
+
+  return pParser->bLastSOValid ;
+}
+
+
+
 /*
  * Create a new feature and add it to the feature set.
  *
@@ -4371,6 +4400,14 @@ gboolean zMapGFFSetSOSetInUse(ZMapGFFParser  pParserBase, ZMapSOSetInUse cUse)
   zMapReturnValIfFail(pParser && pParser->pHeader, bSet) ;
 
   pParser->cSOSetInUse = cUse ;
+
+  /* The last type looked up may not be in the new set. */
+  if (pParser->sLastSOType)
+    {
+      g_free(pParser->sLastSOType) ;
+      pParser->sLastSOType = NULL ;
+    }
+
   bSet = TRUE ;
   return bSet ;
 }
@@ -58,6 +58,10 @@ static const char *sSemicolon = ";" ;
 static const char *sSpace = " " ;
 
 
+static char *decodeSpan(ZMapGFFStringSpanStruct *pSpan) ;
+static void trimSpan(char **psStart, char **psEnd) ;
+
+
 /*
  * Return the name stored as a string (not necessarily the same as the
  * name from the above lookups).
@@ -66,6 +70,8 @@ char * zMapGFFAttributeGetNamestring(ZMapGFFAttribute pAttribute)
 {
   if (!pAttribute)
     return NULL ;
+  if (pAttribute->cName.sStart)
+    pAttribute->sName = decodeSpan(&pAttribute->cName) ;
   return pAttribute->sName ;
 }
 
@@ -76,6 +82,12 @@ char * zMapGFFAttributeGetTempstring(ZMapGFFAttribute pAttribute)
 {
   if (!pAttribute)
     return NULL ;
+  if (pAttribute->cValue.sStart)
+    {
+      pAttribute->sTemp = decodeSpan(&pAttribute->cValue) ;
+      if (pAttribute->bRemoveQuotes)
+        zMapGFFAttributeRemoveQuotes(pAttribute) ;
+    }
   return pAttribute->sTemp ;
 }
 
@@ -99,6 +111,11 @@ ZMapGFFAttribute zMapGFFCreateAttribute()
    */
   pAttribute->sName = NULL ;
   pAttribute->sTemp = NULL ;
+  pAttribute->cName.sStart = NULL ;
+  pAttribute->cName.iLength = 0 ;
+  pAttribute->cValue.sStart = NULL ;
+  pAttribute->cValue.iLength = 0 ;
+  pAttribute->bRemoveQuotes = FALSE ;
 
   return pAttribute ;
 }
@@ -255,17 +272,28 @@ gboolean zMapGFFAttributeRemoveQuotes(ZMapGFFAttribute pAttribute )
 
 
 /*
- * Parse multiple attributes from input string. Calls the above parse function
- * for each attribute found.
+ * Parse multiple attributes from input string.
+ *
+ * This is done for every body line so is kept cheap: the column is copied once
+ * into the same block of memory as the attributes and scanned to find the name
+ * and value of each attribute, nothing is decoded until it is asked for (see
+ * zMapGFFAttributeGetNamestring() and zMapGFFAttributeGetTempstring()). The
+ * attributes are split in the same way as zMapGFFAttributeParse() does for a
+ * single one: delimiters within quotes are ignored, leading and trailing spaces
+ * are removed and the value is everything after the first cDelimAttValue.
+ *
+ * The list must be freed with zMapGFFAttributeDestroyList() and its attributes
+ * are only valid until then.
  */
 ZMapGFFAttribute* zMapGFFAttributeParseList(ZMapGFFParser pParserBase, const char * const sAttributes,
                                             unsigned int * const pnAttributes, gboolean bRemoveQuotes)
 {
-  unsigned int i = 0 ;
-  char **sTokens ;
-  gboolean bIncludeEmpty = FALSE,
-    bFail = FALSE ;
+  unsigned int nMaxAttributes = 1 ;
+  size_t iLength = 0 ;
+  char *sCopy = NULL, *sPos = NULL, *sStart = NULL, *sEnd = NULL, *sValue = NULL ;
+  gboolean bQuoted = FALSE ;
   ZMapGFFAttribute *pAttributes = NULL ;
+  ZMapGFFAttributeStruct *pAttributeData = NULL ;
   ZMapGFFVersion eVersion = ZMAPGFF_VERSION_UNKNOWN ;
 
   /*
@@ -275,8 +303,6 @@ ZMapGFFAttribute* zMapGFFAttributeParseList(ZMapGFFParser pParserBase, const cha
     return pAttributes ;
   if (!sAttributes || !*sAttributes)
     return pAttributes ;
-  if (!strlen(sAttributes))
-    return pAttributes ;
   eVersion = pParserBase->gff_version ;
   if (eVersion != ZMAPGFF_VERSION_3)
     return pAttributes ;
@@ -289,54 +315,70 @@ ZMapGFFAttribute* zMapGFFAttributeParseList(ZMapGFFParser pParserBase, const cha
   *pnAttributes = 0 ;
 
   /*
-   * Tokenize attribute string; we do have to worry about allowing quoted delimited
-   * characters in this process.
+   * There can't be more attributes than delimiters plus one; the pointers, the
+   * attributes and the copy of the column all go in one allocation.
    */
-  bIncludeEmpty = FALSE ;
-  sTokens = zMapGFFStringUtilsTokenizer02(pParser->cDelimAttributes, pParser->cDelimQuote, sAttributes, pnAttributes,
-                                   bIncludeEmpty, g_malloc, g_free) ;
-  if (*pnAttributes == 0)
-    return pAttributes ;
+  iLength = strlen(sAttributes) ;
+  for (sPos = (char *)sAttributes ; (sPos = strchr(sPos, pParser->cDelimAttributes)) ; ++sPos)
+    ++nMaxAttributes ;
 
-  /*
-   * Allocate and initialize array of attributes (well, pointers to attribute).
-   */
-  pAttributes = (ZMapGFFAttribute*) g_malloc(sizeof(ZMapGFFAttribute)* *pnAttributes) ;
-  for (i=0; i<*pnAttributes; ++i)
-    pAttributes[i] = NULL ;
+  pAttributes = (ZMapGFFAttribute*) g_malloc(nMaxAttributes * (sizeof(ZMapGFFAttribute) + sizeof(ZMapGFFAttributeStruct))
+                                             + iLength + 1) ;
+  pAttributeData = (ZMapGFFAttributeStruct*) (pAttributes + nMaxAttributes) ;
+  sCopy = (char*) (pAttributeData + nMaxAttributes) ;
+  memcpy(sCopy, sAttributes, iLength + 1) ;
 
   /*
-   * Parse each of these attributes.
+   * Record the name and value of each non-empty attribute.
    */
-  for (i=0; i<*pnAttributes; ++i)
+  for (sStart = sPos = sCopy ; sStart ; ++sPos)
     {
-      pAttributes[i] = zMapGFFAttributeParse(pParserBase, sTokens[i], bRemoveQuotes) ;
-      if (pAttributes[i] == NULL)
+      if (*sPos == pParser->cDelimQuote)
+        bQuoted = !bQuoted ;
+
+      if (*sPos && (*sPos != pParser->cDelimAttributes || bQuoted))
+        continue ;
+
+      sEnd = sPos ;
+      trimSpan(&sStart, &sEnd) ;
+
+      if (sStart < sEnd)
         {
-          bFail = TRUE ;
-          break ;
+          ZMapGFFAttribute pAttribute = &pAttributeData[*pnAttributes] ;
+
+          pAttribute->sName = NULL ;
+          pAttribute->sTemp = NULL ;
+          pAttribute->cValue.sStart = NULL ;
+          pAttribute->cValue.iLength = 0 ;
+          pAttribute->bRemoveQuotes = bRemoveQuotes ;
+
+          if ((sValue = (char*) memchr(sStart, pParser->cDelimAttValue, sEnd - sStart)))
+            {
+              char *sValueStart = sValue + 1 ;
+
+              trimSpan(&sValueStart, &sEnd) ;
+              pAttribute->cValue.sStart = sValueStart ;
+              pAttribute->cValue.iLength = (unsigned int) (sEnd - sValueStart) ;
+
+              sEnd = sValue ;
+              trimSpan(&sStart, &sEnd) ;
+            }
+
+          pAttribute->cName.sStart = sStart ;
+          pAttribute->cName.iLength = (unsigned int) (sEnd - sStart) ;
+
+          pAttributes[(*pnAttributes)++] = pAttribute ;
         }
+
+      sStart = *sPos ? sPos + 1 : NULL ;
     }
 
-  /*
-   * If one of these fails, then destroy all attribute objects,
-   * set the number of attributes found to 0, and return NULL.
-   */
-  if (bFail)
+  if (*pnAttributes == 0)
     {
-      for (i=0; i<*pnAttributes; ++i)
-        if (pAttributes[i] != NULL)
-          zMapGFFDestroyAttribute(pAttributes[i]) ;
       g_free(pAttributes) ;
-      *pnAttributes = 0 ;
       pAttributes = NULL ;
     }
 
-  /*
-   * Destroy array of token strings.
-   */
-  zMapGFFStringUtilsArrayDelete(sTokens, *pnAttributes, g_free) ;
-
   return pAttributes ;
 }
 
@@ -348,12 +390,12 @@ ZMapGFFAttribute* zMapGFFAttributeParseList(ZMapGFFParser pParserBase, const cha
 gboolean zMapGFFAttributeDestroyList(ZMapGFFAttribute* pAttributes, unsigned int nAttributes)
 {
   gboolean bResult = FALSE ;
-  unsigned int iAtt;
   if (!pAttributes || !nAttributes )
     return bResult ;
-  for (iAtt=0; iAtt<nAttributes; ++iAtt)
-    if (pAttributes[iAtt] != NULL)
-      zMapGFFDestroyAttribute(pAttributes[iAtt]) ;
+
+  /*
+   * The attributes and their strings are all in the same block as the list.
+   */
   g_free(pAttributes) ;
   bResult = TRUE ;
   return bResult ;
@@ -362,7 +404,8 @@ gboolean zMapGFFAttributeDestroyList(ZMapGFFAttribute* pAttributes, unsigned int
 
 /*
  * Queries a list of attributes to see if it contains one with the name passed in.
- * Returns a pointer to it or NULL if not found (or some other error).
+ * Returns a pointer to it or NULL if not found (or some other error). The names
+ * are compared without decoding them.
  */
 ZMapGFFAttribute zMapGFFAttributeListContains( ZMapGFFAttribute* pAtt, unsigned int nAttributes, const char * const sName)
 {
@@ -375,7 +418,9 @@ ZMapGFFAttribute zMapGFFAttributeListContains( ZMapGFFAttribute* pAtt, unsigned
 
   for (iAtt=0; iAtt<nAttributes; ++iAtt)
     {
-      if (!strcmp(zMapGFFAttributeGetNamestring(pAttributes[iAtt]), sName))
+      if (pAttributes[iAtt]->cName.sStart
+          ? zMapGFFStringUtilsSpanEquals(&pAttributes[iAtt]->cName, sName)
+          : !strcmp(pAttributes[iAtt]->sName, sName))
         {
           pAttribute = pAttributes[iAtt] ;
           break ;
@@ -387,6 +432,40 @@ ZMapGFFAttribute zMapGFFAttributeListContains( ZMapGFFAttribute* pAtt, unsigned
 
 
 
+/*
+ * Null terminate a span of an attribute list's copy of the column and mark it
+ * as decoded. The character overwritten is always a delimiter, space or the
+ * end of the column so never part of another span.
+ */
+static char *decodeSpan(ZMapGFFStringSpanStruct *pSpan)
+{
+  char *sResult = (char*) pSpan->sStart ;
+
+  sResult[pSpan->iLength] = '\0' ;
+  pSpan->sStart = NULL ;
+
+  return sResult ;
+}
+
+
+/*
+ * Move the start and end of [*psStart, *psEnd) past any leading and trailing
+ * spaces, as remove_leading_trailing_characters() does for the tokenizers.
+ */
+static void trimSpan(char **psStart, char **psEnd)
+{
+  static const char cSpace = ' ' ;
+
+  while (*psStart < *psEnd && **psStart == cSpace)
+    ++*psStart ;
+  while (*psEnd > *psStart && *(*psEnd-1) == cSpace)
+    --*psEnd ;
+
+  return ;
+}
+
+
+
 
 
 
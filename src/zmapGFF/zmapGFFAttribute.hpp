@@ -41,6 +41,7 @@
 #include <ctype.h>
 #include <ZMap/zmapFeature.hpp>
 #include <ZMap/zmapGFF.hpp>
+#include <ZMap/zmapGFFStringUtils.hpp>
 #include <zmapGFF3_P.hpp>
 
 /*
@@ -104,11 +105,25 @@ DEFINE_ATTRIBUTE(sAttributeName, read_pair_id)
  * sName                string of the name as found in the data file
  * sTemp                data string found with attribute
  *
+ * Attributes from zMapGFFAttributeParseList() are not decoded when the
+ * line is parsed; instead the name and value are held as spans of the
+ * list's copy of the attribute column and sName/sTemp are only filled in
+ * when first asked for (see zMapGFFAttributeGetNamestring() and
+ * zMapGFFAttributeGetTempstring()). Most lines only need a few of their
+ * attributes.
+ *
+ * cName                span of the name, sStart is NULL once decoded
+ * cValue               span of the value, sStart is NULL if decoded or none
+ * bRemoveQuotes        remove quotes from the value when it is decoded
+ *
  */
 typedef struct ZMapGFFAttributeStruct_
   {
     char *sName ;
     char *sTemp ;
+    ZMapGFFStringSpanStruct cName ;
+    ZMapGFFStringSpanStruct cValue ;
+    gboolean bRemoveQuotes ;
   } ZMapGFFAttributeStruct ;
 
 
@@ -40,6 +40,8 @@
  */
 #include <glib.h>
 
+#include <ZMap/zmapGFFStringUtils.hpp>
+
 
 
 
@@ -324,6 +326,228 @@ char** zMapGFFStringUtilsTokenizer02(char cDelim,
 
 
 
+/*
+ * Span based tokenizer for the body line path; this does no allocation and
+ * does not copy anything. The spans point into sTarg and have leading and
+ * trailing spaces removed in the same way as zMapGFFStringUtilsTokenizer().
+ * At most iMaxSpans are stored but the return value is the total number of
+ * tokens found so that the caller can detect lines with too many fields.
+ */
+unsigned int zMapGFFStringUtilsSpanTokenizer(char cDelim, const char * const sTarg, gboolean bIncludeEmpty,
+                                             ZMapGFFStringSpanStruct *pSpans, unsigned int iMaxSpans)
+{
+  static const char cSpace = ' ' ;
+  const char *sPosLast = sTarg,
+    *sPos = NULL,
+    *sStart = NULL,
+    *sEnd = NULL ;
+  unsigned int iNumTokens = 0 ;
+  gboolean bLast = FALSE ;
+
+  if (!sTarg || !*sTarg || !pSpans)
+    return iNumTokens ;
+
+  while (!bLast)
+    {
+      if (!(sPos = strchr(sPosLast, cDelim)))
+        {
+          sPos = sPosLast + strlen(sPosLast) ;
+          bLast = TRUE ;
+        }
+
+      if (sPos != sPosLast || bIncludeEmpty)
+        {
+          if (iNumTokens < iMaxSpans)
+            {
+              sStart = sPosLast ;
+              sEnd = sPos ;
+              while (sStart < sEnd && *sStart == cSpace)
+                ++sStart ;
+              while (sEnd > sStart && *(sEnd-1) == cSpace)
+                --sEnd ;
+
+              pSpans[iNumTokens].sStart = sStart ;
+              pSpans[iNumTokens].iLength = (unsigned int)(sEnd - sStart) ;
+            }
+          ++iNumTokens ;
+        }
+
+      sPosLast = sPos + 1 ;
+    }
+
+  return iNumTokens ;
+}
+
+
+/*
+ * Copy the span into the buffer and null terminate it; the buffer must be at
+ * least pSpan->iLength+1 in size. Returns the buffer.
+ */
+char *zMapGFFStringUtilsSpanCopy(const ZMapGFFStringSpanStruct * const pSpan, char *sBuff)
+{
+  if (!pSpan || !sBuff)
+    return sBuff ;
+
+  memcpy(sBuff, pSpan->sStart, pSpan->iLength) ;
+  sBuff[pSpan->iLength] = '\0' ;
+
+  return sBuff ;
+}
+
+
+/*
+ * Does the span hold exactly the string given.
+ */
+gboolean zMapGFFStringUtilsSpanEquals(const ZMapGFFStringSpanStruct * const pSpan, const char * const sStr)
+{
+  size_t iLength ;
+
+  if (!pSpan || !sStr)
+    return FALSE ;
+
+  iLength = strlen(sStr) ;
+
+  return (iLength == pSpan->iLength && !memcmp(pSpan->sStart, sStr, iLength)) ;
+}
+
+
+/*
+ * Parse a decimal integer (optional sign) from the span. Returns FALSE if the
+ * span contains anything else or the value does not fit in an int.
+ */
+gboolean zMapGFFStringUtilsSpanToInt(const ZMapGFFStringSpanStruct * const pSpan, int *piOut)
+{
+  const char *s = NULL, *sEnd = NULL ;
+  gint64 iValue = 0 ;
+  gboolean bNegative = FALSE ;
+
+  if (!pSpan || !pSpan->iLength || !piOut)
+    return FALSE ;
+
+  s = pSpan->sStart ;
+  sEnd = s + pSpan->iLength ;
+
+  if (*s == '-' || *s == '+')
+    {
+      bNegative = (*s == '-') ;
+      ++s ;
+    }
+
+  if (s == sEnd)
+    return FALSE ;
+
+  for ( ; s < sEnd ; ++s)
+    {
+      if (*s < '0' || *s > '9')
+        return FALSE ;
+
+      iValue = iValue * 10 + (*s - '0') ;
+
+      if (iValue > (gint64)G_MAXINT + 1)
+        return FALSE ;
+    }
+
+  if (bNegative)
+    iValue = -iValue ;
+
+  if (iValue > G_MAXINT || iValue < G_MININT)
+    return FALSE ;
+
+  *piOut = (int)iValue ;
+
+  return TRUE ;
+}
+
+
+/*
+ * Parse a plain decimal number of the form [+-]digits[.digits][(e|E)[+-]digits]
+ * from the span. This only handles the cases where the result can be computed
+ * exactly from an integer mantissa and a power of ten, i.e. mantissa < 2^53 and
+ * a decimal exponent no larger than 22 in magnitude; anything else (including
+ * inf/nan/hex forms) returns FALSE and the caller should fall back to strtod().
+ */
+gboolean zMapGFFStringUtilsSpanToDouble(const ZMapGFFStringSpanStruct * const pSpan, double *pdOut)
+{
+  static const double dPowers[] =
+    {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    } ;
+  static const int iMaxPower = 22 ;
+  static const guint64 iMaxMantissa = ((guint64)1 << 53) ;
+  const char *s = NULL, *sEnd = NULL ;
+  guint64 iMantissa = 0 ;
+  int iExponent = 0, iExpValue = 0, nDigits = 0 ;
+  gboolean bNegative = FALSE, bExpNegative = FALSE ;
+  double dValue = 0.0 ;
+
+  if (!pSpan || !pSpan->iLength || !pdOut)
+    return FALSE ;
+
+  s = pSpan->sStart ;
+  sEnd = s + pSpan->iLength ;
+
+  if (*s == '-' || *s == '+')
+    {
+      bNegative = (*s == '-') ;
+      ++s ;
+    }
+
+  for ( ; s < sEnd && *s >= '0' && *s <= '9' ; ++s, ++nDigits)
+    {
+      iMantissa = iMantissa * 10 + (*s - '0') ;
+      if (iMantissa >= iMaxMantissa)
+        return FALSE ;
+    }
+
+  if (s < sEnd && *s == '.')
+    {
+      for (++s ; s < sEnd && *s >= '0' && *s <= '9' ; ++s, ++nDigits)
+        {
+          iMantissa = iMantissa * 10 + (*s - '0') ;
+          if (iMantissa >= iMaxMantissa)
+            return FALSE ;
+          --iExponent ;
+        }
+    }
+
+  if (!nDigits)
+    return FALSE ;
+
+  if (s < sEnd && (*s == 'e' || *s == 'E'))
+    {
+      ++s ;
+      if (s < sEnd && (*s == '-' || *s == '+'))
+        {
+          bExpNegative = (*s == '-') ;
+          ++s ;
+        }
+      if (s == sEnd)
+        return FALSE ;
+      for ( ; s < sEnd && *s >= '0' && *s <= '9' ; ++s)
+        {
+          iExpValue = iExpValue * 10 + (*s - '0') ;
+          if (iExpValue > iMaxPower * 2)
+            return FALSE ;
+        }
+      iExponent += (bExpNegative ? -iExpValue : iExpValue) ;
+    }
+
+  if (s != sEnd || iExponent > iMaxPower || iExponent < -iMaxPower)
+    return FALSE ;
+
+  dValue = (double)iMantissa ;
+  if (iExponent < 0)
+    dValue /= dPowers[-iExponent] ;
+  else
+    dValue *= dPowers[iExponent] ;
+
+  *pdOut = bNegative ? -dValue : dValue ;
+
+  return TRUE ;
+}
+
+
 
 /*
  * Static functions only from here on.
@@ -32,6 +32,109 @@
 #include <zmapSOParser_P.hpp>
 
 
+/*
+ * One of the generated SO data tables along with the indices of its
+ * entries sorted by name and by ID, see zmap_SO_header.pl.
+ */
+typedef struct SOTableStruct_
+  {
+    const ZMapSOIDDataStruct *pData ;
+    const unsigned int *pByName ;
+    const unsigned int *pByID ;
+    unsigned int iNumItems ;
+  } SOTableStruct ;
+
+static const SOTableStruct table_sofa_G =
+  {ZMAP_SO_DATA_TABLE01, ZMAP_SO_DATA_TABLE01_BY_NAME, ZMAP_SO_DATA_TABLE01_BY_ID,
+   ZMAP_SO_DATA_TABLE01_NUM_ITEMS} ;
+static const SOTableStruct table_soxp_G =
+  {ZMAP_SO_DATA_TABLE02, ZMAP_SO_DATA_TABLE02_BY_NAME, ZMAP_SO_DATA_TABLE02_BY_ID,
+   ZMAP_SO_DATA_TABLE02_NUM_ITEMS} ;
+static const SOTableStruct table_soxpsimple_G =
+  {ZMAP_SO_DATA_TABLE03, ZMAP_SO_DATA_TABLE03_BY_NAME, ZMAP_SO_DATA_TABLE03_BY_ID,
+   ZMAP_SO_DATA_TABLE03_NUM_ITEMS} ;
+#ifdef USE_SO_TERM_HACK
+static const SOTableStruct table_hack_G =
+  {ZMAP_SO_DATA_TABLE04_HACK, ZMAP_SO_DATA_TABLE04_HACK_BY_NAME, ZMAP_SO_DATA_TABLE04_HACK_BY_ID,
+   ZMAP_SO_DATA_TABLE04_HACK_NUM_ITEMS} ;
+#endif
+
+
+/*
+ * The table for the SO set in use, NULL if there isn't one.
+ */
+static const SOTableStruct *getSOTable(ZMapSOSetInUse cSOSetInUse)
+{
+  const SOTableStruct *pTable = NULL ;
+
+  if (cSOSetInUse == ZMAPSO_USE_SOFA)
+    pTable = &table_sofa_G ;
+  else if (cSOSetInUse == ZMAPSO_USE_SOXP)
+    pTable = &table_soxp_G ;
+  else if (cSOSetInUse == ZMAPSO_USE_SOXPSIMPLE)
+    pTable = &table_soxpsimple_G ;
+
+  return pTable ;
+}
+
+/*
+ * Binary search of the table for the name. If the name is in the
+ * table more than once this is the first entry, as a scan would find.
+ */
+static const ZMapSOIDDataStruct *findSOName(const SOTableStruct *pTable, const char * const sName)
+{
+  const ZMapSOIDDataStruct *pFound = NULL ;
+  unsigned int iLo = 0, iHi = 0, iMid = 0 ;
+
+  if (pTable)
+    {
+      iHi = pTable->iNumItems ;
+      while (iLo < iHi)
+        {
+          iMid = iLo + (iHi - iLo) / 2 ;
+
+          if (strcmp(pTable->pData[pTable->pByName[iMid]].sName, sName) < 0)
+            iLo = iMid + 1 ;
+          else
+            iHi = iMid ;
+        }
+
+      if (iLo < pTable->iNumItems && !strcmp(pTable->pData[pTable->pByName[iLo]].sName, sName))
+        pFound = &pTable->pData[pTable->pByName[iLo]] ;
+    }
+
+  return pFound ;
+}
+
+/*
+ * As findSOName() but for the numerical ID.
+ */
+static const ZMapSOIDDataStruct *findSOID(const SOTableStruct *pTable, unsigned int iID)
+{
+  const ZMapSOIDDataStruct *pFound = NULL ;
+  unsigned int iLo = 0, iHi = 0, iMid = 0 ;
+
+  if (pTable)
+    {
+      iHi = pTable->iNumItems ;
+      while (iLo < iHi)
+        {
+          iMid = iLo + (iHi - iLo) / 2 ;
+
+          if (pTable->pData[pTable->pByID[iMid]].iID < iID)
+            iLo = iMid + 1 ;
+          else
+            iHi = iMid ;
+        }
+
+      if (iLo < pTable->iNumItems && pTable->pData[pTable->pByID[iLo]].iID == iID)
+        pFound = &pTable->pData[pTable->pByID[iLo]] ;
+    }
+
+  return pFound ;
+}
+
+
 /*
  * Create a single SO ID Data object with null data.
  */
@@ -152,50 +255,16 @@ gboolean zMapSOIDDataDestroy(ZMapSOIDData pID)
 char *       zMapSOIDDataName2SOAcc(const char * const pData)
 {
   char * sResult = NULL ;
-  unsigned int iID = 0 ;
-  gboolean bFound = FALSE ;
-  int i = 0 ;
+  const ZMapSOIDDataStruct *pFound = NULL ;
   zMapReturnValIfFailSafe(pData, sResult ) ;
 
-  for (i=0; i<ZMAP_SO_DATA_TABLE01_NUM_ITEMS; ++i)
-    {
-      if (!strcmp(pData, ZMAP_SO_DATA_TABLE01[i].sName))
-        {
-          iID = ZMAP_SO_DATA_TABLE01[i].iID ;
-          bFound = TRUE ;
-          break ;
-        }
-    }
+  if (!(pFound = findSOName(&table_sofa_G, pData))
+      && !(pFound = findSOName(&table_soxp_G, pData)))
+    pFound = findSOName(&table_soxpsimple_G, pData) ;
 
-  if (!bFound)
+  if (pFound)
     {
-      for (i=0; i<ZMAP_SO_DATA_TABLE02_NUM_ITEMS; ++i)
-        {
-          if (!strcmp(pData, ZMAP_SO_DATA_TABLE02[i].sName))
-            {
-              iID = ZMAP_SO_DATA_TABLE02[i].iID ;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-
-  if (!bFound)
-  {
-    for (i=0; i<ZMAP_SO_DATA_TABLE03_NUM_ITEMS; ++i)
-      {
-        if (!strcmp(pData, ZMAP_SO_DATA_TABLE03[i].sName))
-          {
-            iID = ZMAP_SO_DATA_TABLE03[i].iID ;
-            bFound = TRUE ;
-            break ;
-          }
-      }
-  }
-
-  if (bFound)
-    {
-      sResult = g_strdup_printf("SO:%07d", iID) ;
+      sResult = g_strdup_printf("SO:%07d", pFound->iID) ;
     }
 
 
@@ -209,62 +278,9 @@ char *       zMapSOIDDataName2SOAcc(const char * const pData)
 ZMapStyleMode zMapSOSetGetStyleModeFromID(ZMapSOSetInUse cSOSetInUse, unsigned int iID)
 {
   ZMapStyleMode cTheMode = ZMAPSTYLE_MODE_INVALID ;
-  gboolean bFound = FALSE ;
-  unsigned int i ;
   zMapReturnValIfFail(iID, cTheMode) ;
 
-  if (cSOSetInUse == ZMAPSO_USE_SOFA)
-    {
-      for (i=0; i<ZMAP_SO_DATA_TABLE01_NUM_ITEMS; ++i)
-        {
-          if (iID == ZMAP_SO_DATA_TABLE01[i].iID )
-            {
-              cTheMode =  ZMAP_SO_DATA_TABLE01[i].cStyleMode ;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-  else if (cSOSetInUse == ZMAPSO_USE_SOXP)
-    {
-      for (i=0; i<ZMAP_SO_DATA_TABLE02_NUM_ITEMS; ++i)
-        {
-          if (iID == ZMAP_SO_DATA_TABLE02[i].iID )
-            {
-              cTheMode = ZMAP_SO_DATA_TABLE02[i].cStyleMode ;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-  else if (cSOSetInUse == ZMAPSO_USE_SOXPSIMPLE)
-    {
-      for (i=0; i<ZMAP_SO_DATA_TABLE03_NUM_ITEMS; ++i)
-        {
-          if (iID == ZMAP_SO_DATA_TABLE03[i].iID )
-            {
-              cTheMode = ZMAP_SO_DATA_TABLE03[i].cStyleMode ;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-
-#ifdef USE_SO_TERM_HACK
-  if (!bFound)
-    {
-      for (i=0; i<ZMAP_SO_DATA_TABLE04_HACK_NUM_ITEMS; ++i)
-        {
-          if (iID == ZMAP_SO_DATA_TABLE04_HACK[i].iID )
-            {
-              cTheMode = ZMAP_SO_DATA_TABLE04_HACK[i].cStyleMode ;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-#endif
-
+  zMapSOSetGetDataFromID(cSOSetInUse, iID, NULL, &cTheMode, NULL) ;
 
   return cTheMode ;
 }
@@ -275,62 +291,9 @@ ZMapStyleMode zMapSOSetGetStyleModeFromID(ZMapSOSetInUse cSOSetInUse, unsigned i
 ZMapHomolType zMapSOSetGetHomolFromID(ZMapSOSetInUse cSOSetInUse, unsigned int iID)
 {
   ZMapHomolType cHomol = ZMAPHOMOL_NONE;
-  gboolean bFound = FALSE ;
-  unsigned int i ;
   zMapReturnValIfFail(iID, cHomol ) ;
 
-  if (cSOSetInUse == ZMAPSO_USE_SOFA)
-    {
-      for (i=0; i<ZMAP_SO_DATA_TABLE01_NUM_ITEMS; ++i)
-        {
-          if (iID == ZMAP_SO_DATA_TABLE01[i].iID )
-            {
-              cHomol =  ZMAP_SO_DATA_TABLE01[i].cHomol ;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-  else if (cSOSetInUse == ZMAPSO_USE_SOXP)
-    {
-      for (i=0; i<ZMAP_SO_DATA_TABLE02_NUM_ITEMS; ++i)
-        {
-          if (iID == ZMAP_SO_DATA_TABLE02[i].iID )
-            {
-              cHomol = ZMAP_SO_DATA_TABLE02[i].cHomol ;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-  else if (cSOSetInUse == ZMAPSO_USE_SOXPSIMPLE)
-    {
-      for (i=0; i<ZMAP_SO_DATA_TABLE03_NUM_ITEMS; ++i)
-        {
-          if (iID == ZMAP_SO_DATA_TABLE03[i].iID )
-            {
-              cHomol = ZMAP_SO_DATA_TABLE03[i].cHomol ;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-
-#ifdef USE_SO_TERM_HACK
-  if (!bFound)
-    {
-      for (i=0; i<ZMAP_SO_DATA_TABLE04_HACK_NUM_ITEMS; ++i)
-        {
-          if (iID == ZMAP_SO_DATA_TABLE04_HACK[i].iID )
-            {
-              cHomol = ZMAP_SO_DATA_TABLE04_HACK[i].cHomol ;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-#endif
-
+  zMapSOSetGetDataFromID(cSOSetInUse, iID, NULL, NULL, &cHomol) ;
 
   return cHomol ;
 }
@@ -341,61 +304,9 @@ ZMapHomolType zMapSOSetGetHomolFromID(ZMapSOSetInUse cSOSetInUse, unsigned int i
 ZMapStyleMode zMapSOSetGetStyleModeFromName(ZMapSOSetInUse cSOSetInUse, const char * const sName )
 {
   ZMapStyleMode cTheMode = ZMAPSTYLE_MODE_INVALID ;
-  gboolean bFound = FALSE ;
-  unsigned int i ;
   zMapReturnValIfFail(sName && *sName, cTheMode ) ;
 
-  if (cSOSetInUse == ZMAPSO_USE_SOFA)
-    {
-      for (i=0; i<ZMAP_SO_DATA_TABLE01_NUM_ITEMS; ++i)
-        {
-          if (!strcmp(sName, ZMAP_SO_DATA_TABLE01[i].sName))
-            {
-              cTheMode = ZMAP_SO_DATA_TABLE01[i].cStyleMode ;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-  else if (cSOSetInUse == ZMAPSO_USE_SOXP)
-    {
-      for (i=0; i<ZMAP_SO_DATA_TABLE02_NUM_ITEMS; ++i)
-        {
-          if (!strcmp(sName, ZMAP_SO_DATA_TABLE02[i].sName))
-            {
-              cTheMode = ZMAP_SO_DATA_TABLE02[i].cStyleMode ;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-  else if (cSOSetInUse == ZMAPSO_USE_SOXPSIMPLE)
-    {
-      for (i=0; i<ZMAP_SO_DATA_TABLE03_NUM_ITEMS; ++i)
-        {
-          if (!strcmp(sName, ZMAP_SO_DATA_TABLE03[i].sName))
-            {
-              cTheMode = ZMAP_SO_DATA_TABLE03[i].cStyleMode ;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-
-#ifdef USE_SO_TERM_HACK
-  if (!bFound)
-    {
-      for (i=0; i<ZMAP_SO_DATA_TABLE04_HACK_NUM_ITEMS; ++i)
-        {
-          if (!strcmp(sName, ZMAP_SO_DATA_TABLE04_HACK[i].sName))
-            {
-              cTheMode = ZMAP_SO_DATA_TABLE04_HACK[i].cStyleMode ;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-#endif
+  zMapSOSetGetDataFromName(cSOSetInUse, sName, NULL, &cTheMode, NULL) ;
 
   return cTheMode ;
 }
@@ -406,61 +317,10 @@ ZMapStyleMode zMapSOSetGetStyleModeFromName(ZMapSOSetInUse cSOSetInUse, const ch
  */
 unsigned int zMapSOSetIsNamePresent(ZMapSOSetInUse cSOSetInUse, const char * const sType)
 {
-  unsigned int iResult = ZMAPSO_ID_UNK, i ;
-  gboolean bFound = FALSE ;
+  unsigned int iResult = ZMAPSO_ID_UNK ;
   zMapReturnValIfFail(sType && *sType, iResult ) ;
 
-  if (cSOSetInUse == ZMAPSO_USE_SOFA)
-    {
-      for (i=0; i<ZMAP_SO_DATA_TABLE01_NUM_ITEMS; ++i)
-        {
-          if (!strcmp(sType, ZMAP_SO_DATA_TABLE01[i].sName))
-            {
-              iResult = ZMAP_SO_DATA_TABLE01[i].iID ;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-  else if (cSOSetInUse == ZMAPSO_USE_SOXP)
-    {
-      for (i=0; i<ZMAP_SO_DATA_TABLE02_NUM_ITEMS; ++i)
-        {
-          if (!strcmp(sType, ZMAP_SO_DATA_TABLE02[i].sName))
-            {
-              iResult = ZMAP_SO_DATA_TABLE02[i].iID ;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-  else if (cSOSetInUse == ZMAPSO_USE_SOXPSIMPLE)
-    {
-      for (i=0; i<ZMAP_SO_DATA_TABLE03_NUM_ITEMS; ++i)
-        {
-          if (!strcmp(sType, ZMAP_SO_DATA_TABLE03[i].sName))
-            {
-              iResult = ZMAP_SO_DATA_TABLE03[i].iID ;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-
-#ifdef USE_SO_TERM_HACK
-  if (!bFound)
-    {
-      for (i=0; i<ZMAP_SO_DATA_TABLE04_HACK_NUM_ITEMS; ++i)
-        {
-          if (!strcmp(sType, ZMAP_SO_DATA_TABLE04_HACK[i].sName))
-            {
-              iResult = ZMAP_SO_DATA_TABLE04_HACK[i].iID ;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-#endif
+  zMapSOSetGetDataFromName(cSOSetInUse, sType, &iResult, NULL, NULL) ;
 
   return iResult ;
 }
@@ -472,81 +332,77 @@ unsigned int zMapSOSetIsNamePresent(ZMapSOSetInUse cSOSetInUse, const char * con
 const char * zMapSOSetIsIDPresent(ZMapSOSetInUse cSOSetInUse, unsigned int iID )
 {
   const char* sResult = NULL ;
-  gboolean bFound = FALSE ;
-  unsigned int i ;
   zMapReturnValIfFail(iID, sResult ) ;
 
-  if (cSOSetInUse == ZMAPSO_USE_SOFA)
-    {
-      for (i=0; i<ZMAP_SO_DATA_TABLE01_NUM_ITEMS; ++i)
-        {
-          if (iID == ZMAP_SO_DATA_TABLE01[i].iID )
-            {
-              sResult =  ZMAP_SO_DATA_TABLE01[i].sName ;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-  else if (cSOSetInUse == ZMAPSO_USE_SOXP)
-    {
-      for (i=0; i<ZMAP_SO_DATA_TABLE02_NUM_ITEMS; ++i)
-        {
-          if (iID == ZMAP_SO_DATA_TABLE02[i].iID )
-            {
-              sResult = ZMAP_SO_DATA_TABLE02[i].sName ;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-  else if (cSOSetInUse == ZMAPSO_USE_SOXPSIMPLE)
-    {
-      for (i=0; i<ZMAP_SO_DATA_TABLE03_NUM_ITEMS; ++i)
-        {
-          if (iID == ZMAP_SO_DATA_TABLE03[i].iID )
-            {
-              sResult = ZMAP_SO_DATA_TABLE03[i].sName;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-
-#ifdef USE_SO_TERM_HACK
-  if (!bFound)
-    {
-      for (i=0; i<ZMAP_SO_DATA_TABLE04_HACK_NUM_ITEMS; ++i)
-        {
-          if (iID == ZMAP_SO_DATA_TABLE04_HACK[i].iID )
-            {
-              sResult = ZMAP_SO_DATA_TABLE04_HACK[i].sName ;
-              bFound = TRUE ;
-              break ;
-            }
-        }
-    }
-#endif
+  zMapSOSetGetDataFromID(cSOSetInUse, iID, &sResult, NULL, NULL) ;
 
   return sResult ;
 }
 
-
 /*
- * Need functions to lookup ZMapStyleMode from either the ID
- * or the name string.
+ * Look up everything we hold for the SO term with the given name in one go.
+ * Returns TRUE if the name is present, in which case any of the non-NULL
+ * arguments are set to the ID, style mode and homol type of the term.
  */
+gboolean zMapSOSetGetDataFromName(ZMapSOSetInUse cSOSetInUse, const char * const sName,
+                                  unsigned int *piID, ZMapStyleMode *pcStyleMode, ZMapHomolType *pcHomol)
+{
+  gboolean bFound = FALSE ;
+  const ZMapSOIDDataStruct *pFound = NULL ;
+  zMapReturnValIfFail(sName && *sName, bFound ) ;
 
+  pFound = findSOName(getSOTable(cSOSetInUse), sName) ;
 
+#ifdef USE_SO_TERM_HACK
+  if (!pFound)
+    pFound = findSOName(&table_hack_G, sName) ;
+#endif
 
+  if (pFound)
+    {
+      if (piID)
+        *piID = pFound->iID ;
+      if (pcStyleMode)
+        *pcStyleMode = pFound->cStyleMode ;
+      if (pcHomol)
+        *pcHomol = pFound->cHomol ;
+      bFound = TRUE ;
+    }
 
+  return bFound ;
+}
 
+/*
+ * As zMapSOSetGetDataFromName() but for a numerical ID, the name returned
+ * is a pointer into the SO data and must not be freed.
+ */
+gboolean zMapSOSetGetDataFromID(ZMapSOSetInUse cSOSetInUse, unsigned int iID,
+                                const char **psName, ZMapStyleMode *pcStyleMode, ZMapHomolType *pcHomol)
+{
+  gboolean bFound = FALSE ;
+  const ZMapSOIDDataStruct *pFound = NULL ;
+  zMapReturnValIfFail(iID, bFound ) ;
 
+  pFound = findSOID(getSOTable(cSOSetInUse), iID) ;
 
+#ifdef USE_SO_TERM_HACK
+  if (!pFound)
+    pFound = findSOID(&table_hack_G, iID) ;
+#endif
 
+  if (pFound)
+    {
+      if (psName)
+        *psName = pFound->sName ;
+      if (pcStyleMode)
+        *pcStyleMode = pFound->cStyleMode ;
+      if (pcHomol)
+        *pcHomol = pFound->cHomol ;
+      bFound = TRUE ;
+    }
 
-
-
+  return bFound ;
+}
 
 
 /*
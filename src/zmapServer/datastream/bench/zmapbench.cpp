@@ -0,0 +1,1306 @@
+/*  File: zmapbench.cpp
+ *  Copyright (c) 2006-2017: Genome Research Ltd.
+ *-------------------------------------------------------------------
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------
+ * This file is part of the ZMap genome database package
+ * originally written by:
+ *
+ *      Ed Griffiths (Sanger Institute, UK) edgrif@sanger.ac.uk
+ *        Roy Storey (Sanger Institute, UK) rds@sanger.ac.uk
+ *   Malcolm Hinsley (Sanger Institute, UK) mh17@sanger.ac.uk
+ *       Gemma Guest (Sanger Institute, UK) gb10@sanger.ac.uk
+ *      Steve Miller (Sanger Institute, UK) sm23@sanger.ac.uk
+ *
+ * Description: Program to time zmap's feature loading without a display.
+ *
+ *              Each file is loaded as a separate source in the same way
+ *              as the file server does it: the data stream is created,
+ *              its header and any sequence read, then its body parsed
+ *              into a new context which is merged into one "view"
+ *              context. Finally the featureset indexes are built.
+ *
+ *              Timings are printed as one JSON object per file followed
+ *              by a summary object, e.g.
+ *
+ *              zmap_bench --sequence=chr6-18 --start=2696324 --end=2706512 a.gff b.bam
+ *
+ *              With --dump the loaded features are then exported as GFF
+ *              to the given file, once with the line at a time dumper and
+ *              once with the parallel one, and the rates compared.
+ *
+ *              With --canvas-index each featureset's canvas display index
+ *              is built both as a skip list and as the sorted index (see
+ *              CANVAS_FEATURESET_SORTED_INDEX) and the operations the
+ *              canvas does with it are timed: building it, exposes
+ *              (find the first feature of a window and walk to its end),
+ *              finding single features and bumping (walking all of it).
+ *
+ *              With --gff-lines the body lines of each GFF3 file are
+ *              split into columns with the old token array tokenizer and
+ *              with the span tokenizer, and their attributes parsed with
+ *              the old eager attribute parsing and the lazy attribute
+ *              list, and the rates and heap allocations per line compared.
+ *
+ *              With --packed-dna the loaded dna (or random dna for the
+ *              region if none was loaded) is packed and the memory saved
+ *              and the cost of decoding it compared with copying plain dna.
+ *
+ *              The program is built but not installed.
+ *
+ * Exported functions: none
+ *-------------------------------------------------------------------
+ */
+
+#include <ZMap/zmap.hpp>
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <glib/gstdio.h>
+
+#include <ZMap/zmapUtils.hpp>
+#include <ZMap/zmapConfigIni.hpp>
+#include <ZMap/zmapFeature.hpp>
+#include <ZMap/zmapGFF.hpp>
+#include <ZMap/zmapGFFStringUtils.hpp>
+#include <ZMap/zmapDNA.hpp>
+#include <ZMap/zmapStyleTree.hpp>
+#include <zmapServer/datastream/zmapDataStream_P.hpp>
+#include <zmapGFF_P.hpp>
+#include <zmapGFFAttribute.hpp>
+#include <zmapWindowCanvasFeatureset_I.hpp>
+#include <zmapWindowCanvasFeature_I.hpp>
+
+
+
+#define ZMAPBENCH_APPNAME "zmap_bench"
+
+#define CANVAS_INDEX_EXPOSES 1000                           /* Windows exposed per featureset. */
+#define CANVAS_INDEX_WINDOW_FRACTION 100                    /* Window is 1/this of the region. */
+#define CANVAS_INDEX_MAX_FINDS 10000                        /* Features looked up per featureset. */
+
+#define GFF_LINES_MAX 1000000                               /* Body lines read per file. */
+#define GFF_TOKEN_LIMIT 1000                                /* As the old parseBodyLine_V3() */
+
+#define PACKED_DNA_WINDOW 1000                              /* Bases decoded per window... */
+#define PACKED_DNA_WINDOWS 10000                            /* ...and windows decoded. */
+
+
+/* Results for loading one file. */
+typedef struct BenchFileStructType
+{
+  const char *file_name ;
+  gboolean ok ;
+  char *err_msg ;
+
+  int gff_version ;                                         /* 0 if not a GFF file. */
+
+  int num_records ;                                         /* Body lines/records parsed. */
+  int num_features ;                                        /* Features in the file's context. */
+
+  double open_secs ;                                        /* Create stream, read header/dna. */
+  double parse_secs ;
+  double merge_secs ;
+
+} BenchFileStruct, *BenchFile ;
+
+
+/* The canvas features of one featureset and the two display indexes of them. */
+typedef struct CanvasIndexDataStructType
+{
+  int n_features ;
+  zmapWindowCanvasFeatureStruct *canvas_features ;
+  GPtrArray *features ;                                     /* sorted by zMapWindowFeatureCmp() */
+  double longest ;                                          /* as fi->longest */
+
+  ZMapSkipList skip_list ;
+  ZMapWindowCanvasSortedIndex sorted_index ;
+} CanvasIndexDataStruct, *CanvasIndexData ;
+
+
+static gboolean loadFile(const char *file_name, ZMapStyleTree &styles,
+                         const char *sequence, int start, int end,
+                         ZMapFeatureContext *view_context_inout, BenchFile result) ;
+static ZMapFeatureContext createContext(const char *sequence, int start, int end, ZMapFeatureBlock *block_out) ;
+static int countFeatures(ZMapFeatureContext context) ;
+static void countSetFeaturesCB(gpointer key, gpointer data, gpointer user_data) ;
+static void indexSetCB(gpointer key, gpointer data, gpointer user_data) ;
+static gboolean dumpContext(ZMapFeatureContext context, ZMapStyleTree &styles,
+                            const char *dump_file, gboolean parallel) ;
+static void benchGFFLines(const char *file_name, const char *sequence, int start, int end) ;
+static GPtrArray *readGFFBodyLines(const char *file_name, size_t *max_length_out) ;
+static void benchPackedDNA(ZMapFeatureContext view_context, int start, int end) ;
+static void canvasIndexSetCB(gpointer key, gpointer data, gpointer user_data) ;
+static ZMapSkipList canvasIndexFind(CanvasIndexData index_data, gboolean sorted, double y1, double y2) ;
+static int canvasIndexExpose(CanvasIndexData index_data, gboolean sorted, int start, int end) ;
+static int canvasIndexFindFeatures(CanvasIndexData index_data, gboolean sorted) ;
+static int canvasIndexWalk(CanvasIndexData index_data, gboolean sorted) ;
+static long peakRSS(void) ;
+static long numAllocs(void) ;
+static char *jsonEscape(const char *str) ;
+static void printFileResult(BenchFile result) ;
+
+
+
+/* Command line args. */
+static char *sequence_G = NULL ;
+static int start_G = 0 ;
+static int end_G = 0 ;
+static char **files_G = NULL ;
+static char *dump_file_G = NULL ;
+static gboolean canvas_index_G = FALSE ;
+static gboolean gff_lines_G = FALSE ;
+static gboolean packed_dna_G = FALSE ;
+
+static GOptionEntry entries_G[] =
+  {
+    /* long_name, short_name, flags, arg, arg_data, description, arg_description */
+    { "sequence", 0, 0, G_OPTION_ARG_STRING, &sequence_G, "Sequence to load features for.", "sequence" },
+    { "start", 0, 0, G_OPTION_ARG_INT, &start_G, "Start of region.", "start" },
+    { "end", 0, 0, G_OPTION_ARG_INT, &end_G, "End of region.", "end" },
+    { "dump", 0, 0, G_OPTION_ARG_FILENAME, &dump_file_G, "Time exporting the features as GFF to this file.", "file" },
+    { "canvas-index", 0, 0, G_OPTION_ARG_NONE, &canvas_index_G,
+      "Compare the skip list and sorted canvas display indexes of each featureset.", NULL },
+    { "gff-lines", 0, 0, G_OPTION_ARG_NONE, &gff_lines_G,
+      "Compare the old and new GFF3 body line tokenizers and attribute parsing.", NULL },
+    { "packed-dna", 0, 0, G_OPTION_ARG_NONE, &packed_dna_G,
+      "Measure the memory and decoding cost of packed dna.", NULL },
+    { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &files_G, NULL, "<file>..." },
+    { NULL }
+  } ;
+
+
+#if defined(__GLIBC__)
+/* With glibc the allocation functions are replaced by wrappers of the libc ones that count
+ * the calls, g_malloc() and friends end up here too. */
+#define BENCH_COUNT_ALLOCS 1
+
+extern "C"
+{
+  void *__libc_malloc(size_t size) ;
+  void *__libc_calloc(size_t n_members, size_t size) ;
+  void *__libc_realloc(void *ptr, size_t size) ;
+}
+
+static std::atomic<long> num_allocs_G(0) ;
+
+extern "C" void *malloc(size_t size) noexcept
+{
+  num_allocs_G.fetch_add(1, std::memory_order_relaxed) ;
+
+  return __libc_malloc(size) ;
+}
+
+extern "C" void *calloc(size_t n_members, size_t size) noexcept
+{
+  num_allocs_G.fetch_add(1, std::memory_order_relaxed) ;
+
+  return __libc_calloc(n_members, size) ;
+}
+
+extern "C" void *realloc(void *ptr, size_t size) noexcept
+{
+  num_allocs_G.fetch_add(1, std::memory_order_relaxed) ;
+
+  return __libc_realloc(ptr, size) ;
+}
+#endif /* __GLIBC__ */
+
+
+
+
+int main(int argc, char *argv[])
+{
+  int exit_rc = EXIT_FAILURE ;
+  GOptionContext *opt_context ;
+  GError *error = NULL ;
+
+  opt_context = g_option_context_new(NULL) ;
+
+  g_option_context_set_summary(opt_context,
+                               "Load GFF/BED/bigBed/bigWig/BAM/VCF files into a zmap feature context without "
+                               "a display and report how long each stage takes.") ;
+  g_option_context_add_main_entries(opt_context, entries_G, NULL) ;
+
+  if (!g_option_context_parse(opt_context, &argc, &argv, &error))
+    {
+      g_printerr("%s: option parsing failed: %s\n", ZMAPBENCH_APPNAME, error->message) ;
+    }
+  else if (!sequence_G || start_G < 1 || end_G < start_G || !files_G || !*files_G)
+    {
+      g_printerr("%s: a sequence, a start/end and at least one file are required.\n", ZMAPBENCH_APPNAME) ;
+    }
+  else
+    {
+      ZMapStyleTree styles ;
+      GHashTable *styles_hash ;
+      ZMapFeatureContext view_context = NULL ;
+      GTimer *timer ;
+      double total_secs, index_secs ;
+      int total_records = 0, total_features = 0, num_ok = 0 ;
+      char **file ;
+
+      /* Same predefined styles as the view falls back on. */
+      styles_hash = zmapConfigIniGetDefaultStyles() ;
+      styles.merge(styles_hash, ZMAPSTYLE_MERGE_PRESERVE) ;
+
+      timer = g_timer_new() ;
+
+      for (file = files_G ; *file ; file++)
+        {
+          BenchFileStruct result = {NULL} ;
+
+          if (loadFile(*file, styles, sequence_G, start_G, end_G, &view_context, &result))
+            {
+              total_records += result.num_records ;
+              total_features += result.num_features ;
+              num_ok++ ;
+            }
+
+          printFileResult(&result) ;
+
+          /* The line benchmarks are timed separately so must not count towards the totals. */
+          if (gff_lines_G && result.gff_version == ZMAPGFF_VERSION_3)
+            {
+              g_timer_stop(timer) ;
+
+              benchGFFLines(*file, sequence_G, start_G, end_G) ;
+
+              g_timer_continue(timer) ;
+            }
+
+          g_free(result.err_msg) ;
+        }
+
+      /* Build the featureset indexes as the first display of the features would. */
+      index_secs = g_timer_elapsed(timer, NULL) ;
+
+      if (view_context)
+        {
+          ZMapFeatureBlock block ;
+
+          block = (ZMapFeatureBlock)zMap_g_hash_table_nth(view_context->master_align->blocks, 0) ;
+
+          g_hash_table_foreach(block->feature_sets, indexSetCB, NULL) ;
+        }
+
+      total_secs = g_timer_elapsed(timer, NULL) ;
+      index_secs = total_secs - index_secs ;
+
+      g_print("{\"summary\": true, \"files\": %d, \"files_ok\": %d, \"records\": %d, \"features\": %d, "
+              "\"index_secs\": %.6f, \"total_secs\": %.6f, \"records_per_sec\": %.1f, "
+              "\"features_per_sec\": %.1f, \"peak_rss_kb\": %ld}\n",
+              (int)g_strv_length(files_G), num_ok, total_records, total_features,
+              index_secs, total_secs,
+              (total_secs > 0.0 ? total_records / total_secs : 0.0),
+              (total_secs > 0.0 ? total_features / total_secs : 0.0),
+              peakRSS()) ;
+
+      g_timer_destroy(timer) ;
+
+      if (view_context && dump_file_G)
+        {
+          if (!dumpContext(view_context, styles, dump_file_G, FALSE)
+              || !dumpContext(view_context, styles, dump_file_G, TRUE))
+            num_ok = 0 ;
+        }
+
+      if (packed_dna_G)
+        benchPackedDNA(view_context, start_G, end_G) ;
+
+      if (view_context && canvas_index_G)
+        {
+          ZMapFeatureBlock block ;
+
+          block = (ZMapFeatureBlock)zMap_g_hash_table_nth(view_context->master_align->blocks, 0) ;
+
+          g_hash_table_foreach(block->feature_sets, canvasIndexSetCB, NULL) ;
+        }
+
+      if (view_context)
+        zMapFeatureContextDestroy(view_context, TRUE) ;
+
+      if (num_ok == (int)g_strv_length(files_G))
+        exit_rc = EXIT_SUCCESS ;
+    }
+
+  g_option_context_free(opt_context) ;
+
+  return exit_rc ;
+}
+
+
+
+/*
+ *                      Internal routines
+ */
+
+
+/* Load a file following the same steps as the file server, then merge it into the view context. */
+static gboolean loadFile(const char *file_name, ZMapStyleTree &styles,
+                         const char *sequence, int start, int end,
+                         ZMapFeatureContext *view_context_inout, BenchFile result)
+{
+  ZMapConfigSource config_source ;
+  ZMapDataStream data_stream = NULL ;
+  ZMapFeatureContext context = NULL, diff_context = NULL ;
+  ZMapFeatureContextMergeStats merge_stats = NULL ;
+  ZMapFeatureBlock block = NULL ;
+  GHashTable *featureset_2_column, *source_2_sourcedata ;
+  GTimer *timer ;
+  GError *error = NULL ;
+  std::string err_msg ;
+  char *url, *source_name ;
+
+  result->file_name = file_name ;
+  result->ok = FALSE ;
+
+  timer = g_timer_new() ;
+
+  config_source = new ZMapConfigSourceStruct ;
+  if (g_path_is_absolute(file_name))
+    {
+      url = g_strdup_printf("file://%s", file_name) ;
+    }
+  else
+    {
+      char *cwd = g_get_current_dir() ;
+
+      url = g_strdup_printf("file://%s/%s", cwd, file_name) ;
+      g_free(cwd) ;
+    }
+  config_source->setUrl(url) ;
+  source_name = g_path_get_basename(file_name) ;
+  config_source->name_ = g_quark_from_string(source_name) ;
+
+  featureset_2_column = g_hash_table_new(NULL, NULL) ;
+  source_2_sourcedata = g_hash_table_new(NULL, NULL) ;
+
+  if (!(data_stream = zMapDataStreamCreate(config_source, file_name, sequence, start, end, &error)))
+    {
+      result->err_msg = g_strdup(error ? error->message : "could not open file") ;
+    }
+  else
+    {
+      bool empty_or_eof = false ;
+      gboolean sequence_finished = FALSE ;
+      int gff_version = 0 ;
+
+      if (!data_stream->checkHeader(err_msg, empty_or_eof, false))
+        {
+          result->err_msg = g_strdup(err_msg.c_str()) ;
+        }
+      else
+        {
+          /* Only gff has dna at the head of the stream. */
+          if (data_stream->gffVersion(&gff_version))
+            {
+              result->gff_version = gff_version ;
+
+              if (data_stream->init(sequence, start, end))
+                data_stream->parseSequence(sequence_finished, err_msg) ;
+            }
+
+          result->open_secs = g_timer_elapsed(timer, NULL) ;
+          g_timer_start(timer) ;
+
+          context = createContext(sequence, start, end, &block) ;
+
+          data_stream->parserInit(featureset_2_column, source_2_sourcedata, &styles) ;
+
+          if (!data_stream->init(sequence, start, end))
+            {
+              result->err_msg = g_strdup("could not initialise stream for region") ;
+            }
+          else
+            {
+              while (!data_stream->endOfFile())
+                {
+                  if (!data_stream->parseBodyLine(&error))
+                    {
+                      if (data_stream->terminated() || zMapFeatureErrorIsFatal(&error))
+                        {
+                          result->err_msg = g_strdup(error ? error->message : "parse failed") ;
+
+                          break ;
+                        }
+                    }
+
+                  if (error)
+                    {
+                      g_error_free(error) ;
+                      error = NULL ;
+                    }
+
+                  result->num_records++ ;
+                }
+
+              if (!result->err_msg && !data_stream->addFeaturesToBlock(block))
+                result->err_msg = g_strdup("could not get features from parser") ;
+            }
+
+          result->parse_secs = g_timer_elapsed(timer, NULL) ;
+          g_timer_start(timer) ;
+        }
+    }
+
+  if (context && !result->err_msg)
+    {
+      ZMapFeatureContextMergeCode merge_code ;
+      GList *featureset_names ;
+
+      result->num_features = countFeatures(context) ;
+
+      context->src_feature_set_names = data_stream->getFeaturesets() ;
+      featureset_names = g_list_copy(context->src_feature_set_names) ;
+
+      if (!*view_context_inout)
+        *view_context_inout = createContext(sequence, start, end, NULL) ;
+
+      merge_code = zMapFeatureContextMerge(view_context_inout, &context, &diff_context, &merge_stats,
+                                           featureset_names) ;
+
+      if (merge_code == ZMAPFEATURE_CONTEXT_OK || merge_code == ZMAPFEATURE_CONTEXT_NONE)
+        result->ok = TRUE ;
+      else
+        result->err_msg = g_strdup("merge failed") ;
+
+      result->merge_secs = g_timer_elapsed(timer, NULL) ;
+
+      g_list_free(featureset_names) ;
+
+      /* As the view does once the new features are drawn. */
+      if (diff_context && diff_context != *view_context_inout)
+        zMapFeatureContextDestroy(diff_context, TRUE) ;
+
+      g_free(merge_stats) ;
+    }
+
+  if (context)
+    zMapFeatureContextDestroy(context, TRUE) ;
+
+  if (data_stream)
+    zMapDataStreamDestroy(&data_stream) ;
+
+  if (error)
+    g_error_free(error) ;
+
+  g_hash_table_destroy(featureset_2_column) ;
+  g_hash_table_destroy(source_2_sourcedata) ;
+  g_free(source_name) ;
+  g_free(url) ;
+  delete config_source ;
+  g_timer_destroy(timer) ;
+
+  return result->ok ;
+}
+
+
+/* Like zmapViewCreateContext(), one master align with one block covering the region. */
+static ZMapFeatureContext createContext(const char *sequence, int start, int end, ZMapFeatureBlock *block_out)
+{
+  ZMapFeatureContext context ;
+  ZMapFeatureAlignment alignment ;
+  ZMapFeatureBlock block ;
+  char *seq = (char *)sequence ;
+
+  context = zMapFeatureContextCreate(seq, start, end, NULL) ;
+
+  alignment = zMapFeatureAlignmentCreate(seq, TRUE) ;
+  zMapFeatureContextAddAlignment(context, alignment, TRUE) ;
+
+  block = zMapFeatureBlockCreate(seq, start, end, ZMAPSTRAND_FORWARD, start, end, ZMAPSTRAND_FORWARD) ;
+  zMapFeatureAlignmentAddBlock(alignment, block) ;
+
+  if (block_out)
+    *block_out = block ;
+
+  return context ;
+}
+
+
+static int countFeatures(ZMapFeatureContext context)
+{
+  ZMapFeatureBlock block ;
+  int num_features = 0 ;
+
+  block = (ZMapFeatureBlock)zMap_g_hash_table_nth(context->master_align->blocks, 0) ;
+
+  g_hash_table_foreach(block->feature_sets, countSetFeaturesCB, &num_features) ;
+
+  return num_features ;
+}
+
+static void countSetFeaturesCB(gpointer key, gpointer data, gpointer user_data)
+{
+  ZMapFeatureSet feature_set = (ZMapFeatureSet)data ;
+  int *num_features = (int *)user_data ;
+
+  *num_features += g_hash_table_size(feature_set->features) ;
+
+  return ;
+}
+
+
+/* Any overlap search builds the set's index. */
+static void indexSetCB(gpointer key, gpointer data, gpointer user_data)
+{
+  ZMapFeatureSet feature_set = (ZMapFeatureSet)data ;
+  GList *features ;
+
+  features = zMapFeatureSetGetOverlapFeatures(feature_set, 1, 1) ;
+
+  g_list_free(features) ;
+
+  return ;
+}
+
+
+/* Export the context as GFF with the line at a time or the parallel dumper and print the rate. */
+static gboolean dumpContext(ZMapFeatureContext context, ZMapStyleTree &styles,
+                            const char *dump_file, gboolean parallel)
+{
+  gboolean result = FALSE ;
+  GIOChannel *file ;
+  GError *error = NULL ;
+  GTimer *timer ;
+  struct stat file_stats ;
+  double secs = 0.0, mbytes = 0.0 ;
+  char *err_msg = NULL ;
+
+  timer = g_timer_new() ;
+
+  if ((file = g_io_channel_new_file(dump_file, "w", &error)))
+    {
+      if (parallel)
+        result = zMapGFFDumpRegionParallel((ZMapFeatureAny)context, styles, NULL, file, &error) ;
+      else
+        result = zMapGFFDumpRegion((ZMapFeatureAny)context, styles, NULL, file, &error) ;
+
+      if (g_io_channel_shutdown(file, TRUE, (error ? NULL : &error)) != G_IO_STATUS_NORMAL)
+        result = FALSE ;
+
+      g_io_channel_unref(file) ;
+    }
+
+  secs = g_timer_elapsed(timer, NULL) ;
+
+  if (result && g_stat(dump_file, &file_stats) == 0)
+    mbytes = (double)file_stats.st_size / (1024.0 * 1024.0) ;
+
+  if (error)
+    err_msg = jsonEscape(error->message) ;
+
+  g_print("{\"dump\": \"%s\", \"ok\": %s, \"mbytes\": %.3f, \"secs\": %.6f, \"mbytes_per_sec\": %.1f, "
+          "\"peak_rss_kb\": %ld%s%s%s}\n",
+          (parallel ? "parallel" : "serial"), (result ? "true" : "false"), mbytes, secs,
+          (secs > 0.0 ? mbytes / secs : 0.0),
+          peakRSS(),
+          (err_msg ? ", \"error\": \"" : ""), (err_msg ? err_msg : ""), (err_msg ? "\"" : "")) ;
+
+  g_free(err_msg) ;
+
+  if (error)
+    g_error_free(error) ;
+
+  g_timer_destroy(timer) ;
+
+  return result ;
+}
+
+
+/* Time splitting the file's body lines into columns and parsing their attributes the way
+ * parseBodyLine_V3() did before and does now, see zMapGFFStringUtilsSpanTokenizer() and
+ * zMapGFFAttributeParseList(). Both are given the same lines from memory so only the
+ * tokenizing and attribute parsing is timed. */
+static void benchGFFLines(const char *file_name, const char *sequence, int start, int end)
+{
+  static const char *attribute_names[] = {"ID", "Parent", "Name", "Target"} ;
+  GPtrArray *lines ;
+  GPtrArray *attributes ;
+  ZMapGFFParser parser ;
+  GTimer *timer ;
+  size_t buffer_length = 0 ;
+  char *buffers[ZMAPGFF_MANDATORY_FIELDS], *tmp_buffer ;
+  double secs[2][2] ;                                       /* [new][tokens, attributes] */
+  long allocs[2][2] ;
+  gint64 checksum[2] = {0, 0} ;
+  unsigned int i, b ;
+  char *name ;
+
+  if (!(lines = readGFFBodyLines(file_name, &buffer_length)))
+    return ;
+
+  /* As the parser's buffers, at least as long as the longest line. */
+  for (b = 0 ; b < ZMAPGFF_MANDATORY_FIELDS ; b++)
+    buffers[b] = (char *)g_malloc(buffer_length + 1) ;
+  tmp_buffer = (char *)g_malloc(buffer_length + 1) ;
+
+  attributes = g_ptr_array_new_with_free_func(g_free) ;
+  parser = zMapGFFCreateParser(ZMAPGFF_VERSION_3, sequence, start, end) ;
+  timer = g_timer_new() ;
+
+  /* Tokenizers: the old one g_mallocs a token array and copies every column into it, each
+   * buffer was cleared first and start/end were sscanf'd. */
+  for (int is_new = 0 ; is_new < 2 ; is_new++)
+    {
+      allocs[is_new][0] = numAllocs() ;
+      g_timer_start(timer) ;
+
+      for (i = 0 ; i < lines->len ; i++)
+        {
+          const char *line = (const char *)g_ptr_array_index(lines, i) ;
+          int line_start = 0, line_end = 0 ;
+          gboolean has_score = FALSE ;
+          double score = 0.0 ;
+          unsigned int n_fields = 0 ;
+
+          if (is_new)
+            {
+              ZMapGFFStringSpanStruct spans[ZMAPGFF_MANDATORY_FIELDS + 1] ;
+
+              n_fields = zMapGFFStringUtilsSpanTokenizer('\t', line, FALSE, spans, ZMAPGFF_MANDATORY_FIELDS + 1) ;
+
+              if (n_fields >= ZMAPGFF_MANDATORY_FIELDS)
+                {
+                  zMapGFFStringUtilsSpanCopy(&spans[0], buffers[0]) ;
+                  zMapGFFStringUtilsSpanCopy(&spans[1], buffers[1]) ;
+                  zMapGFFStringUtilsSpanCopy(&spans[2], buffers[2]) ;
+                  zMapGFFStringUtilsSpanCopy(&spans[5], buffers[3]) ;
+                  zMapGFFStringUtilsSpanCopy(&spans[6], buffers[4]) ;
+                  zMapGFFStringUtilsSpanCopy(&spans[7], buffers[5]) ;
+                  zMapGFFStringUtilsSpanToInt(&spans[3], &line_start) ;
+                  zMapGFFStringUtilsSpanToInt(&spans[4], &line_end) ;
+
+                  if (!(has_score = zMapGFFStringUtilsSpanToDouble(&spans[5], &score)))
+                    zMapFeatureFormatScore(buffers[3], &has_score, &score) ;
+                }
+
+              if (n_fields == ZMAPGFF_MANDATORY_FIELDS + 1)
+                zMapGFFStringUtilsSpanCopy(&spans[ZMAPGFF_MANDATORY_FIELDS], buffers[6]) ;
+              else
+                *buffers[6] = '\0' ;
+            }
+          else
+            {
+              char **tokens ;
+
+              for (b = 0 ; b < 7 ; b++)
+                memset(buffers[b], 0, buffer_length) ;
+
+              tokens = zMapGFFStringUtilsTokenizer('\t', line, &n_fields, FALSE, GFF_TOKEN_LIMIT,
+                                                   g_malloc, g_free, tmp_buffer) ;
+
+              if (n_fields >= ZMAPGFF_MANDATORY_FIELDS)
+                {
+                  strcpy(buffers[0], tokens[0]) ;
+                  strcpy(buffers[1], tokens[1]) ;
+                  strcpy(buffers[2], tokens[2]) ;
+                  sscanf(tokens[3], "%i", &line_start) ;
+                  sscanf(tokens[4], "%i", &line_end) ;
+                  strcpy(buffers[3], tokens[5]) ;
+                  strcpy(buffers[4], tokens[6]) ;
+                  strcpy(buffers[5], tokens[7]) ;
+
+                  zMapFeatureFormatScore(buffers[3], &has_score, &score) ;
+                }
+
+              if (n_fields == ZMAPGFF_MANDATORY_FIELDS + 1)
+                strcpy(buffers[6], tokens[ZMAPGFF_MANDATORY_FIELDS]) ;
+
+              zMapGFFStringUtilsArrayDelete(tokens, n_fields, g_free) ;
+            }
+
+          checksum[is_new] += line_start + line_end + (has_score ? (gint64)score : 0) ;
+        }
+
+      secs[is_new][0] = g_timer_elapsed(timer, NULL) ;
+      allocs[is_new][0] = numAllocs() - allocs[is_new][0] ;
+    }
+
+  /* The attribute columns for the attribute timings. */
+  for (i = 0 ; i < lines->len ; i++)
+    {
+      ZMapGFFStringSpanStruct spans[ZMAPGFF_MANDATORY_FIELDS + 1] ;
+
+      if (zMapGFFStringUtilsSpanTokenizer('\t', (const char *)g_ptr_array_index(lines, i), FALSE,
+                                          spans, ZMAPGFF_MANDATORY_FIELDS + 1) == ZMAPGFF_MANDATORY_FIELDS + 1)
+        g_ptr_array_add(attributes, g_strndup(spans[ZMAPGFF_MANDATORY_FIELDS].sStart,
+                                              spans[ZMAPGFF_MANDATORY_FIELDS].iLength)) ;
+    }
+
+  /* Attributes: the old way parsed every attribute into its own struct and strings, the lazy
+   * list is one allocation and decodes only what is asked for, here the attributes
+   * makeNewFeature_V3() nearly always looks up. */
+  for (int is_new = 0 ; is_new < 2 ; is_new++)
+    {
+      allocs[is_new][1] = numAllocs() ;
+      g_timer_start(timer) ;
+
+      for (i = 0 ; i < attributes->len ; i++)
+        {
+          const char *column = (const char *)g_ptr_array_index(attributes, i) ;
+          ZMapGFFAttribute *list = NULL ;
+          unsigned int n_attributes = 0, a ;
+          char **tokens = NULL ;
+
+          if (is_new)
+            {
+              list = zMapGFFAttributeParseList(parser, column, &n_attributes, FALSE) ;
+            }
+          else if ((tokens = zMapGFFStringUtilsTokenizer02(';', '"', column, &n_attributes, FALSE,
+                                                           g_malloc, g_free)))
+            {
+              gboolean failed = FALSE ;
+
+              list = (ZMapGFFAttribute *)g_malloc(sizeof(ZMapGFFAttribute) * n_attributes) ;
+
+              for (a = 0 ; a < n_attributes ; a++)
+                {
+                  if (!(list[a] = zMapGFFAttributeParse(parser, tokens[a], FALSE)))
+                    failed = TRUE ;
+                }
+
+              /* As the old list parse did, one bad attribute loses them all. */
+              if (failed)
+                {
+                  for (a = 0 ; a < n_attributes ; a++)
+                    if (list[a])
+                      zMapGFFDestroyAttribute(list[a]) ;
+
+                  g_free(list) ;
+                  list = NULL ;
+                }
+            }
+
+          for (a = 0 ; a < G_N_ELEMENTS(attribute_names) && list ; a++)
+            {
+              ZMapGFFAttribute attribute ;
+
+              if ((attribute = zMapGFFAttributeListContains(list, n_attributes, attribute_names[a])))
+                zMapGFFAttributeGetTempstring(attribute) ;
+            }
+
+          if (is_new)
+            {
+              zMapGFFAttributeDestroyList(list, n_attributes) ;
+            }
+          else if (tokens)
+            {
+              for (a = 0 ; a < n_attributes && list ; a++)
+                zMapGFFDestroyAttribute(list[a]) ;
+
+              g_free(list) ;
+              zMapGFFStringUtilsArrayDelete(tokens, n_attributes, g_free) ;
+            }
+        }
+
+      secs[is_new][1] = g_timer_elapsed(timer, NULL) ;
+      allocs[is_new][1] = numAllocs() - allocs[is_new][1] ;
+    }
+
+  name = jsonEscape(file_name) ;
+
+  /* allocs are -1 where they can't be counted, "same" checks both tokenizers gave the same
+   * coords and scores. */
+  g_print("{\"gff_lines\": \"%s\", \"lines\": %u, \"same\": %s, "
+          "\"old_tokenizer_lines_per_sec\": %.1f, \"new_tokenizer_lines_per_sec\": %.1f, "
+          "\"old_tokenizer_allocs_per_line\": %.2f, \"new_tokenizer_allocs_per_line\": %.2f, "
+          "\"attribute_lines\": %u, "
+          "\"old_attributes_lines_per_sec\": %.1f, \"new_attributes_lines_per_sec\": %.1f, "
+          "\"old_attributes_allocs_per_line\": %.2f, \"new_attributes_allocs_per_line\": %.2f}\n",
+          name, lines->len, (checksum[0] == checksum[1] ? "true" : "false"),
+          (secs[0][0] > 0.0 ? lines->len / secs[0][0] : 0.0),
+          (secs[1][0] > 0.0 ? lines->len / secs[1][0] : 0.0),
+          (numAllocs() < 0 ? -1.0 : (double)allocs[0][0] / MAX(1, lines->len)),
+          (numAllocs() < 0 ? -1.0 : (double)allocs[1][0] / MAX(1, lines->len)),
+          attributes->len,
+          (secs[0][1] > 0.0 ? attributes->len / secs[0][1] : 0.0),
+          (secs[1][1] > 0.0 ? attributes->len / secs[1][1] : 0.0),
+          (numAllocs() < 0 ? -1.0 : (double)allocs[0][1] / MAX(1, attributes->len)),
+          (numAllocs() < 0 ? -1.0 : (double)allocs[1][1] / MAX(1, attributes->len))) ;
+
+  g_free(name) ;
+  g_timer_destroy(timer) ;
+  zMapGFFDestroyParser(parser) ;
+  g_ptr_array_free(attributes, TRUE) ;
+  g_ptr_array_free(lines, TRUE) ;
+  g_free(tmp_buffer) ;
+  for (b = 0 ; b < ZMAPGFF_MANDATORY_FIELDS ; b++)
+    g_free(buffers[b]) ;
+
+  return ;
+}
+
+
+/* Returns up to GFF_LINES_MAX body lines of the file without their line ends, or NULL if the
+ * file can't be read. */
+static GPtrArray *readGFFBodyLines(const char *file_name, size_t *max_length_out)
+{
+  GPtrArray *lines = NULL ;
+  FILE *file ;
+  char *line = NULL ;
+  size_t line_size = 0, max_length = 0 ;
+  ssize_t length ;
+
+  if ((file = fopen(file_name, "r")))
+    {
+      lines = g_ptr_array_new_with_free_func(g_free) ;
+
+      while (lines->len < GFF_LINES_MAX && (length = getline(&line, &line_size, file)) >= 0)
+        {
+          while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+            line[--length] = '\0' ;
+
+          if (g_str_has_prefix(line, "##FASTA"))
+            break ;
+
+          if (!length || *line == '#')
+            continue ;
+
+          if ((size_t)length > max_length)
+            max_length = length ;
+
+          g_ptr_array_add(lines, g_strndup(line, length)) ;
+        }
+
+      free(line) ;
+      fclose(file) ;
+    }
+
+  *max_length_out = max_length ;
+
+  return lines ;
+}
+
+
+/* Compare packed dna with the plain string the block used to hold: memory used, and the cost
+ * of getting a window of bases for display and the whole sequence, forwards and reverse
+ * complemented. Uses the block's dna if some was loaded, otherwise random bases. */
+static void benchPackedDNA(ZMapFeatureContext view_context, int start, int end)
+{
+  ZMapFeatureBlock block = NULL ;
+  ZMapPackedDNA packed ;
+  GTimer *timer ;
+  char *dna = NULL, *buf ;
+  int length = 0, window, i ;
+  double pack_secs, plain_window_secs, window_secs, revcomp_window_secs, full_secs, revcomp_full_secs ;
+  gint64 checksum[2] = {0, 0} ;
+  const char *dna_source = "random" ;
+
+  if (view_context)
+    block = (ZMapFeatureBlock)zMap_g_hash_table_nth(view_context->master_align->blocks, 0) ;
+
+  if (block && block->packed_dna && zMapFeatureBlockDNA(block, NULL, &length, &dna))
+    {
+      dna_source = "loaded" ;
+    }
+  else
+    {
+      static const char bases[] = "acgt" ;
+      GRand *rand ;
+
+      length = end - start + 1 ;
+      rand = g_rand_new_with_seed(length) ;
+
+      dna = (char *)g_malloc(length + 1) ;
+
+      for (i = 0 ; i < length ; i++)
+        dna[i] = bases[g_rand_int_range(rand, 0, 4)] ;
+      dna[length] = '\0' ;
+
+      g_rand_free(rand) ;
+    }
+
+  window = MIN(PACKED_DNA_WINDOW, length) ;
+  buf = (char *)g_malloc(length + 1) ;
+  timer = g_timer_new() ;
+
+  packed = zMapPackedDNACreate(dna, length) ;
+  pack_secs = g_timer_elapsed(timer, NULL) ;
+
+  /* A window of bases as the sequence column draws them: copied from the plain string... */
+  g_timer_start(timer) ;
+  for (i = 0 ; i < PACKED_DNA_WINDOWS ; i++)
+    {
+      int window_start = (int)(((gint64)(length - window) * i) / PACKED_DNA_WINDOWS) ;
+
+      memcpy(buf, dna + window_start, window) ;
+      checksum[0] += buf[window / 2] ;
+    }
+  plain_window_secs = g_timer_elapsed(timer, NULL) ;
+
+  /* ...or decoded from the packed dna. */
+  g_timer_start(timer) ;
+  for (i = 0 ; i < PACKED_DNA_WINDOWS ; i++)
+    {
+      int window_start = (int)(((gint64)(length - window) * i) / PACKED_DNA_WINDOWS) ;
+
+      zMapPackedDNADecode(packed, window_start, window, FALSE, buf) ;
+      checksum[1] += buf[window / 2] ;
+    }
+  window_secs = g_timer_elapsed(timer, NULL) ;
+
+  g_timer_start(timer) ;
+  for (i = 0 ; i < PACKED_DNA_WINDOWS ; i++)
+    {
+      int window_start = (int)(((gint64)(length - window) * i) / PACKED_DNA_WINDOWS) ;
+
+      zMapPackedDNADecode(packed, window_start, window, TRUE, buf) ;
+    }
+  revcomp_window_secs = g_timer_elapsed(timer, NULL) ;
+
+  /* The whole sequence, as for export or translation. */
+  g_timer_start(timer) ;
+  zMapPackedDNADecode(packed, 0, length, FALSE, buf) ;
+  full_secs = g_timer_elapsed(timer, NULL) ;
+
+  g_timer_start(timer) ;
+  zMapPackedDNADecode(packed, 0, length, TRUE, buf) ;
+  revcomp_full_secs = g_timer_elapsed(timer, NULL) ;
+
+  /* "same" checks the packed dna decodes to the plain dna. */
+  g_print("{\"packed_dna\": \"%s\", \"bases\": %d, \"same\": %s, "
+          "\"plain_bytes\": %d, \"packed_bytes\": %" G_GSIZE_FORMAT ", \"pack_secs\": %.6f, "
+          "\"plain_window_secs\": %.6f, \"packed_window_secs\": %.6f, \"packed_revcomp_window_secs\": %.6f, "
+          "\"packed_full_decode_mbases_per_sec\": %.1f, \"packed_revcomp_full_decode_mbases_per_sec\": %.1f}\n",
+          dna_source, length, (checksum[0] == checksum[1] ? "true" : "false"),
+          length + 1, zMapPackedDNAGetMemUsage(packed), pack_secs,
+          plain_window_secs, window_secs, revcomp_window_secs,
+          (full_secs > 0.0 ? length / full_secs / 1e6 : 0.0),
+          (revcomp_full_secs > 0.0 ? length / revcomp_full_secs / 1e6 : 0.0)) ;
+
+  g_timer_destroy(timer) ;
+  zMapPackedDNAUnref(packed) ;
+  g_free(buf) ;
+  g_free(dna) ;
+
+  return ;
+}
+
+
+/* Build the featureset's canvas index both ways and time the operations the canvas does with
+ * it. The canvas features only have the coords and feature set, as for a basic feature. */
+static void canvasIndexSetCB(gpointer key, gpointer data, gpointer user_data)
+{
+  ZMapFeatureSet feature_set = (ZMapFeatureSet)data ;
+  CanvasIndexDataStruct index_data = {0} ;
+  GHashTableIter iter ;
+  gpointer value ;
+  GList *feature_list = NULL ;
+  GTimer *timer ;
+  double secs[2][4] ;                                       /* [sorted][build, expose, find, walk] */
+  int counts[2][3] ;                                        /* [sorted][expose, find, walk] */
+  int start = 0, end = 0, window, i ;
+  char *set_name ;
+
+  if (!(index_data.n_features = g_hash_table_size(feature_set->features)))
+    return ;
+
+  index_data.canvas_features = g_new0(zmapWindowCanvasFeatureStruct, index_data.n_features) ;
+  index_data.features = g_ptr_array_sized_new(index_data.n_features) ;
+
+  i = 0 ;
+  g_hash_table_iter_init(&iter, feature_set->features) ;
+  while (g_hash_table_iter_next(&iter, NULL, &value))
+    {
+      ZMapFeature feature = (ZMapFeature)value ;
+      ZMapWindowCanvasFeature feat = &(index_data.canvas_features[i++]) ;
+
+      feat->type = FEATURE_BASIC ;
+      feat->feature = feature ;
+      feat->y1 = feature->x1 ;
+      feat->y2 = feature->x2 ;
+
+      if (feat->y2 - feat->y1 + 1 > index_data.longest)
+        index_data.longest = feat->y2 - feat->y1 + 1 ;
+
+      if (!start || feature->x1 < start)
+        start = feature->x1 ;
+      if (feature->x2 > end)
+        end = feature->x2 ;
+
+      g_ptr_array_add(index_data.features, feat) ;
+    }
+
+  zmapWindowCanvasFeaturesetSortFeatures(index_data.features, zMapWindowFeatureCmp) ;
+
+  window = MAX(1, (end - start + 1) / CANVAS_INDEX_WINDOW_FRACTION) ;
+
+  timer = g_timer_new() ;
+
+  for (int sorted = 0 ; sorted < 2 ; sorted++)
+    {
+      g_timer_start(timer) ;
+
+      /* As displayIndexCreate() does it. */
+      if (sorted)
+        {
+          index_data.sorted_index = zmapWindowCanvasSortedIndexCreate(index_data.features) ;
+        }
+      else
+        {
+          for (i = index_data.n_features - 1 ; i >= 0 ; i--)
+            feature_list = g_list_prepend(feature_list, g_ptr_array_index(index_data.features, i)) ;
+
+          index_data.skip_list = zMapSkipListCreate(feature_list, NULL) ;
+
+          g_list_free(feature_list) ;
+          feature_list = NULL ;
+        }
+
+      secs[sorted][0] = g_timer_elapsed(timer, NULL) ;
+      g_timer_start(timer) ;
+
+      counts[sorted][0] = 0 ;
+      for (i = 0 ; i < CANVAS_INDEX_EXPOSES ; i++)
+        {
+          int expose_start = start + (int)(((gint64)(end - start + 1 - window) * i) / CANVAS_INDEX_EXPOSES) ;
+
+          counts[sorted][0] += canvasIndexExpose(&index_data, sorted, expose_start, expose_start + window - 1) ;
+        }
+
+      secs[sorted][1] = g_timer_elapsed(timer, NULL) ;
+      g_timer_start(timer) ;
+
+      counts[sorted][1] = canvasIndexFindFeatures(&index_data, sorted) ;
+
+      secs[sorted][2] = g_timer_elapsed(timer, NULL) ;
+      g_timer_start(timer) ;
+
+      counts[sorted][2] = canvasIndexWalk(&index_data, sorted) ;
+
+      secs[sorted][3] = g_timer_elapsed(timer, NULL) ;
+    }
+
+  set_name = jsonEscape(g_quark_to_string(feature_set->original_id)) ;
+
+  /* Both indexes should give the same features, "same" checks that they do. */
+  g_print("{\"canvas_index\": \"%s\", \"features\": %d, \"same\": %s, "
+          "\"skip_list_build_secs\": %.6f, \"sorted_build_secs\": %.6f, "
+          "\"skip_list_expose_secs\": %.6f, \"sorted_expose_secs\": %.6f, "
+          "\"skip_list_find_secs\": %.6f, \"sorted_find_secs\": %.6f, "
+          "\"skip_list_bump_walk_secs\": %.6f, \"sorted_bump_walk_secs\": %.6f}\n",
+          set_name, index_data.n_features,
+          ((counts[0][0] == counts[1][0] && counts[0][1] == counts[1][1] && counts[0][2] == counts[1][2])
+           ? "true" : "false"),
+          secs[0][0], secs[1][0], secs[0][1], secs[1][1], secs[0][2], secs[1][2], secs[0][3], secs[1][3]) ;
+
+  g_free(set_name) ;
+  g_timer_destroy(timer) ;
+
+  zMapSkipListDestroy(index_data.skip_list, NULL) ;
+  zmapWindowCanvasSortedIndexDestroy(index_data.sorted_index) ;
+  g_ptr_array_free(index_data.features, TRUE) ;
+  g_free(index_data.canvas_features) ;
+
+  return ;
+}
+
+
+/* The search zmap_window_canvas_featureset_find_feature_coords() and displayIndexFind() do
+ * for an overlapping, unbumped featureset. */
+static ZMapSkipList canvasIndexFind(CanvasIndexData index_data, gboolean sorted, double y1, double y2)
+{
+  ZMapSkipList sl = NULL ;
+  zmapWindowCanvasFeatureStruct search = {FEATURE_INVALID} ;
+
+  search.y1 = y1 - index_data->longest ;
+  search.y2 = y2 ;
+
+  if (sorted)
+    {
+      if (!(sl = zmapWindowCanvasSortedIndexFindOverlap(index_data->sorted_index, y1)))
+        sl = zmapWindowCanvasSortedIndexFind(index_data->sorted_index, zMapWindowFeatureCmp, &search) ;
+    }
+  else
+    {
+      sl = zMapSkipListFind(index_data->skip_list, zMapWindowFeatureCmp, &search) ;
+    }
+
+  return sl ;
+}
+
+
+/* As the featureset draw does: find the first feature that may be exposed and walk to the end
+ * of the window, returns how many features overlap it. */
+static int canvasIndexExpose(CanvasIndexData index_data, gboolean sorted, int start, int end)
+{
+  ZMapSkipList sl ;
+  int n_exposed = 0 ;
+
+  for (sl = canvasIndexFind(index_data, sorted, start, end) ; sl ; sl = sl->next)
+    {
+      ZMapWindowCanvasFeature feat = (ZMapWindowCanvasFeature)(sl->data) ;
+
+      if (feat->y1 > end)
+        break ;
+
+      if (feat->y2 >= start)
+        n_exposed++ ;
+    }
+
+  return n_exposed ;
+}
+
+
+/* As zmap_window_canvas_featureset_find_feature_index() does for up to CANVAS_INDEX_MAX_FINDS
+ * features spread through the set, returns how many were found. */
+static int canvasIndexFindFeatures(CanvasIndexData index_data, gboolean sorted)
+{
+  int step = MAX(1, index_data->n_features / CANVAS_INDEX_MAX_FINDS) ;
+  int n_found = 0 ;
+
+  for (int i = 0 ; i < index_data->n_features ; i += step)
+    {
+      ZMapWindowCanvasFeature target = (ZMapWindowCanvasFeature)g_ptr_array_index(index_data->features, i) ;
+      ZMapSkipList sl ;
+
+      for (sl = canvasIndexFind(index_data, sorted, target->y1, target->y2) ; sl ; sl = sl->next)
+        {
+          ZMapWindowCanvasFeature feat = (ZMapWindowCanvasFeature)(sl->data) ;
+
+          if (feat->y1 > target->y2)
+            break ;
+
+          if (feat == target)
+            {
+              n_found++ ;
+              break ;
+            }
+        }
+    }
+
+  return n_found ;
+}
+
+
+/* Bumping and the other whole column operations walk the index from the head. */
+static int canvasIndexWalk(CanvasIndexData index_data, gboolean sorted)
+{
+  ZMapSkipList sl ;
+  int n_walked = 0 ;
+
+  if (sorted)
+    sl = zmapWindowCanvasSortedIndexHead(index_data->sorted_index) ;
+  else
+    sl = zMapSkipListFirst(index_data->skip_list) ;
+
+  for ( ; sl ; sl = sl->next)
+    {
+      if (sl->data)
+        n_walked++ ;
+    }
+
+  return n_walked ;
+}
+
+
+/* Heap allocations so far, or -1 if they can't be counted, see the malloc() wrappers below. */
+static long numAllocs(void)
+{
+#if BENCH_COUNT_ALLOCS
+  return num_allocs_G.load(std::memory_order_relaxed) ;
+#else
+  return -1 ;
+#endif
+}
+
+
+/* Returns a g_malloc'd copy of str escaped for use as a JSON string: quote, backslash and
+ * the control characters are escaped, other bytes are copied as they are. */
+static char *jsonEscape(const char *str)
+{
+  GString *escaped ;
+  const unsigned char *c ;
+
+  escaped = g_string_sized_new(strlen(str) + 8) ;
+
+  for (c = (const unsigned char *)str ; *c ; c++)
+    {
+      switch (*c)
+        {
+        case '"':
+          g_string_append(escaped, "\\\"") ;
+          break ;
+        case '\\':
+          g_string_append(escaped, "\\\\") ;
+          break ;
+        case '\b':
+          g_string_append(escaped, "\\b") ;
+          break ;
+        case '\f':
+          g_string_append(escaped, "\\f") ;
+          break ;
+        case '\n':
+          g_string_append(escaped, "\\n") ;
+          break ;
+        case '\r':
+          g_string_append(escaped, "\\r") ;
+          break ;
+        case '\t':
+          g_string_append(escaped, "\\t") ;
+          break ;
+        default:
+          if (*c < 0x20)
+            g_string_append_printf(escaped, "\\u%04x", *c) ;
+          else
+            g_string_append_c(escaped, *c) ;
+          break ;
+        }
+    }
+
+  return g_string_free(escaped, FALSE) ;
+}
+
+
+/* Peak resident set size in kilobytes (linux units). */
+static long peakRSS(void)
+{
+  struct rusage usage ;
+  long peak_kb = 0 ;
+
+  if (getrusage(RUSAGE_SELF, &usage) == 0)
+    peak_kb = usage.ru_maxrss ;
+
+  return peak_kb ;
+}
+
+
+static void printFileResult(BenchFile result)
+{
+  double load_secs = result->open_secs + result->parse_secs + result->merge_secs ;
+  char *file_name, *err_msg = NULL ;
+
+  file_name = jsonEscape(result->file_name) ;
+  if (result->err_msg)
+    err_msg = jsonEscape(result->err_msg) ;
+
+  g_print("{\"file\": \"%s\", \"ok\": %s, \"records\": %d, \"features\": %d, "
+          "\"open_secs\": %.6f, \"parse_secs\": %.6f, \"merge_secs\": %.6f, "
+          "\"records_per_sec\": %.1f, \"features_per_sec\": %.1f, \"peak_rss_kb\": %ld%s%s%s}\n",
+          file_name, (result->ok ? "true" : "false"), result->num_records, result->num_features,
+          result->open_secs, result->parse_secs, result->merge_secs,
+          (load_secs > 0.0 ? result->num_records / load_secs : 0.0),
+          (load_secs > 0.0 ? result->num_features / load_secs : 0.0),
+          peakRSS(),
+          (err_msg ? ", \"error\": \"" : ""), (err_msg ? err_msg : ""), (err_msg ? "\"" : "")) ;
+
+  g_free(file_name) ;
+  g_free(err_msg) ;
+
+  return ;
+}
@@ -48,6 +48,7 @@
 #include <ZMap/zmapGFF.hpp>
 #include <ZMap/zmapGFFStringUtils.hpp>
 #include <ZMap/zmapServerProtocol.hpp>
+#include <ZMap/zmapThreadsLib.hpp>
 
 #include <zmapDataStream_P.hpp>
 
@@ -99,6 +100,8 @@ namespace // unnamed namespace
  *
  */
 #define ZMAP_BAM_SO_TERM  "read"
+#define ZMAP_BAM_COVERAGE_SO_TERM "score"
+#define ZMAP_BAM_COVERAGE_DEFAULT_BINS 10000  // bins for coverage when the source sets no summary-bins
 #define ZMAP_BCF_SO_TERM  "snv"
 #define ZMAP_BED_SO_TERM  "sequence_feature"
 #define ZMAP_BIGBED_SO_TERM "sequence_feature"
@@ -189,7 +192,9 @@ public:
  * Globals
  */
 
-/* Keep track of how many files we've opened in different threads */
+/* Keep track of how many files we've opened in different threads, not needed when the sources
+ * run in the worker pool which is already bounded (and waiting in a pool worker could
+ * deadlock the pool). */
 static semaphore semaphore_G(MAX_FILE_THREADS) ;
 
 /* Map of file types to a data-source types */
@@ -230,9 +235,14 @@ ZMapDataStreamStruct::ZMapDataStreamStruct(ZMapConfigSource source,
     end_of_file_(false),
     featureset_2_column_(NULL),
     source_2_sourcedata_(NULL),
-    styles_(NULL)
+    styles_(NULL),
+    throttled_(false)
 {
-  semaphore_G.wait() ;
+  if (!zMapThreadPoolInWorker())
+    {
+      semaphore_G.wait() ;
+      throttled_ = true ;
+    }
 
   if (sequence)
     sequence_ = g_strdup(sequence) ;
@@ -524,6 +534,8 @@ ZMapDataStreamHTSStruct::ZMapDataStreamHTSStruct(ZMapConfigSource source,
   hts_rec = bam_init1() ;
   if (hts_file && hts_hdr && hts_rec)
     {
+      if (source && source->coverage)
+        coverage_ = true ;
     }
   else
     {
@@ -607,7 +619,8 @@ ZMapDataStreamBCFStruct::ZMapDataStreamBCFStruct(ZMapConfigSource source,
 
 ZMapDataStreamStruct::~ZMapDataStreamStruct()
 {
-  semaphore_G.notify() ;
+  if (throttled_)
+    semaphore_G.notify() ;
 
   if (sequence_)
     g_free(sequence_) ;
@@ -1255,9 +1268,13 @@ bool ZMapDataStreamBIGWIGStruct::readLine()
     {
       if (err_handler.errTry())
         {
-          // First line. Initialise the query. 
+          // First line. Initialise the query, long regions may be summarised.
           lm_ = lmInit(0); // Memory pool to hold returned list
-          list_ = bigWigIntervalQuery(bbi_file_, sequence_, start_, end_, lm_);
+
+          if ((list_ = summaryQuery()))
+            summarised_ = true ;
+          else
+            list_ = bigWigIntervalQuery(bbi_file_, sequence_, start_, end_, lm_);
 
           cur_interval_ = list_ ;
         }
@@ -1292,12 +1309,70 @@ bool ZMapDataStreamBIGWIGStruct::readLine()
   return result ;
 }
 
+/*
+ * If the source asks for summary bins and the region is long enough for one of the file's zoom
+ * levels then returns a list of intervals, one per bin that has data, with the mean value of the
+ * bin, allocated in lm_. Otherwise returns NULL and the raw intervals should be used, so as the
+ * user loads shorter regions they get the full resolution data. The bin features are flagged as
+ * summary_bin and the view replaces them with the features of any shorter region loaded later,
+ * see zmapJustMergeContext().
+ */
+struct bbiInterval *ZMapDataStreamBIGWIGStruct::summaryQuery()
+{
+  struct bbiInterval *list = NULL ;
+  int n_bins = (source_ ? source_->summary_bins : 0) ;
+  int bases_per_bin ;
+
+  if (n_bins > 0
+      && (bases_per_bin = (end_ - start_ + 1) / n_bins) > 1
+      && bbiBestZoom(bbi_file_->levelList, bases_per_bin))
+    {
+      struct bbiSummaryElement *summary = g_new0(struct bbiSummaryElement, n_bins) ;
+
+      if (bigWigSummaryArrayExtended(bbi_file_, sequence_, start_, end_, n_bins, summary))
+        {
+          struct bbiInterval *last = NULL ;
+          bits64 span = end_ - start_ ;
+
+          for (int i = 0 ; i < n_bins ; ++i)
+            {
+              if (summary[i].validCount > 0)
+                {
+                  struct bbiInterval *interval = (struct bbiInterval *)lmAlloc(lm_, sizeof(struct bbiInterval)) ;
+
+                  interval->start = start_ + (bits32)(span * i / n_bins) ;
+                  interval->end = start_ + (bits32)(span * (i + 1) / n_bins) ;
+                  interval->val = summary[i].sumData / summary[i].validCount ;
+
+                  if (last)
+                    last->next = interval ;
+                  else
+                    list = interval ;
+
+                  last = interval ;
+                }
+            }
+        }
+
+      g_free(summary) ;
+    }
+
+  return list ;
+}
+
 #ifdef USE_HTSLIB
 bool ZMapDataStreamHTSStruct::readLine()
 {
   bool result = false ;
 
-  if (hts_iter)
+  if (coverage_)
+    {
+      if (!coverage_done_)
+        calcCoverage() ;
+
+      result = nextCoverage() ;
+    }
+  else if (hts_iter)
     {
       if (bam_itr_next(hts_file, hts_iter, hts_rec) >= 0)
         {
@@ -1660,7 +1735,9 @@ ZMapFeature ZMapDataStreamStruct::makeFeature(const char *sequence,
                                               const char *cigar_string,
                                               ZMapStyleMode feature_mode,
                                               const bool is_seq,
-                                              GError **error)
+                                              GError **error,
+                                              const guint32 *bam_cigar,
+                                              const int n_bam_cigar)
 {
   ZMapFeature feature = NULL ;
   zMapReturnValIfFail(sequence && so_type, feature) ;
@@ -1705,7 +1782,7 @@ ZMapFeature ZMapDataStreamStruct::makeFeature(const char *sequence,
   // Ok, go ahead and create the feature
   if (ok)
     {
-      feature = zMapFeatureCreateEmpty(error) ;
+      feature = zMapFeatureCreateEmptyFromSet(feature_set_, error) ;
 
       if (!feature || (error && *error))
         ok = false ;
@@ -1720,7 +1797,13 @@ ZMapFeature ZMapDataStreamStruct::makeFeature(const char *sequence,
 
   GArray *gaps = NULL ;
 
-  if (ok && cigar_string && *cigar_string)
+  if (ok && bam_cigar && n_bam_cigar)
+    {
+      ok = zMapFeatureAlignmentBAMCigar2Gaps(strand, start, end,
+                                             target_strand, target_start, target_end,
+                                             bam_cigar, n_bam_cigar, &gaps) ;
+    }
+  else if (ok && cigar_string && *cigar_string)
     {
       ok = zMapFeatureAlignmentString2Gaps(ZMAPALIGN_FORMAT_CIGAR_BAM,
                                            strand, start, end,
@@ -1836,6 +1919,8 @@ bool ZMapDataStreamBIGWIGStruct::parseBodyLine(GError **error)
 
       if (!feature)
         result = false ;
+      else if (summarised_)
+        feature->flags.summary_bin = TRUE ;
     }
 
   return result ;
@@ -1846,7 +1931,33 @@ bool ZMapDataStreamHTSStruct::parseBodyLine(GError **error)
 {
   bool result = true ;
 
-  if (readLine())
+  if (coverage_)
+    {
+      if (readLine())
+        {
+          ZMapFeature feature = makeFeature(sequence_,
+                                            ZMAP_BAM_COVERAGE_SO_TERM,
+                                            cur_feature_data_.start_,
+                                            cur_feature_data_.end_,
+                                            cur_feature_data_.score_,
+                                            '.',
+                                            NULL,
+                                            false,
+                                            0,
+                                            0,
+                                            '.',
+                                            NULL,
+                                            ZMAPSTYLE_MODE_GRAPH,
+                                            true,
+                                            error) ;
+
+          if (!feature)
+            result = false ;
+          else if (bases_per_bin_ > 1)
+            feature->flags.summary_bin = TRUE ;             // replaced when a shorter region is loaded
+        }
+    }
+  else if (readLine())
     {
       //bool ok = loadAlignString(parser_base, ZMAPALIGN_FORMAT_CIGAR_BAM,
       //                          gaps_onwards, &gaps,
@@ -1864,10 +1975,12 @@ bool ZMapDataStreamHTSStruct::parseBodyLine(GError **error)
                                         cur_feature_data_.target_start_,
                                         cur_feature_data_.target_end_,
                                         cur_feature_data_.target_strand_c_,
-                                        cur_feature_data_.cigar_.c_str(),
+                                        NULL,
                                         ZMAPSTYLE_MODE_ALIGNMENT,
                                         true,
-                                        error) ;
+                                        error,
+                                        cur_feature_data_.bam_cigar_,
+                                        cur_feature_data_.n_bam_cigar_) ;
 
       if (!feature)
         result = false ;
@@ -2101,7 +2214,6 @@ bool ZMapDataStreamHTSStruct::processRead()
     iTargetEnd = 0;
   uint32_t *pCigar = NULL ;
   double dScore = 0.0 ;
-  stringstream ssCigar ;
   const char *query_name = NULL ;
 
   /*
@@ -2122,7 +2234,8 @@ bool ZMapDataStreamHTSStruct::processRead()
   cStrand = '+' ;
 
   /*
-   * "cigar_bam" attribute
+   * "cigar_bam" attribute, the packed operators are passed straight through to the
+   * feature code, the text form is only made if the feature is exported.
    */
   nCigar = hts_rec->core.n_cigar ;
   if (nCigar)
@@ -2131,7 +2244,6 @@ bool ZMapDataStreamHTSStruct::processRead()
 
       for (iCigar=0; iCigar<nCigar; ++iCigar)
         {
-          ssCigar << bam_cigar_oplen(pCigar[iCigar]) << bam_cigar_opchr(pCigar[iCigar]) ;
           iEnd += bam_cigar_oplen(pCigar[iCigar]) ;
         }
     }
@@ -2153,7 +2265,9 @@ bool ZMapDataStreamHTSStruct::processRead()
 
   cur_feature_data_ = ZMapDataStreamFeatureData(iStart, iEnd, dScore, cStrand, cPhase, 
                                                 query_name, iTargetStart, iTargetEnd, cTargetStrand,
-                                                ssCigar.str().c_str(), ZMAPALIGN_FORMAT_CIGAR_BAM) ;
+                                                "", ZMAPALIGN_FORMAT_CIGAR_BAM) ;
+  cur_feature_data_.bam_cigar_ = pCigar ;
+  cur_feature_data_.n_bam_cigar_ = nCigar ;
 
   /*
    * return value
@@ -2163,6 +2277,124 @@ bool ZMapDataStreamHTSStruct::processRead()
   return result ;
 }
 
+
+/*
+ * Coverage mode: reads all the reads in the region and adds up the depth of each bin of bases
+ * so no read features are made. There are summary-bins bins, or ZMAP_BAM_COVERAGE_DEFAULT_BINS
+ * if the source doesn't set it, so only regions shorter than that are done per base. Reads that
+ * are unmapped, secondary, duplicates or failed QC are skipped, as for samtools depth, and
+ * deletions/introns don't count.
+ */
+void ZMapDataStreamHTSStruct::calcCoverage()
+{
+  int length = end_ - start_ + 1 ;
+  int n_bins ;
+  int tid ;
+
+  coverage_done_ = true ;
+
+  zMapReturnIfFail(hts_file && hts_hdr && hts_rec && length > 0) ;
+
+  tid = bam_name2id(hts_hdr, sequence_) ;
+
+  n_bins = ((source_ && source_->summary_bins > 0) ? source_->summary_bins : ZMAP_BAM_COVERAGE_DEFAULT_BINS) ;
+  bases_per_bin_ = std::max(1, length / n_bins) ;
+
+  depth_.assign((length + bases_per_bin_ - 1) / bases_per_bin_, 0) ;
+
+  while ((hts_iter ? bam_itr_next(hts_file, hts_iter, hts_rec) : sam_read1(hts_file, hts_hdr, hts_rec)) >= 0)
+    {
+      const uint32_t *cigar = bam_get_cigar(hts_rec) ;
+      int pos = hts_rec->core.pos + 1 ;
+
+      if (hts_rec->core.tid != tid
+          || (hts_rec->core.flag & (BAM_FUNMAP | BAM_FSECONDARY | BAM_FQCFAIL | BAM_FDUP)))
+        continue ;
+
+      for (uint32_t i = 0 ; i < hts_rec->core.n_cigar && pos <= end_ ; ++i)
+        {
+          int op = bam_cigar_op(cigar[i]) ;
+          int len = bam_cigar_oplen(cigar[i]) ;
+
+          if (!(bam_cigar_type(op) & 2))                    // doesn't consume the reference
+            continue ;
+
+          if (op == BAM_CMATCH || op == BAM_CEQUAL || op == BAM_CDIFF)
+            {
+              // Add the part of the block in the region a bin at a time.
+              int block_start = std::max(pos, start_) ;
+              int block_end = std::min(pos + len - 1, end_) ;
+
+              while (block_start <= block_end)
+                {
+                  int bin = (block_start - start_) / bases_per_bin_ ;
+                  int bin_end = std::min(start_ + (bin + 1) * bases_per_bin_ - 1, block_end) ;
+
+                  guint32 bases = (guint32)(bin_end - block_start + 1) ;
+
+                  // Saturate rather than wrap for very deep, wide bins.
+                  if (depth_[bin] > G_MAXUINT32 - bases)
+                    depth_[bin] = G_MAXUINT32 ;
+                  else
+                    depth_[bin] += bases ;
+
+                  block_start = bin_end + 1 ;
+                }
+            }
+
+          pos += len ;
+        }
+    }
+
+  return ;
+}
+
+
+/*
+ * Sets cur_feature_data_ to the next run of bins with the same depth, skipping bins with no
+ * reads, returns false when there are no more.
+ */
+bool ZMapDataStreamHTSStruct::nextCoverage()
+{
+  bool result = false ;
+
+  while (cur_bin_ < depth_.size() && !depth_[cur_bin_])
+    ++cur_bin_ ;
+
+  if (cur_bin_ < depth_.size())
+    {
+      size_t first = cur_bin_ ;
+      int start = start_ + (int)first * bases_per_bin_ ;
+      int end ;
+      double score ;
+
+      // Only runs of single bases are joined, a bin's mean is unlikely to match the next one.
+      if (bases_per_bin_ == 1)
+        {
+          while (cur_bin_ + 1 < depth_.size() && depth_[cur_bin_ + 1] == depth_[first])
+            ++cur_bin_ ;
+        }
+
+      end = std::min(start_ + (int)(cur_bin_ + 1) * bases_per_bin_ - 1, end_) ;
+
+      // Mean depth of the first bin, the last bin in the region may be short.
+      score = (double)depth_[first] / (double)(std::min(start + bases_per_bin_ - 1, end_) - start + 1) ;
+
+      cur_feature_data_ = ZMapDataStreamFeatureData(start, end, score) ;
+
+      ++cur_bin_ ;
+
+      result = true ;
+    }
+  else
+    {
+      // Finished, give back the memory.
+      std::vector<guint32>().swap(depth_) ;
+    }
+
+  return result ;
+}
+
 #endif //HTSLIB
 
 
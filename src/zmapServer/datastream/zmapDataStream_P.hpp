@@ -31,6 +31,8 @@
 #define DATA_STREAM_P_H
 
 
+#include <vector>
+
 #include <ZMap/zmapDataStream.hpp>
 
 
@@ -91,6 +93,11 @@ public:
   int target_strand_c_ ;
   std::string cigar_ ;
   ZMapFeatureAlignFormat align_format_ ;
+
+  // Packed BAM cigar operators, used instead of cigar_ to avoid a text round trip, these
+  // point into the current record so are only valid until the next read.
+  const guint32 *bam_cigar_{NULL} ;
+  int n_bam_cigar_{0} ;
 } ;
 
 
@@ -128,7 +135,8 @@ public:
                           const bool have_target = false, const int target_start = 0, const int target_end = 0, 
                           const char target_strand = '.', const char *cigar_string = NULL,
                           ZMapStyleMode feature_mode = ZMAPSTYLE_MODE_INVALID, 
-                          const bool is_seq = false, GError **error = NULL) ;
+                          const bool is_seq = false, GError **error = NULL,
+                          const guint32 *bam_cigar = NULL, const int n_bam_cigar = 0) ;
   bool endOfFile() ;
   GError* error() ;
 
@@ -146,6 +154,7 @@ protected:
   ZMapFeatureSet feature_set_{NULL} ; // only used if all features go into same feature set
   int num_features_{0}    ;           // counts how many features we have created
   bool end_of_file_{false} ;          // set to true when there is no more to read
+  bool throttled_{false} ;            // true if we hold one of the open file slots
 
   GHashTable *featureset_2_column_{NULL} ;
   GHashTable *source_2_sourcedata_{NULL} ;
@@ -245,10 +254,13 @@ public:
   bool parseBodyLine(GError **error) ;
 
 private:
+  struct bbiInterval *summaryQuery() ;
+
   struct bbiFile *bbi_file_{NULL} ;
   struct lm *lm_{NULL}; // Memory pool to hold returned list from bbi file
   struct bbiInterval *list_{NULL} ;
   struct bbiInterval *cur_interval_{NULL} ; // current item from list_
+  bool summarised_{false} ;                 // list_ holds summary bins not raw intervals
 } ;
 
 
@@ -277,8 +289,17 @@ public:
 
 private:
   bool processRead() ;
+  void calcCoverage() ;
+  bool nextCoverage() ;
 
   ZMapDataStreamFeatureData cur_feature_data_ ;  
+
+  // Coverage mode, the reads are added up into depth_ and given as graph features.
+  bool coverage_{false} ;
+  bool coverage_done_{false} ;
+  int bases_per_bin_{1} ;
+  std::vector<guint32> depth_ ;  // sum of the depth over each base of each bin
+  size_t cur_bin_{0} ;           // next bin to give as a feature
 } ;
 
 
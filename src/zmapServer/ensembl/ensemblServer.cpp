@@ -1786,7 +1786,7 @@ static ZMapFeature makeFeature(EnsemblServer server,
           if (feature_set)
             {
               /* ok, actually create the feature now */
-              feature = zMapFeatureCreateEmpty(error) ;
+              feature = zMapFeatureCreateEmptyFromSet(feature_set, error) ;
 
               /* cast away const... ugh */
               if (feature)
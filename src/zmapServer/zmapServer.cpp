@@ -402,13 +402,19 @@ ZMapServerResponseType zMapServerGetFeatures(ZMapServer server,
 
   if (server->last_response != ZMAP_SERVERRESPONSE_SERVERDIED  && server->last_response != ZMAP_SERVERRESPONSE_REQFAIL)
     {
+      ZMapFeatureCount::instance().beginSource(server->url->url) ;
+
       result = server->last_response
         = (server->funcs->get_features)(server->server_conn, styles, feature_context) ;
 
+      ZMapFeatureCount::instance().endSource() ;
+
       if (result != ZMAP_SERVERRESPONSE_OK)
         zMapServerSetErrorMsg(server, ZMAPSERVER_MAKEMESSAGE(server->url->protocol,
                                                              server->url->host, "%s",
                                                              (server->funcs->errmsg)(server->server_conn))) ;
+      else
+        zMapFeatureContextPostProcess(feature_context) ;    /* Collapse etc. here, not in the gui thread. */
     }
 
   return result ;
@@ -63,6 +63,8 @@ using namespace std ;
 enum {ZMAPTHREAD_SLAVE_REQ_BUFSIZE = 512} ;
 
 
+static ZMapThreadReturnCode handleRequest(zmapThreadCB thread_cb, void *request, bool exit_on_fail,
+                                          bool *found_error_out, int *call_clean_inout) ;
 static void cleanUpThread(void *thread_args) ;
 
 
@@ -199,250 +201,346 @@ void *zmapNewThread(void *thread_args)
         }
       else if (signalled_state == ZMAPTHREAD_REQUEST_EXECUTE)
         {
-          char *slave_error = NULL ;
+          bool found_error = false ;
 
-          bool found_error = FALSE ;
+          slave_response = handleRequest(thread_cb, request, exit_on_fail, &found_error, &call_clean) ;
 
+          // for the new slave handling we quit the loop if there was a problem.          
+          if (found_error)
+            break ;
+        }
 
-          // Call the data source with the new request, this is a synchronous call.
-          //
 
-          ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::SLAVE, thread, ZMapThreadType::MASTER, NULL, "%s", "calling server to service request....") ;
-          zMapPrintTimer(NULL, "In thread, calling handler function") ;
 
-          /* Call the registered slave handler function. */
-          slave_response = (*(thread->req_handler_func))(&(thread_cb->slave_data), request, &slave_error) ;
+      /* pthread_testcancel fix for MACOSX */
+      pthread_testcancel();
 
-          zMapPrintTimer(NULL, "In thread, returned from handler function") ;
-          ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::SLAVE, thread, ZMapThreadType::MASTER, NULL, "returned from server, response was %s....",
-                           zMapThreadReturnCode2ExactStr(slave_response)) ;
+    }
 
 
-          // Handle the response.
-          //
+  /* Note that once we reach here the thread will exit, pthread_cleanup_pop() will call
+   * our cleanup routine if call_clean == 1 before we exit.
+   * Note if thread is cancelled we will go straight into our clean_up routine. */
+
+  // if we got here then the exit is normal so set state for clean up routine.
+  thread_cb->thread_cancelled = false ;
+
+
+  /* something about 64 bit pthread needs pthread_cleanup_pop() at the end. */
+  /* cleanup_push and pop are basically fancy open and close braces so
+   * there must be some code between the "clean_up:" label and this pop or it doesn't compile! */
+
+  // Call the clean up routine if call_clean == 1
+  ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::SLAVE, thread, ZMapThreadType::MASTER, NULL,
+                       "slave thread about to exit: will %scall clean up routine....",
+                       (call_clean ? "" : "not ")) ;
+
+
+
+  pthread_cleanup_pop(call_clean) ;
+
+
+  // Tidy up......
+  g_free(thread_cb) ;
+
+  // Mark thread as finished.
+  ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::SLAVE, thread, ZMapThreadType::MASTER, NULL, "%s", "Marking thread as finished and exiting....") ;
+
+
+  // Signal that the thread is finished.
+  zmapThreadFinish(thread) ;
+
+
+  return thread_args ;
+}
+
+
+/* The pooled versions of zmapNewThread(), there is no loop, instead each request from the
+ * master is run by a pool worker calling zmapSlavePoolRequest(). The slave's state is kept
+ * in thread->pool_slave_data between requests, NULL means the slave has finished. */
+void zmapSlavePoolInit(ZMapThread thread)
+{
+  zmapThreadCB thread_cb ;
+
+  thread_cb = g_new0(zmapThreadCBstruct, 1) ;
+  thread_cb->thread = thread ;
+  thread_cb->thread_cancelled = false ;
+  thread_cb->server_died = FALSE ;
+
+  thread->pool_slave_data = thread_cb ;
+
+  return ;
+}
 
-          switch (slave_response)
-            {
-            case ZMAPTHREAD_RETURNCODE_OK:
-              {
-                ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::SLAVE, thread, ZMapThreadType::MASTER, NULL, "%s: %s", zMapThreadReturnCode2ExactStr(slave_response), "got all data....") ;
 
-                /* Signal that we got some data. */
-                zmapVarSetValueWithData(&(thread->reply), ZMAPTHREAD_REPLY_GOTDATA, request) ;
-                request = NULL ;			    /* Reset, we don't free this data. */
+void zmapSlavePoolRequest(ZMapThread thread, ZMapThreadRequest request_type, void *request)
+{
+  zmapThreadCB thread_cb = (zmapThreadCB)(thread->pool_slave_data) ;
+  bool finished = false ;
+  int call_clean = 1 ;
 
-                break ;
-              }
-            case ZMAPTHREAD_RETURNCODE_SOURCEEMPTY:
-            case ZMAPTHREAD_RETURNCODE_REQFAIL:
-              {
-                char *error_msg = NULL ;
+  if (!thread_cb)
+    return ;
 
-                ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::SLAVE, thread, ZMapThreadType::MASTER, NULL, "%s", "request failed....") ;
+  if (request_type == ZMAPTHREAD_REQUEST_TERMINATE)
+    {
+      ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::SLAVE, thread, ZMapThreadType::MASTER, NULL,
+                           "%s", "Been told to terminate by master slave") ;
 
-                /* Create an informative error message for the log */
-                error_msg = g_strdup_printf("%s %s - %s", ZMAPTHREAD_SLAVEREQUEST,
-                                            zMapThreadReturnCode2ExactStr(slave_response), slave_error) ;
+      zmapVarSetValue(&(thread->reply), ZMAPTHREAD_REPLY_QUIT) ;
 
-                zMapLogWarning("%s", error_msg) ;
+      // As for zmapNewThread(), don't try to clear up the data source.
+      finished = true ;
+      call_clean = 0 ;
+    }
+  else if (request_type == ZMAPTHREAD_REQUEST_EXECUTE)
+    {
+      ZMapThreadReturnCode slave_response ;
+      bool found_error = false ;
 
-                /* Create a simpler message (without the return code etc) to show to the user */
-                g_free(error_msg) ;
-                error_msg = g_strdup_printf("%s", slave_error) ;
+      slave_response = handleRequest(thread_cb, request, thread->new_interface, &found_error, &call_clean) ;
 
-                /* Signal that we failed. */
-                zmapVarSetValueWithErrorAndData(&(thread->reply), ZMAPTHREAD_REPLY_REQERROR, error_msg, request) ;
+      if (found_error || slave_response == ZMAPTHREAD_RETURNCODE_QUIT)
+        finished = true ;
+    }
 
-                request = NULL ;
+  if (finished)
+    {
+      if (call_clean)
+        cleanUpThread(thread_cb) ;
 
-                g_free(error_msg) ;
-                error_msg = NULL ;
+      g_free(thread_cb) ;
+      thread->pool_slave_data = NULL ;
 
-                if (exit_on_fail)
-                  found_error = true ;
+      zmapThreadFinish(thread) ;
+    }
 
-                break ;
-              }
-            case ZMAPTHREAD_RETURNCODE_TIMEDOUT:
-              {
-                char *error_msg = NULL ;
+  return ;
+}
 
-                ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::SLAVE, thread, ZMapThreadType::MASTER, NULL, "%s", "request failed....") ;
 
-                /* Create an informative error message for the log */
-                error_msg = g_strdup_printf("%s %s - %s", ZMAPTHREAD_SLAVEREQUEST,
-                                            zMapThreadReturnCode2ExactStr(slave_response), slave_error) ;
+/* Called after the master has killed the thread, unlike a cancelled pthread we are not in the
+ * middle of a request so the slave can be cleaned up properly. */
+void zmapSlavePoolKill(ZMapThread thread)
+{
+  zmapThreadCB thread_cb = (zmapThreadCB)(thread->pool_slave_data) ;
 
-                zMapLogWarning("%s", error_msg) ;
+  if (!thread_cb)
+    return ;
 
-                /* Create a simpler message (without the return code etc) to show to the user */
-                g_free(error_msg) ;
-                error_msg = g_strdup_printf("%s", slave_error) ;
+  cleanUpThread(thread_cb) ;
 
-                /* Signal that we failed. */
-                zmapVarSetValueWithError(&(thread->reply), ZMAPTHREAD_REPLY_REQERROR, error_msg) ;
+  g_free(thread_cb) ;
+  thread->pool_slave_data = NULL ;
 
-                g_free(error_msg) ;
-                error_msg = NULL ;
+  zmapThreadFinish(thread) ;
 
-                if (exit_on_fail)
-                  found_error = true ;
+  return ;
+}
 
-                break ;
-              }
-            case ZMAPTHREAD_RETURNCODE_BADREQ:
-              {
-                char *error_msg = NULL ;
 
-                ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::SLAVE, thread, ZMapThreadType::MASTER, NULL, "%s", "bad request....") ;
+/* Call the slave's request handler for one request and set the thread's reply from the
+ * handler's response. found_error_out is set if the thread should exit because of the
+ * failure, call_clean_inout is set to 0 if the clean up routine need not be called. */
+static ZMapThreadReturnCode handleRequest(zmapThreadCB thread_cb, void *request, bool exit_on_fail,
+                                          bool *found_error_out, int *call_clean_inout)
+{
+  ZMapThread thread = thread_cb->thread ;
+  ZMapThreadReturnCode slave_response = ZMAPTHREAD_RETURNCODE_OK ;
+  char *slave_error = NULL ;
 
-                error_msg = g_strdup_printf("%s %s - %s", ZMAPTHREAD_SLAVEREQUEST,
-                                            zMapThreadReturnCode2ExactStr(slave_response), slave_error) ;
+  // Call the data source with the new request, this is a synchronous call.
+  //
 
-                zMapLogWarning("Bad Request: %s", error_msg) ;
+  ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::SLAVE, thread, ZMapThreadType::MASTER, NULL, "%s", "calling server to service request....") ;
+  zMapPrintTimer(NULL, "In thread, calling handler function") ;
 
-                thread_cb->initial_error = g_strdup(error_msg) ;
+  /* Call the registered slave handler function. */
+  slave_response = (*(thread->req_handler_func))(&(thread_cb->slave_data), request, &slave_error) ;
 
-                /* Signal that we failed. */
-                zmapVarSetValueWithError(&(thread->reply), ZMAPTHREAD_REPLY_REQERROR, error_msg) ;
+  zMapPrintTimer(NULL, "In thread, returned from handler function") ;
+  ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::SLAVE, thread, ZMapThreadType::MASTER, NULL, "returned from server, response was %s....",
+                   zMapThreadReturnCode2ExactStr(slave_response)) ;
 
-                g_free(error_msg) ;
-                error_msg = NULL ;
 
-                if (exit_on_fail)
-                  found_error = true ;
+  // Handle the response.
+  //
 
-                break ;
-              }
-            case ZMAPTHREAD_RETURNCODE_SERVERDIED:
-              {
-                char *error_msg = NULL ;
+  switch (slave_response)
+    {
+    case ZMAPTHREAD_RETURNCODE_OK:
+      {
+        ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::SLAVE, thread, ZMapThreadType::MASTER, NULL, "%s: %s", zMapThreadReturnCode2ExactStr(slave_response), "got all data....") ;
 
-                ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::SLAVE, thread, ZMapThreadType::MASTER, NULL, "%s", "server died....") ;
+        /* Signal that we got some data. */
+        zmapVarSetValueWithData(&(thread->reply), ZMAPTHREAD_REPLY_GOTDATA, request) ;
+        request = NULL ;			    /* Reset, we don't free this data. */
 
-                thread_cb->server_died = TRUE ;
+        break ;
+      }
+    case ZMAPTHREAD_RETURNCODE_SOURCEEMPTY:
+    case ZMAPTHREAD_RETURNCODE_REQFAIL:
+      {
+        char *error_msg = NULL ;
 
-                /* Create an informative error message for the log */
-                error_msg = g_strdup_printf("%s %s - %s", ZMAPTHREAD_SLAVEREQUEST,
-                                            zMapThreadReturnCode2ExactStr(slave_response), slave_error) ;
+        ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::SLAVE, thread, ZMapThreadType::MASTER, NULL, "%s", "request failed....") ;
 
-                zMapLogWarning("%s", error_msg) ;
+        /* Create an informative error message for the log */
+        error_msg = g_strdup_printf("%s %s - %s", ZMAPTHREAD_SLAVEREQUEST,
+                                    zMapThreadReturnCode2ExactStr(slave_response), slave_error) ;
 
-                thread_cb->initial_error = g_strdup(error_msg) ;
-                
-                /* Create a simpler message (without the return code etc) to show to the user */
-                g_free(error_msg) ;
-                error_msg = g_strdup_printf("%s", slave_error) ;
+        zMapLogWarning("%s", error_msg) ;
 
-                // THIS SHOULD BE A GOT_DATA.....
-                /* must continue on to getStatus if it's in the step list
-                 * zmapServer functions will not run if status is DIED
-                 */
-                zmapVarSetValueWithError(&(thread->reply), ZMAPTHREAD_REPLY_DIED, error_msg) ;
+        /* Create a simpler message (without the return code etc) to show to the user */
+        g_free(error_msg) ;
+        error_msg = g_strdup_printf("%s", slave_error) ;
 
-                g_free(error_msg) ;
-                error_msg = NULL ;
+        /* Signal that we failed. */
+        zmapVarSetValueWithErrorAndData(&(thread->reply), ZMAPTHREAD_REPLY_REQERROR, error_msg, request) ;
 
-                if (exit_on_fail)
-                  found_error = true ;
+        request = NULL ;
 
-                // Server died so no point in calling clean up routine.
-                call_clean = 0 ;
+        g_free(error_msg) ;
+        error_msg = NULL ;
 
-                break;
-              }
-            case ZMAPTHREAD_RETURNCODE_QUIT:
-              {
-                // THIS ALL SEEMS TO BE SCREWED UP...QUITTING SHOULD IMPLY A NORMAL EXIT BUT
-                // SOMEHOW THIS ALL SEEMS TO HAVE BECOME A MESS....Ed
+        if (exit_on_fail)
+          *found_error_out = true ;
 
-                char *error_msg = NULL ;
+        break ;
+      }
+    case ZMAPTHREAD_RETURNCODE_TIMEDOUT:
+      {
+        char *error_msg = NULL ;
 
-                /* this message goes to the otterlace features loaded message
-                   and no error gets mangled into a string that says (Server Pipe: - null)
-                   there's no obvious way to get the real exit status here
-                   due to the structure of the code and data
-                   its unfeasably difficult to detect a sucessful server here and we can only report
-                   "(no error: ( no error ( no error)))"
-                */
-                if (slave_error)
-                  error_msg = g_strdup_printf("%s %s - %s \"%s\"", ZMAPTHREAD_SLAVEREQUEST,
-                                              zMapThreadReturnCode2ExactStr(slave_response), "server terminated with error:", slave_error) ;
-                else
-                  error_msg = g_strdup_printf("%s %s - %s", ZMAPTHREAD_SLAVEREQUEST,
-                                              zMapThreadReturnCode2ExactStr(slave_response), "server terminated cleanly") ;
+        ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::SLAVE, thread, ZMapThreadType::MASTER, NULL, "%s", "request failed....") ;
 
-                zMapLogWarning("%s", error_msg) ;
+        /* Create an informative error message for the log */
+        error_msg = g_strdup_printf("%s %s - %s", ZMAPTHREAD_SLAVEREQUEST,
+                                    zMapThreadReturnCode2ExactStr(slave_response), slave_error) ;
 
-                zmapVarSetValueWithError(&(thread->reply), ZMAPTHREAD_REPLY_QUIT, error_msg) ;
+        zMapLogWarning("%s", error_msg) ;
 
-                g_free(error_msg) ;
-                error_msg = NULL ;
+        /* Create a simpler message (without the return code etc) to show to the user */
+        g_free(error_msg) ;
+        error_msg = g_strdup_printf("%s", slave_error) ;
 
+        /* Signal that we failed. */
+        zmapVarSetValueWithError(&(thread->reply), ZMAPTHREAD_REPLY_REQERROR, error_msg) ;
 
-                // Clean quit from slave so no need to call clean up routine.
-                call_clean = 0 ;
+        g_free(error_msg) ;
+        error_msg = NULL ;
 
-                break;
-              }
+        if (exit_on_fail)
+          *found_error_out = true ;
 
-            default:
-              {
-                zMapLogCritical("Data server code has returned an unhandled/bad slave response: %d", slave_response) ;
+        break ;
+      }
+    case ZMAPTHREAD_RETURNCODE_BADREQ:
+      {
+        char *error_msg = NULL ;
 
-                break ;
-              }
+        ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::SLAVE, thread, ZMapThreadType::MASTER, NULL, "%s", "bad request....") ;
 
-            }
+        error_msg = g_strdup_printf("%s %s - %s", ZMAPTHREAD_SLAVEREQUEST,
+                                    zMapThreadReturnCode2ExactStr(slave_response), slave_error) ;
 
+        zMapLogWarning("Bad Request: %s", error_msg) ;
 
-          // for the new slave handling we quit the loop if there was a problem.          
-          if (found_error)
-            break ;
-        }
+        thread_cb->initial_error = g_strdup(error_msg) ;
 
+        /* Signal that we failed. */
+        zmapVarSetValueWithError(&(thread->reply), ZMAPTHREAD_REPLY_REQERROR, error_msg) ;
 
+        g_free(error_msg) ;
+        error_msg = NULL ;
 
-      /* pthread_testcancel fix for MACOSX */
-      pthread_testcancel();
+        if (exit_on_fail)
+          *found_error_out = true ;
 
-    }
+        break ;
+      }
+    case ZMAPTHREAD_RETURNCODE_SERVERDIED:
+      {
+        char *error_msg = NULL ;
 
+        ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::SLAVE, thread, ZMapThreadType::MASTER, NULL, "%s", "server died....") ;
 
-  /* Note that once we reach here the thread will exit, pthread_cleanup_pop() will call
-   * our cleanup routine if call_clean == 1 before we exit.
-   * Note if thread is cancelled we will go straight into our clean_up routine. */
+        thread_cb->server_died = TRUE ;
 
-  // if we got here then the exit is normal so set state for clean up routine.
-  thread_cb->thread_cancelled = false ;
+        /* Create an informative error message for the log */
+        error_msg = g_strdup_printf("%s %s - %s", ZMAPTHREAD_SLAVEREQUEST,
+                                    zMapThreadReturnCode2ExactStr(slave_response), slave_error) ;
 
+        zMapLogWarning("%s", error_msg) ;
 
-  /* something about 64 bit pthread needs pthread_cleanup_pop() at the end. */
-  /* cleanup_push and pop are basically fancy open and close braces so
-   * there must be some code between the "clean_up:" label and this pop or it doesn't compile! */
+        thread_cb->initial_error = g_strdup(error_msg) ;
+        
+        /* Create a simpler message (without the return code etc) to show to the user */
+        g_free(error_msg) ;
+        error_msg = g_strdup_printf("%s", slave_error) ;
 
-  // Call the clean up routine if call_clean == 1
-  ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::SLAVE, thread, ZMapThreadType::MASTER, NULL,
-                       "slave thread about to exit: will %scall clean up routine....",
-                       (call_clean ? "" : "not ")) ;
+        // THIS SHOULD BE A GOT_DATA.....
+        /* must continue on to getStatus if it's in the step list
+         * zmapServer functions will not run if status is DIED
+         */
+        zmapVarSetValueWithError(&(thread->reply), ZMAPTHREAD_REPLY_DIED, error_msg) ;
 
+        g_free(error_msg) ;
+        error_msg = NULL ;
 
+        if (exit_on_fail)
+          *found_error_out = true ;
 
-  pthread_cleanup_pop(call_clean) ;
+        // Server died so no point in calling clean up routine.
+        *call_clean_inout = 0 ;
 
+        break;
+      }
+    case ZMAPTHREAD_RETURNCODE_QUIT:
+      {
+        // THIS ALL SEEMS TO BE SCREWED UP...QUITTING SHOULD IMPLY A NORMAL EXIT BUT
+        // SOMEHOW THIS ALL SEEMS TO HAVE BECOME A MESS....Ed
 
-  // Tidy up......
-  g_free(thread_cb) ;
+        char *error_msg = NULL ;
 
-  // Mark thread as finished.
-  ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::SLAVE, thread, ZMapThreadType::MASTER, NULL, "%s", "Marking thread as finished and exiting....") ;
+        /* this message goes to the otterlace features loaded message
+           and no error gets mangled into a string that says (Server Pipe: - null)
+           there's no obvious way to get the real exit status here
+           due to the structure of the code and data
+           its unfeasably difficult to detect a sucessful server here and we can only report
+           "(no error: ( no error ( no error)))"
+        */
+        if (slave_error)
+          error_msg = g_strdup_printf("%s %s - %s \"%s\"", ZMAPTHREAD_SLAVEREQUEST,
+                                      zMapThreadReturnCode2ExactStr(slave_response), "server terminated with error:", slave_error) ;
+        else
+          error_msg = g_strdup_printf("%s %s - %s", ZMAPTHREAD_SLAVEREQUEST,
+                                      zMapThreadReturnCode2ExactStr(slave_response), "server terminated cleanly") ;
 
+        zMapLogWarning("%s", error_msg) ;
 
-  // Signal that the thread is finished.
-  zmapThreadFinish(thread) ;
+        zmapVarSetValueWithError(&(thread->reply), ZMAPTHREAD_REPLY_QUIT, error_msg) ;
 
+        g_free(error_msg) ;
+        error_msg = NULL ;
 
-  return thread_args ;
+
+        // Clean quit from slave so no need to call clean up routine.
+        *call_clean_inout = 0 ;
+
+        break;
+      }
+
+    default:
+      {
+        zMapLogCritical("Data server code has returned an unhandled/bad slave response: %d", slave_response) ;
+
+        break ;
+      }
+
+    }
+
+  return slave_response ;
 }
 
 
@@ -78,6 +78,10 @@ extern bool zmap_threadsource_debug_G ;
 
 void *zmapNewThread(void *thread_args) ;
 
+void zmapSlavePoolInit(ZMapThread thread) ;
+void zmapSlavePoolRequest(ZMapThread thread, ZMapThreadRequest request_type, void *request) ;
+void zmapSlavePoolKill(ZMapThread thread) ;
+
 
 
 #endif /* !ZMAP_SLAVE_P_H */
@@ -55,6 +55,7 @@ namespace ZMapThreadSource
 {
 
   static gint sourceCheckCB(gpointer cb_data) ;
+  static bool startSlave(ZMapThread thread, bool pooled) ;
 
 
 
@@ -92,11 +93,11 @@ namespace ZMapThreadSource
   // Hack for old code.....which does it's own monitoring of thread value returns (in the huge
   // checkStateConnections() function in zmapView.cpp...which I'm not going to touch.
   //
-  bool ThreadSource::ThreadStart()
+  bool ThreadSource::ThreadStart(bool pooled)
   {
     bool result = false ;
 
-    result = zMapThreadStart(thread_, zmapNewThread) ;
+    result = startSlave(thread_, pooled) ;
 
     return result ;
   }
@@ -136,7 +137,7 @@ namespace ZMapThreadSource
   // like zmap is looping using 100% CPU.)
   //
   bool ThreadSource::ThreadStart(ZMapThreadPollSlaveUserReplyFunc user_reply_func,
-                                 void *user_reply_func_data)
+                                 void *user_reply_func_data, bool pooled)
   {
     bool result = false ;
 
@@ -146,7 +147,7 @@ namespace ZMapThreadSource
         user_reply_func_data_ = user_reply_func_data ;
 
         // If we can't start the thread we set an error state.
-        if (zMapThreadStart(thread_, zmapNewThread))
+        if (startSlave(thread_, pooled))
           {
             // WARNING: gtk_timeout_add is deprecated and should not be used in newly-written
             // code. Use g_timeout_add() instead.
@@ -277,6 +278,30 @@ namespace ZMapThreadSource
   }
 
 
+  // Run the slave as tasks in the shared worker pool if there is one, otherwise give it
+  // its own thread. A request running in the pool cannot be cancelled so sources that may
+  // block indefinitely (network, pipes) must not be pooled or they could hold a worker,
+  // and so stall all the other sources, for the rest of the session.
+  static bool startSlave(ZMapThread thread, bool pooled)
+  {
+    bool result = false ;
+    ZMapThreadPool pool ;
+
+    if (pooled && (pool = zMapThreadPoolGetDefault()))
+      {
+        zmapSlavePoolInit(thread) ;
+
+        result = zMapThreadStartPooled(thread, pool, zmapSlavePoolRequest, zmapSlavePoolKill) ;
+      }
+    else
+      {
+        result = zMapThreadStart(thread, zmapNewThread) ;
+      }
+
+    return result ;
+  }
+
+
 
   /* This function checks the status of the connection and checks for any reply and
    * then acts on it, it gets called from the ZMap idle function.
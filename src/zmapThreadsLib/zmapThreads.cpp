@@ -54,6 +54,11 @@
 
 static ZMapThread createThread() ;
 static void destroyThread(ZMapThread thread) ;
+static bool submitPooled(ZMapThread thread, ZMapThreadRequest request_type, void *request) ;
+static void pooledRequestTaskCB(void *task_data) ;
+static void pooledKillTaskCB(void *task_data) ;
+static void pooledThreadRef(ZMapThread thread) ;
+static void pooledThreadUnref(ZMapThread thread) ;
 static GString *addThreadString(GString *str, ZMapThreadType thread_type, ZMapThread thread) ;
 
 
@@ -118,6 +123,8 @@ ZMapThread zMapThreadCreate(bool new_interface,
       thread->terminate_handler_func = terminate_handler_func ;
       thread->destroy_handler_func = destroy_handler_func ;
 
+      thread->priority = ZMapThreadPriority::NORMAL ;
+
       thread->state = ThreadState::INIT ;
     }
   else
@@ -209,6 +216,61 @@ bool zMapThreadStart(ZMapThread thread, ZMapThreadCreateFunc create_func)
 
 
 
+// As zMapThreadStart() but no pthread is created, instead each request is run as a task in
+// the given pool by request_func. If the thread is killed kill_func is run as a task to clean
+// up, pooled threads cannot be cancelled in the middle of a request so the kill waits for any
+// running request to finish. Only use this for sources whose requests are sure to finish,
+// a request that hangs holds its pool worker for good.
+bool zMapThreadStartPooled(ZMapThread thread, ZMapThreadPool pool,
+                           ZMapThreadPoolRequestFunc request_func, ZMapThreadPoolKillFunc kill_func)
+{
+  bool result = false ;
+  int status ;
+
+  ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::MASTER, NULL, ZMapThreadType::SLAVE, thread, "%s", "Starting pooled thread...") ;
+
+  zMapReturnValIfFail((thread->state == ThreadState::INIT && pool && request_func && kill_func), false) ;
+
+  if ((status = pthread_mutex_init(&(thread->pool_exec_mutex), NULL)) != 0)
+    {
+      zMapLogCriticalSysErr(status, "%s", "pool exec mutex init") ;
+
+      thread->state = ThreadState::FINISHED ;
+    }
+  else
+    {
+      thread->pool = pool ;
+      thread->pool_request_func = request_func ;
+      thread->pool_kill_func = kill_func ;
+      thread->pool_killed = false ;
+      thread->pool_ref_count = 1 ;                          /* The master's reference. */
+
+      thread->state = ThreadState::CONNECTED ;
+
+      result = true ;
+    }
+
+  ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::MASTER, NULL, ZMapThreadType::SLAVE, thread, "%s", "Started pooled thread...") ;
+
+  return result ;
+}
+
+
+// Set the priority of the thread's future requests, only has an effect for pooled threads.
+void zMapThreadSetPriority(ZMapThread thread, ZMapThreadPriority priority)
+{
+  thread->priority = priority ;
+
+  return ;
+}
+
+
+bool zMapThreadIsPooled(ZMapThread thread)
+{
+  return (thread->pool != NULL) ;
+}
+
+
 bool zMapThreadRequest(ZMapThread thread, void *request)
 {
   bool result = false ;
@@ -217,7 +279,10 @@ bool zMapThreadRequest(ZMapThread thread, void *request)
 
   if (thread->state == ThreadState::CONNECTED)
     {
-      result = zmapCondVarSignal(&thread->request, ZMAPTHREAD_REQUEST_EXECUTE, request) ;
+      if (thread->pool)
+        result = submitPooled(thread, ZMAPTHREAD_REQUEST_EXECUTE, request) ;
+      else
+        result = zmapCondVarSignal(&thread->request, ZMAPTHREAD_REQUEST_EXECUTE, request) ;
     }
 
   ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::MASTER, NULL, ZMapThreadType::SLAVE, thread, "%s", "Sent request...") ;
@@ -305,7 +370,7 @@ bool zMapThreadExists(ZMapThread thread)
 
   if (thread->state == ThreadState::CONNECTED)
     {
-      if (pthread_kill(thread->thread_id, 0) == 0)
+      if (thread->pool || pthread_kill(thread->thread_id, 0) == 0)
         exists = TRUE ;
     }
 
@@ -339,7 +404,10 @@ bool zMapThreadStop(ZMapThread thread)
 
       // On receiving this the slave thread should exit but should use zMapThreadFinish() to
       // indicate that it is doing so.
-      result = zmapCondVarSignal(&thread->request, ZMAPTHREAD_REQUEST_TERMINATE, NULL) ;
+      if (thread->pool)
+        result = submitPooled(thread, ZMAPTHREAD_REQUEST_TERMINATE, NULL) ;
+      else
+        result = zmapCondVarSignal(&thread->request, ZMAPTHREAD_REQUEST_TERMINATE, NULL) ;
     }
 
   ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::MASTER, NULL, ZMapThreadType::SLAVE, thread, "%s", "Stopped thread...") ;
@@ -363,8 +431,27 @@ void zMapThreadKill(ZMapThread thread)
 
   ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::MASTER, NULL, ZMapThreadType::SLAVE, thread, "%s", "Killing thread...") ;
 
+  if (thread->pool)
+    {
+      int num_cancelled ;
+
+      // Any request not yet started is dropped and the slave is cleaned up as soon as a
+      // running request (if any) finishes.
+      pthread_mutex_lock(&(thread->request.mutex)) ;
+      thread->pool_killed = true ;
+      pthread_mutex_unlock(&(thread->request.mutex)) ;
+
+      num_cancelled = zMapThreadPoolCancel(thread->pool, pooledRequestTaskCB, thread) ;
+      while (num_cancelled--)
+        pooledThreadUnref(thread) ;
+
+      pooledThreadRef(thread) ;
+
+      if (!zMapThreadPoolSubmit(thread->pool, pooledKillTaskCB, thread, ZMapThreadPriority::URGENT))
+        pooledThreadUnref(thread) ;
+    }
   /* Unconditionally cancel the thread if it still exists. */
-  if ((thread->thread_id) && (pthread_kill(thread->thread_id, 0) == 0))
+  else if ((thread->thread_id) && (pthread_kill(thread->thread_id, 0) == 0))
     {
       ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::MASTER, NULL, ZMapThreadType::SLAVE, thread,
                            "Issuing pthread_cancel on this thread (%s)", zMapThreadGetThreadID(thread)) ;
@@ -394,7 +481,14 @@ bool zMapThreadDestroy(ZMapThread thread)
 
   ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::MASTER, NULL, ZMapThreadType::SLAVE, thread, "%s", "Destroying thread...") ;
 
-  if (thread->state == ThreadState::FINISHED)
+  if (thread->state == ThreadState::FINISHED && thread->pool)
+    {
+      // Tasks may still hold the thread, the last one out destroys it.
+      pooledThreadUnref(thread) ;
+
+      result = true ;
+    }
+  else if (thread->state == ThreadState::FINISHED)
     {
       bool var_destroy, cond_destroy ;
 
@@ -440,6 +534,9 @@ void zmapThreadFinish(ZMapThread thread)
 
   thread->state = ThreadState::FINISHED ;
 
+  // Let the master know without waiting for it to poll.
+  zmapVarNotify(&thread->reply) ;
+
   ZMAPTHREAD_DEBUG_MSG(ZMapThreadType::SLAVE, thread, ZMapThreadType::MASTER, NULL, "%s", "Finished thread...") ;
 
   return ;
@@ -488,6 +585,95 @@ static ZMapThread createThread()
 }
 
 
+/* Queue a request for a pooled thread, the master only sends one request at a time so there
+ * is at most one pending. */
+static bool submitPooled(ZMapThread thread, ZMapThreadRequest request_type, void *request)
+{
+  bool result = false ;
+
+  pthread_mutex_lock(&(thread->request.mutex)) ;
+  thread->request.state = request_type ;
+  thread->request.request = request ;
+  pthread_mutex_unlock(&(thread->request.mutex)) ;
+
+  pooledThreadRef(thread) ;
+
+  if (!(result = zMapThreadPoolSubmit(thread->pool, pooledRequestTaskCB, thread, thread->priority)))
+    pooledThreadUnref(thread) ;
+
+  return result ;
+}
+
+
+/* Run by a pool worker, runs the thread's pending request unless it has been killed. */
+static void pooledRequestTaskCB(void *task_data)
+{
+  ZMapThread thread = (ZMapThread)task_data ;
+  ZMapThreadRequest request_type ;
+  void *request ;
+  bool killed ;
+
+  pthread_mutex_lock(&(thread->pool_exec_mutex)) ;
+
+  pthread_mutex_lock(&(thread->request.mutex)) ;
+  request_type = thread->request.state ;
+  request = thread->request.request ;
+  thread->request.state = ZMAPTHREAD_REQUEST_WAIT ;
+  thread->request.request = NULL ;
+  killed = thread->pool_killed ;
+  pthread_mutex_unlock(&(thread->request.mutex)) ;
+
+  if (!killed && (request_type == ZMAPTHREAD_REQUEST_EXECUTE || request_type == ZMAPTHREAD_REQUEST_TERMINATE))
+    (thread->pool_request_func)(thread, request_type, request) ;
+
+  pthread_mutex_unlock(&(thread->pool_exec_mutex)) ;
+
+  pooledThreadUnref(thread) ;
+
+  return ;
+}
+
+
+/* Run by a pool worker after the master has killed a pooled thread. */
+static void pooledKillTaskCB(void *task_data)
+{
+  ZMapThread thread = (ZMapThread)task_data ;
+
+  pthread_mutex_lock(&(thread->pool_exec_mutex)) ;
+
+  (thread->pool_kill_func)(thread) ;
+
+  pthread_mutex_unlock(&(thread->pool_exec_mutex)) ;
+
+  pooledThreadUnref(thread) ;
+
+  return ;
+}
+
+
+static void pooledThreadRef(ZMapThread thread)
+{
+  g_atomic_int_inc(&(thread->pool_ref_count)) ;
+
+  return ;
+}
+
+
+static void pooledThreadUnref(ZMapThread thread)
+{
+  if (g_atomic_int_dec_and_test(&(thread->pool_ref_count)))
+    {
+      zmapVarDestroy(&thread->reply) ;
+      zmapCondVarDestroy(&(thread->request)) ;
+      pthread_mutex_destroy(&(thread->pool_exec_mutex)) ;
+
+      destroyThread(thread) ;
+    }
+
+  return ;
+}
+
+
 /* some care needed in using this....what about the condvars, when can they be freed ?
  * CHECK THIS ALL WORKS.... */
 static void destroyThread(ZMapThread thread)
@@ -0,0 +1,295 @@
+/*  File: zmapThreadsNotify.cpp
+ *  Author: Ed Griffiths (edgrif@sanger.ac.uk)
+ *  Copyright (c) 2006-2017: Genome Research Ltd.
+ *-------------------------------------------------------------------
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------
+ * This file is part of the ZMap genome database package
+ * originally written by:
+ *
+ *      Ed Griffiths (Sanger Institute, UK) edgrif@sanger.ac.uk
+ *        Roy Storey (Sanger Institute, UK) rds@sanger.ac.uk
+ *   Malcolm Hinsley (Sanger Institute, UK) mh17@sanger.ac.uk
+ *       Gemma Guest (Sanger Institute, UK) gb10@sanger.ac.uk
+ *      Steve Miller (Sanger Institute, UK) sm23@sanger.ac.uk
+ *
+ * Description: Wakes the master (GUI) thread's main loop when a slave
+ *              thread sets a new reply so the master does not have to
+ *              poll its slaves on a timer.
+ *
+ *              A notifier is a non-blocking pipe whose read end is
+ *              watched by the default GLib main context, slaves write a
+ *              single byte to it. At most one byte is ever outstanding
+ *              so a slave never blocks and a burst of replies costs the
+ *              master a single wake up.
+ *
+ *              Notifiers are reference counted because slave threads
+ *              that have been cancelled may still set a reply after the
+ *              master has finished with the notifier.
+ *
+ * Exported functions: See ZMap/zmapThreadsLib.hpp
+ *-------------------------------------------------------------------
+ */
+
+#include <ZMap/zmap.hpp>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+
+#include <ZMap/zmapUtils.hpp>
+#include <zmapThreads_P.hpp>
+
+
+
+typedef struct ZMapThreadNotifyStructType
+{
+  gint ref_count ;                                          /* atomic. */
+
+  gint pending ;                                            /* atomic, 1 => byte in pipe. */
+
+  int pipe_fds[2] ;                                         /* [0] read, [1] write. */
+
+  GIOChannel *channel ;
+  guint watch_id ;                                          /* 0 => detached from main loop. */
+
+  ZMapThreadNotifyFunc notify_func ;
+  void *notify_func_data ;
+
+} ZMapThreadNotifyStruct ;
+
+
+
+static gboolean notifyWatchCB(GIOChannel *source, GIOCondition condition, gpointer user_data) ;
+static void drainPipe(ZMapThreadNotify notify) ;
+
+
+
+//
+//                   External interface
+//
+
+
+/* Create a notifier whose notify_func will be called from the default main context each
+ * time one or more slaves have signalled it. notify_func should return FALSE when it no
+ * longer wants to be called, the notifier then detaches itself from the main loop but
+ * must still be released with zMapThreadNotifyDestroy().
+ *
+ * Returns NULL if the pipe could not be created. */
+ZMapThreadNotify zMapThreadNotifyCreate(ZMapThreadNotifyFunc notify_func, void *notify_func_data)
+{
+  ZMapThreadNotify notify = NULL ;
+  int pipe_fds[2] ;
+
+  zMapReturnValIfFail(notify_func, notify) ;
+
+  if (pipe(pipe_fds) != 0)
+    {
+      zMapLogCriticalSysErr(errno, "%s", "thread notify pipe") ;
+    }
+  else
+    {
+      fcntl(pipe_fds[0], F_SETFL, fcntl(pipe_fds[0], F_GETFL) | O_NONBLOCK) ;
+      fcntl(pipe_fds[1], F_SETFL, fcntl(pipe_fds[1], F_GETFL) | O_NONBLOCK) ;
+
+      notify = g_new0(ZMapThreadNotifyStruct, 1) ;
+
+      notify->ref_count = 1 ;
+      notify->pending = 0 ;
+      notify->pipe_fds[0] = pipe_fds[0] ;
+      notify->pipe_fds[1] = pipe_fds[1] ;
+      notify->notify_func = notify_func ;
+      notify->notify_func_data = notify_func_data ;
+
+      notify->channel = g_io_channel_unix_new(notify->pipe_fds[0]) ;
+      notify->watch_id = g_io_add_watch(notify->channel, (GIOCondition)(G_IO_IN | G_IO_HUP | G_IO_ERR),
+                                        notifyWatchCB, notify) ;
+    }
+
+  return notify ;
+}
+
+
+/* Wake the master, may be called from any thread. Cheap if a wake up is already pending. */
+void zMapThreadNotifySignal(ZMapThreadNotify notify)
+{
+  zMapReturnIfFail(notify) ;
+
+  if (g_atomic_int_compare_and_exchange(&(notify->pending), 0, 1))
+    {
+      const char byte = 'n' ;
+      ssize_t bytes ;
+
+      while ((bytes = write(notify->pipe_fds[1], &byte, 1)) < 0 && errno == EINTR)
+        ;
+
+      /* Pipe full means the master has plenty of wake ups queued anyway. */
+      if (bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+        zMapLogCriticalSysErr(errno, "%s", "thread notify write") ;
+    }
+
+  return ;
+}
+
+
+/* Master only: stop calling notify_func and drop the master's reference, any slaves still
+ * holding the notifier can signal it harmlessly until they drop theirs. Safe to call from
+ * within notify_func. */
+void zMapThreadNotifyDestroy(ZMapThreadNotify notify)
+{
+  zMapReturnIfFail(notify) ;
+
+  if (notify->watch_id)
+    {
+      g_source_remove(notify->watch_id) ;
+      notify->watch_id = 0 ;
+    }
+
+  notify->notify_func = NULL ;
+  notify->notify_func_data = NULL ;
+
+  zmapThreadNotifyUnref(notify) ;
+
+  return ;
+}
+
+
+/* Attach a notifier to a thread so the thread signals it whenever it sets a reply, NULL
+ * detaches any existing notifier. The notifier is signalled once straight away so the
+ * master catches any reply that was set before the notifier was attached. */
+bool zMapThreadSetNotify(ZMapThread thread, ZMapThreadNotify notify)
+{
+  bool result = false ;
+  ZMapThreadNotify old_notify = NULL ;
+  int status ;
+
+  zMapReturnValIfFail(thread, result) ;
+
+  if (notify)
+    zmapThreadNotifyRef(notify) ;
+
+  if ((status = pthread_mutex_lock(&(thread->reply.mutex))) != 0)
+    {
+      zMapLogCriticalSysErr(status, "%s", "zMapThreadSetNotify mutex lock") ;
+
+      if (notify)
+        zmapThreadNotifyUnref(notify) ;
+    }
+  else
+    {
+      old_notify = thread->reply.notify ;
+      thread->reply.notify = notify ;
+
+      if ((status = pthread_mutex_unlock(&(thread->reply.mutex))) != 0)
+        zMapLogCriticalSysErr(status, "%s", "zMapThreadSetNotify mutex unlock") ;
+
+      if (old_notify)
+        zmapThreadNotifyUnref(old_notify) ;
+
+      if (notify)
+        zMapThreadNotifySignal(notify) ;
+
+      result = true ;
+    }
+
+  return result ;
+}
+
+
+
+/*
+ *                         Package routines
+ */
+
+void zmapThreadNotifyRef(ZMapThreadNotify notify)
+{
+  g_atomic_int_inc(&(notify->ref_count)) ;
+
+  return ;
+}
+
+void zmapThreadNotifyUnref(ZMapThreadNotify notify)
+{
+  if (g_atomic_int_dec_and_test(&(notify->ref_count)))
+    {
+      if (notify->watch_id)
+        g_source_remove(notify->watch_id) ;
+
+      g_io_channel_unref(notify->channel) ;
+
+      close(notify->pipe_fds[0]) ;
+      close(notify->pipe_fds[1]) ;
+
+      g_free(notify) ;
+    }
+
+  return ;
+}
+
+
+
+/*
+ *                           Internal Routines
+ */
+
+
+/* Called from the main loop when there is a byte in the pipe. */
+static gboolean notifyWatchCB(GIOChannel *source, GIOCondition condition, gpointer user_data)
+{
+  gboolean call_again = TRUE ;
+  ZMapThreadNotify notify = (ZMapThreadNotify)user_data ;
+
+  /* Hold a reference in case notify_func destroys the notifier. */
+  zmapThreadNotifyRef(notify) ;
+
+  /* Empty the pipe _before_ clearing pending and clear pending _before_ calling notify_func:
+   * any reply set after this point will either be seen by notify_func or will write a new
+   * byte and wake us again, so no reply can be missed. */
+  drainPipe(notify) ;
+
+  g_atomic_int_set(&(notify->pending), 0) ;
+
+  if ((condition & (G_IO_HUP | G_IO_ERR)))
+    {
+      zMapLogCritical("%s", "Thread notify pipe has failed, no more thread replies will be seen.") ;
+
+      call_again = FALSE ;
+    }
+  else if (notify->notify_func)
+    {
+      call_again = (notify->notify_func)(notify->notify_func_data) ;
+    }
+
+  /* notify_func may have destroyed the notifier in which case its watch is already gone. */
+  if (!notify->watch_id)
+    call_again = FALSE ;
+  else if (!call_again)
+    notify->watch_id = 0 ;
+
+  zmapThreadNotifyUnref(notify) ;
+
+  return call_again ;
+}
+
+
+static void drainPipe(ZMapThreadNotify notify)
+{
+  char buf[64] ;
+  ssize_t bytes ;
+
+  while ((bytes = read(notify->pipe_fds[0], buf, sizeof(buf))) > 0 || (bytes < 0 && errno == EINTR))
+    ;
+
+  return ;
+}
@@ -0,0 +1,431 @@
+/*  File: zmapThreadsPool.cpp
+ *  Author: Ed Griffiths (edgrif@sanger.ac.uk)
+ *  Copyright (c) 2006-2017: Genome Research Ltd.
+ *-------------------------------------------------------------------
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------
+ * This file is part of the ZMap genome database package
+ * originally written by:
+ *
+ *      Ed Griffiths (Sanger Institute, UK) edgrif@sanger.ac.uk
+ *        Roy Storey (Sanger Institute, UK) rds@sanger.ac.uk
+ *   Malcolm Hinsley (Sanger Institute, UK) mh17@sanger.ac.uk
+ *       Gemma Guest (Sanger Institute, UK) gb10@sanger.ac.uk
+ *      Steve Miller (Sanger Institute, UK) sm23@sanger.ac.uk
+ *
+ * Description: A bounded pool of worker threads that run tasks in
+ *              priority order (FIFO within a priority).
+ *
+ *              All tasks are submitted by the master thread so there is
+ *              a single shared queue rather than per-worker queues, this
+ *              keeps the priority ordering global. Workers are started
+ *              lazily, only when there is queued work and fewer than the
+ *              maximum are running, and exit if the pool is shrunk.
+ *
+ * Exported functions: See ZMap/zmapThreadsLib.hpp
+ *-------------------------------------------------------------------
+ */
+
+#include <ZMap/zmap.hpp>
+
+#include <unistd.h>
+#include <set>
+
+#include <ZMap/zmapUtils.hpp>
+#include <zmapThreads_P.hpp>
+
+
+using namespace std ;
+
+
+
+/* Pool size used when none has been configured, workers are mostly waiting on I/O so we allow
+ * more than there are cpus. */
+#define POOL_DEFAULT_MIN   4
+#define POOL_DEFAULT_MAX  16
+
+
+typedef struct PoolTaskStructType
+{
+  ZMapThreadPriority priority ;
+  unsigned long seq ;                                       /* FIFO within a priority. */
+
+  ZMapThreadPoolTaskFunc func ;
+  void *task_data ;
+
+  bool operator<(const PoolTaskStructType &other) const
+  {
+    return (priority > other.priority || (priority == other.priority && seq < other.seq)) ;
+  }
+
+} PoolTaskStruct ;
+
+
+typedef struct ZMapThreadPoolStructType
+{
+  pthread_mutex_t mutex ;
+  pthread_cond_t work_cond ;                                /* Workers wait on this for tasks. */
+  pthread_cond_t idle_cond ;                                /* Destroy waits on this for workers to exit. */
+
+  set<PoolTaskStruct> *queue ;
+
+  bool shutdown ;
+
+  int max_workers ;
+  int num_workers ;
+  int num_idle ;
+  int num_busy ;
+
+  unsigned long next_seq ;
+
+  int max_queue_depth ;
+  unsigned long num_submitted ;
+  unsigned long num_completed ;
+
+} ZMapThreadPoolStruct ;
+
+
+
+static void *poolWorker(void *pool_data) ;
+static bool startWorker(ZMapThreadPool pool) ;
+static int defaultPoolSize() ;
+
+
+
+/* Default pool shared by all sources, -1 => not set so use defaultPoolSize(). */
+static pthread_mutex_t default_pool_mutex_G = PTHREAD_MUTEX_INITIALIZER ;
+static ZMapThreadPool default_pool_G = NULL ;
+static int default_pool_size_G = -1 ;
+
+/* Set in each pool worker thread. */
+static __thread bool is_pool_worker_G = false ;
+
+
+
+//
+//                   External interface
+//
+
+
+ZMapThreadPool zMapThreadPoolCreate(int max_workers)
+{
+  ZMapThreadPool pool = NULL ;
+
+  zMapReturnValIfFail(max_workers > 0, pool) ;
+
+  pool = g_new0(ZMapThreadPoolStruct, 1) ;
+
+  pthread_mutex_init(&(pool->mutex), NULL) ;
+  pthread_cond_init(&(pool->work_cond), NULL) ;
+  pthread_cond_init(&(pool->idle_cond), NULL) ;
+
+  pool->queue = new set<PoolTaskStruct> ;
+  pool->max_workers = max_workers ;
+
+  return pool ;
+}
+
+
+/* Queue a task to be run by one of the pool's workers, tasks of higher priority are run first.
+ * Returns false if the pool is shutting down or no worker could be started. */
+bool zMapThreadPoolSubmit(ZMapThreadPool pool, ZMapThreadPoolTaskFunc func, void *task_data,
+                          ZMapThreadPriority priority)
+{
+  bool result = false ;
+  PoolTaskStruct task ;
+
+  zMapReturnValIfFail(pool && func, result) ;
+
+  pthread_mutex_lock(&(pool->mutex)) ;
+
+  if (!pool->shutdown)
+    {
+      task.priority = priority ;
+      task.seq = pool->next_seq++ ;
+      task.func = func ;
+      task.task_data = task_data ;
+
+      pool->queue->insert(task) ;
+      pool->num_submitted++ ;
+
+      if ((int)pool->queue->size() > pool->max_queue_depth)
+        pool->max_queue_depth = (int)pool->queue->size() ;
+
+      if (pool->num_idle)
+        pthread_cond_signal(&(pool->work_cond)) ;
+      else if (pool->num_workers < pool->max_workers)
+        startWorker(pool) ;
+
+      /* There must be at least one worker to run the task. */
+      if (pool->num_workers)
+        {
+          result = true ;
+        }
+      else
+        {
+          pool->queue->erase(task) ;
+          pool->num_submitted-- ;
+        }
+    }
+
+  pthread_mutex_unlock(&(pool->mutex)) ;
+
+  return result ;
+}
+
+
+/* Remove any queued (not yet running) tasks matching func/task_data, returns how many were
+ * removed. */
+int zMapThreadPoolCancel(ZMapThreadPool pool, ZMapThreadPoolTaskFunc func, void *task_data)
+{
+  int num_cancelled = 0 ;
+
+  zMapReturnValIfFail(pool && func, num_cancelled) ;
+
+  pthread_mutex_lock(&(pool->mutex)) ;
+
+  for (auto iter = pool->queue->begin() ; iter != pool->queue->end() ; )
+    {
+      if (iter->func == func && iter->task_data == task_data)
+        {
+          iter = pool->queue->erase(iter) ;
+          num_cancelled++ ;
+        }
+      else
+        {
+          ++iter ;
+        }
+    }
+
+  pthread_mutex_unlock(&(pool->mutex)) ;
+
+  return num_cancelled ;
+}
+
+
+/* Change the maximum number of workers, surplus workers exit once they finish their
+ * current task. */
+void zMapThreadPoolSetSize(ZMapThreadPool pool, int max_workers)
+{
+  zMapReturnIfFail(pool && max_workers > 0) ;
+
+  pthread_mutex_lock(&(pool->mutex)) ;
+
+  pool->max_workers = max_workers ;
+
+  while (pool->num_workers < pool->max_workers && (int)pool->queue->size() > pool->num_idle)
+    {
+      if (!startWorker(pool))
+        break ;
+    }
+
+  pthread_cond_broadcast(&(pool->work_cond)) ;
+
+  pthread_mutex_unlock(&(pool->mutex)) ;
+
+  return ;
+}
+
+
+void zMapThreadPoolGetStats(ZMapThreadPool pool, ZMapThreadPoolStats stats_out)
+{
+  zMapReturnIfFail(pool && stats_out) ;
+
+  pthread_mutex_lock(&(pool->mutex)) ;
+
+  stats_out->max_workers = pool->max_workers ;
+  stats_out->num_workers = pool->num_workers ;
+  stats_out->num_busy = pool->num_busy ;
+  stats_out->queue_depth = (int)pool->queue->size() ;
+  stats_out->max_queue_depth = pool->max_queue_depth ;
+  stats_out->num_submitted = pool->num_submitted ;
+  stats_out->num_completed = pool->num_completed ;
+
+  pthread_mutex_unlock(&(pool->mutex)) ;
+
+  return ;
+}
+
+
+/* Discards any queued tasks and waits for the running ones to finish. */
+void zMapThreadPoolDestroy(ZMapThreadPool pool)
+{
+  zMapReturnIfFail(pool) ;
+
+  pthread_mutex_lock(&(pool->mutex)) ;
+
+  pool->shutdown = true ;
+  pool->queue->clear() ;
+
+  pthread_cond_broadcast(&(pool->work_cond)) ;
+
+  while (pool->num_workers)
+    pthread_cond_wait(&(pool->idle_cond), &(pool->mutex)) ;
+
+  pthread_mutex_unlock(&(pool->mutex)) ;
+
+  delete pool->queue ;
+
+  pthread_cond_destroy(&(pool->idle_cond)) ;
+  pthread_cond_destroy(&(pool->work_cond)) ;
+  pthread_mutex_destroy(&(pool->mutex)) ;
+
+  g_free(pool) ;
+
+  return ;
+}
+
+
+/* Returns the pool shared by all sources, creating it if necessary, or NULL if the pool
+ * has been configured off (size 0) in which case each source gets its own thread. */
+ZMapThreadPool zMapThreadPoolGetDefault()
+{
+  ZMapThreadPool pool = NULL ;
+
+  pthread_mutex_lock(&default_pool_mutex_G) ;
+
+  if (default_pool_size_G < 0)
+    default_pool_size_G = defaultPoolSize() ;
+
+  if (default_pool_size_G > 0)
+    {
+      if (!default_pool_G)
+        default_pool_G = zMapThreadPoolCreate(default_pool_size_G) ;
+
+      pool = default_pool_G ;
+    }
+
+  pthread_mutex_unlock(&default_pool_mutex_G) ;
+
+  return pool ;
+}
+
+
+/* Returns true if the caller is running in a pool worker, code that would otherwise block
+ * waiting for a resource held by another task must not do so in a worker. */
+bool zMapThreadPoolInWorker()
+{
+  return is_pool_worker_G ;
+}
+
+
+/* Set the size of the shared pool, 0 turns the pool off for sources started from now on. */
+void zMapThreadPoolSetDefaultSize(int max_workers)
+{
+  zMapReturnIfFail(max_workers >= 0) ;
+
+  pthread_mutex_lock(&default_pool_mutex_G) ;
+
+  default_pool_size_G = max_workers ;
+
+  if (default_pool_G && max_workers > 0)
+    zMapThreadPoolSetSize(default_pool_G, max_workers) ;
+
+  pthread_mutex_unlock(&default_pool_mutex_G) ;
+
+  return ;
+}
+
+
+
+/*
+ *                           Internal Routines
+ */
+
+
+/* Must be called with the pool locked. */
+static bool startWorker(ZMapThreadPool pool)
+{
+  bool result = false ;
+  pthread_attr_t thread_attr ;
+  pthread_t thread_id ;
+  int status ;
+
+  /* Workers are detached, destroy waits for num_workers to reach zero instead of joining. */
+  pthread_attr_init(&thread_attr) ;
+  pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_DETACHED) ;
+
+  if ((status = pthread_create(&thread_id, &thread_attr, poolWorker, (void *)pool)) != 0)
+    {
+      zMapLogCritical("Failed to create thread pool worker: %s", g_strerror(status)) ;
+    }
+  else
+    {
+      pool->num_workers++ ;
+
+      result = true ;
+    }
+
+  pthread_attr_destroy(&thread_attr) ;
+
+  return result ;
+}
+
+
+static void *poolWorker(void *pool_data)
+{
+  ZMapThreadPool pool = (ZMapThreadPool)pool_data ;
+
+  is_pool_worker_G = true ;
+
+  pthread_mutex_lock(&(pool->mutex)) ;
+
+  while (!pool->shutdown && pool->num_workers <= pool->max_workers)
+    {
+      if (pool->queue->empty())
+        {
+          pool->num_idle++ ;
+          pthread_cond_wait(&(pool->work_cond), &(pool->mutex)) ;
+          pool->num_idle-- ;
+        }
+      else
+        {
+          PoolTaskStruct task = *(pool->queue->begin()) ;
+
+          pool->queue->erase(pool->queue->begin()) ;
+          pool->num_busy++ ;
+
+          pthread_mutex_unlock(&(pool->mutex)) ;
+
+          (task.func)(task.task_data) ;
+
+          pthread_mutex_lock(&(pool->mutex)) ;
+
+          pool->num_busy-- ;
+          pool->num_completed++ ;
+        }
+    }
+
+  pool->num_workers-- ;
+
+  if (!pool->num_workers)
+    pthread_cond_broadcast(&(pool->idle_cond)) ;
+
+  pthread_mutex_unlock(&(pool->mutex)) ;
+
+  return NULL ;
+}
+
+
+static int defaultPoolSize()
+{
+  int size = POOL_DEFAULT_MIN ;
+  long num_cpus ;
+
+  if ((num_cpus = sysconf(_SC_NPROCESSORS_ONLN)) > 0)
+    size = (int)(num_cpus * 2) ;
+
+  size = CLAMP(size, POOL_DEFAULT_MIN, POOL_DEFAULT_MAX) ;
+
+  return size ;
+}
@@ -282,6 +282,7 @@ bool zmapVarCreate(ZMapReply thread_reply)
   if (status == 0)
     {
       thread_reply->state = ZMAPTHREAD_REPLY_INVALID ;
+      thread_reply->notify = NULL ;
 
       result = true ;
     }
@@ -295,6 +296,7 @@ bool zmapVarSetValue(ZMapReply thread_reply, ZMapThreadReply new_state)
 {
   bool result = false ;
   int status = 0 ;
+  ZMapThreadNotify notify = NULL ;
 
   if (status == 0)
     {
@@ -311,6 +313,9 @@ bool zmapVarSetValue(ZMapReply thread_reply, ZMapThreadReply new_state)
   if (status == 0)
     {
       thread_reply->state = new_state ;
+
+      if ((notify = thread_reply->notify))
+        zmapThreadNotifyRef(notify) ;
     }
 
   if (status == 0)
@@ -328,6 +333,15 @@ bool zmapVarSetValue(ZMapReply thread_reply, ZMapThreadReply new_state)
   if (status)
     result = true ;
 
+  /* Wake the master outside of the lock. */
+  if (notify)
+    {
+      if (new_state != ZMAPTHREAD_REPLY_WAIT)
+        zMapThreadNotifySignal(notify) ;
+
+      zmapThreadNotifyUnref(notify) ;
+    }
+
   return result ;
 }
 
@@ -383,6 +397,7 @@ bool zmapVarSetValueWithData(ZMapReply thread_reply, ZMapThreadReply new_state,
 {
   bool result = false ;
   int status = 0 ;
+  ZMapThreadNotify notify = NULL ;
 
   if (status == 0)
     {
@@ -399,6 +414,10 @@ bool zmapVarSetValueWithData(ZMapReply thread_reply, ZMapThreadReply new_state,
   if (status == 0)
     {
       thread_reply->state = new_state ;
+
+      if ((notify = thread_reply->notify))
+        zmapThreadNotifyRef(notify) ;
+
       thread_reply->reply = data ;
     }
 
@@ -419,6 +438,15 @@ bool zmapVarSetValueWithData(ZMapReply thread_reply, ZMapThreadReply new_state,
       result = true ;
     }
 
+  /* Wake the master outside of the lock. */
+  if (notify)
+    {
+      if (new_state != ZMAPTHREAD_REPLY_WAIT)
+        zMapThreadNotifySignal(notify) ;
+
+      zmapThreadNotifyUnref(notify) ;
+    }
+
   return result ;
 }
 
@@ -427,6 +455,7 @@ bool zmapVarSetValueWithError(ZMapReply thread_reply, ZMapThreadReply new_state,
 {
   bool result = false ;
   int status = 0 ;
+  ZMapThreadNotify notify = NULL ;
 
   if (status == 0)
     {
@@ -444,6 +473,9 @@ bool zmapVarSetValueWithError(ZMapReply thread_reply, ZMapThreadReply new_state,
     {
       thread_reply->state = new_state ;
 
+      if ((notify = thread_reply->notify))
+        zmapThreadNotifyRef(notify) ;
+
       if (err_msg)
         {
           if (thread_reply->error_msg)
@@ -471,6 +503,15 @@ bool zmapVarSetValueWithError(ZMapReply thread_reply, ZMapThreadReply new_state,
       result = true ;
     }
 
+  /* Wake the master outside of the lock. */
+  if (notify)
+    {
+      if (new_state != ZMAPTHREAD_REPLY_WAIT)
+        zMapThreadNotifySignal(notify) ;
+
+      zmapThreadNotifyUnref(notify) ;
+    }
+
   return result ;
 }
 
@@ -482,6 +523,7 @@ bool zmapVarSetValueWithErrorAndData(ZMapReply thread_reply, ZMapThreadReply new
 {
   bool result = false ;
   int status = 0 ;
+  ZMapThreadNotify notify = NULL ;
 
   if (status == 0)
     {
@@ -499,6 +541,9 @@ bool zmapVarSetValueWithErrorAndData(ZMapReply thread_reply, ZMapThreadReply new
     {
       thread_reply->state = new_state ;
 
+      if ((notify = thread_reply->notify))
+        zmapThreadNotifyRef(notify) ;
+
       if (err_msg)
         {
           if (thread_reply->error_msg)
@@ -527,6 +572,15 @@ bool zmapVarSetValueWithErrorAndData(ZMapReply thread_reply, ZMapThreadReply new
       result = true ;
     }
 
+  /* Wake the master outside of the lock. */
+  if (notify)
+    {
+      if (new_state != ZMAPTHREAD_REPLY_WAIT)
+        zMapThreadNotifySignal(notify) ;
+
+      zmapThreadNotifyUnref(notify) ;
+    }
+
   return result ;
 }
 
@@ -592,11 +646,48 @@ bool zmapVarGetValueWithData(ZMapReply thread_reply, ZMapThreadReply *state_out,
 }
 
 
+/* Signal the reply's notifier (if any) without changing the reply, used when a slave
+ * finishes so the master gets to see that the thread has gone. */
+void zmapVarNotify(ZMapReply thread_reply)
+{
+  ZMapThreadNotify notify = NULL ;
+  int status = 0 ;
+
+  if ((status = pthread_mutex_lock(&(thread_reply->mutex))) != 0)
+    {
+      zMapLogCriticalSysErr(status, "%s", "zmapVarNotify mutex lock") ;
+    }
+  else
+    {
+      if ((notify = thread_reply->notify))
+        zmapThreadNotifyRef(notify) ;
+
+      if ((status = pthread_mutex_unlock(&(thread_reply->mutex))) != 0)
+        zMapLogCriticalSysErr(status, "%s", "zmapVarNotify mutex unlock") ;
+    }
+
+  if (notify)
+    {
+      zMapThreadNotifySignal(notify) ;
+
+      zmapThreadNotifyUnref(notify) ;
+    }
+
+  return ;
+}
+
+
 bool zmapVarDestroy(ZMapReply thread_reply)
 {
   bool result = false ;
   int status = 0 ;
 
+  if (thread_reply->notify)
+    {
+      zmapThreadNotifyUnref(thread_reply->notify) ;
+      thread_reply->notify = NULL ;
+    }
+
   if (status == 0)
     {
       if ((status = pthread_mutex_destroy(&(thread_reply->mutex))) != 0)
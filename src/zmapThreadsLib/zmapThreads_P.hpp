@@ -105,6 +105,7 @@ typedef struct
   ZMapThreadReply state ;				    /* Thread reply from slave. */
   void *reply ;						    /* Reply from callee. */
   char *error_msg ;                                         /* Error message for when thread fails. */
+  ZMapThreadNotify notify ;                                 /* If set, signalled on each new reply. */
 } ZMapReplyStruct, *ZMapReply ;
 
 
@@ -130,6 +131,17 @@ typedef struct _ZMapThreadStruct
   ZMapSlaveTerminateHandlerFunc terminate_handler_func ;
   ZMapSlaveDestroyHandlerFunc destroy_handler_func ;
 
+  // Set if requests are run as tasks in a shared pool rather than in a pthread of our own,
+  // the request struct then just holds the pending request.
+  ZMapThreadPool pool ;
+  ZMapThreadPriority priority ;
+  ZMapThreadPoolRequestFunc pool_request_func ;
+  ZMapThreadPoolKillFunc pool_kill_func ;
+  pthread_mutex_t pool_exec_mutex ;                         /* Only one task at a time per thread. */
+  bool pool_killed ;                                        /* Protected by request.mutex. */
+  gint pool_ref_count ;                                     /* atomic, master + queued/running tasks. */
+  void *pool_slave_data ;                                   /* Slave's per thread state. */
+
 } ZMapThreadStruct ;
 
 
@@ -159,7 +171,13 @@ bool zmapVarSetValueWithErrorAndData(ZMapReply thread_state, ZMapThreadReply new
 				     const char *err_msg, void *data) ;
 bool zmapVarGetValueWithData(ZMapReply thread_state, ZMapThreadReply *state_out,
                              void **data_out, char **err_msg_out) ;
+void zmapVarNotify(ZMapReply thread_state) ;
 bool zmapVarDestroy(ZMapReply thread_state) ;
 
 
+/* Notifier reference counting, slaves hold a reference for as long as they may signal. */
+void zmapThreadNotifyRef(ZMapThreadNotify notify) ;
+void zmapThreadNotifyUnref(ZMapThreadNotify notify) ;
+
+
 #endif /* !ZMAP_THREAD_PRIV_H */
@@ -37,6 +37,8 @@
 
 
 #include <string.h>
+#include <thread>
+#include <vector>
 #include <ZMap/zmapUtils.hpp>
 #include <ZMap/zmapSequence.hpp>
 #include <ZMap/zmapDNA.hpp>
@@ -76,6 +78,69 @@ static char dnaEncodeChar[0x80] =
 } ;
 
 
+/* Longest match string returned, see zMapDNAFindMatch(). */
+#define MAX_BASE 50
+
+
+/* Queries up to this length are searched bit-parallel, one bit per query base. */
+#define DNA_SEARCH_MAX_BITPARALLEL 64
+
+/* Sequences longer than this are split into chunks of about this size that are
+ * searched by separate threads. */
+#define DNA_SEARCH_CHUNK_SIZE (1 << 20)
+
+
+/* A compiled query for the bit-parallel search. */
+typedef struct DNASearchStructType
+{
+  char *query ;                                             /* Encoded query. */
+  int query_len ;
+
+  int max_errors ;
+  int max_Ns ;
+
+  guint64 masks[0x80] ;                                     /* Bit i set if text char matches
+                                                               query base i. */
+  guint64 valid_mask ;                                      /* Bit i set if query base i is a
+                                                               valid code, an n always matches
+                                                               these. */
+} DNASearchStruct, *DNASearch ;
+
+
+/* The text to search for one strand. */
+typedef struct DNASearchStrandStructType
+{
+  ZMapStrand strand ;
+  char *text ;
+  int length ;
+
+  GArray *starts ;                                          /* Offsets into text of the matches. */
+} DNASearchStrandStruct, *DNASearchStrand ;
+
+
+/* A part of a strand searched by one thread, ends of all matching windows are recorded. */
+typedef struct DNASearchChunkStructType
+{
+  DNASearch search ;
+  char *text ;
+  int scan_start ;                                          /* Where to start scanning... */
+  int report_start ;                                        /* ...and first end to report,
+                                                               earlier ones are another
+                                                               chunk's. */
+  int end ;
+
+  GArray *ends ;
+} DNASearchChunkStruct, *DNASearchChunk ;
+
+
+
+static void dnaSearchInit(DNASearch search, char *tx_query, int max_errors, int max_Ns) ;
+static void dnaSearchStrands(DNASearch search, DNASearchStrand strands, int num_strands) ;
+static void dnaSearchChunk(DNASearchChunk chunk) ;
+static GArray *dnaSearchNaive(DNASearch search, char *text, int length) ;
+
+
+
 #ifdef ED_G_NEVER_INCLUDE_THIS_CODE
 
 /* 1<<4 = 16, not big enough for the 45th element in dnaDecodeString() */
@@ -262,7 +327,6 @@ gboolean zMapDNAFindMatch(char *cp, char *end, char *tp, int maxError, int maxN,
   if (result || !*t)
     {
       int len;
-#define MAX_BASE 50
 
       result = TRUE ;
       *start_out = start ;
@@ -282,25 +346,28 @@ gboolean zMapDNAFindMatch(char *cp, char *end, char *tp, int maxError, int maxN,
 
 
 
-/* Looks for dna matches on either or both strand (if strand == ZMAPSTRAND_NONE it does both). */
+/* Looks for dna matches on either or both strand (if strand == ZMAPSTRAND_NONE it does both).
+ *
+ * Matches do not overlap, each is the leftmost one starting after the previous one as
+ * for repeated calls to zMapDNAFindMatch(). For queries of up to DNA_SEARCH_MAX_BITPARALLEL
+ * bases the search is bit-parallel and long sequences are split into chunks searched by
+ * separate threads. */
 GList *zMapDNAFindAllMatches(char *dna, char *query, ZMapStrand strand, int from, int length,
 			     int max_errors, int max_Ns, gboolean return_matches)
 {
   GList *sites = NULL ;
-  int  n ;
-  char *cp ;
-  char *start, *end ;
-  char *search_start, *search_end, *match ;
-  char **match_ptr = NULL ;
-  char * tx_query;
+  int n ;
+  char *tx_query ;
+  char *revcomp_dna = NULL ;
+  DNASearchStruct search = {0} ;
+  DNASearchStrandStruct strands[2] = {{NULL}} ;
+  int num_strands = 0, i ;
+
+  zMapReturnValIfFail(dna && query && *query, sites) ;
 
   tx_query = g_strdup(query);
   zMapDNAEncodeString(tx_query);
 
-  /* Return the actual match string ? */
-  if (return_matches)
-    match_ptr = &match ;
-
   /* rationalise coords, they are always given in terms of the forward strand.... */
   n = strlen(dna) ;
   if (from < 0)
@@ -311,83 +378,60 @@ GList *zMapDNAFindAllMatches(char *dna, char *query, ZMapStrand strand, int from
     n = from + length ;
   if (from > n)
     from = n ;
+  length = n - from ;
 
-  search_start = dna + from ;
-  search_end = search_start + length - 1 ;
-  start = end = cp = search_start ;
+  dnaSearchInit(&search, tx_query, max_errors, max_Ns) ;
 
   if (strand == ZMAPSTRAND_NONE || strand == ZMAPSTRAND_FORWARD)
     {
-      /* cp < search_end for when the last match is @ the end of target seq...
-       * e.g.
-       *  Query:               ATG
-       * Target: ATGGCGGATTAGCAATG
-       */
-      while (cp < search_end && zMapDNAFindMatch(cp, search_end, tx_query, max_errors, max_Ns, &start, &end, match_ptr))
-        {
-          ZMapDNAMatch match ;
-
-          /* Record this match. */
-          match = g_new0(ZMapDNAMatchStruct, 1) ;
-          match->match_type = ZMAPSEQUENCE_DNA ;
-          match->strand = ZMAPSTRAND_FORWARD ;
-
-          match->start = start - dna ;
-          match->end = end - dna ;
-
-          /* Must be one-based for reference. */
-          match->ref_start = match->start + 1 ;
-          match->ref_end = match->end + 1 ;
-
-          match->frame = zMapSequenceGetFrame(match->start + 1) ;
-
-          if (return_matches)
-            match->match = *match_ptr ;
-
-          sites = g_list_append(sites, match) ;
-
-          /* Move pointers on. */
-          cp = end + 1 ;
-        }
+      strands[num_strands].strand = ZMAPSTRAND_FORWARD ;
+      strands[num_strands].text = dna + from ;
+      strands[num_strands].length = length ;
+      num_strands++ ;
     }
 
   if (strand == ZMAPSTRAND_NONE || strand == ZMAPSTRAND_REVERSE)
     {
-      char *revcomp_dna ;
-      int offset ;
-
-      offset = search_start - dna ;
-
       /* Make a revcomp'd copy of the forward strand section. */
-      revcomp_dna = (char *)g_memdup(search_start, length) ;
+      revcomp_dna = (char *)g_memdup(dna + from, length) ;
       zMapDNAReverseComplement(revcomp_dna, length) ;
 
-      /* Set the pointers and search. */
-      search_start = revcomp_dna ;
-      search_end = search_start + length - 1 ;
-      start = end = cp = search_start ;
+      strands[num_strands].strand = ZMAPSTRAND_REVERSE ;
+      strands[num_strands].text = revcomp_dna ;
+      strands[num_strands].length = length ;
+      num_strands++ ;
+    }
+
+  dnaSearchStrands(&search, strands, num_strands) ;
 
-      /* cp < search_end for when the last match is @ the end of target seq...
-       * e.g.
-       *  Query:               ATG
-       * Target: ATGGCGGATTAGCAATG
-       */
+  for (i = 0 ; i < num_strands ; i++)
+    {
+      DNASearchStrand search_strand = &strands[i] ;
+      guint j ;
 
-      while (cp < search_end && zMapDNAFindMatch(cp, search_end, tx_query, max_errors, max_Ns, &start, &end, match_ptr))
+      for (j = 0 ; j < search_strand->starts->len ; j++)
         {
           ZMapDNAMatch match ;
-          int tmp ;
+          int start, end ;
+
+          start = g_array_index(search_strand->starts, int, j) ;
+          end = start + search.query_len - 1 ;
 
           /* Record this match. */
           match = g_new0(ZMapDNAMatchStruct, 1) ;
           match->match_type = ZMAPSEQUENCE_DNA ;
-          match->strand = ZMAPSTRAND_REVERSE ;
+          match->strand = search_strand->strand ;
 
-          match->start = (length - (start - revcomp_dna)) + offset - 1 ;
-          match->end = (length - (end - revcomp_dna)) + offset - 1 ;
-          tmp = match->start ;
-          match->start = match->end ;
-          match->end = tmp ;
+          if (search_strand->strand == ZMAPSTRAND_FORWARD)
+            {
+              match->start = start + from ;
+              match->end = end + from ;
+            }
+          else
+            {
+              match->start = (length - end) + from - 1 ;
+              match->end = (length - start) + from - 1 ;
+            }
 
           /* Must be one-based for reference. */
           match->ref_start = match->start + 1 ;
@@ -396,17 +440,21 @@ GList *zMapDNAFindAllMatches(char *dna, char *query, ZMapStrand strand, int from
           match->frame = zMapSequenceGetFrame(match->start + 1) ;
 
           if (return_matches)
-            match->match = *match_ptr ;
+            match->match = g_strdup_printf("%.*s%s",
+                                           search.query_len < MAX_BASE ? search.query_len : MAX_BASE,
+                                           search_strand->text + start,
+                                           search.query_len > MAX_BASE ? "..." : "") ;
 
-          sites = g_list_append(sites, match) ;
-
-          /* Move pointers on. */
-          cp = end + 1 ;
+          sites = g_list_prepend(sites, match) ;
         }
 
-      g_free(revcomp_dna) ;
+      g_array_free(search_strand->starts, TRUE) ;
     }
 
+  sites = g_list_reverse(sites) ;
+
+  g_free(revcomp_dna) ;
+
   g_free(tx_query);
 
   return sites ;
@@ -479,3 +527,230 @@ void zMapDNAReverseComplement(char *sequence_in, int length_in)
 
 
 
+
+/*
+ *                      Internal routines.
+ */
+
+
+static void dnaSearchInit(DNASearch search, char *tx_query, int max_errors, int max_Ns)
+{
+  int i, c ;
+
+  search->query = tx_query ;
+  search->query_len = strlen(tx_query) ;
+
+  /* More errors or n's than bases cannot make any difference. */
+  search->max_errors = CLAMP(max_errors, 0, search->query_len) ;
+  search->max_Ns = CLAMP(max_Ns, 0, search->query_len) ;
+
+  if (search->query_len <= DNA_SEARCH_MAX_BITPARALLEL)
+    {
+      for (i = 0 ; i < search->query_len ; i++)
+        {
+          guint64 bit = G_GUINT64_CONSTANT(1) << i ;
+
+          for (c = 0 ; c < 0x80 ; c++)
+            {
+              if (tx_query[i] & dnaEncodeChar[c])
+                search->masks[c] |= bit ;
+            }
+
+          if (tx_query[i] & N_)
+            search->valid_mask |= bit ;
+        }
+    }
+
+  return ;
+}
+
+
+/* Finds the non-overlapping matches on each strand, chunks of all the strands are searched in
+ * parallel then the matches to keep are picked from the results. */
+static void dnaSearchStrands(DNASearch search, DNASearchStrand strands, int num_strands)
+{
+  std::vector<DNASearchChunkStruct> chunks ;
+  std::vector<int> strand_chunks ;
+  int i ;
+
+  if (search->query_len > DNA_SEARCH_MAX_BITPARALLEL)
+    {
+      for (i = 0 ; i < num_strands ; i++)
+        strands[i].starts = dnaSearchNaive(search, strands[i].text, strands[i].length) ;
+
+      return ;
+    }
+
+  for (i = 0 ; i < num_strands ; i++)
+    {
+      int num_chunks, chunk_size, j ;
+
+      num_chunks = zMapUtilsSysGetNumThreads(strands[i].length, DNA_SEARCH_CHUNK_SIZE, 0) ;
+      chunk_size = (strands[i].length + num_chunks - 1) / num_chunks ;
+
+      for (j = 0 ; j < num_chunks ; j++)
+        {
+          DNASearchChunkStruct chunk = {NULL} ;
+
+          chunk.search = search ;
+          chunk.text = strands[i].text ;
+          chunk.report_start = j * chunk_size ;
+          chunk.scan_start = MAX(chunk.report_start - (search->query_len - 1), 0) ;
+          chunk.end = MIN(chunk.report_start + chunk_size, strands[i].length) ;
+          chunk.ends = g_array_new(FALSE, FALSE, sizeof(int)) ;
+
+          chunks.push_back(chunk) ;
+          strand_chunks.push_back(i) ;
+        }
+    }
+
+  if (chunks.size() == 1)
+    {
+      dnaSearchChunk(&chunks[0]) ;
+    }
+  else
+    {
+      std::vector<std::thread> threads ;
+
+      for (auto &chunk : chunks)
+        threads.push_back(std::thread(dnaSearchChunk, &chunk)) ;
+
+      for (auto &thread : threads)
+        thread.join() ;
+    }
+
+  /* The chunks are in order so this gives each strand's matching windows in order, take the
+   * leftmost that starts after the last one kept as zMapDNAFindMatch() would. */
+  for (i = 0 ; i < num_strands ; i++)
+    {
+      int next_start = 0 ;
+      guint j, k ;
+
+      strands[i].starts = g_array_new(FALSE, FALSE, sizeof(int)) ;
+
+      for (j = 0 ; j < chunks.size() ; j++)
+        {
+          if (strand_chunks[j] != i)
+            continue ;
+
+          for (k = 0 ; k < chunks[j].ends->len ; k++)
+            {
+              int start = g_array_index(chunks[j].ends, int, k) - search->query_len + 1 ;
+
+              /* zMapDNAFindAllMatches() has always stopped when there is only the
+               * last base left to search. */
+              if (next_start >= strands[i].length - 1)
+                break ;
+
+              if (start >= next_start)
+                {
+                  g_array_append_val(strands[i].starts, start) ;
+                  next_start = start + search->query_len ;
+                }
+            }
+        }
+    }
+
+  for (auto &chunk : chunks)
+    g_array_free(chunk.ends, TRUE) ;
+
+  return ;
+}
+
+
+/* Shift-And search allowing mismatches and n's, run for each chunk in its own thread.
+ *
+ * states[e * (max_Ns + 1) + n] has bit i set if the query's first i + 1 bases match the text
+ * ending at the current base with at most e mismatches and at most n n's, as in
+ * zMapDNAFindMatch() an n/x in the text always counts against max_Ns. */
+static void dnaSearchChunk(DNASearchChunk chunk)
+{
+  DNASearch search = chunk->search ;
+  int num_n = search->max_Ns + 1 ;
+  int num_states = (search->max_errors + 1) * num_n ;
+  guint64 *states ;
+  guint64 match_bit = G_GUINT64_CONSTANT(1) << (search->query_len - 1) ;
+  int pos ;
+
+  states = g_new0(guint64, num_states) ;
+
+  for (pos = chunk->scan_start ; pos < chunk->end ; pos++)
+    {
+      char c = chunk->text[pos] ;
+      gboolean is_N = (c == 'n' || c == 'x') ;
+      guint64 mask = search->masks[(int)c & 0x7f] ;
+      int e, n ;
+
+      /* Work down so the states used are still those for the previous base. */
+      for (e = search->max_errors ; e >= 0 ; e--)
+        {
+          for (n = search->max_Ns ; n >= 0 ; n--)
+            {
+              guint64 *state = &states[e * num_n + n] ;
+
+              if (is_N)
+                {
+                  guint64 next = 0 ;
+
+                  if (n > 0)
+                    {
+                      next = ((states[e * num_n + n - 1] << 1) | 1) & search->valid_mask ;
+
+                      if (e > 0)
+                        next |= (states[(e - 1) * num_n + n - 1] << 1) | 1 ;
+                    }
+
+                  *state = next ;
+                }
+              else
+                {
+                  guint64 next = ((*state << 1) | 1) & mask ;
+
+                  if (e > 0)
+                    next |= (states[(e - 1) * num_n + n] << 1) | 1 ;
+
+                  *state = next ;
+                }
+            }
+        }
+
+      if ((states[num_states - 1] & match_bit) && pos >= chunk->report_start)
+        g_array_append_val(chunk->ends, pos) ;
+    }
+
+  g_free(states) ;
+
+  return ;
+}
+
+
+/* For queries too long for the bit-parallel search. */
+static GArray *dnaSearchNaive(DNASearch search, char *text, int length)
+{
+  GArray *starts ;
+  char *cp, *start, *end, *search_end ;
+
+  starts = g_array_new(FALSE, FALSE, sizeof(int)) ;
+
+  search_end = text + length - 1 ;
+  cp = text ;
+
+  /* cp < search_end for when the last match is @ the end of target seq...
+   * e.g.
+   *  Query:               ATG
+   * Target: ATGGCGGATTAGCAATG
+   */
+  while (cp < search_end
+         && zMapDNAFindMatch(cp, search_end, search->query, search->max_errors, search->max_Ns,
+                             &start, &end, NULL))
+    {
+      int offset = start - text ;
+
+      g_array_append_val(starts, offset) ;
+
+      /* Move pointers on. */
+      cp = end + 1 ;
+    }
+
+  return starts ;
+}
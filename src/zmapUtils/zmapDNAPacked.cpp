@@ -0,0 +1,362 @@
+/*  File: zmapDNAPacked.cpp
+ *  Copyright (c) 2006-2017: Genome Research Ltd.
+ *-------------------------------------------------------------------
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------
+ * This file is part of the ZMap genome database package
+ * originally written by:
+ *
+ *      Ed Griffiths (Sanger Institute, UK) edgrif@sanger.ac.uk
+ *        Roy Storey (Sanger Institute, UK) rds@sanger.ac.uk
+ *   Malcolm Hinsley (Sanger Institute, UK) mh17@sanger.ac.uk
+ *       Gemma Guest (Sanger Institute, UK) gb10@sanger.ac.uk
+ *      Steve Miller (Sanger Institute, UK) sm23@sanger.ac.uk
+ *
+ * Description: Packed storage for long dna sequences.
+ *
+ *              Bases a/c/g/t are held in 2 bits each, anything else
+ *              (n's, ambiguity codes, padding, upper case masking) is
+ *              held as a sorted list of runs of the same character
+ *              which overlay the packed bases. Sequences can be read
+ *              in either orientation, reverse complement reads go
+ *              through zMapDNAReverseComplement() so give the same
+ *              result as complementing a copy of the string.
+ *
+ *              The container is immutable once made and reference
+ *              counted so it can be shared without copying.
+ *
+ * Exported functions: See ZMap/zmapDNA.hpp
+ *-------------------------------------------------------------------
+ */
+
+#include <ZMap/zmap.hpp>
+
+#include <string.h>
+#include <ZMap/zmapUtils.hpp>
+#include <ZMap/zmapDNA.hpp>
+
+
+
+#define BASES_PER_BYTE 4
+
+
+/* A run of characters that are not packed. */
+typedef struct PackedRunStructType
+{
+  int start ;
+  int length ;
+  char base ;
+} PackedRunStruct, *PackedRun ;
+
+
+typedef struct ZMapPackedDNAStructType
+{
+  int ref_count ;
+
+  int length ;
+
+  guint8 *bases ;                                           /* 2 bits per base, first base in
+                                                               the low bits. */
+
+  PackedRun runs ;                                          /* Sorted by start. */
+  int num_runs ;
+
+} ZMapPackedDNAStruct ;
+
+
+
+static int base2Code(char base) ;
+static const char *byte2Bases(guint8 byte) ;
+static void decodeForward(ZMapPackedDNA packed, int start, int length, char *buf) ;
+
+
+
+/* a, c, g, t are coded 0 to 3, anything else is -1. */
+static const char code_2_base_G[] = {'a', 'c', 'g', 't'} ;
+
+
+
+
+/*
+ *                  External routines
+ */
+
+
+/* Packs the first length bases of dna, which need not be null terminated. Returns NULL if
+ * there is no dna. */
+ZMapPackedDNA zMapPackedDNACreate(const char *dna, int length)
+{
+  ZMapPackedDNA packed = NULL ;
+  GArray *runs ;
+  PackedRunStruct run = {0, 0, 0} ;
+  int i ;
+
+  zMapReturnValIfFail(dna && length > 0, packed) ;
+
+  packed = g_new0(ZMapPackedDNAStruct, 1) ;
+  packed->ref_count = 1 ;
+  packed->length = length ;
+  packed->bases = g_new0(guint8, (length + BASES_PER_BYTE - 1) / BASES_PER_BYTE) ;
+
+  runs = g_array_new(FALSE, FALSE, sizeof(PackedRunStruct)) ;
+
+  for (i = 0 ; i < length ; i++)
+    {
+      int code ;
+
+      if ((code = base2Code(dna[i])) >= 0)
+        {
+          packed->bases[i / BASES_PER_BYTE] |= (guint8)(code << ((i % BASES_PER_BYTE) * 2)) ;
+        }
+      else if (run.length && run.base == dna[i] && run.start + run.length == i)
+        {
+          run.length++ ;
+        }
+      else
+        {
+          if (run.length)
+            g_array_append_val(runs, run) ;
+
+          run.start = i ;
+          run.length = 1 ;
+          run.base = dna[i] ;
+        }
+    }
+
+  if (run.length)
+    g_array_append_val(runs, run) ;
+
+  packed->num_runs = runs->len ;
+  packed->runs = (PackedRun)g_array_free(runs, FALSE) ;
+
+  return packed ;
+}
+
+
+ZMapPackedDNA zMapPackedDNARef(ZMapPackedDNA packed)
+{
+  zMapReturnValIfFail(packed, packed) ;
+
+  g_atomic_int_inc(&(packed->ref_count)) ;
+
+  return packed ;
+}
+
+
+void zMapPackedDNAUnref(ZMapPackedDNA packed)
+{
+  if (packed && g_atomic_int_dec_and_test(&(packed->ref_count)))
+    {
+      g_free(packed->bases) ;
+      g_free(packed->runs) ;
+
+      g_free(packed) ;
+    }
+
+  return ;
+}
+
+
+int zMapPackedDNALength(ZMapPackedDNA packed)
+{
+  int length = 0 ;
+
+  if (packed)
+    length = packed->length ;
+
+  return length ;
+}
+
+
+/* Decodes length bases from start (zero-based) into buf, which is not null terminated.
+ * If revcomp is TRUE then start is on the reverse strand and the bases are complemented.
+ * Long sequences can be decoded a chunk at a time with repeated calls. */
+gboolean zMapPackedDNADecode(ZMapPackedDNA packed, int start, int length, gboolean revcomp, char *buf)
+{
+  gboolean result = FALSE ;
+
+  zMapReturnValIfFail(packed && buf && start >= 0 && length >= 0 && start + length <= packed->length,
+                      result) ;
+
+  if (revcomp)
+    {
+      decodeForward(packed, packed->length - (start + length), length, buf) ;
+
+      zMapDNAReverseComplement(buf, length) ;
+    }
+  else
+    {
+      decodeForward(packed, start, length, buf) ;
+    }
+
+  result = TRUE ;
+
+  return result ;
+}
+
+
+/* As zMapPackedDNADecode() but returns a null terminated string to be g_free'd, or NULL if the
+ * coords are not in the sequence. */
+char *zMapPackedDNAGetString(ZMapPackedDNA packed, int start, int length, gboolean revcomp)
+{
+  char *dna = NULL ;
+
+  zMapReturnValIfFail(packed, dna) ;
+
+  dna = (char *)g_malloc(length + 1) ;
+
+  if (zMapPackedDNADecode(packed, start, length, revcomp, dna))
+    {
+      dna[length] = '\0' ;
+    }
+  else
+    {
+      g_free(dna) ;
+      dna = NULL ;
+    }
+
+  return dna ;
+}
+
+
+char zMapPackedDNAGetBase(ZMapPackedDNA packed, int pos, gboolean revcomp)
+{
+  char base = '\0' ;
+
+  if (packed && pos >= 0 && pos < packed->length)
+    zMapPackedDNADecode(packed, pos, 1, revcomp, &base) ;
+
+  return base ;
+}
+
+
+/* Bytes used by the packed sequence, compare with zMapPackedDNALength() for the unpacked size. */
+gsize zMapPackedDNAGetMemUsage(ZMapPackedDNA packed)
+{
+  gsize bytes = 0 ;
+
+  if (packed)
+    bytes = sizeof(ZMapPackedDNAStruct)
+      + ((packed->length + BASES_PER_BYTE - 1) / BASES_PER_BYTE)
+      + (packed->num_runs * sizeof(PackedRunStruct)) ;
+
+  return bytes ;
+}
+
+
+
+
+/*
+ *                  Internal routines
+ */
+
+
+static int base2Code(char base)
+{
+  int code = -1 ;
+
+  switch (base)
+    {
+    case 'a':
+      code = 0 ;
+      break ;
+    case 'c':
+      code = 1 ;
+      break ;
+    case 'g':
+      code = 2 ;
+      break ;
+    case 't':
+      code = 3 ;
+      break ;
+    default:
+      break ;
+    }
+
+  return code ;
+}
+
+
+/* Returns the 4 bases packed into byte. */
+static const char *byte2Bases(guint8 byte)
+{
+  static char table[256][BASES_PER_BYTE] ;
+  static gsize table_init = 0 ;
+
+  if (g_once_init_enter(&table_init))
+    {
+      int i, j ;
+
+      for (i = 0 ; i < 256 ; i++)
+        for (j = 0 ; j < BASES_PER_BYTE ; j++)
+          table[i][j] = code_2_base_G[(i >> (j * 2)) & 0x3] ;
+
+      g_once_init_leave(&table_init, 1) ;
+    }
+
+  return table[byte] ;
+}
+
+
+static void decodeForward(ZMapPackedDNA packed, int start, int length, char *buf)
+{
+  int end = start + length ;
+  int pos = start ;
+  int lo, hi ;
+
+  /* Up to the first byte boundary, then whole bytes, then what's left. */
+  while (pos < end && (pos % BASES_PER_BYTE))
+    {
+      *buf++ = byte2Bases(packed->bases[pos / BASES_PER_BYTE])[pos % BASES_PER_BYTE] ;
+      pos++ ;
+    }
+
+  while (pos + BASES_PER_BYTE <= end)
+    {
+      memcpy(buf, byte2Bases(packed->bases[pos / BASES_PER_BYTE]), BASES_PER_BYTE) ;
+      buf += BASES_PER_BYTE ;
+      pos += BASES_PER_BYTE ;
+    }
+
+  while (pos < end)
+    {
+      *buf++ = byte2Bases(packed->bases[pos / BASES_PER_BYTE])[pos % BASES_PER_BYTE] ;
+      pos++ ;
+    }
+
+  buf -= length ;
+
+  /* Overlay the runs that end inside or after start. */
+  lo = 0 ;
+  hi = packed->num_runs ;
+  while (lo < hi)
+    {
+      int mid = lo + (hi - lo) / 2 ;
+
+      if (packed->runs[mid].start + packed->runs[mid].length <= start)
+        lo = mid + 1 ;
+      else
+        hi = mid ;
+    }
+
+  for ( ; lo < packed->num_runs && packed->runs[lo].start < end ; lo++)
+    {
+      PackedRun run = &(packed->runs[lo]) ;
+      int run_start = MAX(run->start, start) ;
+      int run_end = MIN(run->start + run->length, end) ;
+
+      memset(buf + (run_start - start), run->base, run_end - run_start) ;
+    }
+
+  return ;
+}
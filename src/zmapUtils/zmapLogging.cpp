@@ -27,6 +27,11 @@
  *              on/off. Currently there is just one global log for the
  *              whole application.
  *
+ *              Optionally the log can be written asynchronously: log
+ *              calls copy their message into a fixed size ring buffer
+ *              and return straight away, a writer thread empties the
+ *              ring into the log file in batches.
+ *
  * Exported functions: See zmapUtilsLog.h
  *-------------------------------------------------------------------
  */
@@ -40,6 +45,12 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include <ZMap/zmapConfigDir.hpp>
 #include <ZMap/zmapConfigIni.hpp>
 #include <ZMap/zmapConfigStrings.hpp>
@@ -82,6 +93,68 @@
 #define FOO_LOG 0
 
 
+/* Async logging: number of messages the ring holds (must be a power of 2), how often the writer
+ * thread empties it and how long a fatal message waits for its record to be written. */
+#define LOG_RING_SIZE (1 << 14)
+#define LOG_WRITE_INTERVAL_MS 100
+#define LOG_SYNC_TIMEOUT_MS 2000
+
+
+
+/* Writes log messages to the log file from its own thread.
+ *
+ * The ring is a bounded multi-producer queue, each slot has a sequence number that says
+ * whether it is free for the next producer or full and ready for the writer, so callers
+ * never wait for each other or for the file. If the ring is full the message is dropped
+ * and counted, the writer records how many were lost. The writer wakes up on a timer or
+ * when a critical message is logged and does one flush per batch. */
+class LogWriter
+{
+public:
+  LogWriter() ;
+  ~LogWriter() ;
+
+  void start(GIOChannel *logfile) ;
+  void stop() ;
+
+  bool enqueue(gchar *message, bool flush) ;
+  void sync() ;
+
+  bool failed() { return failed_.load() ; }
+
+private:
+  typedef struct
+  {
+    std::atomic<gsize> sequence ;
+    gchar *message ;
+  } RingSlot ;
+
+  void requestWrite() ;
+  void run() ;
+  bool dequeue(gchar **message_out) ;
+  void writeBatch() ;
+  void writeMessage(gchar *message) ;
+
+  RingSlot *slots_ ;
+  std::atomic<gsize> enqueue_pos_ ;
+  gsize dequeue_pos_ ;                                      /* Only used by the writer. */
+  std::atomic<gsize> written_pos_ ;
+  std::atomic<guint> dropped_ ;
+  std::atomic<bool> failed_ ;
+
+  std::mutex mutex_ ;                                       /* Protects the wake ups and the
+                                                               running/stop flags. */
+  std::condition_variable wake_writer_ ;
+  std::condition_variable batch_written_ ;
+  std::atomic<bool> write_requested_ ;
+  bool stop_requested_ ;
+  bool running_ ;
+
+  GIOChannel *logfile_ ;
+  std::thread thread_ ;
+} ;
+
+
 
 
 
@@ -127,6 +200,9 @@ typedef struct  _ZMapLogStruct
   gboolean catch_glib;
   gboolean echo_glib;   /* to stdout if caught */
 
+  gboolean async ;                                          /* write log from writer thread ? */
+  LogWriter *writer ;
+
 } ZMapLogStruct ;
 
 
@@ -154,6 +230,8 @@ static void nullLogger(const gchar *log_domain, GLogLevelFlags log_level, const
                        gpointer user_data) ;
 static void fileLogger(const gchar *log_domain, GLogLevelFlags log_level, const gchar *message,
                        gpointer user_data) ;
+static void asyncFileLogger(const gchar *log_domain, GLogLevelFlags log_level, const gchar *message,
+                            gpointer user_data) ;
 static void glibLogger(const gchar *log_domain, GLogLevelFlags log_level, const gchar *message,
                        gpointer user_data);
 
@@ -280,7 +358,7 @@ void zMapWriteStopMsg(void)
 /* Configure the log. */
 gboolean zMapLogConfigure(gboolean logging, gboolean log_to_file,
                           gboolean show_process, gboolean show_code, gboolean show_time,
-                          gboolean catch_glib, gboolean echo_glib,
+                          gboolean catch_glib, gboolean echo_glib, gboolean async,
                           char *logfile_path, GError **error)
 {
   gboolean result = FALSE ;
@@ -304,6 +382,9 @@ gboolean zMapLogConfigure(gboolean logging, gboolean log_to_file,
   log->catch_glib = catch_glib ;
   log->echo_glib = echo_glib ;
 
+  /* write log from a separate thread ? */
+  log->async = async ;
+
   /* user specified dir, default to config dir */
   log->active_handler.log_path = logfile_path ;
 
@@ -542,6 +623,10 @@ void zMapLogStack(void)
 
   OUR_MUTEX_LOCK ;
 
+  /* Get the buffered records out first so the stack follows them in the file. */
+  if (log->writer)
+    log->writer->sync() ;
+
   if (log->active_handler.logfile &&
       (log_fd = g_io_channel_unix_get_fd(log->active_handler.logfile)))
     {
@@ -658,6 +743,10 @@ static ZMapLog createLog(void)
 
 static void destroyLog(ZMapLog log)
 {
+  /* All our handlers have gone so nothing can be using the writer. */
+  if (log->writer)
+    delete log->writer ;
+
   if (log->active_handler.log_path)
     g_free(log->active_handler.log_path) ;
 
@@ -695,6 +784,9 @@ static gboolean startLogging(ZMapLog log, GError **error)
         {
           if (openLogFile(log, &g_error))
             {
+              if (log->writer)
+                log->writer->start(log->active_handler.logfile) ;
+
               log->active_handler.cb_id = g_log_set_handler(ZMAPLOG_DOMAIN,
                                                             (GLogLevelFlags)(G_LOG_LEVEL_MASK | G_LOG_FLAG_FATAL
                                                                              | G_LOG_FLAG_RECURSION),
@@ -737,6 +829,10 @@ static gboolean stopLogging(ZMapLog log, gboolean remove_all_handlers)
           if (log->catch_glib)
             g_log_set_default_handler(g_log_default_handler, NULL);
 
+          /* Writer thread writes out anything left in its buffer before it finishes. */
+          if (log->writer)
+            log->writer->stop() ;
+
           /* Need to close the log file here. */
           if (!closeLogFile(log))
             result = FALSE ;
@@ -808,7 +904,19 @@ static gboolean configureLog(ZMapLog log, GError **error)
            * otherwise by default glib will log to stdout/err. */
           if (log->log_to_file)
             {
-              log->active_handler.log_cb = fileLogger ;
+              if (log->async)
+                {
+                  /* The writer is kept until the log is destroyed because a thread may still be
+                   * in our handler after it's been removed. */
+                  if (!log->writer)
+                    log->writer = new LogWriter ;
+
+                  log->active_handler.log_cb = asyncFileLogger ;
+                }
+              else
+                {
+                  log->active_handler.log_cb = fileLogger ;
+                }
             }
 
           result = startLogging(log, &g_error) ;
@@ -955,6 +1063,51 @@ static void fileLogger(const gchar *log_domain, GLogLevelFlags log_level, const
 }
 
 
+/* Used instead of fileLogger() for async logging. The message is copied into the writer's
+ * ring, critical messages get the writer to write straight away and fatal ones wait until
+ * they have been written because the application is about to abort. */
+static void asyncFileLogger(const gchar *log_domain, GLogLevelFlags log_level, const gchar *message,
+                            gpointer user_data)
+{
+  ZMapLog log = (ZMapLog)user_data ;
+  bool flush, fatal ;
+
+  zMapReturnIfFail((log && log->logging && log->writer && message && *message)) ;
+
+  if (log->writer->failed())
+    {
+      gboolean removed = FALSE ;
+
+      OUR_MUTEX_LOCK ;
+
+      if (log->active_handler.cb_id)
+        {
+          g_log_remove_handler(ZMAPLOG_DOMAIN, log->active_handler.cb_id) ;
+          log->active_handler.cb_id = 0 ;
+
+          removed = TRUE ;
+        }
+
+      OUR_MUTEX_UNLOCK ;
+
+      /* Outside the lock as this may come back to us via glibLogger(). */
+      if (removed)
+        zMapLogCritical("Unable to log to file %s, logging to this file has been turned off.",
+                        log->active_handler.log_path) ;
+    }
+  else
+    {
+      fatal = ((log_level & (G_LOG_LEVEL_ERROR | G_LOG_FLAG_FATAL)) != 0) ;
+      flush = (fatal || (log_level & G_LOG_LEVEL_CRITICAL)) ;
+
+      if (log->writer->enqueue(g_strdup(message), flush) && fatal)
+        log->writer->sync() ;
+    }
+
+  return ;
+}
+
+
 static void glibLogger(const gchar *log_domain, GLogLevelFlags log_level, const gchar *message,
                        gpointer user_data)
 {
@@ -1024,3 +1177,299 @@ static bool getFuncNamePosition(const char *function_prototype, char **start_out
 
   return result ;
 }
+
+
+
+
+/*
+ *                LogWriter, see the class declaration at the top of the file.
+ */
+
+
+LogWriter::LogWriter()
+  : enqueue_pos_(0), dequeue_pos_(0), written_pos_(0), dropped_(0), failed_(false),
+    write_requested_(false), stop_requested_(false), running_(false), logfile_(NULL)
+{
+  gsize i ;
+
+  slots_ = new RingSlot[LOG_RING_SIZE] ;
+
+  for (i = 0 ; i < LOG_RING_SIZE ; i++)
+    {
+      slots_[i].sequence.store(i) ;
+      slots_[i].message = NULL ;
+    }
+
+  return ;
+}
+
+
+LogWriter::~LogWriter()
+{
+  gchar *message = NULL ;
+
+  stop() ;
+
+  /* Anything logged after the writer stopped. */
+  while (dequeue(&message))
+    g_free(message) ;
+
+  delete [] slots_ ;
+
+  return ;
+}
+
+
+void LogWriter::start(GIOChannel *logfile)
+{
+  std::lock_guard<std::mutex> lock(mutex_) ;
+
+  if (!running_)
+    {
+      logfile_ = logfile ;
+      failed_ = false ;
+      stop_requested_ = false ;
+      running_ = true ;
+
+      thread_ = std::thread(&LogWriter::run, this) ;
+    }
+
+  return ;
+}
+
+
+/* Returns once the writer has written everything in the ring and finished. */
+void LogWriter::stop()
+{
+  bool running ;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_) ;
+
+    if ((running = running_))
+      {
+        stop_requested_ = true ;
+        wake_writer_.notify_one() ;
+      }
+  }
+
+  if (running)
+    {
+      thread_.join() ;
+
+      std::lock_guard<std::mutex> lock(mutex_) ;
+
+      running_ = false ;
+      logfile_ = NULL ;
+    }
+
+  return ;
+}
+
+
+/* Takes ownership of message, returns false if it had to be dropped because the ring is full.
+ * If flush is true the writer is woken to write it now, otherwise it's written with the next
+ * batch. */
+bool LogWriter::enqueue(gchar *message, bool flush)
+{
+  bool queued = false, full = false ;
+  gsize pos ;
+  RingSlot *slot = NULL ;
+
+  pos = enqueue_pos_.load(std::memory_order_relaxed) ;
+
+  while (!queued && !full)
+    {
+      gssize diff ;
+
+      slot = &(slots_[pos & (LOG_RING_SIZE - 1)]) ;
+      diff = (gssize)slot->sequence.load(std::memory_order_acquire) - (gssize)pos ;
+
+      if (diff == 0)
+        queued = enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed) ;
+      else if (diff < 0)
+        full = true ;                                       /* Writer hasn't emptied the slot yet. */
+      else
+        pos = enqueue_pos_.load(std::memory_order_relaxed) ; /* Another caller took the slot. */
+    }
+
+  if (queued)
+    {
+      slot->message = message ;
+      slot->sequence.store(pos + 1, std::memory_order_release) ;
+
+      /* Don't wait for the timer if the ring is filling up. */
+      if (flush || (pos - written_pos_.load()) > (LOG_RING_SIZE / 2))
+        requestWrite() ;
+    }
+  else
+    {
+      g_free(message) ;
+
+      dropped_++ ;
+
+      if (flush)
+        requestWrite() ;
+    }
+
+  return queued ;
+}
+
+
+/* Waits until the writer has written everything queued so far (or a timeout, the writer may be
+ * stuck on the file). Does nothing if the writer isn't running. */
+void LogWriter::sync()
+{
+  gsize target = enqueue_pos_.load() ;
+  std::unique_lock<std::mutex> lock(mutex_) ;
+
+  if (running_ && thread_.get_id() != std::this_thread::get_id())
+    {
+      write_requested_ = true ;
+      wake_writer_.notify_one() ;
+
+      batch_written_.wait_for(lock, std::chrono::milliseconds(LOG_SYNC_TIMEOUT_MS),
+                              [this, target] { return written_pos_.load() >= target || stop_requested_ ; }) ;
+    }
+
+  return ;
+}
+
+
+/* Only the first caller after a batch needs to take the lock to wake the writer. */
+void LogWriter::requestWrite()
+{
+  if (!write_requested_.exchange(true))
+    {
+      std::lock_guard<std::mutex> lock(mutex_) ;
+
+      wake_writer_.notify_one() ;
+    }
+
+  return ;
+}
+
+
+/* The writer thread. */
+void LogWriter::run()
+{
+  bool stopping = false ;
+
+  while (!stopping)
+    {
+      {
+        std::unique_lock<std::mutex> lock(mutex_) ;
+
+        wake_writer_.wait_for(lock, std::chrono::milliseconds(LOG_WRITE_INTERVAL_MS),
+                              [this] { return write_requested_.load() || stop_requested_ ; }) ;
+
+        stopping = stop_requested_ ;
+      }
+
+      write_requested_ = false ;
+
+      writeBatch() ;
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_) ;
+
+        batch_written_.notify_all() ;
+      }
+    }
+
+  return ;
+}
+
+
+/* Only called by the writer thread (or when it's stopped), there is just one reader. */
+bool LogWriter::dequeue(gchar **message_out)
+{
+  bool result = false ;
+  RingSlot *slot = &(slots_[dequeue_pos_ & (LOG_RING_SIZE - 1)]) ;
+
+  if (slot->sequence.load(std::memory_order_acquire) == dequeue_pos_ + 1)
+    {
+      *message_out = slot->message ;
+      slot->message = NULL ;
+
+      /* Free the slot for the caller that wraps round to it. */
+      slot->sequence.store(dequeue_pos_ + LOG_RING_SIZE, std::memory_order_release) ;
+      dequeue_pos_++ ;
+
+      result = true ;
+    }
+
+  return result ;
+}
+
+
+/* Writes out everything in the ring plus a record of any dropped messages, then flushes once. */
+void LogWriter::writeBatch()
+{
+  gchar *message = NULL ;
+  guint dropped ;
+  bool written = false ;
+
+  while (dequeue(&message))
+    {
+      writeMessage(message) ;
+      g_free(message) ;
+
+      written = true ;
+    }
+
+  if ((dropped = dropped_.exchange(0)))
+    {
+      message = g_strdup_printf("%s[Warning:%u log messages were dropped because the log buffer was full.]\n",
+                                ZMAPLOG_MESSAGE_TUPLE, dropped) ;
+      writeMessage(message) ;
+      g_free(message) ;
+
+      written = true ;
+    }
+
+  if (written && !failed_)
+    {
+      GError *g_error = NULL ;
+
+      if (g_io_channel_flush(logfile_, &g_error) != G_IO_STATUS_NORMAL)
+        failed_ = true ;
+
+      if (g_error)
+        g_error_free(g_error) ;
+    }
+
+  written_pos_.store(dequeue_pos_) ;
+
+  return ;
+}
+
+
+/* Once a write has failed we stop writing, asyncFileLogger() sees failed() and turns logging to
+ * the file off as fileLogger() does. */
+void LogWriter::writeMessage(gchar *message)
+{
+  const gchar *bad_char_out = NULL ;
+  GError *g_error = NULL ;
+  gsize bytes_written = 0 ;
+
+  if (!failed_)
+    {
+      /* Must make sure it's UTF8 or g_io_channel_write_chars will crash,
+       * for now just replace the bad character with a question mark */
+      while (!g_utf8_validate(message, -1, &bad_char_out))
+        {
+          char *bad_char = (char *)bad_char_out ;
+
+          *bad_char = '?' ;
+        }
+
+      if (g_io_channel_write_chars(logfile_, message, -1, &bytes_written, &g_error) != G_IO_STATUS_NORMAL)
+        failed_ = true ;
+
+      if (g_error)
+        g_error_free(g_error) ;
+    }
+
+  return ;
+}
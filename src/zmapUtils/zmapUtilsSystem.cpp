@@ -32,10 +32,15 @@
 #include <ZMap/zmap.hpp>
 
 #include <sys/utsname.h>
+#include <atomic>
+#include <thread>
 
 #include <zmapUtils_P.hpp>
 
 
+static std::atomic<int> &getSpareThreads(void) ;
+
+
 
 
 /*
@@ -62,6 +67,61 @@ char *zMapUtilsSysGetSysName(void)
 }
 
 
+/* Returns how many threads to use for num_items of work: one per min_items_per_thread items
+ * but no more than the machine's cores or max_threads (if > 0), and always at least one. */
+int zMapUtilsSysGetNumThreads(int num_items, int min_items_per_thread, int max_threads)
+{
+  int num_threads ;
+
+  num_threads = (int)std::thread::hardware_concurrency() ;
+
+  if (min_items_per_thread > 0)
+    num_threads = MIN(num_threads, num_items / min_items_per_thread) ;
+
+  if (max_threads > 0)
+    num_threads = MIN(num_threads, max_threads) ;
+
+  num_threads = MAX(num_threads, 1) ;
+
+  return num_threads ;
+}
+
+
+/* Threads are started for compute work from several places, some of which run at the same
+ * time on different source threads, so the extra threads they start are taken from one budget
+ * of a thread per core for the whole process. Returns how many of num_threads the caller may
+ * use, including itself, always at least one. Give them back with zMapUtilsSysReleaseThreads(). */
+int zMapUtilsSysReserveThreads(int num_threads)
+{
+  int wanted, spare, granted = 0 ;
+  std::atomic<int> &spare_threads = getSpareThreads() ;
+
+  if ((wanted = num_threads - 1) > 0)
+    {
+      spare = spare_threads.load() ;
+
+      do
+        {
+          granted = MIN(wanted, spare) ;
+        } while (granted > 0 && !spare_threads.compare_exchange_weak(spare, spare - granted)) ;
+
+      granted = MAX(granted, 0) ;
+    }
+
+  return granted + 1 ;
+}
+
+
+/* Gives back threads got from zMapUtilsSysReserveThreads(), num_threads is what it returned. */
+void zMapUtilsSysReleaseThreads(int num_threads)
+{
+  if (num_threads > 1)
+    getSpareThreads() += num_threads - 1 ;
+
+  return ;
+}
+
+
 
 
 
@@ -70,3 +130,11 @@ char *zMapUtilsSysGetSysName(void)
  *               Internal functions
  */
 
+/* The caller's own thread is not counted so there is one less spare than there are cores. */
+static std::atomic<int> &getSpareThreads(void)
+{
+  static std::atomic<int> spare_threads((int)std::thread::hardware_concurrency() - 1) ;
+
+  return spare_threads ;
+}
+
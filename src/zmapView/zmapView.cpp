@@ -137,7 +137,7 @@ static void displayDataWindows(ZMapView zmap_view,
                                gboolean undisplay, GList *masked,
                                ZMapFeature highlight_feature, gboolean splice_highlight,
                                gboolean allow_clean) ;
-static gint zmapIdleCB(gpointer cb_data) ;
+static gboolean zmapIdleCB(gpointer cb_data) ;
 static void enterCB(ZMapWindow window, void *caller_data, void *window_data) ;
 static void leaveCB(ZMapWindow window, void *caller_data, void *window_data) ;
 static void scrollCB(ZMapWindow window, void *caller_data, void *window_data) ;
@@ -154,10 +154,10 @@ static void splitMagic(gpointer data, gpointer user_data);
 static void doBlixemCmd(ZMapView view, ZMapWindowCallbackCommandAlign align_cmd) ;
 
 static void startStateConnectionChecking(ZMapView zmap_view) ;
-#ifdef ED_G_NEVER_INCLUDE_THIS_CODE
 static void stopStateConnectionChecking(ZMapView zmap_view) ;
-#endif /* ED_G_NEVER_INCLUDE_THIS_CODE */
+static void kickStateConnectionChecking(ZMapView zmap_view) ;
 static gboolean checkStateConnections(ZMapView zmap_view) ;
+static void logLoadStats(ZMapView zmap_view) ;
 
 
 static gboolean processGetSeqRequests(void *user_data, ZMapServerReqAny req_any) ;
@@ -249,6 +249,12 @@ static ZMapFeatureContextExecuteStatus add_default_styles(GQuark key,
                                                           char **error_out) ;
 
 static gboolean zMapViewSortExons(ZMapFeatureContext diff_context) ;
+static void replaceSummaryFeatures(ZMapView view, ZMapFeatureContext new_features) ;
+static ZMapFeatureContextExecuteStatus replaceSummaryFeaturesCB(GQuark key,
+                                                                gpointer data,
+                                                                gpointer user_data,
+                                                                char **error_out) ;
+static void hasRawFeatureCB(gpointer data, gpointer user_data) ;
 
 
 
@@ -848,6 +854,8 @@ gboolean zMapViewReset(ZMapView zmap_view)
          sequence. */
       killConnections(zmap_view) ;
 
+      kickStateConnectionChecking(zmap_view) ;
+
       result = TRUE ;
     }
 
@@ -1227,6 +1235,9 @@ void zMapViewDestroy(ZMapView zmap_view)
            * a result of both the ZMap window and the threads dying asynchronously.  */
           zmap_view->state = ZMAPVIEW_DYING ;
         }
+
+      /* Don't wait for a thread to reply before noticing we are dying. */
+      kickStateConnectionChecking(zmap_view) ;
     }
 
   return ;
@@ -1553,6 +1564,11 @@ ZMapFeatureContextMergeCode zmapJustMergeContext(ZMapView view, ZMapFeatureConte
     }
 
 
+  /* Summary bins of a long region are replaced by the features of any shorter region loaded
+   * later, i.e. the user refines coverage data by loading the marked or visible region. */
+  replaceSummaryFeatures(view, new_features) ;
+
+
   /* we need a list of requested featureset names, which is different from those returned
    * these names are user compatable (not normalised)
    */
@@ -1689,12 +1705,8 @@ ZMapFeatureContextMergeCode zmapJustMergeContext(ZMapView view, ZMapFeatureConte
       zMapViewSortExons(diff_context);
 
 
-      /* collpase short reads if configured
-       * NOTE this is simpler than EST masking as we simply don't display the collapsed features
-       * if it is thought necessary to change this then follow the example of EST masking code
-       * you will need to head into window code via just DrawContext()
-       */
-      zMapViewCollapseFeatureSets(view,diff_context);
+      /* short reads are collapsed, and sets to be masked are sorted, by the source's thread
+       * when it gets the features, see zMapFeatureContextPostProcess() */
 
       // mask ESTs with mRNAs if configured
       l = zMapViewMaskFeatureSets(view, diff_context->src_feature_set_names);
@@ -2203,6 +2215,19 @@ static void getIniData(ZMapView view, char *config_str, GList *req_sources)
           ZMapFeatureCount::instance().setLimit(int_value) ;
         }
 
+      /* Size of the worker pool that loads the sources. */
+      if (zMapConfigIniContextGetInt(context,
+                                     ZMAPSTANZA_APP_CONFIG,
+                                     ZMAPSTANZA_APP_CONFIG,
+                                     ZMAPSTANZA_APP_THREAD_POOL,&int_value))
+        {
+          if (int_value >= 0)
+            zMapThreadPoolSetDefaultSize(int_value) ;
+          else
+            zMapLogWarning("Bad value for \"%s\": %d, must be >= 0",
+                           ZMAPSTANZA_APP_THREAD_POOL, int_value) ;
+        }
+
       /*-------------------------------------
        * the dataset
        *-------------------------------------
@@ -2612,9 +2637,10 @@ static void getIniData(ZMapView view, char *config_str, GList *req_sources)
 
 
 /* This is really the guts of the code to check what a connection thread is up
- * to. Every time the GUI thread has stopped doing things GTK calls this routine
- * which then checks our connections for responses from the threads...... */
-static gint zmapIdleCB(gpointer cb_data)
+ * to. GTK calls this routine whenever a thread has signalled that it has replied
+ * (and occasionally from a backstop timer) and it then checks our connections for
+ * responses from the threads...... */
+static gboolean zmapIdleCB(gpointer cb_data)
 {
   gint call_again = 0 ;
   ZMapView zmap_view = (ZMapView)cb_data ;
@@ -2837,8 +2863,9 @@ static void splitMagic(gpointer data, gpointer user_data)
  * the View is now dead.
  *
  * NOTE that you cannot use a condvar here, if the connection thread signals us using a
- * condvar we will probably miss it, that just doesn't work, we have to pole for changes
- * and this is possible because this routine is called from the idle function of the GUI.
+ * condvar we will probably miss it, that just doesn't work. Instead the threads write to
+ * a notifier pipe which is watched by the GUI main loop and this routine is called from
+ * the watch, the replies themselves are still read from the threads' reply structs.
  *
  *
  * There are now too many state variables here, it's all confusing, this routine needs
@@ -3508,6 +3535,8 @@ static gboolean checkStateConnections(ZMapView zmap_view)
               zmap_view->sources_loading = NULL ;
 
               state_change = TRUE ;
+
+              logLoadStats(zmap_view) ;
             }
           else if (!(zmap_view->sources_loading))
             {
@@ -3515,6 +3544,8 @@ static gboolean checkStateConnections(ZMapView zmap_view)
 
               zmap_view->state = ZMAPVIEW_LOADED ;
               state_change = TRUE ;
+
+              logLoadStats(zmap_view) ;
             }
         }
     }
@@ -3651,6 +3682,8 @@ static void destroyZMapView(ZMapView *zmap_view_out)
 {
   ZMapView zmap_view = *zmap_view_out ;
 
+  stopStateConnectionChecking(zmap_view) ;
+
   if(zmap_view->view_sequence)
   {
 //      if(zmap_view->view_sequence->sequence)
@@ -3691,44 +3724,111 @@ static void destroyZMapView(ZMapView *zmap_view_out)
  */
 
 
-/* Start the ZMapView GTK idle function (gets run when the GUI is doing nothing).
+/* Start checking the view's connections. Threads wake us via a notifier when they set a
+ * reply so there is no need to poll them, the timer is only a slow backstop in case a
+ * state change is made without a thread replying.
  */
 static void startStateConnectionChecking(ZMapView zmap_view)
 {
+  GList *list_item ;
 
-#ifdef UTILISE_ALL_CPU_ON_DESKPRO203
-  zmap_view->idle_handle = gtk_idle_add(zmapIdleCB, (gpointer)zmap_view) ;
-#endif /* UTILISE_ALL_CPU_ON_DESKPRO203 */
+  if (zmap_view->thread_notify || zmap_view->idle_handle)
+    stopStateConnectionChecking(zmap_view) ;
 
+  if ((zmap_view->thread_notify = zMapThreadNotifyCreate(zmapIdleCB, (void *)zmap_view)))
+    {
+      /* Connections set up before we were started need the notifier too. */
+      for (list_item = g_list_first(zmap_view->connection_list) ; list_item ; list_item = g_list_next(list_item))
+        {
+          ZMapNewDataSource view_con = (ZMapNewDataSource)(list_item->data) ;
 
+          zMapThreadSetNotify(view_con->thread->GetThread(), zmap_view->thread_notify) ;
+        }
 
-  zmap_view->idle_handle = gtk_timeout_add(100, zmapIdleCB, (gpointer)zmap_view) ;
-  // WARNING: gtk_timeout_add is deprecated and should not be used in newly-written code. Use g_timeout_add() instead.
+      zmap_view->idle_handle = g_timeout_add(1000, zmapIdleCB, (gpointer)zmap_view) ;
+    }
+  else
+    {
+      /* No notifier so fall back to polling. */
+      zmap_view->idle_handle = g_timeout_add(100, zmapIdleCB, (gpointer)zmap_view) ;
+    }
 
   return ;
 }
 
 
+/* Stop checking the view's connections, must be called before the view is freed and is safe
+ * to call from within zmapIdleCB(). Threads may still hold the notifier, they release it
+ * when they are destroyed. */
+static void stopStateConnectionChecking(ZMapView zmap_view)
+{
+  if (zmap_view->idle_handle)
+    {
+      g_source_remove(zmap_view->idle_handle) ;
+      zmap_view->idle_handle = 0 ;
+    }
+
+  if (zmap_view->thread_notify)
+    {
+      zMapThreadNotifyDestroy(zmap_view->thread_notify) ;
+      zmap_view->thread_notify = NULL ;
+    }
 
-#ifdef ED_G_NEVER_INCLUDE_THIS_CODE
-/* WE do need to do this in fact......we should do it when all connections have died...
- * ADD CODE TO call this.... */
+  return ;
+}
 
 
-/* I think that probably I won't need this most of the time, it could be used to remove the idle
- * function in a kind of unilateral way as a last resort, otherwise the idle function needs
- * to cancel itself.... */
-static void stopStateConnectionChecking(ZMapView zmap_view)
+/* Get the connections checked as soon as the GUI is idle, used when the view's own state
+ * changes in a way that needs action from the checking code. */
+static void kickStateConnectionChecking(ZMapView zmap_view)
 {
-  gtk_timeout_remove(zmap_view->idle_handle) ;
+  if (zmap_view->thread_notify)
+    zMapThreadNotifySignal(zmap_view->thread_notify) ;
 
   return ;
 }
-#endif /* ED_G_NEVER_INCLUDE_THIS_CODE */
 
 
 
 
+/* Record how busy the source loading pool was, helps with setting thread-pool-size, and how
+ * much memory each featureset and the feature ids are using. */
+static void logLoadStats(ZMapView zmap_view)
+{
+  ZMapThreadPool pool ;
+
+  if ((pool = zMapThreadPoolGetDefault()))
+    {
+      ZMapThreadPoolStatsStruct stats ;
+
+      zMapThreadPoolGetStats(pool, &stats) ;
+
+      zMapLogMessage("Source loading pool: %d/%d workers, %d busy, queue depth %d (max %d), %lu tasks submitted, %lu completed",
+                     stats.num_workers, stats.max_workers, stats.num_busy,
+                     stats.queue_depth, stats.max_queue_depth,
+                     stats.num_submitted, stats.num_completed) ;
+    }
+
+  if (zmap_view->features)
+    {
+      zMapFeatureContextLogMemUsage(zmap_view->features) ;
+      zMapFeatureContextLogDNAMemUsage(zmap_view->features) ;
+    }
+
+  {
+    ZMapFeatureIDStatsStruct id_stats ;
+
+    zMapFeatureIDGetStats(&id_stats) ;
+
+    zMapLogMessage("Feature ids: %" G_GINT64_FORMAT " interned, %" G_GINT64_FORMAT " string bytes, "
+                   "~%" G_GINT64_FORMAT " table bytes, %" G_GINT64_FORMAT " lookups",
+                   id_stats.num_ids, id_stats.string_bytes, id_stats.table_bytes, id_stats.lookups) ;
+  }
+
+  return ;
+}
+
+
 
 void printStyle(GQuark style_id, gpointer data, gpointer user_data)
 {
@@ -4217,6 +4317,140 @@ static gboolean zMapViewSortExons(ZMapFeatureContext diff_context)
 }
 
 
+/* Summary bins (see the summary-bins source option) are the mean score of a stretch of a long
+ * region, so when features arrive for a region that has already been loaded as summary bins:
+ *
+ * - the view's summary bins overlapping the new region are erased from the view and windows,
+ *   the new features hold the same data at higher resolution.
+ * - new summary bins overlapping features already loaded at full resolution are dropped
+ *   before they are merged so the region is not drawn twice.
+ *
+ * Bins straddling the edge of the new region are removed too so that part of the bin outside
+ * the region is left empty until it is loaded again. */
+static void replaceSummaryFeatures(ZMapView view, ZMapFeatureContext new_features)
+{
+  if (view->features && new_features)
+    zMapFeatureContextExecute((ZMapFeatureAny)new_features,
+                              ZMAPFEATURE_STRUCT_FEATURESET,
+                              replaceSummaryFeaturesCB,
+                              view) ;
+
+  return ;
+}
+
+static ZMapFeatureContextExecuteStatus replaceSummaryFeaturesCB(GQuark key,
+                                                                gpointer data,
+                                                                gpointer user_data,
+                                                                char **error_out)
+{
+  ZMapFeatureContextExecuteStatus status = ZMAP_CONTEXT_EXEC_STATUS_OK ;
+  ZMapFeatureAny feature_any = (ZMapFeatureAny)data ;
+  ZMapView view = (ZMapView)user_data ;
+  ZMapFeatureSet new_set, view_set ;
+  ZMapFeatureBlock new_block ;
+  GList *summary_list = NULL, *drop_list = NULL, *l ;
+  GHashTableIter iter ;
+  gpointer value ;
+
+  if (feature_any->struct_type != ZMAPFEATURE_STRUCT_FEATURESET
+      || !(view_set = (ZMapFeatureSet)zMapFeatureContextFindFeatureFromFeature(view->features, feature_any)))
+    return status ;
+
+  new_set = (ZMapFeatureSet)feature_any ;
+  new_block = (ZMapFeatureBlock)(new_set->parent) ;
+
+  /* The new features may still be waiting to be revcomp'd to match the view. */
+  zMapFeatureSetRevCompResolve(new_set) ;
+
+  /* The new block's coords are the region that was requested. */
+  for (l = zMapFeatureSetGetOverlapFeatures(view_set,
+                                            new_block->block_to_sequence.block.x1,
+                                            new_block->block_to_sequence.block.x2) ;
+       l ; l = g_list_delete_link(l, l))
+    {
+      ZMapFeature feature = (ZMapFeature)(l->data) ;
+
+      if (feature->flags.summary_bin)
+        summary_list = g_list_prepend(summary_list, feature) ;
+    }
+
+  g_hash_table_iter_init(&iter, new_set->features) ;
+  while (g_hash_table_iter_next(&iter, NULL, &value))
+    {
+      ZMapFeature feature = (ZMapFeature)value ;
+      gboolean has_raw = FALSE ;
+
+      if (feature->flags.summary_bin)
+        {
+          zMapFeatureSetForeachOverlap(view_set, feature->x1, feature->x2, hasRawFeatureCB, &has_raw) ;
+
+          if (has_raw)
+            drop_list = g_list_prepend(drop_list, feature) ;
+        }
+    }
+
+  if (summary_list)
+    {
+      GList *feature_list = NULL ;
+      ZMapFeature feature_copy = NULL ;
+      ZMapFeatureContext context_copy ;
+
+      if ((context_copy = zmapViewCopyContextAll(view->features, (ZMapFeature)(summary_list->data), view_set,
+                                                 &feature_list, &feature_copy)))
+        {
+          ZMapFeatureSet set_copy = (ZMapFeatureSet)(feature_copy->parent) ;
+
+          for (l = summary_list->next ; l ; l = l->next)
+            {
+              feature_copy = (ZMapFeature)zMapFeatureAnyCopy((ZMapFeatureAny)(l->data)) ;
+              zMapFeatureSetAddFeature(set_copy, feature_copy) ;
+              feature_list = g_list_prepend(feature_list, feature_copy) ;
+            }
+
+          zmapViewEraseFeatures(view, context_copy, &feature_list) ;
+
+          g_list_free(feature_list) ;
+          zMapFeatureContextDestroy(context_copy, TRUE) ;
+        }
+
+      zMapLogMessage("Replaced %d summary bins of \"%s\" in %d-%d",
+                     g_list_length(summary_list), g_quark_to_string(new_set->original_id),
+                     new_block->block_to_sequence.block.x1, new_block->block_to_sequence.block.x2) ;
+
+      g_list_free(summary_list) ;
+    }
+
+  if (drop_list)
+    {
+      zMapLogMessage("Dropped %d summary bins of \"%s\" already loaded at full resolution",
+                     g_list_length(drop_list), g_quark_to_string(new_set->original_id)) ;
+
+      for (l = drop_list ; l ; l = l->next)
+        {
+          zMapFeatureSetRemoveFeature(new_set, (ZMapFeature)(l->data)) ;
+          zMapFeatureDestroy((ZMapFeature)(l->data)) ;
+        }
+
+      g_list_free(drop_list) ;
+    }
+
+  return status ;
+}
+
+/* Called for each view feature overlapping a new summary bin, records whether any of them is
+ * a full resolution feature. */
+static void hasRawFeatureCB(gpointer data, gpointer user_data)
+{
+  ZMapFeature feature = (ZMapFeature)data ;
+  gboolean *has_raw = (gboolean *)user_data ;
+
+  if (!feature->flags.summary_bin)
+    *has_raw = TRUE ;
+
+  return ;
+}
+
+
 
 
 static ZMapFeatureContextExecuteStatus add_default_styles(GQuark key,
@@ -4832,6 +5066,8 @@ static gboolean checkContinue(ZMapView zmap_view)
          * checking.... */
         zmap_view->state = ZMAPVIEW_MAPPED;       /* ZMAPVIEW_INIT */
 
+        stopStateConnectionChecking(zmap_view) ;
+
         /* Signal layer above us because the view has reset. */
         (*(view_cbs_G->state_change))(zmap_view, zmap_view->app_data, NULL) ;
 
@@ -607,6 +607,9 @@ static gboolean initBlixemData(ZMapView view, ZMapFeatureBlock block,
   blixem_data->feature_set = feature_set ;
   blixem_data->block = block ;
   blixem_data->over_write = TRUE ;
+
+  /* Features from any of the block's sets may be sent so they must all be the right way round. */
+  zMapFeatureAnyRevCompResolve((ZMapFeatureAny)block) ;
   zMapGFFFormatAttributeUnsetAll(blixem_data->attribute_flags) ;
 
   if (!(zMapFeatureBlockDNA(block, NULL, NULL, NULL)))
@@ -2495,7 +2498,7 @@ static gboolean writeFastAFile(ZMapBlixemData blixem_data)
   int i = 0;
 
 
-  if (!zMapFeatureBlockDNA(blixem_data->block, NULL, NULL, &cp))
+  if (!zMapFeatureBlockDNA(blixem_data->block, NULL, NULL, NULL))
     {
       zMapShowMsg(ZMAP_MSG_WARNING, "Error creating FASTA file, failed to get feature's DNA");
 
@@ -59,16 +59,6 @@
 #define PDEBUG          zMapLogWarning
 
 
-/* header of list of features of the same name */
-typedef struct _align_set
-{
-      GQuark id;
-      Coord x1,x2;
-      gboolean masked;  /* by self */
-
-} ZMapViewAlignSetStruct, *ZMapViewAlignSet;
-
-
 typedef struct _ZMapMaskFeatureSetData
 {
       GList *masker;
@@ -94,8 +84,6 @@ static ZMapFeatureContextExecuteStatus maskNewFeaturesetByAll(GQuark key,
 
 static void mask_set_with_set(ZMapFeatureSet masked, ZMapFeatureSet masker,gboolean perfect);
 
-static GList *sortFeatureset(ZMapFeatureSet fset);
-
 
 
 
@@ -290,8 +278,10 @@ static ZMapFeatureContextExecuteStatus maskNewFeaturesetByAll(GQuark key,
 
             masker_set = (ZMapFeatureSet) g_hash_table_lookup(feature_any->children, GUINT_TO_POINTER(set_id));
 
-            // has new data, must need sorting
-            feature_set->masker_sorted_features = sortFeatureset(feature_set);
+            // has new data, the source thread sorts it but masking by an earlier masker
+            // will have set the header flags
+            if(!zMapFeatureSetMaskerIsSorted(feature_set) || fset != masked_by)
+              zMapFeatureSetMaskerSort(feature_set);
 
 
             if(masker_set)
@@ -313,173 +303,6 @@ static ZMapFeatureContextExecuteStatus maskNewFeaturesetByAll(GQuark key,
 
 
 
-/* order features by start coord then end coord reversed */
-/* regardless of strand this still works */
-gint fsetListOrderCB(gconstpointer a, gconstpointer b)
-{
-  GList *la = (GList *) a;
-  GList *lb = (GList *) b;
-  ZMapViewAlignSet sa = (ZMapViewAlignSet) la->data;
-  ZMapViewAlignSet sb = (ZMapViewAlignSet) lb->data;
-
-  if(sa->x1 < sb->x1)
-    return(-1);
-  if(sa->x1 > sb->x1)
-    return(1);
-
-  if(sa->x2 > sb->x2)
-    return(-1);
-  if(sa->x2 < sb->x2)
-    return(1);
-  return(0);
-}
-
-guint fsetListOrderKey(gconstpointer thing, int digit)
-{
-  guint coord;
-  ZMapViewAlignSet as = (ZMapViewAlignSet) thing;
-
-  if(digit < 4)
-    {
-      coord = G_MAXUINT - as->x2;        /* least significant: end coord reversed */
-    }
-  else
-    {
-      digit -= 4;
-      coord = as->x1;         /* start coord */
-    }
-
-  while (--digit >= 0)
-    coord >>= RADIX_BITS;
-  coord &= 0xff;
-
-  return coord;
-}
-
-
-
-/* order feature by start coord */
-gint fsetStartOrderCB(gconstpointer a, gconstpointer b)
-{
-  ZMapFeature fa = (ZMapFeature) a;
-  ZMapFeature fb = (ZMapFeature) b;
-
-  if(fa->x1 < fb->x1)
-    return(-1);
-  if(fa->x1 > fb->x1)
-    return(1);
-  return(0);
-}
-
-
-
-/* sort features in random name order using thier id quarks
- * we just want features with the same name to be together
- */
-gint nameOrderCB(gconstpointer a, gconstpointer b)
-{
-  ZMapFeature fa = (ZMapFeature) a;
-  ZMapFeature fb = (ZMapFeature) b;
-
-  if(fa->strand != fb->strand)
-    return((gint) fa->strand - (gint) fb->strand);
-
-  return ((gint) fa->original_id - (gint) fb->original_id);
-}
-
-
-/* related alignments have the same name but are distinct features
- * so we sort by name  and make lists of these
- * then we prepend an item to hold the start and end coord for the whole list
- *   using a noddy structure (can't get at the list end thanks to glib)
- * then we sort these into start coord then end coord reversed order
- */
-static GList *sortFeatureset(ZMapFeatureSet fset)
-{
-  GList *l = NULL,*l_out = NULL;
-  GList *gl_start, *gl_end;
-  ZMapViewAlignSet align_set;
-  ZMapFeature f_start,f_end,f;
-
-  if(fset->masker_sorted_features)    /* free existing list of lists */
-    {
-      for(l = fset->masker_sorted_features;l;l = l->next)
-        {
-          g_list_free((GList *) l->data);
-        }
-      g_list_free(fset->masker_sorted_features);
-      fset->masker_sorted_features = NULL;
-    }
-  /* get pointers to all the features grouped according to name */
-  zMap_g_hash_table_get_data(&l, fset->features);
-  l = g_list_sort(l,nameOrderCB);
-
-  /* chop this list into lists per name group and strand
-   * sorted by start coordinate
-   * with a little header struct at the front
-   * then add to another list,
-   */
-
-  for(gl_start = l;gl_start;)
-    {
-      f_start = (ZMapFeature) gl_start->data;
-
-      for(gl_end = gl_start;gl_end;gl_end = gl_end->next)
-        {
-          f_end = (ZMapFeature) gl_end->data;
-          if(f_end->strand != f_start->strand)
-            break;
-          if(f_end->original_id != f_start->original_id)
-            break;
-        }
-
-      if(gl_end)
-        {
-          gl_end->prev->next = NULL;
-          gl_end->prev = NULL;
-        }
-
-      gl_start = g_list_sort(gl_start,fsetStartOrderCB);
-
-      align_set = g_new0(ZMapViewAlignSetStruct,1);
-      f = (ZMapFeature) gl_start->data;
-      align_set->id = f->original_id;
-      align_set->x1 = f->x1;
-
-      l_out = g_list_prepend(l_out, g_list_prepend(gl_start,align_set));
-      for(;gl_start;gl_start = gl_start->next)
-        {
-          f = (ZMapFeature) gl_start->data;
-          align_set->x2 = f->x2;
-        }
-
-      gl_start = gl_end;
-    }
-
-  /* order these lists by start coord and end coord reversed */
-
-#if MH17_test_radix_sort
-  /* see zmapRadix#Sort.c for performance stats */
-
-  printf("%s has %d items\n",g_quark_to_string(fset->unique_id),g_list_length(l_out));
-  zMapStartTimer("normal sort","");
-  { int i;
-    for(i = 0;i < 1000;i++)
-      l_out = g_list_sort(l_out,fsetListOrderCB);
-    zMapStopTimer("normal sort","");
-    zMapStartTimer("radix sort","");
-    for(i = 0;i < 1000;i++)
-      l_out = zMapRadixSort(l_out,fsetListOrderKey,8);
-    zMapStopTimer("radix sort","");
-  }
-#else
-  /* merge sort faster fot this data+key combo */
-  l_out = g_list_sort(l_out,fsetListOrderCB);
-
-#endif
-  return(l_out);
-}
-
 static gboolean maskOne(GList *mask_top, GList *f, GList *mask,  gboolean exact, gboolean perfect)
 {
   GList *l;
@@ -563,7 +386,7 @@ static void mask_set_with_set(ZMapFeatureSet masked, ZMapFeatureSet masker, gboo
 {
   GList *ESTset,*mRNAset;
   GList *EST,*mRNA;
-  ZMapViewAlignSet est,mrna;
+  ZMapFeatureMaskSet est,mrna;
   GList *m;
   gboolean exact = FALSE;
 
@@ -595,12 +418,12 @@ static void mask_set_with_set(ZMapFeatureSet masked, ZMapFeatureSet masker, gboo
   /* for clarity we pretend we are masking an EST with an mRNA
    * but it could be EST x EST or mRNA x mRNA
    */
-  if(!masked->masker_sorted_features)
-    masked->masker_sorted_features = sortFeatureset(masked);
+  if(!zMapFeatureSetMaskerIsSorted(masked))
+    zMapFeatureSetMaskerSort(masked);
   ESTset = masked->masker_sorted_features;
 
-  if(!masker->masker_sorted_features)
-    masker->masker_sorted_features = sortFeatureset(masker);
+  if(!zMapFeatureSetMaskerIsSorted(masker))
+    zMapFeatureSetMaskerSort(masker);
   mRNAset = masker->masker_sorted_features;
 
   /* is an EST completely covered by an mRNA?? */
@@ -609,7 +432,7 @@ static void mask_set_with_set(ZMapFeatureSet masked, ZMapFeatureSet masker, gboo
       n_tried++;
 
       EST = (GList *) ESTset->data;
-      est = (ZMapViewAlignSet) EST->data;
+      est = (ZMapFeatureMaskSet) EST->data;
 #if FILE_DEBUG
 
       if(0)
@@ -626,7 +449,7 @@ static void mask_set_with_set(ZMapFeatureSet masked, ZMapFeatureSet masker, gboo
       while(mRNAset)
         {
           mRNA = (GList *) mRNAset->data;
-          mrna = (ZMapViewAlignSet) mRNA->data;
+          mrna = (ZMapFeatureMaskSet) mRNA->data;
 #if FILE_DEBUG
           if(twitter_G) PDEBUG("find mRNA est %s %d-%d mrna %d-%d",g_quark_to_string(est->id),est->x1,est->x1,mrna->x1,mrna->x2);
 #endif
@@ -645,7 +468,7 @@ static void mask_set_with_set(ZMapFeatureSet masked, ZMapFeatureSet masker, gboo
       for(m = mRNAset;m && mrna->x1 <= est->x1;m = m->next)
         {
           mRNA = (GList *) m->data;
-          mrna = (ZMapViewAlignSet) mRNA->data;
+          mrna = (ZMapFeatureMaskSet) mRNA->data;
 
           if(mrna == est)                     /* matching feature against self */
             continue;
@@ -271,6 +271,8 @@ ZMapFeature zmapViewScratchGetFeature(ZMapView view)
       GHashTableIter iter;
       gpointer key, value;
 
+      zMapFeatureSetRevCompResolve(feature_set) ;
+
       g_hash_table_iter_init (&iter, feature_any->children);
 
       /* Should only be one, so just get the first */
@@ -398,6 +400,9 @@ static gboolean scratchMergeCoords(ScratchMergeData merge_data, const int coord1
       merge_data->dest_feature->x1 = coord1;
       merge_data->dest_feature->x2 = coord2;
 
+      if (merge_data->dest_feature->parent)
+        zMapFeatureSetIndexInvalidate((ZMapFeatureSet)(merge_data->dest_feature->parent)) ;
+
       scratchSetStartEndFlag(merge_data->view, TRUE);
     }
 
@@ -613,6 +618,9 @@ static gboolean scratchMergeFeature(ScratchMergeData merge_data,
       merge_data->dest_feature->x1 = feature->x1;
       merge_data->dest_feature->x2 = feature->x2;
 
+      if (merge_data->dest_feature->parent)
+        zMapFeatureSetIndexInvalidate((ZMapFeatureSet)(merge_data->dest_feature->parent)) ;
+
       scratchSetStartEndFlag(merge_data->view, TRUE);
     }
 
@@ -58,6 +58,14 @@ typedef struct DrawableDataStructType
 } DrawableDataStruct, *DrawableData ;
 
 
+/* One tile of a request that has been split up, see requestServerTiles(). */
+typedef struct LoadTileStructType
+{
+  int start, end ;
+  int distance ;                                            /* From the visible part of the window. */
+} LoadTileStruct, *LoadTile ;
+
+
 
 
 
@@ -74,6 +82,17 @@ static bool createStepList(ZMapView zmap_view, ZMapNewDataSource view_con, ZMapC
                            ZMapFeatureContext context, GList *req_featuresets, GList *req_biotypes,
                            gboolean dna_requested, gboolean req_styles, char *styles_file,
                            gboolean terminate) ;
+static ZMapThreadPriority getRequestPriority(ZMapView view, GList *req_featuresets, gboolean dna_requested,
+                                             const char *req_sequence, int req_start, int req_end) ;
+static ZMapNewDataSource requestServerTiles(ZMapView view, ZMapNewDataSource view_conn,
+                                            ZMapFeatureBlock block_orig, GList *req_featuresets, GList *req_biotypes,
+                                            ZMapConfigSource server,
+                                            const char *req_sequence, int req_start, int req_end,
+                                            gboolean dna_requested, gboolean terminate, gboolean show_warning) ;
+static gint tileDistanceCmp(gconstpointer a, gconstpointer b) ;
+static gboolean tileIsLoaded(ZMapView view, ZMapFeatureBlock view_block, GList *req_featuresets, int start, int end) ;
+static gboolean isBeingLoaded(ZMapView view, GQuark set_id, int start, int end) ;
+static gboolean getVisibleSpan(ZMapView view, int *start_out, int *end_out) ;
 static gboolean dispatchContextRequests(ZMapServerReqAny req_any, gpointer connection_data) ;
 static gboolean processDataRequests(void *user_data, ZMapServerReqAny req_any) ;
 static void freeDataRequest(ZMapServerReqAny req_any) ;
@@ -347,6 +366,16 @@ ZMapNewDataSource zmapViewRequestServer(ZMapView view, ZMapNewDataSource view_co
       // Add this connection to the list of connections to be monitored for data by zmapview
       view->connection_list = g_list_append(view->connection_list, view_conn) ;
 
+      // and have the thread wake the view when it replies (if the view isn't checking yet
+      // this is done when it starts).
+      if (view->thread_notify)
+        zMapThreadSetNotify(view_conn->thread->GetThread(), view->thread_notify) ;
+
+      // When sources are loaded by the worker pool this decides which are loaded first.
+      zMapThreadSetPriority(view_conn->thread->GetThread(),
+                            getRequestPriority(view, req_featuresets, dna_requested,
+                                               req_sequence, req_start, req_end)) ;
+
       // Now dispatch the first request......
       zmapViewStepListIter(connect_data->step_list, view_conn->thread->GetThread(), view_conn) ;
 
@@ -424,7 +453,8 @@ gboolean zmapViewSetUpServerConnections(ZMapView zmap_view, GList *settings_list
 /* Loads features within block from the sets req_featuresets that lie within features_start
  * to features_end. The features are fetched from the data sources and added to the existing
  * view. N.B. this is asynchronous because the sources are separate threads and once
- * retrieved the features are added via a gtk event.
+ * retrieved the features are added via a gtk event. Long regions from sources with a
+ * tile-size are requested a tile at a time, see requestServerTiles().
  *
  * NOTE req_sources is nominally a list of featuresets.
  * Otterlace could request a featureset that belongs to ACE
@@ -477,8 +507,8 @@ void zmapViewLoadFeatures(ZMapView view, ZMapFeatureBlock block_orig,
           dna_requested = TRUE ;
         }
 
-      view_conn = zmapViewRequestServer(view, NULL, block_orig, req_sources, req_biotypes, server,
-                                        req_sequence, req_start, req_end, dna_requested, terminate, !view->thread_fail_silent);
+      view_conn = requestServerTiles(view, NULL, block_orig, req_sources, req_biotypes, server,
+                                     req_sequence, req_start, req_end, dna_requested, terminate, !view->thread_fail_silent);
       if(view_conn)
         requested = TRUE;
     }
@@ -647,10 +677,10 @@ void zmapViewLoadFeatures(ZMapView view, ZMapFeatureBlock block_orig,
               view_conn = (make_new_connection ? NULL : (existing ? view_conn : NULL)) ;
 
 
-              view_conn = zmapViewRequestServer(view, view_conn, block_orig, req_featuresets, req_biotypes,
-                                                server, req_sequence, req_start, req_end,
-                                                dna_requested,
-                                                (!existing && terminate), !view->thread_fail_silent) ;
+              view_conn = requestServerTiles(view, view_conn, block_orig, req_featuresets, req_biotypes,
+                                             server, req_sequence, req_start, req_end,
+                                             dna_requested,
+                                             (!existing && terminate), !view->thread_fail_silent) ;
 
               if(view_conn)
                 requested = TRUE;
@@ -954,6 +984,266 @@ static bool createStepList(ZMapView zmap_view, ZMapNewDataSource view_con, ZMapC
 }
 
 
+/* The dna is needed by many columns so is loaded first, sources whose columns are all
+ * hidden, or requests for a part of the region the user can't see, are loaded last. */
+static ZMapThreadPriority getRequestPriority(ZMapView view, GList *req_featuresets, gboolean dna_requested,
+                                             const char *req_sequence, int req_start, int req_end)
+{
+  ZMapThreadPriority priority = ZMapThreadPriority::LOW ;
+  int vis_start = 0, vis_end = 0 ;
+  GList *l ;
+
+  if (dna_requested)
+    return ZMapThreadPriority::HIGH ;
+  else if (!req_featuresets)
+    return ZMapThreadPriority::NORMAL ;
+
+  for (l = req_featuresets ; l && priority == ZMapThreadPriority::LOW ; l = l->next)
+    {
+      GQuark set_id = zMapFeatureSetCreateID((char *)g_quark_to_string(GPOINTER_TO_UINT(l->data))) ;
+      ZMapFeatureSetDesc set_desc = NULL ;
+      ZMapFeatureColumn column = NULL ;
+
+      if (view->context_map.featureset_2_column)
+        set_desc = (ZMapFeatureSetDesc)g_hash_table_lookup(view->context_map.featureset_2_column,
+                                                           GUINT_TO_POINTER(set_id)) ;
+
+      if (set_desc && view->context_map.columns)
+        {
+          std::map<GQuark, ZMapFeatureColumn>::iterator iter = view->context_map.columns->find(set_desc->column_id) ;
+
+          if (iter != view->context_map.columns->end())
+            column = iter->second ;
+        }
+
+      if (!column || !column->style || !zMapStyleIsHidden(column->style))
+        priority = ZMapThreadPriority::NORMAL ;
+    }
+
+  /* Other sequences' coords can't be compared with the window's. */
+  if (priority == ZMapThreadPriority::NORMAL && !req_sequence
+      && getVisibleSpan(view, &vis_start, &vis_end)
+      && (req_end < vis_start || req_start > vis_end))
+    priority = ZMapThreadPriority::LOW ;
+
+  return priority ;
+}
+
+
+/* Requests features from server as zmapViewRequestServer() does but if the source has a
+ * tile size and the region is longer than that then the region is requested as a series of
+ * tiles, each one merged and drawn as it arrives. Tiles nearest the visible part of the window
+ * are requested first and tiles that all of req_featuresets already have loaded, or are
+ * loading, are not requested again. Returns the last connection made, NULL if none were. */
+static ZMapNewDataSource requestServerTiles(ZMapView view, ZMapNewDataSource view_conn,
+                                            ZMapFeatureBlock block_orig, GList *req_featuresets, GList *req_biotypes,
+                                            ZMapConfigSource server,
+                                            const char *req_sequence, int req_start, int req_end,
+                                            gboolean dna_requested, gboolean terminate, gboolean show_warning)
+{
+  ZMapFeatureBlock view_block = NULL ;
+
+  if (view->features)
+    view_block = (ZMapFeatureBlock)zMap_g_hash_table_nth(view->features->master_align->blocks, 0) ;
+
+  /* The dna has to come in one go and the loaded spans are in the view's sequence coords. */
+  if (server->tile_size <= 0 || dna_requested || req_sequence || !view_block
+      || (req_end - req_start + 1) <= server->tile_size)
+    {
+      view_conn = zmapViewRequestServer(view, view_conn, block_orig, req_featuresets, req_biotypes, server,
+                                        req_sequence, req_start, req_end, dna_requested, terminate, show_warning) ;
+    }
+  else
+    {
+      ZMapNewDataSource tile_conn = NULL ;
+      GArray *tiles ;
+      int vis_start = 0, vis_end = 0 ;
+      gboolean have_visible ;
+      int start, num_requested = 0 ;
+      guint i ;
+
+      /* Requests with a block get their block coords set to the request so the loaded spans
+       * recorded for sets with no features in a tile are just the tile. */
+      if (!block_orig)
+        block_orig = view_block ;
+
+      have_visible = getVisibleSpan(view, &vis_start, &vis_end) ;
+
+      tiles = g_array_new(FALSE, FALSE, sizeof(LoadTileStruct)) ;
+
+      for (start = req_start ; start <= req_end ; start += server->tile_size)
+        {
+          LoadTileStruct tile ;
+
+          tile.start = start ;
+          tile.end = MIN(start + server->tile_size - 1, req_end) ;
+
+          if (!have_visible || (tile.end >= vis_start && tile.start <= vis_end))
+            tile.distance = 0 ;
+          else if (tile.end < vis_start)
+            tile.distance = vis_start - tile.end ;
+          else
+            tile.distance = tile.start - vis_end ;
+
+          g_array_append_val(tiles, tile) ;
+        }
+
+      g_array_sort(tiles, tileDistanceCmp) ;
+
+      for (i = 0 ; i < tiles->len ; i++)
+        {
+          LoadTile tile = &g_array_index(tiles, LoadTileStruct, i) ;
+          gboolean first = (num_requested == 0) ;
+          ZMapNewDataSource new_conn ;
+
+          if (tileIsLoaded(view, view_block, req_featuresets, tile->start, tile->end))
+            continue ;
+
+          /* Threads keep the lists they are given so each tile needs its own copies, only the
+           * first can reuse the connection or keep it open afterwards. */
+          new_conn = zmapViewRequestServer(view, (first ? view_conn : NULL), block_orig,
+                                           (first ? req_featuresets : g_list_copy(req_featuresets)),
+                                           (first ? req_biotypes : g_list_copy(req_biotypes)),
+                                           server, req_sequence, tile->start, tile->end,
+                                           dna_requested, (first ? terminate : TRUE), show_warning) ;
+
+          if (new_conn)
+            tile_conn = new_conn ;
+
+          num_requested++ ;
+        }
+
+      /* Nothing was handed to a thread so the featureset list, which the thread would have
+       * freed, is still ours. */
+      if (num_requested == 0)
+        {
+          g_list_free(req_featuresets) ;
+
+          zMapLogMessage("All %d tiles of %d bases from %s are already loaded or loading, none requested",
+                         (int)tiles->len, server->tile_size, server->url()) ;
+        }
+      else
+        {
+          zMapLogMessage("Requested %d of %d tiles of %d bases from %s",
+                         num_requested, (int)tiles->len, server->tile_size, server->url()) ;
+        }
+
+      g_array_free(tiles, TRUE) ;
+
+      view_conn = tile_conn ;
+    }
+
+  return view_conn ;
+}
+
+
+/* Nearest the visible part of the window first, then in sequence order. */
+static gint tileDistanceCmp(gconstpointer a, gconstpointer b)
+{
+  LoadTile tile_a = (LoadTile)a ;
+  LoadTile tile_b = (LoadTile)b ;
+  gint result = 0 ;
+
+  if (tile_a->distance != tile_b->distance)
+    result = (tile_a->distance < tile_b->distance ? -1 : 1) ;
+  else if (tile_a->start != tile_b->start)
+    result = (tile_a->start < tile_b->start ? -1 : 1) ;
+
+  return result ;
+}
+
+
+/* A tile is loaded if every featureset has loaded it, or is loading it, already. The tile is
+ * forward strand like all requests but the loaded spans are in the view's coords. */
+static gboolean tileIsLoaded(ZMapView view, ZMapFeatureBlock view_block, GList *req_featuresets, int start, int end)
+{
+  gboolean loaded = TRUE ;
+  int view_start = start, view_end = end ;
+  GList *l ;
+
+  if (zMapViewGetRevCompStatus(view))
+    {
+      zmapFeatureRevCompCoord(&view_start, view->features->parent_span.x1, view->features->parent_span.x2) ;
+      zmapFeatureRevCompCoord(&view_end, view->features->parent_span.x1, view->features->parent_span.x2) ;
+      zMapUtilsSwop(int, view_start, view_end) ;
+    }
+
+  for (l = req_featuresets ; l && loaded ; l = l->next)
+    {
+      GQuark set_id = zMapFeatureSetCreateID((char *)g_quark_to_string(GPOINTER_TO_UINT(l->data))) ;
+      ZMapFeatureSet feature_set ;
+
+      if (!(feature_set = zMapFeatureBlockGetSetByID(view_block, set_id))
+          || !zMapFeatureSetIsLoadedInSpan(feature_set, view_start, view_end))
+        loaded = isBeingLoaded(view, set_id, start, end) ;
+    }
+
+  return loaded ;
+}
+
+
+/* Is there a connection still fetching the featureset over all of start to end ? */
+static gboolean isBeingLoaded(ZMapView view, GQuark set_id, int start, int end)
+{
+  gboolean result = FALSE ;
+  GList *l ;
+
+  for (l = view->connection_list ; l && !result ; l = l->next)
+    {
+      ZMapConnectionData connect_data ;
+
+      connect_data = (ZMapConnectionData)zMapServerConnectionGetUserData((ZMapNewDataSource)(l->data)) ;
+
+      if (connect_data && connect_data->start <= start && connect_data->end >= end)
+        {
+          GList *fs ;
+
+          for (fs = connect_data->feature_sets ; fs && !result ; fs = fs->next)
+            {
+              if (zMapFeatureSetCreateID((char *)g_quark_to_string(GPOINTER_TO_UINT(fs->data))) == set_id)
+                result = TRUE ;
+            }
+        }
+    }
+
+  return result ;
+}
+
+
+/* Gets the forward strand coords of the part of the view's first window that the user can
+ * see, FALSE if there isn't one or it hasn't been drawn yet. */
+static gboolean getVisibleSpan(ZMapView view, int *start_out, int *end_out)
+{
+  gboolean result = FALSE ;
+  ZMapViewWindow view_window ;
+  int start, end ;
+
+  if (view->window_list && view->features
+      && (view_window = (ZMapViewWindow)(view->window_list->data))
+      && zMapWindowGetVisibleSpan(view_window->window, &start, &end))
+    {
+      if (zMapViewGetRevCompStatus(view))
+        {
+          int tmp ;
+
+          /* requests are always forward strand, see commandCB() */
+          zmapFeatureRevCompCoord(&start, view->features->parent_span.x1, view->features->parent_span.x2) ;
+          zmapFeatureRevCompCoord(&end, view->features->parent_span.x1, view->features->parent_span.x2) ;
+
+          tmp = start ;
+          start = end ;
+          end = tmp ;
+        }
+
+      *start_out = start ;
+      *end_out = end ;
+      result = TRUE ;
+    }
+
+  return result ;
+}
+
+
 /* This is _not_ a generalised dispatch function, it handles a sequence of requests that
  * will end up fetching a feature context from a source. The steps are interdependent
  * and data from one step must be available to the next. */
@@ -1674,6 +1964,14 @@ static gboolean viewGetFeatures(ZMapView zmap_view, ZMapServerReqGetFeatures fea
 
       connect_data->loaded_features->merge_stats = *merge_stats ;
 
+      zMapLogMessage("Merged %d features from source of %s%s: %d featuresets moved, %d merged, in %g secs",
+                     merge_stats->features_added,
+                     (connect_data->feature_sets
+                      ? g_quark_to_string(GPOINTER_TO_UINT(connect_data->feature_sets->data)) : "<no featuresets>"),
+                     ((connect_data->feature_sets && connect_data->feature_sets->next) ? ",..." : ""),
+                     merge_stats->featuresets_moved, merge_stats->featuresets_merged,
+                     merge_stats->merge_secs) ;
+
       g_free(merge_stats) ;
 
 
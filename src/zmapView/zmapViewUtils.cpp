@@ -311,6 +311,7 @@ gboolean zMapViewSessionGetAsText(ZMapViewWindow view_window, GString *session_s
 {
   gboolean result = FALSE ;
   ZMapView view ;
+  ZMapFeatureIDStatsStruct id_stats ;
 
   view = view_window->parent_view ;
 
@@ -320,6 +321,14 @@ gboolean zMapViewSessionGetAsText(ZMapViewWindow view_window, GString *session_s
 
       g_list_foreach(view->connection_list, formatSession, session_str_inout) ;
 
+      /* The ids are shared by all views so this is for the whole session. */
+      zMapFeatureIDGetStats(&id_stats) ;
+
+      g_string_append_printf(session_str_inout,
+                             "\tFeature IDs: %" G_GINT64_FORMAT " interned, %" G_GINT64_FORMAT " string bytes, "
+                             "~%" G_GINT64_FORMAT " table bytes\n\n",
+                             id_stats.num_ids, id_stats.string_bytes, id_stats.table_bytes) ;
+
       result = TRUE ;
     }
 
@@ -210,7 +210,8 @@ typedef struct _ZMapViewStruct
 
   gulong map_event_handler ;				    /* map event handler id for xremote widget. */
 
-  guint idle_handle ;
+  guint idle_handle ;                                       /* Backstop timer for connection checking. */
+  ZMapThreadNotify thread_notify ;                          /* Threads wake us via this when they reply. */
 
   void *app_data ;					    /* Passed back to caller from view
 							       callbacks. */
@@ -428,8 +429,6 @@ void zmapViewEraseFeatures(ZMapView view, ZMapFeatureContext context, GList **fe
 /* zmapViewFeatureMask.c */
 GList *zMapViewMaskFeatureSets(ZMapView view, GList *feature_set_names);
 
-gboolean zMapViewCollapseFeatureSets(ZMapView view, ZMapFeatureContext diff_context);
-
 /* zmapViewScratch.c */
 void zmapViewScratchInit(ZMapView zmap_view,
                          ZMapFeatureSequenceMap sequence, ZMapFeatureContext context, ZMapFeatureBlock block);
@@ -41,6 +41,32 @@
 #include <zmapWindowCanvasFeature_I.hpp>
 
 
+/* Features are allocated from chunks owned by their featureset, small featuresets get small
+ * chunks and the chunk size doubles up to N_FEAT_ALLOC. */
+#define FEATURE_POOL_FIRST_CHUNK 16
+
+
+/* Overlays a freed feature to chain it on its pool's free list. */
+typedef struct FreeFeatureStructType
+{
+  zmapWindowCanvasFeatureType type ;
+  struct FreeFeatureStructType *next ;
+} FreeFeatureStruct, *FreeFeature ;
+
+
+typedef struct ZMapWindowCanvasFeaturePoolStructType
+{
+  GPtrArray *chunks ;                                       /* All the memory, freed with the pool. */
+
+  FreeFeature free_list[FEATURE_N_TYPE] ;
+
+  int next_chunk_size[FEATURE_N_TYPE] ;
+
+} ZMapWindowCanvasFeaturePoolStruct ;
+
+
+
+static size_t featureSize(zmapWindowCanvasFeatureType type) ;
 static void freeSplicePosCB(gpointer data, gpointer user_data_unused) ;
 
 
@@ -111,57 +137,50 @@ void zMapWindowCanvasFeatureSetSize(int featuretype, gpointer *feature_funcs, si
 
 
 
-/* allocate a free list for an unknown structure */
-ZMapWindowCanvasFeature zMapWindowCanvasFeatureAlloc(zmapWindowCanvasFeatureType type)
+/* Allocates a zeroed feature of the given type from the featureset's pool. */
+ZMapWindowCanvasFeature zMapWindowCanvasFeatureAlloc(ZMapWindowCanvasFeaturePool pool, zmapWindowCanvasFeatureType type)
 {
   ZMapWindowCanvasFeature feat = NULL ;
 
-  /* WARNING...THIS CODE IS QUITE HARD TO FATHOM/FOLLOW... */
+  zMapReturnValIfFail(pool && feature_class_G, feat) ;
 
   if (type > FEATURE_INVALID && type < FEATURE_N_TYPE)
     {
-      GList *l = NULL ;
-      size_t size = feature_class_G->struct_size[type] ;
+      size_t size = featureSize(type) ;
 
-      if (!feature_class_G->feature_free_list[type])
+      if (!pool->free_list[type])
         {
+          int n_feats ;
+          char *mem ;
           int i ;
-          ZMapWindowCanvasFeature mem = NULL ;
-          mem = (ZMapWindowCanvasFeature) g_malloc0(size * N_FEAT_ALLOC) ;
 
-          if (mem)
-            {
-              for (i = 0 ; i < N_FEAT_ALLOC ; ++i)
-                {
-                  feat = (ZMapWindowCanvasFeature)mem ;
-                  feat->type = type ;
-                  feat->feature = NULL ;
-                  zmapWindowCanvasFeatureFree((gpointer)mem) ;
-                  mem = (ZMapWindowCanvasFeature) ((size_t)mem + size ) ;
-                }
-              ++n_block_alloc ;
-            }
-        }
+          if (!(n_feats = pool->next_chunk_size[type]))
+            n_feats = FEATURE_POOL_FIRST_CHUNK ;
+          pool->next_chunk_size[type] = MIN(n_feats * 2, N_FEAT_ALLOC) ;
 
-      l = feature_class_G->feature_free_list[type] ;
+          mem = (char *)g_malloc(size * n_feats) ;
+          g_ptr_array_add(pool->chunks, mem) ;
 
-      if (l)
-        {
-          feat = (ZMapWindowCanvasFeature)l->data ;
+          /* Chain from the end so features come off in address order. */
+          for (i = n_feats - 1 ; i >= 0 ; i--)
+            {
+              FreeFeature free_feat = (FreeFeature)(mem + (i * size)) ;
 
-          feature_class_G->feature_free_list[type]
-            = g_list_delete_link(feature_class_G->feature_free_list[type], l) ;
+              free_feat->type = type ;
+              free_feat->next = pool->free_list[type] ;
+              pool->free_list[type] = free_feat ;
+            }
 
-          /* GOODNESS ME....THIS SEEMS TO REZERO SOMETHING WE INIT'D ABOVE.... */
-          /* these can get re-allocated so must zero */
-          memset((void*)feat, 0, size) ;
+          ++n_block_alloc ;
+        }
 
-          /* AND NOW WE RESET THE TYPE....STREUTH..... */
-          feat->type = type ;
-          feat->feature = NULL ;
+      feat = (ZMapWindowCanvasFeature)(pool->free_list[type]) ;
+      pool->free_list[type] = pool->free_list[type]->next ;
 
-          ++n_feature_alloc ;
-        }
+      memset((void*)feat, 0, size) ;
+      feat->type = type ;
+
+      ++n_feature_alloc ;
     }
 
   return feat ;
@@ -597,22 +616,47 @@ gint zMapFeatureSetNameCmp(gconstpointer a, gconstpointer b)
  */
 
 
-/* need to be a ZMapSkipListFreeFunc for use as a callback */
-void zmapWindowCanvasFeatureFree(gpointer thing)
+ZMapWindowCanvasFeaturePool zmapWindowCanvasFeaturePoolCreate(void)
+{
+  ZMapWindowCanvasFeaturePool pool ;
+
+  pool = g_new0(ZMapWindowCanvasFeaturePoolStruct, 1) ;
+  pool->chunks = g_ptr_array_new_with_free_func(g_free) ;
+
+  return pool ;
+}
+
+
+/* Frees all the pool's features in one go, they must not be referenced afterwards. */
+void zmapWindowCanvasFeaturePoolDestroy(ZMapWindowCanvasFeaturePool pool)
+{
+  if (pool)
+    {
+      g_ptr_array_free(pool->chunks, TRUE) ;
+
+      g_free(pool) ;
+    }
+
+  return ;
+}
+
+
+/* Returns a feature to the pool it was allocated from for reuse. */
+void zmapWindowCanvasFeatureFree(ZMapWindowCanvasFeaturePool pool, gpointer thing)
 {
   ZMapWindowCanvasFeature feat = NULL ;
+  FreeFeature free_feat ;
   zmapWindowCanvasFeatureType type ;
 
-  zMapReturnIfFail(thing && feature_class_G) ;
+  zMapReturnIfFail(pool && thing) ;
 
   feat = (ZMapWindowCanvasFeature) thing ;
   type = feat->type ;
 
-  if(!feature_class_G->struct_size[type])
-    type = FEATURE_INVALID ;                /* catch all for simple features */
-
-  feature_class_G->feature_free_list[type] =
-    g_list_prepend(feature_class_G->feature_free_list[type], thing) ;
+  free_feat = (FreeFeature)thing ;
+  free_feat->type = type ;
+  free_feat->next = pool->free_list[type] ;
+  pool->free_list[type] = free_feat ;
 
   n_feature_free++ ;
 }
@@ -624,6 +668,18 @@ void zmapWindowCanvasFeatureFree(gpointer thing)
  */
 
 
+/* Types without their own struct are just the base struct. */
+static size_t featureSize(zmapWindowCanvasFeatureType type)
+{
+  size_t size ;
+
+  if (!(size = feature_class_G->struct_size[type]))
+    size = feature_class_G->struct_size[FEATURE_INVALID] ;
+
+  return size ;
+}
+
+
 static void freeSplicePosCB(gpointer data, gpointer user_data_unused)
 {
   ZMapSplicePosition splice_pos = (ZMapSplicePosition)data ; /* for debugging. */
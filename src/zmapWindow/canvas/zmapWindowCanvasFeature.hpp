@@ -75,11 +75,14 @@ typedef struct ZMapWindowCanvasFeatureClassStructType *ZMapWindowCanvasFeatureCl
 /* ZMapWindowCanvasFeature instance struct. */
 typedef struct _zmapWindowCanvasFeatureStruct *ZMapWindowCanvasFeature ;
 
+/* Storage for a featureset's canvas features, freed with the featureset. */
+typedef struct ZMapWindowCanvasFeaturePoolStructType *ZMapWindowCanvasFeaturePool ;
+
 
 
 void zMapWindowCanvasFeatureInit(void) ;
 void zMapWindowCanvasFeatureSetSize(int featuretype, gpointer *feature_funcs, size_t feature_struct_size) ;
-ZMapWindowCanvasFeature zMapWindowCanvasFeatureAlloc(zmapWindowCanvasFeatureType type) ;
+ZMapWindowCanvasFeature zMapWindowCanvasFeatureAlloc(ZMapWindowCanvasFeaturePool pool, zmapWindowCanvasFeatureType type) ;
 ZMapFeature zMapWindowCanvasFeatureGetFeature(ZMapWindowCanvasFeature feature) ;
 gboolean zMapWindowCanvasFeatureGetFeatureExtent(ZMapWindowCanvasFeature feature, gboolean is_complex,
                                                  ZMapSpan span, double *width) ;
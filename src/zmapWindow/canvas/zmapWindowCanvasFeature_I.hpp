@@ -56,8 +56,6 @@ typedef struct ZMapWindowCanvasFeatureClassStructType
 {
   size_t struct_size[FEATURE_N_TYPE];
 
-  GList *feature_free_list[FEATURE_N_TYPE] ;
-
 } ZMapWindowCanvasFeatureClassStruct ;
 
 
@@ -142,7 +140,9 @@ typedef struct _zmapWindowCanvasFeatureStruct
 
 
 
-void zmapWindowCanvasFeatureFree(gpointer thing) ;
+ZMapWindowCanvasFeaturePool zmapWindowCanvasFeaturePoolCreate(void) ;
+void zmapWindowCanvasFeaturePoolDestroy(ZMapWindowCanvasFeaturePool pool) ;
+void zmapWindowCanvasFeatureFree(ZMapWindowCanvasFeaturePool pool, gpointer thing) ;
 
 
 
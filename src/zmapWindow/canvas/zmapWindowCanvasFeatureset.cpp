@@ -122,6 +122,10 @@ static double graphicsPoint(ZMapWindowFeaturesetItem fi, ZMapWindowCanvasFeature
 static void setFeaturesetColours(ZMapWindowFeaturesetItem featureset, ZMapWindowCanvasFeature feature);
 
 static void featuresetAddToIndex(ZMapWindowFeaturesetItem featureset_item, ZMapWindowCanvasFeature feat) ;
+static void displayIndexCreate(ZMapWindowFeaturesetItem fi, GPtrArray *features) ;
+static ZMapSkipList displayIndexFind(ZMapWindowFeaturesetItem fi, FeatureCmpFunc compare_func,
+                                     zmapWindowCanvasFeatureStruct *search, double y1) ;
+static void displayIndexDestroy(ZMapWindowFeaturesetItem fi) ;
 
 static ZMapSkipList zmap_window_canvas_featureset_find_feature_index(ZMapWindowFeaturesetItem fi,ZMapFeature feature);
 static ZMapWindowCanvasFeature zmap_window_canvas_featureset_find_feature(ZMapWindowFeaturesetItem fi,
@@ -141,6 +145,7 @@ void zmap_window_canvas_featureset_expose_feature(ZMapWindowFeaturesetItem fi, Z
 static guint32 gdk_color_to_rgba(GdkColor *color) ;
 
 static void itemLinkSideways(ZMapWindowFeaturesetItem fi) ;
+static gint featurePtrCmp(gconstpointer a, gconstpointer b, gpointer user_data) ;
 #if NOT_USED
 static gint setNameCmp(gconstpointer a, gconstpointer b) ;
 #endif
@@ -887,7 +892,7 @@ void zMapWindowCanvasFeaturesetPaintFlush(ZMapWindowFeaturesetItem featureset, Z
 /* Dump to screen information about all the features  */
 void zmapWindowCanvasFeaturesetDumpFeatures(ZMapWindowFeaturesetItem featureset)
 {
-  g_list_foreach(featureset->features, printCanvasFeature, NULL) ;
+  g_ptr_array_foreach(featureset->features, printCanvasFeature, NULL) ;
 
   return ;
 }
@@ -1250,7 +1255,7 @@ void  zmap_window_featureset_item_item_bounds (FooCanvasItem *item, double *x1,
 
 void zMapWindowCanvasFeaturesetIndex(ZMapWindowFeaturesetItem fi)
 {
-  GList *features;
+  GPtrArray *features;
 
   zMapReturnIfFail(fi) ;
 
@@ -1269,14 +1274,14 @@ void zMapWindowCanvasFeaturesetIndex(ZMapWindowFeaturesetItem fi)
   if (!fi->features_sorted)
     {
       //printf("sort index\n");
-      fi->features = g_list_sort(fi->features, zMapWindowFeatureCmp) ;
+      zmapWindowCanvasFeaturesetSortFeatures(fi->features, zMapWindowFeatureCmp) ;
       fi->features_sorted = TRUE;
     }
 
   if (!features)                                /* was not pre-processed */
     features = fi->features;
 
-  fi->display_index = zMapSkipListCreate(features, NULL) ;
+  displayIndexCreate(fi, features) ;
 
   return ;
 }
@@ -2033,7 +2038,7 @@ static ZMapSkipList zmap_window_canvas_featureset_find_feature_coords(FeatureCmp
       //                search.y1 = fi->start;
     }
 
-  sl =  zMapSkipListFind(fi->display_index, compare_func, &search) ;
+  sl = displayIndexFind(fi, compare_func, &search, y1) ;
   //        if(sl->prev)
   //                sl = sl->prev;        /* in case of not exact match when rebinned... done by SkipListFind */
 
@@ -2846,6 +2851,16 @@ void zMapWindowFeaturesetFreeGroupedFeatures(GList *grouped_features)
 
 
 
+/* Sorts an array of canvas features in place with a compare func written for GList's. */
+void zmapWindowCanvasFeaturesetSortFeatures(GPtrArray *features, GCompareFunc compare_func)
+{
+  if (features)
+    g_ptr_array_sort_with_data(features, featurePtrCmp, (gpointer)compare_func) ;
+
+  return ;
+}
+
+
 /* I'm not sure how closely ->display and ->display_index are linked, if the first exists does
  * the second ? or vice versa ?......would affect how this function is coded. */
 gboolean zmapWindowCanvasFeaturesetFreeDisplayLists(ZMapWindowFeaturesetItem featureset_item_inout)
@@ -2854,21 +2869,22 @@ gboolean zmapWindowCanvasFeaturesetFreeDisplayLists(ZMapWindowFeaturesetItem fea
 
   if (featureset_item_inout->display_index)
     {
-      zMapSkipListDestroy(featureset_item_inout->display_index, NULL) ;
-      featureset_item_inout->display_index = NULL ;
+      displayIndexDestroy(featureset_item_inout) ;
       featureset_item_inout->curr_item = NULL ;
 
       if (featureset_item_inout->display)
         {
-          GList  *features ;
+          guint i ;
 
-          for (features = featureset_item_inout->display ; features ;
-               features = g_list_delete_link(features, features))
+          for (i = 0 ; i < featureset_item_inout->display->len ; i++)
             {
-              ZMapWindowCanvasFeature feat = (ZMapWindowCanvasFeature)features->data ;
+              ZMapWindowCanvasFeature feat
+                = (ZMapWindowCanvasFeature)g_ptr_array_index(featureset_item_inout->display, i) ;
 
-              zmapWindowCanvasFeatureFree(feat) ;
+              zmapWindowCanvasFeatureFree(featureset_item_inout->feature_pool, feat) ;
             }
+
+          g_ptr_array_free(featureset_item_inout->display, TRUE) ;
           featureset_item_inout->display = NULL ;
         }
 
@@ -2926,8 +2942,7 @@ gboolean zMapWindowFeaturesetItemSetStyle(ZMapWindowFeaturesetItem featureset_it
 #ifdef ED_G_NEVER_INCLUDE_THIS_CODE
   if (featureset_item->display_index && re_index)
     {
-      zMapSkipListDestroy(featureset_item->display_index, NULL);
-      featureset_item->display_index = NULL;
+      displayIndexDestroy(featureset_item) ;
       featureset_item->curr_item = NULL ;
 
 
@@ -3195,6 +3210,8 @@ static void zmap_window_featureset_item_set_colour(ZMapWindowCanvasItem   item,
 /* Called for each new featureset (== column ??), gosh what happens here.... */
 static void zmap_window_featureset_item_item_init(ZMapWindowFeaturesetItem featureset)
 {
+  featureset->feature_pool = zmapWindowCanvasFeaturePoolCreate() ;
+  featureset->features = g_ptr_array_new() ;
 
   return ;
 }
@@ -3811,7 +3828,7 @@ ZMapWindowCanvasFeature zMapWindowFeaturesetAddFeature(ZMapWindowFeaturesetItem
       if(type == FEATURE_INVALID)                /* no style or feature type not implemented */
         return NULL;
 
-      feat = zMapWindowCanvasFeatureAlloc(type);
+      feat = zMapWindowCanvasFeatureAlloc(featureset_item->feature_pool, type);
 
       feat->feature = feature;
       feat->type = type;
@@ -3877,25 +3894,22 @@ int zMapWindowFeaturesetItemRemoveFeature(FooCanvasItem *foo, ZMapFeature featur
   fi = (ZMapWindowFeaturesetItem) foo ;
 
 #if 1 // ORIGINAL_SLOW_VERSION
-  GList *l;
   ZMapWindowCanvasFeature feat;
+  gboolean done = FALSE ;
+  guint i, n ;
 
-  for(l = fi->features;l;)
+  /* Remove in one pass, the kept features are moved down so the array stays in order. */
+  for (i = 0, n = 0 ; i < fi->features->len ; i++)
     {
-      GList *del;
-
-      feat = (ZMapWindowCanvasFeature) l->data;
+      feat = (ZMapWindowCanvasFeature)g_ptr_array_index(fi->features, i) ;
 
-      if(zmapWindowCanvasFeatureValid(feat) && feat->feature == feature)
+      if(!done && zmapWindowCanvasFeatureValid(feat) && feat->feature == feature)
         {
-          /* NOTE the features list and display index both point to the same structs */
+          /* NOTE the features array and display index both point to the same structs */
 
           zmap_window_canvas_featureset_expose_feature(fi, feat);
 
-          zmapWindowCanvasFeatureFree(feat);
-          del = l;
-          l = l->next;
-          fi->features = g_list_delete_link(fi->features,del);
+          zmapWindowCanvasFeatureFree(fi->feature_pool, feat);
           fi->n_features--;
 
           /*! \todo #warning review this (feature remove) */
@@ -3903,15 +3917,17 @@ int zMapWindowFeaturesetItemRemoveFeature(FooCanvasItem *foo, ZMapFeature featur
           // and that does not give us the features list instsead the canvasfeature structs so no workee
           // perhaps the ultimate caller calls several times??
           if(fi->link_sideways)        /* we'll get calls for each sub-feature */
-            break;
-          /* else have to go through the whole list; fortunately transcripts are low volume */
+            done = TRUE ;
+          /* else have to go through the whole array; fortunately transcripts are low volume */
         }
       else
         {
-          l = l->next;
+          g_ptr_array_index(fi->features, n++) = feat ;
         }
     }
 
+  g_ptr_array_set_size(fi->features, n) ;
+
   /* NOTE we may not have an index so this flag must be unset seperately */
   fi->linked_sideways = FALSE;  /* See code below: this was slack */
 
@@ -3951,8 +3967,7 @@ int zMapWindowFeaturesetItemRemoveFeature(FooCanvasItem *foo, ZMapFeature featur
     {
       /* need to recalc bins */
       /* quick fix FTM, de-calc which requires a re-calc on display */
-      zMapSkipListDestroy(fi->display_index, NULL);
-      fi->display_index = NULL;
+      displayIndexDestroy(fi) ;
       fi->curr_item = NULL ;
 
       /* is still sorted if it was before */
@@ -3973,40 +3988,24 @@ int zMapWindowFeaturesetGetNumFeatures(ZMapWindowFeaturesetItem featureset_item)
 void zMapWindowFeaturesetRemoveAllGraphics(ZMapWindowFeaturesetItem featureset_item )
 {
 
-  GList *l;
   ZMapWindowCanvasFeature feat;
+  guint i ;
 
-  if (featureset_item->features)
+  for (i = 0 ; i < featureset_item->features->len ; i++)
     {
-
-  for(l = featureset_item->features; l ; )
-    {
-      //GList *del;
-
-      feat = (ZMapWindowCanvasFeature) l->data;
+      feat = (ZMapWindowCanvasFeature)g_ptr_array_index(featureset_item->features, i) ;
 
       if(zmapWindowCanvasFeatureValid(feat))
         {
-          /* NOTE the features list and display index both point to the same structs */
+          /* NOTE the features array and display index both point to the same structs */
 
           //zmap_window_canvas_featureset_expose_feature(fi, feat);
 
-          zmapWindowCanvasFeatureFree(feat);
-          //del = l;
-          l = l->next;
-          //fi->features = g_list_delete_link(fi->features,del);
-          //fi->n_features--;
-        }
-      else
-        {
-          l = l->next;
+          zmapWindowCanvasFeatureFree(featureset_item->feature_pool, feat);
         }
     }
 
-  g_list_free(featureset_item->features) ;
-  featureset_item->features = NULL ;
-
-    }
+  g_ptr_array_set_size(featureset_item->features, 0) ;
 
    if(featureset_item->display_index)
     {
@@ -4033,7 +4032,7 @@ ZMapWindowCanvasGraphics zMapWindowFeaturesetAddGraphics(ZMapWindowFeaturesetIte
   if (type == FEATURE_INVALID || type < FEATURE_GRAPHICS)
     return NULL;
 
-  feat = (ZMapWindowCanvasGraphics)zMapWindowCanvasFeatureAlloc(type);
+  feat = (ZMapWindowCanvasGraphics)zMapWindowCanvasFeatureAlloc(featureset_item->feature_pool, type);
 
   feat->type = type;
 
@@ -4089,8 +4088,7 @@ int zMapWindowFeaturesetRemoveGraphics(ZMapWindowFeaturesetItem featureset_item,
     {
       /* need to recalc bins */
       /* quick fix FTM, de-calc which requires a re-calc on display */
-      zMapSkipListDestroy(fi->display_index, NULL);
-      fi->display_index = NULL;
+      displayIndexDestroy(fi) ;
       fi->curr_item = NULL ;
 
       /* is still sorted if it was before */
@@ -4119,15 +4117,13 @@ int zMapWindowFeaturesetItemRemoveSet(FooCanvasItem *foo, ZMapFeatureSet feature
   if(!ZMAP_IS_WINDOW_FEATURESET_ITEM(foo))
     return 0;
 #if 1
-  GList *l;
   ZMapWindowCanvasFeature feat = NULL ;
   ZMapFeatureSet f_set = NULL ;
+  guint i, n ;
 
-  for (l = fi->features;l;)
+  for (i = 0, n = 0 ; i < fi->features->len ; i++)
     {
-      GList *del;
-
-      feat = (ZMapWindowCanvasFeature) l->data;
+      feat = (ZMapWindowCanvasFeature)g_ptr_array_index(fi->features, i) ;
 
       if (zmapWindowCanvasFeatureValid(feat))
         {
@@ -4135,27 +4131,22 @@ int zMapWindowFeaturesetItemRemoveSet(FooCanvasItem *foo, ZMapFeatureSet feature
 
           if (f_set == featureset)
             {
-              /* NOTE the features list and display index both point to the same structs */
+              /* NOTE the features array and display index both point to the same structs */
 
               zmap_window_canvas_featureset_expose_feature(fi, feat);
 
-              zmapWindowCanvasFeatureFree(feat);
-              del = l;
-              l = l->next;
-              fi->features = g_list_delete_link(fi->features,del);
+              zmapWindowCanvasFeatureFree(fi->feature_pool, feat);
               fi->n_features--;
+
+              continue ;
             }
-          else
-            {
-              l = l->next;
-            }
-        }
-      else
-        {
-          l = l->next;
         }
+
+      g_ptr_array_index(fi->features, n++) = feat ;
     }
 
+  g_ptr_array_set_size(fi->features, n) ;
+
   /* NOTE we may not have an index so this flag must be unset seperately */
   fi->linked_sideways = FALSE;  /* See code below: this was slack */
 
@@ -4196,8 +4187,7 @@ int zMapWindowFeaturesetItemRemoveSet(FooCanvasItem *foo, ZMapFeatureSet feature
     {
       /* need to recalc bins */
       /* quick fix FTM, de-calc which requires a re-calc on display */
-      zMapSkipListDestroy(fi->display_index, NULL);
-      fi->display_index = NULL;
+      displayIndexDestroy(fi) ;
       fi->curr_item = NULL ;
 
       /* is still sorted if it was before */
@@ -4273,14 +4263,79 @@ void zMapWindowCanvasFeaturesetGetFeatureBounds(FooCanvasItem *foo,
  */
 
 
-static void featuresetAddToIndex(ZMapWindowFeaturesetItem featureset_item, ZMapWindowCanvasFeature feat)
+/* The display index is either a skip list or a sorted array of skip list nodes, either way
+ * fi->display_index is the head and callers can walk it with sl->next. */
+static void displayIndexCreate(ZMapWindowFeaturesetItem fi, GPtrArray *features)
 {
-  /* even if they come in order we still have to sort them to be sure so just add to the front */
-  /* NOTE we asign the from pointer here: not just more efficient if we have eg 60k features but essential to prepend */
-  //  feat->from =
-  // only for feature not graphics, from does not work anyway
+#if CANVAS_FEATURESET_SORTED_INDEX
+  /* display_index may have been dropped without destroying it. */
+  zmapWindowCanvasSortedIndexDestroy(fi->sorted_index) ;
 
-  featureset_item->features = g_list_prepend(featureset_item->features,feat);
+  fi->sorted_index = zmapWindowCanvasSortedIndexCreate(features) ;
+  fi->display_index = zmapWindowCanvasSortedIndexHead(fi->sorted_index) ;
+#else
+  GList *feature_list = NULL ;
+  int i ;
+
+  for (i = (int)features->len - 1 ; i >= 0 ; i--)
+    feature_list = g_list_prepend(feature_list, g_ptr_array_index(features, i)) ;
+
+  fi->display_index = zMapSkipListCreate(feature_list, NULL) ;
+
+  g_list_free(feature_list) ;
+#endif
+
+  return ;
+}
+
+
+/* search->y1 has already been moved back to allow for overlapping features, y1 is the original
+ * start coord which the sorted index can use to find exactly the first feature that may
+ * overlap it. */
+static ZMapSkipList displayIndexFind(ZMapWindowFeaturesetItem fi, FeatureCmpFunc compare_func,
+                                     zmapWindowCanvasFeatureStruct *search, double y1)
+{
+  ZMapSkipList sl = NULL ;
+
+#if CANVAS_FEATURESET_SORTED_INDEX
+  if (fi->overlap && !fi->bumped && fi->style->mode != ZMAPSTYLE_MODE_GLYPH
+      && compare_func == zMapWindowFeatureCmp)
+    {
+      /* never starts later than the y1 - longest search would */
+      if (!(sl = zmapWindowCanvasSortedIndexFindOverlap(fi->sorted_index, y1)))
+        sl = zmapWindowCanvasSortedIndexFind(fi->sorted_index, compare_func, search) ;
+    }
+  else
+    {
+      sl = zmapWindowCanvasSortedIndexFind(fi->sorted_index, compare_func, search) ;
+    }
+#else
+  sl = zMapSkipListFind(fi->display_index, compare_func, search) ;
+#endif
+
+  return sl ;
+}
+
+
+static void displayIndexDestroy(ZMapWindowFeaturesetItem fi)
+{
+#if CANVAS_FEATURESET_SORTED_INDEX
+  zmapWindowCanvasSortedIndexDestroy(fi->sorted_index) ;
+  fi->sorted_index = NULL ;
+#else
+  zMapSkipListDestroy(fi->display_index, NULL) ;
+#endif
+
+  fi->display_index = NULL ;
+
+  return ;
+}
+
+
+static void featuresetAddToIndex(ZMapWindowFeaturesetItem featureset_item, ZMapWindowCanvasFeature feat)
+{
+  /* even if they come in order we still have to sort them to be sure so just add to the end */
+  g_ptr_array_add(featureset_item->features, feat) ;
   featureset_item->n_features++;
 
 #if STYLE_DEBUG
@@ -4292,7 +4347,7 @@ static void featuresetAddToIndex(ZMapWindowFeaturesetItem featureset_item, ZMapW
       printf("add item %s %s @%p %p: %ld/%d style %p/%p %s\n",
              g_quark_to_string(featureset_item->id),g_quark_to_string(feature->unique_id),
              featureset, feature,
-             featureset_item->n_features, g_list_length(featureset_item->features),
+             featureset_item->n_features, featureset_item->features->len,
              featureset->style, *feature->style, g_quark_to_string(featureset->style->unique_id));
     }
 #endif
@@ -4308,8 +4363,7 @@ static void featuresetAddToIndex(ZMapWindowFeaturesetItem featureset_item, ZMapW
       {
         /* need to recalc bins */
         /* quick fix FTM, de-calc which requires a re-calc on display */
-        zMapSkipListDestroy(featureset_item->display_index, NULL) ;
-        featureset_item->display_index = NULL ;
+        displayIndexDestroy(featureset_item) ;
         featureset_item->curr_item = NULL ;
       }
     }
@@ -4424,7 +4478,7 @@ static void setFeaturesetColours(ZMapWindowFeaturesetItem fi, ZMapWindowCanvasFe
 /* revisit this when VULGAR alignments are implemented: call from zmapView code */
 static void itemLinkSideways(ZMapWindowFeaturesetItem fi)
 {
-  GList *l ;
+  guint i ;
   ZMapWindowCanvasFeature left, right ;                /* feat -ures */
   GQuark name ;
   ZMapFeatureTypeStyle style = fi->style ;
@@ -4432,7 +4486,7 @@ static void itemLinkSideways(ZMapWindowFeaturesetItem fi)
 
   zMapReturnIfFail(fi) ;
 
-  /* we use the featureset features list which sits there in parallel with the skip list (display index) */
+  /* we use the featureset features array which sits there in parallel with the skip list (display index) */
   /* sort by name and start coord */
   /* link same name features with ascending query start coord */
 
@@ -4452,9 +4506,9 @@ static void itemLinkSideways(ZMapWindowFeaturesetItem fi)
      id.....
   */
   if (sort_by_featureset)
-    fi->features = g_list_sort(fi->features, zMapFeatureSetNameCmp) ;
+    zmapWindowCanvasFeaturesetSortFeatures(fi->features, zMapFeatureSetNameCmp) ;
   else
-    fi->features = g_list_sort(fi->features, zMapFeatureNameCmp) ;
+    zmapWindowCanvasFeaturesetSortFeatures(fi->features, zMapFeatureNameCmp) ;
 
 
 #ifdef ED_G_NEVER_INCLUDE_THIS_CODE
@@ -4470,11 +4524,11 @@ static void itemLinkSideways(ZMapWindowFeaturesetItem fi)
 
   /* THIS ALSO NEEDS RECODING.... */
 
-  for (l = fi->features, name = 0 ; l ; l = l->next)
+  for (i = 0, name = 0 ; i < fi->features->len ; i++)
     {
       GQuark feat_name ;
 
-      right = (ZMapWindowCanvasFeature)(l->data) ;
+      right = (ZMapWindowCanvasFeature)g_ptr_array_index(fi->features, i) ;
 
       /* HOW CAN THIS HAPPEN....WHAT CAUSES SOMETHING NOT TO BE VALID... */
       if (!zmapWindowCanvasFeatureValid(right))
@@ -4613,8 +4667,6 @@ static double graphicsPoint(ZMapWindowFeaturesetItem fi, ZMapWindowCanvasFeature
 static void zmap_window_featureset_item_item_destroy (GtkObject *object)
 {
   ZMapWindowFeaturesetItem featureset_item;
-  GList *features;
-  ZMapWindowCanvasFeature feat;
 
   /* mh17 NOTE: this function gets called twice for every object via a very very tall stack */
   /* no idea why, but this is all harmless here if we make sure to test if pointers are valid */
@@ -4649,37 +4701,32 @@ static void zmap_window_featureset_item_item_destroy (GtkObject *object)
 
       if(featureset_item->display_index)
         {
-          zMapSkipListDestroy(featureset_item->display_index, NULL);
-          featureset_item->display_index = NULL;
+          displayIndexDestroy(featureset_item) ;
           featureset_item->features_sorted = FALSE;
           featureset_item->curr_item = NULL ;
         }
+      /* the features themselves all go with the pool below. */
       if(featureset_item->display)        /* was re-binned */
         {
-          for(features = featureset_item->display; features; features = g_list_delete_link(features,features))
-            {
-              feat = (ZMapWindowCanvasFeature) features->data;
-              zmapWindowCanvasFeatureFree(feat);
-            }
+          g_ptr_array_free(featureset_item->display, TRUE) ;
           featureset_item->display = NULL;
         }
 
       if(featureset_item->features)
         {
-          /* free items separately from the index as conceivably we may not have an index */
-          for(features = featureset_item->features; features; features = g_list_delete_link(features,features))
-            {
-              feat = (ZMapWindowCanvasFeature) features->data;
-              zmapWindowCanvasFeatureFree(feat);
-            }
+          g_ptr_array_free(featureset_item->features, TRUE) ;
           featureset_item->features = NULL;
           featureset_item->n_features = 0;
         }
 
-      // printf("featureset %s: %ld %ld %ld,\n",g_quark_to_string(featureset_item->id), n_block_alloc, n_feature_alloc, n_feature_free);
-
       zMapWindowCanvasFeaturesetFree(featureset_item);        /* must tidy optional set data*/
 
+      zmapWindowCanvasFeaturePoolDestroy(featureset_item->feature_pool) ;
+      featureset_item->feature_pool = NULL ;
+
+      zmapWindowCanvasBumpCacheDestroy(featureset_item->bump_cache) ;
+      featureset_item->bump_cache = NULL ;
+
       if(featureset_item->opt)
         {
           g_free(featureset_item->opt);
@@ -4704,6 +4751,16 @@ static void zmap_window_featureset_item_item_destroy (GtkObject *object)
 
 
 
+/* g_ptr_array sort funcs get pointers to the array elements. */
+static gint featurePtrCmp(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  GCompareFunc compare_func = (GCompareFunc)user_data ;
+
+  return compare_func(*(gconstpointer *)a, *(gconstpointer *)b) ;
+}
+
+
+
 static guint32 gdk_color_to_rgba(GdkColor *color)
 {
   guint32 rgba = 0;
@@ -35,6 +35,11 @@
 #include <math.h>
 #include <string.h>
 
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
 #include <ZMap/zmapUtilsLog.hpp>
 #include <ZMap/zmapUtilsDebug.hpp>
 #include <ZMap/zmapSkipList.hpp>
@@ -82,105 +87,67 @@
   10k features: traditional bump in 0.838 seconds	(64x)
   30k features: traditional bump on 8.936 seconds	(135x)
   100k features: tradtional bump in 329.828 seconds (445x)
+
+  The list of sub-column ranges above was still O(n**2) in the worst case (one feature per
+  column) so overlap bumping is now a sweep down the features keeping the busy sub-columns
+  in a min-heap of their end coords and the free ones in a min-heap of column numbers,
+  which gives exactly the same columns (lowest free column first) in O(n log n).
 */
 
 #define MODULE_STATS	0	/* NOTE this is for BUMP_OVERLAP, colinear is BUMP_ALL */
 
-#define SLOW_BUT_EASY	0	/* 30% quicker if not */
-
 
 
-typedef struct BumpColRangeStructName
+/* A feature (or complex feature) to be put in a sub-column by an overlap or featureset name
+ * bump, they are collected in display index order. */
+typedef struct BumpPlacementStructName
 {
-#if !SLOW_BUT_EASY
-
-  /* NOTE we don't use GList add/delete_link as that inolves an extra alloc and free for each list item */
-  GList link;
-
-  /* NOTE also that using a GList struct here does not save a whole heap of work */
-#endif
-
+  ZMapWindowCanvasFeature feature ;
 
   /* extent of a feature - may be simple or complex */
   ZMapSpanStruct span ;
+  double width ;
 
   /* feature set id...we can also bump by feature set....assume no overlap.... */
   GQuark featureset_unique_id ;
 
-  /* must use this as it's defined in zmapFeature,h */
-  double offset ;			/* bump offset for sub column */
-  double width;
-  int column;			/* which one */
-
-} BumpColRangeStruct, *BumpColRange ;
-
-
-#if SLOW_BUT_EASY
-//typedef  struct Glist *BCR;
-#define BCR GList *
+  int column ;				/* which one */
 
-#define bump_col_range_alloc() g_new0(BumpColRangeStruct,1)
-#define bump_col_range_freet(x) g_free(x)
+} BumpPlacementStruct, *BumpPlacement ;
 
-/* NOTE we expect an assignment left of these #defines; take care woth these macros */
-#define bump_col_range_delete(glist, link, bcr)	g_list_delete_link(glist, link);  g_free(bcr);
-#define bump_col_range_insert(glist, link, bcr)	g_list_insert_before(glist, link, bcr);
-
-#define BCR_NEXT(x) 	(x->next)
-#define BCR_DATA(x)	((BumpColRange) x->data)
-
-
-#else /* !SLOW_BUT_EASY */
-
-
-#define N_BUMP_COL_RANGE_ALLOC	1000	/* we expect to bump 10-200k features, normally 1-20k */
-
-#define BCR_NEXT(x) 	((BumpColRange) x->link.next)
-#define BCR_DATA(x)	(x)
-
-/* item and bcr are both the same BumpColRangeStruct, link may be as well but not always */
-#define bump_col_range_delete(glist,item,bcr) \
-  (BumpColRange) g_list_remove_link(&glist->link,&item->link);  bump_col_range_free(bcr)
-
-
-typedef BumpColRange BCR;
 
+/* The last overlap/featureset name layout of a featureset, if the next bump has the same
+ * features with the same extents then the columns are reused rather than recalculated,
+ * e.g. when a column is rebumped after zooming or a style change that doesn't move features. */
+typedef struct ZMapWindowCanvasBumpCacheStructType
+{
+  ZMapStyleBumpMode bump_mode ;
+  GArray *placements ;			/* BumpPlacementStruct */
+  GArray *col_widths ;			/* double, widest feature in each sub-column */
+  GArray *col_names ;			/* GQuark, featureset name bumping only */
+} ZMapWindowCanvasBumpCacheStruct ;
 
-static BumpColRange bump_col_range_alloc(void) ;
-static BumpColRange bump_col_range_insert(BumpColRange alist, BumpColRange link, BumpColRange bcr) ;
-static BumpColRange bump_col_range_append(BumpColRange alist, BumpColRange last, BumpColRange bcr) ;
-static void bump_col_range_free(BumpColRange bcr) ;
 
-#endif
+/* Sub-column end coord and column number. */
+typedef std::pair<Coord, int> BumpColEnd ;
 
 
 
-static BCR calcBumpNoOverlap(ZMapWindowCanvasFeature feature,BumpFeatureset bump_data, BCR pos_list) ;
-static BCR calcBumpNoOverlapFeatureSet(ZMapWindowFeaturesetItem featureset, ZMapWindowCanvasFeature feature,
-                                       BumpFeatureset bump_data, BCR pos_list) ;
+static void bumpLayout(ZMapWindowFeaturesetItem featureset, ZMapStyleBumpMode bump_mode,
+                       GArray *placements, GArray *col_widths, GArray *col_names) ;
+static void calcBumpNoOverlap(GArray *placements, GArray *col_widths) ;
+static void calcBumpNoOverlapFeatureSet(GArray *placements, GArray *col_widths, GArray *col_names) ;
+static void setColWidth(GArray *col_widths, int column, double width) ;
+static gboolean bumpCacheGet(ZMapWindowFeaturesetItem featureset, ZMapStyleBumpMode bump_mode,
+                             GArray *placements, GArray *col_widths, GArray *col_names) ;
+static void bumpCacheSet(ZMapWindowFeaturesetItem featureset, ZMapStyleBumpMode bump_mode,
+                         GArray *placements, GArray *col_widths, GArray *col_names) ;
 
 static gboolean featureTestMark(ZMapWindowCanvasFeature feature, double start, double end) ;
 
 static void freeSubcolListCB(gpointer data, gpointer user_data) ;
 
 
-/*
- *                  Globals
- */
-
-#if !SLOW_BUT_EASY
-
-BumpColRange bump_col_range_free_G = NULL;
-
-GHashTable *sub_col_width_G = NULL;	 /* for complex overlap */
-
-GHashTable *sub_col_offset_G = NULL;
-
-GHashTable *sub_col_name_G = NULL ;
-
-#endif
-
-
 
 /*
  *                  External routines
@@ -209,9 +176,8 @@ gboolean zMapWindowCanvasFeaturesetBump(ZMapWindowFeaturesetItem featureset, ZMa
 {
   gboolean result = FALSE ;
   ZMapSkipList sl ;
-  BCR pos_list = NULL ;
-  BCR l ;
-  int n ;
+  GArray *placements = NULL, *col_widths = NULL, *col_names = NULL ;
+  guint n ;
 #if MODULE_STATS
   double time ;
 #endif
@@ -230,20 +196,9 @@ gboolean zMapWindowCanvasFeaturesetBump(ZMapWindowFeaturesetItem featureset, ZMa
 
   /* prepare */
 
-  if(!sub_col_width_G)
-    sub_col_width_G = g_hash_table_new(NULL,NULL);
-  else
-    g_hash_table_remove_all(sub_col_width_G);
-
-  if(!sub_col_offset_G)
-    sub_col_offset_G = g_hash_table_new(NULL,NULL);
-  else
-    g_hash_table_remove_all(sub_col_offset_G);
-
-  if(!sub_col_name_G)
-    sub_col_name_G = g_hash_table_new(NULL,NULL);
-  else
-    g_hash_table_remove_all(sub_col_name_G);
+  placements = g_array_new(FALSE, FALSE, sizeof(BumpPlacementStruct)) ;
+  col_widths = g_array_new(FALSE, TRUE, sizeof(double)) ;
+  col_names = g_array_new(FALSE, TRUE, sizeof(GQuark)) ;
 
 
   /* If there's an old subcol list then get rid of it. */
@@ -417,10 +372,13 @@ gboolean zMapWindowCanvasFeaturesetBump(ZMapWindowFeaturesetItem featureset, ZMa
 	  feature->bump_offset = bump_data->offset ;
 	  bump_data->offset += bump_data->width + bump_data->spacing ;
 
-          if (bump_mode == ZMAPBUMP_FEATURESET_NAME)
-            pos_list = calcBumpNoOverlapFeatureSet(featureset, feature, bump_data, pos_list) ;
-          else
-            pos_list = calcBumpNoOverlap(feature, bump_data, pos_list) ;
+          /* sub-columns are worked out once we have all the features */
+          {
+            BumpPlacementStruct placement = {feature, bump_data->span, bump_data->width,
+                                             feature->feature->parent->unique_id, 0} ;
+
+            g_array_append_val(placements, placement) ;
+          }
 	  break ;
 
 	case ZMAPBUMP_ALTERNATING:
@@ -472,33 +430,46 @@ gboolean zMapWindowCanvasFeaturesetBump(ZMapWindowFeaturesetItem featureset, ZMa
     case ZMAPBUMP_OVERLAP:
       {
         double width = 0 ;
+        GArray *col_offsets ;
 
-        /* free allocated memory left over */
-        for (n = 0, l = pos_list ; l ; n++)
+        /* Put the features in sub-columns. */
+        bumpLayout(featureset, bump_mode, placements, col_widths, col_names) ;
+
+        for (n = 0 ; n < placements->len ; n++)
           {
-            BumpColRange range = BCR_DATA(l) ;
+            BumpPlacement placement = &g_array_index(placements, BumpPlacementStruct, n) ;
+            ZMapWindowCanvasFeature feature ;
 
-            l = bump_col_range_delete(l, l, range) ;
+            /* store the column for later calculation of the offset, complex features all go in
+             * the same column */
+            for (feature = placement->feature ; feature ; feature = (bump_data->is_complex ? feature->right : NULL))
+              feature->bump_col = placement->column ;
           }
 
+#if MODULE_STATS
+        bump_data->features = placements->len ;
+        bump_data->n_col = col_widths->len ;
+#endif
+
         /* get whole column width and set column offsets note that spacing is added to the right so
          * we remove the extra/redundant spacing for the last offset after the loop. */
-        for (n = 0, featureset->bump_width = 0 ;
-             (width = (double)GPOINTER_TO_UINT(g_hash_table_lookup(sub_col_width_G, GUINT_TO_POINTER(n)))) ;
-             n++)
+        col_offsets = g_array_sized_new(FALSE, TRUE, sizeof(double), col_widths->len) ;
+
+        for (n = 0, featureset->bump_width = 0 ; n < col_widths->len ; n++)
           {
             ZMapWindowCanvasSubCol sub_col_data ;
+            double offset = (double)((int)featureset->bump_width) ;
 
+            width = g_array_index(col_widths, double, n) ;
 
-            g_hash_table_insert(sub_col_offset_G,
-                                GUINT_TO_POINTER(n), GUINT_TO_POINTER((int)featureset->bump_width)) ;
+            g_array_append_val(col_offsets, offset) ;
 
             /* For featureset_name bumping insert subcol information into subcol list. */
             if (bump_mode == ZMAPBUMP_FEATURESET_NAME)
               {
                 sub_col_data = g_new0(ZMapWindowCanvasSubColStruct, 1) ;
 
-                sub_col_data->subcol_id = GPOINTER_TO_UINT(g_hash_table_lookup(sub_col_name_G, GUINT_TO_POINTER(n))) ;
+                sub_col_data->subcol_id = g_array_index(col_names, GQuark, n) ;
                 sub_col_data->offset = featureset->bump_width ;
                 sub_col_data->width = width + bump_data->spacing ;
 
@@ -536,12 +507,18 @@ gboolean zMapWindowCanvasFeaturesetBump(ZMapWindowFeaturesetItem featureset, ZMa
 
             if (zmapWindowCanvasFeatureValid(feature) && !(feature->flags & FEATURE_HIDDEN))
               {
-                width = (double)GPOINTER_TO_UINT(g_hash_table_lookup(sub_col_width_G,
-                                                                     GUINT_TO_POINTER(feature->bump_col)));
+                n = (guint)feature->bump_col ;
 
-                feature->bump_offset
-                  = (double)GPOINTER_TO_UINT(g_hash_table_lookup(sub_col_offset_G,
-                                                                 GUINT_TO_POINTER(feature->bump_col))) ;
+                if (n < col_widths->len)
+                  {
+                    width = g_array_index(col_widths, double, n) ;
+                    feature->bump_offset = g_array_index(col_offsets, double, n) ;
+                  }
+                else
+                  {
+                    width = 0.0 ;
+                    feature->bump_offset = 0.0 ;
+                  }
 
                 /* printf("offset feature %s @ %p %f,%f %d = %f\n",
                    g_quark_to_string(feature->feature->unique_id), feature,
@@ -565,9 +542,12 @@ gboolean zMapWindowCanvasFeaturesetBump(ZMapWindowFeaturesetItem featureset, ZMa
 
 
 
+        g_array_free(col_offsets, TRUE) ;
+
 #if MODULE_STATS
         time = zMapElapsedSeconds - time;
-        printf("bump overlap %s: %d features %d comparisons in %d columns, residual = %d in %.3f seconds (slow = %d)\n", g_quark_to_string(featureset->id),bump_data->features,bump_data->comps,bump_data->n_col,n,time, SLOW_BUT_EASY);
+        printf("bump overlap %s: %d features in %d columns in %.3f seconds\n",
+               g_quark_to_string(featureset->id), bump_data->features, bump_data->n_col, time) ;
 #endif
         break;
       }
@@ -592,11 +572,30 @@ gboolean zMapWindowCanvasFeaturesetBump(ZMapWindowFeaturesetItem featureset, ZMa
       result = TRUE ;
     }
 
+  g_array_free(placements, TRUE) ;
+  g_array_free(col_widths, TRUE) ;
+  g_array_free(col_names, TRUE) ;
 
   return result ;
 }
 
 
+/* Frees a featureset's cached bump layout. */
+void zmapWindowCanvasBumpCacheDestroy(ZMapWindowCanvasBumpCache bump_cache)
+{
+  if (bump_cache)
+    {
+      g_array_free(bump_cache->placements, TRUE) ;
+      g_array_free(bump_cache->col_widths, TRUE) ;
+      g_array_free(bump_cache->col_names, TRUE) ;
+
+      g_free(bump_cache) ;
+    }
+
+  return ;
+}
+
+
 
 
 
@@ -626,293 +625,187 @@ static gboolean featureTestMark(ZMapWindowCanvasFeature feature, double start, d
 
 
 
-/* ONLY EVER USED FOR OVERLAP MODE....
- *
- * scatter features so that they don't overlap.
- *
- * We know that they are fed in in start coordinate order so we keep
- * a pos_list of features per sub-column which get trimmed as the start
- * coordinate increases that way we know that we are unlikely to reach O(n**2).
- *
- * :-( tests reveal O(n**2) / 3
- *
- * obvious worst case is one feature per column it ought to be possible to do this more efficiently
- */
-static BCR calcBumpNoOverlap(ZMapWindowCanvasFeature feature, BumpFeatureset bump_data, BCR pos_list)
+/* Puts each feature in a sub-column, reusing the last layout if the features haven't changed. */
+static void bumpLayout(ZMapWindowFeaturesetItem featureset, ZMapStyleBumpMode bump_mode,
+                       GArray *placements, GArray *col_widths, GArray *col_names)
 {
-  //  GList *l,*cur, *last = NULL;
-  BCR l;
-  BCR cur;
-  BCR last = NULL;
-  BumpColRange curr_range, new_range ;
-  double width ;
-
-  new_range = bump_col_range_alloc();
-  new_range->span.x1 = bump_data->span.x1;
-  new_range->span.x2 = bump_data->span.x2;
-
-#if MODULE_STATS
-  bump_data->features++;
-#endif
-
-  for (l = pos_list ; l ; )                                 /* pos list is sorted by column */
+  if (!bumpCacheGet(featureset, bump_mode, placements, col_widths, col_names))
     {
-      /* NOTE l is where new_range can get inserted before, so must be valid, cannot be if it's freed */
-      cur = l;
+      if (bump_mode == ZMAPBUMP_FEATURESET_NAME)
+        calcBumpNoOverlapFeatureSet(placements, col_widths, col_names) ;
+      else
+        calcBumpNoOverlap(placements, col_widths) ;
 
-      curr_range = BCR_DATA(cur);
+      bumpCacheSet(featureset, bump_mode, placements, col_widths, col_names) ;
+    }
 
-      if(curr_range->span.x2 < new_range->span.x1)
-	{
-          l = BCR_NEXT(l);
+  return ;
+}
 
-          /* lazy evaluation of list trimming, no need to scan fwds if we find a space*/
-          pos_list = bump_col_range_delete(pos_list,cur,curr_range);
 
-          continue;
-	}
+/* ONLY EVER USED FOR OVERLAP MODE....
+ *
+ * scatter features so that they don't overlap, each goes in the lowest sub-column that has
+ * nothing overlapping it.
+ *
+ * We know that they are fed in in start coordinate order so a sub-column is free once the
+ * last feature put in it ends before the current one starts. Busy columns are kept in a heap
+ * by end coord so they can be freed as we go and free columns in a heap so we can take the
+ * lowest, that way it's O(n log n) whatever the features are like.
+ */
+static void calcBumpNoOverlap(GArray *placements, GArray *col_widths)
+{
+  std::priority_queue<BumpColEnd, std::vector<BumpColEnd>, std::greater<BumpColEnd> > busy_cols ;
+  std::priority_queue<int, std::vector<int>, std::greater<int> > free_cols ;
+  guint i ;
 
-      if (new_range->column < curr_range->column)	/* found a space */
-        break;
+  for (i = 0 ; i < placements->len ; i++)
+    {
+      BumpPlacement placement = &g_array_index(placements, BumpPlacementStruct, i) ;
 
-      if(new_range->column == curr_range->column)
+      while (!busy_cols.empty() && busy_cols.top().first < placement->span.x1)
         {
-#if MODULE_STATS
-          bump_data->comps++;
-#endif
-
-          // can overlap with this feature: same column
-          if( ! (new_range->span.x1 > curr_range->span.x2 || new_range->span.x2 < curr_range->span.x1))
-            {
-              new_range->column++;
-              //            	new_range->offset = curr_range->offset + curr_range->width;
-              // got an overlap, try next column
-
-#if MODULE_STATS
-              if(new_range->column > bump_data->n_col)
-                bump_data->n_col = new_range->column;
-#endif
+          free_cols.push(busy_cols.top().second) ;
+          busy_cols.pop() ;
+        }
 
-            }
+      if (!free_cols.empty())
+        {
+          placement->column = free_cols.top() ;
+          free_cols.pop() ;
+        }
+      else
+        {
+          placement->column = col_widths->len ;
         }
 
-      last = l;		/* remember last to insert at the end */
-      l = BCR_NEXT(l);
-    }
-  // either we found a space or ran out of features ie no overlap
+      busy_cols.push(BumpColEnd(placement->span.x2, placement->column)) ;
 
-  if(l)
-    {
-      /* NOTE: {} needed due to macro call */
-      pos_list = bump_col_range_insert(pos_list, l, new_range);
-    }
-  else
-    {
-      pos_list = bump_col_range_append(pos_list, last, new_range);
+      setColWidth(col_widths, placement->column, placement->width) ;
     }
 
-  /* store the column for later calculation of the offset */
-  feature->bump_col = (double) new_range->column;
-
-  /* get the max width of a feature in each column */
-  /* totally yuk casting here but bear with me */
-  width = (double)GPOINTER_TO_UINT(g_hash_table_lookup(sub_col_width_G, GUINT_TO_POINTER(new_range->column))) ;
-
-  if(width < bump_data->width)
-    g_hash_table_replace(sub_col_width_G, GUINT_TO_POINTER(new_range->column),
-                         GUINT_TO_POINTER((int)bump_data->width)) ;
-
-  //zMapLogWarning("bump: width of %d = %f (%f)",new_range->column,width, bump_data->width);
-  //  printf("feature %s @ %p %f,%f col %d\n",g_quark_to_string(feature->feature->unique_id),feature,feature->y1,feature->y2,new_range->column);
-
-  return pos_list;
+  return ;
 }
 
 
-
-static BCR calcBumpNoOverlapFeatureSet(ZMapWindowFeaturesetItem featureset, ZMapWindowCanvasFeature feature,
-                                       BumpFeatureset bump_data, BCR pos_list)
+/* Each featureset gets its own sub-column in the order they are first seen. */
+static void calcBumpNoOverlapFeatureSet(GArray *placements, GArray *col_widths, GArray *col_names)
 {
-  //  GList *l,*cur, *last = NULL;
-  BCR l;
-  BCR cur;
-  BCR last = NULL;
-  BumpColRange curr_range, new_range ;
-  double width ;
+  GHashTable *featureset_cols ;
+  guint i ;
 
+  featureset_cols = g_hash_table_new(NULL, NULL) ;
 
-  new_range = bump_col_range_alloc();
-  new_range->featureset_unique_id = feature->feature->parent->unique_id ;
-
-
-#if MODULE_STATS
-  bump_data->features++;
-#endif
-
-  for (l = pos_list ; l ; )                                 /* pos list is sorted by column */
+  for (i = 0 ; i < placements->len ; i++)
     {
-      /* NOTE l is where new_range can get inserted before, so must be valid, cannot be if it's freed */
-      cur = l;
-
-      curr_range = BCR_DATA(cur);
+      BumpPlacement placement = &g_array_index(placements, BumpPlacementStruct, i) ;
+      gpointer col ;
 
-      if (curr_range->featureset_unique_id != new_range->featureset_unique_id)
-	{
-          last = l;		/* remember last to insert at the end */
-          l = BCR_NEXT(l);
-
-          continue;
-	}
-      else
+      if ((col = g_hash_table_lookup(featureset_cols, GUINT_TO_POINTER(placement->featureset_unique_id))))
         {
-          break ;
+          placement->column = GPOINTER_TO_INT(col) - 1 ;
         }
+      else
+        {
+          GQuark subcol_name = placement->feature->feature->parent->original_id ;
 
-      last = l ;		/* remember last to insert at the end */
-      l = BCR_NEXT(l) ;
-    }
-  // either we found a space or ran out of features ie no overlap
-
-
-
-  /* Post process.... */
-  if(l)
-    {
-      /* need to free allocated new_range.... */
-      bump_col_range_free(new_range) ;
-
-      new_range = curr_range ;
-    }
-  else
-    {
-      if (last)
-        new_range->column = last->column + 1 ;
-
-      pos_list = bump_col_range_append(pos_list, last, new_range) ;
+          placement->column = col_names->len ;
 
+          g_array_append_val(col_names, subcol_name) ;
 
+          g_hash_table_insert(featureset_cols, GUINT_TO_POINTER(placement->featureset_unique_id),
+                              GINT_TO_POINTER(placement->column + 1)) ;
+        }
 
-      /* OK HERE WE SHOULD INSERT THE SUBCOL NAME INTO THE SUBCOL HASH/LIST..... */
-      g_hash_table_insert(sub_col_name_G,
-                          GUINT_TO_POINTER(new_range->column),
-                          GUINT_TO_POINTER(feature->feature->parent->original_id)) ;
+      setColWidth(col_widths, placement->column, placement->width) ;
     }
 
+  g_hash_table_destroy(featureset_cols) ;
 
-  /* store the column for later calculation of the offset */
-  feature->bump_col = (double) new_range->column ;
-
-  /* get the max width of a feature in each column */
-  /* totally yuk casting here but bear with me */
-  width = (double)GPOINTER_TO_UINT(g_hash_table_lookup(sub_col_width_G, GUINT_TO_POINTER(new_range->column))) ;
-
-  if (width < bump_data->width)
-    g_hash_table_replace(sub_col_width_G, GUINT_TO_POINTER(new_range->column),
-                         GUINT_TO_POINTER((int)bump_data->width)) ;
-
-  //zMapLogWarning("bump: width of %d = %f (%f)",new_range->column,width, bump_data->width);
-  //  printf("feature %s @ %p %f,%f col %d\n",g_quark_to_string(feature->feature->unique_id),feature,feature->y1,feature->y2,new_range->column);
-
-  return pos_list;
+  return ;
 }
 
 
-
-
-
-#if SLOW_BUT_EASY
-
-/* GList rubbish: cannot insert after the last one, only before a NUll which means starting at the
- * head of the list
- * last is the last link in the list */
-static GList *bump_col_range_append(GList *glist, GList *last, BumpColRange bcr)
+/* get the max width of a feature in each column, adding the column if it's new. */
+static void setColWidth(GArray *col_widths, int column, double width)
 {
-  last = g_list_append(last,bcr);
-  if(!glist)
-    glist = last;
-  return glist;
-}
+  if (column >= (int)col_widths->len)
+    g_array_set_size(col_widths, column + 1) ;
 
+  /* widths have always been whole numbers */
+  if (g_array_index(col_widths, double, column) < width)
+    g_array_index(col_widths, double, column) = (double)((int)width) ;
 
-#else /* SLOW_BUT_EASY */
+  return ;
+}
 
 
-static BumpColRange bump_col_range_alloc(void)
+/* If the features to be bumped are the same as last time, in the same order with the same extents,
+ * then they get the same columns as last time. */
+static gboolean bumpCacheGet(ZMapWindowFeaturesetItem featureset, ZMapStyleBumpMode bump_mode,
+                             GArray *placements, GArray *col_widths, GArray *col_names)
 {
-  BumpColRange bcr;
-  int i;
+  gboolean result = FALSE ;
+  ZMapWindowCanvasBumpCache bump_cache = featureset->bump_cache ;
 
-  if(!bump_col_range_free_G)
+  if (bump_cache && bump_cache->bump_mode == bump_mode && bump_cache->placements->len == placements->len)
     {
+      guint i ;
 
-      bcr = g_new(BumpColRangeStruct,N_BUMP_COL_RANGE_ALLOC);
+      result = TRUE ;
 
-      for(i = 0;i < N_BUMP_COL_RANGE_ALLOC;i++)
-        bump_col_range_free(bcr++);
-    }
+      for (i = 0 ; result && i < placements->len ; i++)
+        {
+          BumpPlacement placement = &g_array_index(placements, BumpPlacementStruct, i) ;
+          BumpPlacement cached = &g_array_index(bump_cache->placements, BumpPlacementStruct, i) ;
 
-  bcr = bump_col_range_free_G;
-  if(bcr)
-    {
-      bump_col_range_free_G = (BumpColRange) bcr->link.next;
+          if (placement->span.x1 != cached->span.x1 || placement->span.x2 != cached->span.x2
+              || placement->width != cached->width
+              || placement->featureset_unique_id != cached->featureset_unique_id)
+            result = FALSE ;
+          else
+            placement->column = cached->column ;
+        }
 
-      /* these can get re-allocated so must zero */
-      memset((gpointer) bcr,0,sizeof(BumpColRangeStruct));
+      if (result)
+        {
+          g_array_append_vals(col_widths, bump_cache->col_widths->data, bump_cache->col_widths->len) ;
+          g_array_append_vals(col_names, bump_cache->col_names->data, bump_cache->col_names->len) ;
+        }
     }
 
-
-  return(bcr);
+  return result ;
 }
 
 
-/* NOTE for the free list we don't use the prev pointer so ne need to set it */
-static void bump_col_range_free(BumpColRange bcr)
+static void bumpCacheSet(ZMapWindowFeaturesetItem featureset, ZMapStyleBumpMode bump_mode,
+                         GArray *placements, GArray *col_widths, GArray *col_names)
 {
-  bcr->link.next = (GList *) bump_col_range_free_G;
-  bump_col_range_free_G = bcr;
-
-  return ;
-}
+  ZMapWindowCanvasBumpCache bump_cache ;
 
+  if (!(bump_cache = featureset->bump_cache))
+    {
+      bump_cache = featureset->bump_cache = g_new0(ZMapWindowCanvasBumpCacheStruct, 1) ;
 
+      bump_cache->placements = g_array_new(FALSE, FALSE, sizeof(BumpPlacementStruct)) ;
+      bump_cache->col_widths = g_array_new(FALSE, FALSE, sizeof(double)) ;
+      bump_cache->col_names = g_array_new(FALSE, FALSE, sizeof(GQuark)) ;
+    }
 
-/* disappointingly GLib does not provide a function to stitch a GList struct into a list although
- * it provides the converse */
-static BumpColRange bump_col_range_insert(BumpColRange alist, BumpColRange link, BumpColRange bcr)
-{
-  bcr->link.next = &link->link;
-  bcr->link.prev = link->link.prev;
+  bump_cache->bump_mode = bump_mode ;
 
-  if(link->link.prev)
-    link->link.prev->next = (GList *) bcr;
-  link->link.prev = (GList *) bcr;
+  g_array_set_size(bump_cache->placements, 0) ;
+  g_array_append_vals(bump_cache->placements, placements->data, placements->len) ;
 
-  if(!bcr->link.prev)
-    alist = bcr;
+  g_array_set_size(bump_cache->col_widths, 0) ;
+  g_array_append_vals(bump_cache->col_widths, col_widths->data, col_widths->len) ;
 
-  return alist;
-}
+  g_array_set_size(bump_cache->col_names, 0) ;
+  g_array_append_vals(bump_cache->col_names, col_names->data, col_names->len) ;
 
-static BumpColRange bump_col_range_append(BumpColRange alist, BumpColRange last, BumpColRange bcr)
-{
-  if(!last)
-    {
-      last = bcr;
-    }
-  else
-    {
-      last->link.next = (GList *) bcr;
-      bcr->link.prev = &last->link;
-    }
-
-  if(!alist)
-    alist = last;
-
-  return alist;
+  return ;
 }
 
-#endif
-
 
 
 /* A GFunc() routine to free the subcol list, currently very simple. */
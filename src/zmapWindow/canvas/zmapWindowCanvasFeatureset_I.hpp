@@ -153,6 +153,17 @@ typedef struct _pixRect
 #define N_FEAT_ALLOC      1000
 
 
+/* Set to 1 to index featuresets with a sorted array instead of a skip list, see
+ * zmapWindowCanvasSortedIndex.cpp. The skip list stays the default until "zmap_bench
+ * --canvas-index" shows the sorted array is faster on real data. */
+#define CANVAS_FEATURESET_SORTED_INDEX 0
+
+typedef struct ZMapWindowCanvasSortedIndexStructType *ZMapWindowCanvasSortedIndex ;
+
+/* Last overlap bump layout of a featureset, see zmapWindowCanvasFeaturesetBump.cpp. */
+typedef struct ZMapWindowCanvasBumpCacheStructType *ZMapWindowCanvasBumpCache ;
+
+
 
 typedef struct ZMapWindowFeaturesetItemClassStructType
 {
@@ -291,23 +302,31 @@ typedef struct ZMapWindowFeaturesetItemStructType
    * giving offsets, names etc for subcols. */
   GList *sub_col_list ;
 
-  /* we add features to a simple list and create the index on demand when we get an expose */
-  GList *features ;
-  /* NOTE elsewhere we don't use GList as we get a 30% performance improvement
-   * but we need to sort features so GList is more convenient */
+  /* Sub-columns of the last overlap bump, reused if the features haven't changed. */
+  ZMapWindowCanvasBumpCache bump_cache ;
+
+  /* All the canvas features are allocated from this and freed with it when the featureset
+   * is destroyed. */
+  ZMapWindowCanvasFeaturePool feature_pool ;
+
+  /* we add features to an array and create the index on demand when we get an expose,
+   * the array is sorted in place. */
+  GPtrArray *features ;
 
   long n_features ;
   gboolean features_sorted ;				    /* by start coord */
 
   gboolean re_bin ;					    /* re-calculate bins/ features according to zoom */
-  GList *display ;					    /* features for display */
+  GPtrArray *display ;					    /* features for display */
 
   /* NOTE normally features are indexed into display_index
    * coverage data gets re-binned and new features stored in display which is then indexed
    * if we add new features then we re-create the index - new features are added to features
-   * if display is not NULL then we have to free both lists on destroy
+   * if display is not NULL then we have to free both arrays on destroy
    */
   ZMapSkipList display_index ;
+  ZMapWindowCanvasSortedIndex sorted_index ;                /* owns display_index nodes if
+                                                               CANVAS_FEATURESET_SORTED_INDEX */
 
   // Used to cursor through canvasfeatures in the skiplist, reset to NULL when the skiplist is deleted.
   ZMapSkipList curr_item ;
@@ -384,6 +403,17 @@ gboolean zmapWindowCanvasFeaturesetFreeDisplayLists(ZMapWindowFeaturesetItem fea
 void zmapWindowFeaturesetS2Ccoords(double *start_inout, double *end_inout) ;
 gboolean zmapWindowCanvasFeatureValid(ZMapWindowCanvasFeature feature) ;
 
+void zmapWindowCanvasFeaturesetSortFeatures(GPtrArray *features, GCompareFunc compare_func) ;
+
+ZMapWindowCanvasSortedIndex zmapWindowCanvasSortedIndexCreate(GPtrArray *features) ;
+ZMapSkipList zmapWindowCanvasSortedIndexHead(ZMapWindowCanvasSortedIndex index) ;
+ZMapSkipList zmapWindowCanvasSortedIndexFind(ZMapWindowCanvasSortedIndex index,
+                                             GCompareFunc cmp, gconstpointer key) ;
+ZMapSkipList zmapWindowCanvasSortedIndexFindOverlap(ZMapWindowCanvasSortedIndex index, double y1) ;
+void zmapWindowCanvasSortedIndexDestroy(ZMapWindowCanvasSortedIndex index) ;
+
+void zmapWindowCanvasBumpCacheDestroy(ZMapWindowCanvasBumpCache bump_cache) ;
+
 
 
 
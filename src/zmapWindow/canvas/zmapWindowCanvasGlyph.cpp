@@ -692,7 +692,7 @@ static void glyphPreZoom(ZMapWindowFeaturesetItem featureset)
 static void glyphZoom(ZMapWindowFeaturesetItem featureset, GdkDrawable *drawable)
 {
   /* Go through all features and recalc glyph canvas coords.... */
-  g_list_foreach(featureset->features, calcCanvasPos, featureset) ;
+  g_ptr_array_foreach(featureset->features, calcCanvasPos, featureset) ;
 
   return ;
 }
@@ -33,6 +33,11 @@
  *              NOTE originally implemented as free standing canvas type
  *               and later merged into CanvasFeatureset.
  *
+ *              Density data is re-binned from a pyramid of score
+ *              summaries made once per featureset, each level merges the
+ *              previous one into bins of twice the size so a zoom only
+ *              has to look at the level nearest to the new bin size.
+ *
  *-------------------------------------------------------------------
  */
 
@@ -92,10 +97,52 @@ static double graphPoint(ZMapWindowFeaturesetItem fi, ZMapWindowCanvasFeature gs
                          double item_x, double item_y, int cx, int cy,
                          double local_x, double local_y, double x_off) ;
 
-static GList *densityCalcBins(ZMapWindowFeaturesetItem di) ;
+static void graphFreeSet(ZMapWindowFeaturesetItem featureset) ;
+
+static GPtrArray *densityCalcBins(ZMapWindowFeaturesetItem di) ;
+static ZMapWindowCanvasGraphPyramid densityGetPyramid(ZMapWindowFeaturesetItem featureset_item) ;
+static ZMapWindowCanvasGraphPyramid densityPyramidCreate(ZMapWindowFeaturesetItem featureset_item) ;
+static GArray *densityGetLevel(ZMapWindowCanvasGraphPyramid pyramid, int bases_per_bin) ;
+static void densityPyramidDestroy(ZMapWindowCanvasGraphPyramid pyramid) ;
 static void setColumnStyle(ZMapWindowFeaturesetItem featureset, ZMapFeatureTypeStyle feature_style) ;
 
 
+/* Pyramid levels are only kept if they have at most this fraction of the bins of the last level
+ * kept, sparse data needs quite big bins before any merge, this limits the pyramid to about
+ * twice the size of the source data. */
+#define DENSITY_LEVEL_MAX_RATIO 0.5
+
+
+/* One or more source features summarised together, the pyramid levels are arrays of these. */
+typedef struct DensityBinStructType
+{
+  double y1, y2 ;                                           /* Extent of the features. */
+
+  double score ;                                            /* Canvas feature score and feature */
+  ZMapFeature feature ;                                     /* with the biggest absolute score,
+                                                               which is what gets drawn. */
+
+  double min_score, max_score, sum_score ;                  /* Of the features' canvas scores. */
+  int count ;
+
+} DensityBinStruct, *DensityBin ;
+
+
+typedef struct ZMapWindowCanvasGraphPyramidStructType
+{
+  /* What the pyramid was made from, if these change it's remade. Adding features also
+   * unsets features_sorted. */
+  double start ;                                            /* Bins are aligned to this. */
+  long n_features ;
+
+  GPtrArray *levels ;                                       /* GArrays of DensityBinStruct, the
+                                                               first is the features themselves. */
+  GArray *bin_sizes ;                                       /* int, max bases per bin of each level. */
+
+} ZMapWindowCanvasGraphPyramidStruct ;
+
+
+
 /*
  *                        Globals
  */
@@ -126,6 +173,7 @@ void zMapWindowCanvasGraphInit(void)
   funcs[FUNC_PRE_ZOOM] = (void *)graphPreZoom ;
   funcs[FUNC_ZOOM] = (void *)graphZoom ;
   funcs[FUNC_POINT] = (void *)graphPoint ;
+  funcs[FUNC_FREE] = (void *)graphFreeSet ;
 
   /* And again encapsulation is broken..... */
   zMapWindowCanvasFeatureSetSetFuncs(FEATURE_GRAPH, funcs, sizeof(ZMapWindowCanvasGraphStruct)) ;
@@ -164,6 +212,20 @@ static void graphInit(ZMapWindowFeaturesetItem featureset)
 }
 
 
+static void graphFreeSet(ZMapWindowFeaturesetItem featureset)
+{
+  ZMapWindowCanvasGraph graph_set = (ZMapWindowCanvasGraph)(featureset->opt) ;
+
+  if (graph_set)
+    {
+      densityPyramidDestroy(graph_set->pyramid) ;
+      graph_set->pyramid = NULL ;
+    }
+
+  return ;
+}
+
+
 /* Called before any zooming, this column needs to be recalculated with every zoom, this call sets
  * a flag to make sure this happens.  This is required because we need special processing on zoom
  * not just box/line resizing. */
@@ -219,13 +281,10 @@ static void graphZoom(ZMapWindowFeaturesetItem featureset, GdkDrawable *drawable
     {
       /* AGH, CRASHES HERE WITH NO feature->style bexcause there is no feature.... */
 
-      GList *feature_list ;
       ZMapWindowCanvasFeature feature_item ;
       ZMapFeature feature ;
 
-      feature_list = featureset->features ;
-
-      feature_item = (ZMapWindowCanvasFeature)(feature_list->data) ;
+      feature_item = (ZMapWindowCanvasFeature)g_ptr_array_index(featureset->features, 0) ;
 
       feature = feature_item->feature ;
 
@@ -981,7 +1040,7 @@ static double graphPoint(ZMapWindowFeaturesetItem fi, ZMapWindowCanvasFeature gs
 
 
 
-/* create a new list of binned data derived from the real stuff
+/* create a new array of binned data derived from the real stuff
  *
  * bins are coerced to be at least one pixel across
  *
@@ -993,17 +1052,22 @@ static double graphPoint(ZMapWindowFeaturesetItem fi, ZMapWindowCanvasFeature gs
  *
  * try not to split big bins into smaller ones, there's no min size in BP, but the source data
  * imposes a limit
+ *
+ * the source data is the pyramid level with the biggest bins no bigger than the bins we want,
+ * at high zoom that is the features themselves
  */
-static GList *densityCalcBins(ZMapWindowFeaturesetItem featureset_item)
+static GPtrArray *densityCalcBins(ZMapWindowFeaturesetItem featureset_item)
 {
-  GList *result = NULL ;
+  GPtrArray *result = NULL ;
   double start,end;
   int seq_range;
   int n_bins;
   int bases_per_bin;
   int bin_start,bin_end;
-  GList *src = NULL,*dest = NULL ;
-  ZMapWindowCanvasFeature src_gs = NULL;                    /* the original features */
+  GPtrArray *dest ;
+  GArray *level ;
+  guint src, n_src ;
+  DensityBin src_gs = NULL;                                 /* the original features, or summaries of them */
   ZMapWindowCanvasFeature bin_gs = NULL ;                   /* the re-binned features */
   double score = 0.0 ;
   double min_feat_score = 0.0, max_feat_score = 0.0 ;
@@ -1024,11 +1088,6 @@ static GList *densityCalcBins(ZMapWindowFeaturesetItem featureset_item)
                  zmapStyleScale2ExactStr(zMapStyleGetScoreScale(featureset_item->style))) ;
 
 
-  if (!featureset_item->features_sorted)
-    featureset_item->features = g_list_sort(featureset_item->features, zMapWindowFeatureCmp) ;
-
-  featureset_item->features_sorted = TRUE ;
-
   if(!min_bin)
     min_bin = 4;
 
@@ -1043,21 +1102,26 @@ static GList *densityCalcBins(ZMapWindowFeaturesetItem featureset_item)
   if(bases_per_bin < 1) /* at high zoom we get many pixels per base */
     bases_per_bin = 1;
 
-  for (bin_start = start, src = featureset_item->features, dest = NULL ;
-       bin_start < end && src ;
+  level = densityGetLevel(densityGetPyramid(featureset_item), bases_per_bin) ;
+  n_src = level->len ;
+
+  dest = g_ptr_array_new() ;
+
+  for (bin_start = start, src = 0 ;
+       bin_start < end && src < n_src ;
        bin_start = bin_end + 1)
     {
       bin_end = bin_start + bases_per_bin - 1 ;             /* end can equal start */
 
-      bin_gs = zMapWindowCanvasFeatureAlloc(featureset_item->type) ;
+      bin_gs = zMapWindowCanvasFeatureAlloc(featureset_item->feature_pool, featureset_item->type) ;
 
       bin_gs->y1 = bin_start;
       bin_gs->y2 = bin_end;
       bin_gs->score = 0.0;
 
-      for (;src; src = src->next)
+      for (; src < n_src ; src++)
         {
-          src_gs = (ZMapWindowCanvasFeature) src->data;
+          src_gs = &g_array_index(level, DensityBinStruct, src) ;
 
 
           zMapDebugPrint(debug_G, "bin_start, bin_end: %d, %d\tsrc_gs->y1, src_gs->y2: %f, %f",
@@ -1151,14 +1215,19 @@ static GList *densityCalcBins(ZMapWindowFeaturesetItem featureset_item)
               bin_gs->y2 = src_gs->y2;
             }
 
-          dest = g_list_prepend(dest, (gpointer)bin_gs) ;
+          g_ptr_array_add(dest, (gpointer)bin_gs) ;
+        }
+      else
+        {
+          zmapWindowCanvasFeatureFree(featureset_item->feature_pool, bin_gs) ;
         }
-
     }
 
-  /* we could have been artisitic and constructed dest backwards */
-  if (dest)
-    result = g_list_reverse(dest) ;
+  /* callers expect NULL if there's nothing to display */
+  if (dest->len)
+    result = dest ;
+  else
+    g_ptr_array_free(dest, TRUE) ;
 
 
   zMapDebugPrint(debug_G, "Min Feature score: %f, max Feat score: %f",
@@ -1170,6 +1239,171 @@ static GList *densityCalcBins(ZMapWindowFeaturesetItem featureset_item)
 
 
 
+/* Returns the featureset's pyramid, making it if there isn't one or the features have changed. */
+static ZMapWindowCanvasGraphPyramid densityGetPyramid(ZMapWindowFeaturesetItem featureset_item)
+{
+  ZMapWindowCanvasGraph graph_set = (ZMapWindowCanvasGraph)(featureset_item->opt) ;
+  ZMapWindowCanvasGraphPyramid pyramid = graph_set->pyramid ;
+
+  if (!pyramid || pyramid->start != featureset_item->start || !featureset_item->features_sorted
+      || pyramid->n_features != featureset_item->n_features)
+    {
+      densityPyramidDestroy(pyramid) ;
+
+      pyramid = graph_set->pyramid = densityPyramidCreate(featureset_item) ;
+    }
+
+  return pyramid ;
+}
+
+
+/* Level 0 is the features in start order, each pass after that merges runs of bins that lie
+ * within the same 2^n bases (counting from the featureset start), bins that stick out of that
+ * are copied unchanged so the levels stay in start order and the bins keep the extent of the
+ * data. Passes that don't merge much are not kept as levels. */
+static ZMapWindowCanvasGraphPyramid densityPyramidCreate(ZMapWindowFeaturesetItem featureset_item)
+{
+  ZMapWindowCanvasGraphPyramid pyramid = NULL ;
+  GArray *prev, *next ;
+  guint i ;
+  int bin_size, seq_range ;
+  guint kept_len ;
+  gboolean prev_kept, next_kept ;
+
+  if (!featureset_item->features_sorted)
+    zmapWindowCanvasFeaturesetSortFeatures(featureset_item->features, zMapWindowFeatureCmp) ;
+
+  featureset_item->features_sorted = TRUE ;
+
+  pyramid = g_new0(ZMapWindowCanvasGraphPyramidStruct, 1) ;
+  pyramid->start = featureset_item->start ;
+  pyramid->n_features = featureset_item->n_features ;
+  pyramid->levels = g_ptr_array_new() ;
+  pyramid->bin_sizes = g_array_new(FALSE, FALSE, sizeof(int)) ;
+
+  prev = g_array_sized_new(FALSE, FALSE, sizeof(DensityBinStruct), featureset_item->n_features) ;
+
+  for (i = 0 ; i < featureset_item->features->len ; i++)
+    {
+      ZMapWindowCanvasFeature feature = (ZMapWindowCanvasFeature)g_ptr_array_index(featureset_item->features, i) ;
+      DensityBinStruct bin = {feature->y1, feature->y2, feature->score, feature->feature,
+                              feature->score, feature->score, feature->score, 1} ;
+
+      g_array_append_val(prev, bin) ;
+    }
+
+  bin_size = 1 ;
+  g_ptr_array_add(pyramid->levels, prev) ;
+  g_array_append_val(pyramid->bin_sizes, bin_size) ;
+  kept_len = prev->len ;
+  prev_kept = TRUE ;
+
+  seq_range = (int)(featureset_item->end - featureset_item->start + 1) ;
+
+  for (bin_size = 2 ; prev->len > 1 && bin_size < seq_range ; bin_size *= 2)
+    {
+      DensityBin curr = NULL ;
+      double curr_end = 0.0 ;
+
+      next = g_array_sized_new(FALSE, FALSE, sizeof(DensityBinStruct), prev->len / 2 + 1) ;
+
+      for (i = 0 ; i < prev->len ; i++)
+        {
+          DensityBin bin = &g_array_index(prev, DensityBinStruct, i) ;
+
+          if (curr && bin->y2 <= curr_end)
+            {
+              /* same bin, same rule as densityCalcBins() to pick the feature */
+              if (fabs(bin->score) > fabs(curr->score))
+                {
+                  curr->score = bin->score ;
+                  curr->feature = bin->feature ;
+                }
+
+              if (bin->y2 > curr->y2)
+                curr->y2 = bin->y2 ;
+              if (bin->min_score < curr->min_score)
+                curr->min_score = bin->min_score ;
+              if (bin->max_score > curr->max_score)
+                curr->max_score = bin->max_score ;
+              curr->sum_score += bin->sum_score ;
+              curr->count += bin->count ;
+            }
+          else
+            {
+              int offset = (int)(bin->y1 - pyramid->start) ;
+
+              g_array_append_val(next, *bin) ;
+
+              curr = &g_array_index(next, DensityBinStruct, next->len - 1) ;
+              curr_end = pyramid->start + ((MAX(offset, 0) / bin_size) + 1) * bin_size - 1 ;
+
+              /* nothing can be merged with a bin that sticks out */
+              if (curr->y2 > curr_end)
+                curr = NULL ;
+            }
+        }
+
+      /* Keep the level if it's worth it, otherwise carry on merging from it. */
+      if ((next_kept = (next->len <= kept_len * DENSITY_LEVEL_MAX_RATIO)))
+        {
+          g_ptr_array_add(pyramid->levels, next) ;
+          g_array_append_val(pyramid->bin_sizes, bin_size) ;
+          kept_len = next->len ;
+        }
+
+      if (!prev_kept)
+        g_array_free(prev, TRUE) ;
+
+      prev = next ;
+      prev_kept = next_kept ;
+    }
+
+  if (!prev_kept)
+    g_array_free(prev, TRUE) ;
+
+  zMapDebugPrint(debug_G, "FeatureSet \"%s\": %ld features, %d pyramid levels",
+                 g_quark_to_string(featureset_item->id), featureset_item->n_features, pyramid->levels->len) ;
+
+  return pyramid ;
+}
+
+
+/* The level with the biggest bins that are no bigger than bases_per_bin. */
+static GArray *densityGetLevel(ZMapWindowCanvasGraphPyramid pyramid, int bases_per_bin)
+{
+  guint i ;
+
+  for (i = pyramid->levels->len - 1 ; i > 0 ; i--)
+    {
+      if (g_array_index(pyramid->bin_sizes, int, i) <= bases_per_bin)
+        break ;
+    }
+
+  return (GArray *)g_ptr_array_index(pyramid->levels, i) ;
+}
+
+
+static void densityPyramidDestroy(ZMapWindowCanvasGraphPyramid pyramid)
+{
+  if (pyramid)
+    {
+      guint i ;
+
+      for (i = 0 ; i < pyramid->levels->len ; i++)
+        g_array_free((GArray *)g_ptr_array_index(pyramid->levels, i), TRUE) ;
+
+      g_ptr_array_free(pyramid->levels, TRUE) ;
+      g_array_free(pyramid->bin_sizes, TRUE) ;
+
+      g_free(pyramid) ;
+    }
+
+  return ;
+}
+
+
+
 /* THERE IS ANOTHER PROBLEM HERE TOO....THE COLUMN STYLE NEEDS TO REFLECT THE
  * FEATURESET STYLES...NONE OF THIS IS TOO GOOD ACTUALLY SINCE REALLY THE FEATURESET
  * STYLES SHOULD BE USED BY THE CANVAS FEATURESET CODE TOO !! */
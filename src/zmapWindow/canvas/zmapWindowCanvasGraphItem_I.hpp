@@ -51,6 +51,9 @@
 /* this could be dynamic based on screen size because actually Malcolm some screens are this size.... */
 #define N_POINTS	2000	/* will never run out as we only display one screen's worth */
 
+/* Score summaries of a density featureset at increasing bin sizes, see densityCalcBins(). */
+typedef struct ZMapWindowCanvasGraphPyramidStructType *ZMapWindowCanvasGraphPyramid ;
+
 typedef struct ZMapWindowCanvasGraphStructType
 {
   /* Cache our colours.... */
@@ -70,6 +73,9 @@ typedef struct ZMapWindowCanvasGraphStructType
   double last_gy ;					    /* Last drawn feature point, used to join up next graph. */
   double last_width ;                                       /* Width of last drawn feature. */
 
+  ZMapWindowCanvasGraphPyramid pyramid ;                    /* Made on first re-bin, remade if
+                                                               features are added or removed. */
+
 } ZMapWindowCanvasGraphStruct, *ZMapWindowCanvasGraph ;
 
 
@@ -138,7 +138,7 @@ void graphicsZoomSet(ZMapWindowFeaturesetItem featureset, GdkDrawable *drawable)
   /* if longest item < text height increase that to match */
   ZMapWindowCanvasPango pango = NULL;
   double text_h;
-  GList *l;
+  guint i;
 
   zMapReturnIfFail(featureset);
   pango = (ZMapWindowCanvasPango) featureset->opt;
@@ -158,9 +158,9 @@ void graphicsZoomSet(ZMapWindowFeaturesetItem featureset, GdkDrawable *drawable)
 
   /* resize all the text items so they get painted properly */
   /* NOTE these structs are ref'd but he index it it exists */
-  for(l = featureset->features; l ; l = l->next)
+  for(i = 0 ; i < featureset->features->len ; i++)
     {
-      ZMapWindowCanvasGraphics gfx = (ZMapWindowCanvasGraphics ) l->data;
+      ZMapWindowCanvasGraphics gfx = (ZMapWindowCanvasGraphics ) g_ptr_array_index(featureset->features, i);
       double mid;
 
       if(gfx->type == FEATURE_TEXT)
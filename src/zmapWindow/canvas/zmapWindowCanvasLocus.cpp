@@ -373,7 +373,7 @@ static gboolean locusFeatureIsFiltered(GList *filters, char * locus)
 static void zMapWindowCanvasLocusZoomSet(ZMapWindowFeaturesetItem featureset, GdkDrawable *drawable)
 {
   //        ZMapSkipList sl;
-  GList *l = NULL ;
+  guint i ;
   double len = 0.0, width = 0.0, f_width = 0.0 ;
   char *text = NULL ;
   int n_loci = 0;
@@ -398,9 +398,9 @@ static void zMapWindowCanvasLocusZoomSet(ZMapWindowFeaturesetItem featureset, Gd
 
 
   /* but normally we get called before the index is created */
-  for(l = featureset->features; l ; l = l->next)
+  for(i = 0 ; i < featureset->features->len ; i++)
     {
-      ZMapWindowCanvasLocus locus = (ZMapWindowCanvasLocus) l->data;
+      ZMapWindowCanvasLocus locus = (ZMapWindowCanvasLocus) g_ptr_array_index(featureset->features, i);
 
       locus->ylocus = locus->feature.feature->x1;
       locus->ytext = locus->feature.feature->x1;
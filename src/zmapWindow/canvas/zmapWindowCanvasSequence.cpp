@@ -427,6 +427,7 @@ static void zmapWindowCanvasSequencePaintFeature(ZMapWindowFeaturesetItem featur
   FooCanvasItem *foo = (FooCanvasItem *) featureset;
   double y1, y2;
   ZMapSequence sequence = NULL ;
+  ZMapFeatureBlock dna_block = NULL ;
   ZMapWindowCanvasSequence seq = (ZMapWindowCanvasSequence) feature;
   int cx, cy ;
   long seq_y1, seq_y2, y;
@@ -442,6 +443,11 @@ static void zmapWindowCanvasSequencePaintFeature(ZMapWindowFeaturesetItem featur
   sequence = &feature->feature->feature.sequence;
   frame = zMapFeatureFrame(feature->feature);
 
+  /* The dna is held packed by the block, only the rows being drawn are decoded. */
+  if (!sequence->sequence && sequence->type == ZMAPSEQUENCE_DNA)
+    dna_block = (ZMapFeatureBlock)zMapFeatureGetParentGroup((ZMapFeatureAny)(feature->feature),
+                                                            ZMAPFEATURE_STRUCT_BLOCK) ;
+
 #ifdef ED_G_NEVER_INCLUDE_THIS_CODE
   GtkAdjustment *adjust ;
 #endif /* ED_G_NEVER_INCLUDE_THIS_CODE */
@@ -549,15 +555,30 @@ static void zmapWindowCanvasSequencePaintFeature(ZMapWindowFeaturesetItem featur
 
       //if(sequence->frame == ZMAPFRAME_2) zMapDebugPrintf("3FT y, seq: %ld (%ld %ld) start,end %ld %ld, ybase %ld\n",y, seq_y1,seq_y2,seq->start, seq->end, y_base);
 
-      p = sequence->sequence + y_base;
       q = seq->text;
 
       nb = seq->n_bases;
       if(sequence->length - y_base < nb)
         nb = sequence->length - y_base;
 
-      for(i = 0;i < nb; i++)
-        *q++ = *p++;        // & 0x5f; original code did this lower cased, peptides are upper
+      if (dna_block)
+        {
+          if (!zMapFeatureBlockDNADecode(dna_block, y_base, nb, q))
+            break ;
+
+          q += nb ;
+        }
+      else if (sequence->sequence)
+        {
+          p = sequence->sequence + y_base;
+
+          for(i = 0;i < nb; i++)
+            *q++ = *p++;        // & 0x5f; original code did this lower cased, peptides are upper
+        }
+      else
+        {
+          break ;
+        }
 
       strcpy(q,seq->truncated);        /* may just be a null */
       while (*q)
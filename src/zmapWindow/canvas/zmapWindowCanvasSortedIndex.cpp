@@ -0,0 +1,192 @@
+/*  File: zmapWindowCanvasSortedIndex.cpp
+ *  Copyright (c) 2006-2017: Genome Research Ltd.
+ *-------------------------------------------------------------------
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------
+ * This file is part of the ZMap genome database package
+ * originally written by:
+ *
+ *      Ed Griffiths (Sanger Institute, UK) edgrif@sanger.ac.uk
+ *        Roy Storey (Sanger Institute, UK) rds@sanger.ac.uk
+ *   Malcolm Hinsley (Sanger Institute, UK) mh17@sanger.ac.uk
+ *       Gemma Guest (Sanger Institute, UK) gb10@sanger.ac.uk
+ *      Steve Miller (Sanger Institute, UK) sm23@sanger.ac.uk
+ *
+ * Description: Alternative to the skip list for a featureset's
+ *              display index, see CANVAS_FEATURESET_SORTED_INDEX.
+ *
+ *              The canvas features are held in one sorted array of skip
+ *              list nodes linked to their neighbours so all the code
+ *              that walks the index with sl->next/sl->prev works
+ *              unchanged but walks contiguous memory. Finds are binary
+ *              searches. A prefix maximum of the features' end coords
+ *              gives the first feature that can overlap a coord so
+ *              overlap searches don't need to go back by the length of
+ *              the longest feature.
+ *
+ *              The index is static, features added to the featureset
+ *              cause it to be rebuilt as for the skip list.
+ *
+ * Exported functions: See zmapWindowCanvasFeatureset_I.hpp
+ *-------------------------------------------------------------------
+ */
+
+#include <ZMap/zmap.hpp>
+
+#include <zmapWindowCanvasFeatureset_I.hpp>
+#include <zmapWindowCanvasFeature_I.hpp>
+
+
+
+typedef struct ZMapWindowCanvasSortedIndexStructType
+{
+  int n_nodes ;
+  zmapSkipListStruct *nodes ;                               /* In feature order, linked as a
+                                                               single skip list layer. */
+  double *max_y2 ;                                          /* max_y2[i] is the largest y2 of
+                                                               nodes 0..i */
+} ZMapWindowCanvasSortedIndexStruct ;
+
+
+
+
+/*
+ *                  Package routines
+ */
+
+
+/* features must be sorted by zMapWindowFeatureCmp(), returns NULL if there are none
+ * as zMapSkipListCreate() does. */
+ZMapWindowCanvasSortedIndex zmapWindowCanvasSortedIndexCreate(GPtrArray *features)
+{
+  ZMapWindowCanvasSortedIndex index = NULL ;
+  double max_y2 = 0.0 ;
+  int i ;
+
+  if (features && features->len)
+    {
+      index = g_new0(ZMapWindowCanvasSortedIndexStruct, 1) ;
+
+      index->n_nodes = features->len ;
+      index->nodes = g_new0(zmapSkipListStruct, index->n_nodes) ;
+      index->max_y2 = g_new(double, index->n_nodes) ;
+
+      for (i = 0 ; i < index->n_nodes ; i++)
+        {
+          ZMapWindowCanvasFeature feature = (ZMapWindowCanvasFeature)g_ptr_array_index(features, i) ;
+          ZMapSkipList node = &(index->nodes[i]) ;
+
+          node->data = feature ;
+
+          if (i > 0)
+            node->prev = node - 1 ;
+          if (i < index->n_nodes - 1)
+            node->next = node + 1 ;
+
+          if (!i || feature->y2 > max_y2)
+            max_y2 = feature->y2 ;
+
+          index->max_y2[i] = max_y2 ;
+        }
+    }
+
+  return index ;
+}
+
+
+/* The first node, NULL if the index is empty. */
+ZMapSkipList zmapWindowCanvasSortedIndexHead(ZMapWindowCanvasSortedIndex index)
+{
+  ZMapSkipList head = NULL ;
+
+  if (index && index->n_nodes)
+    head = index->nodes ;
+
+  return head ;
+}
+
+
+/* Same result as zMapSkipListFind(): the first node whose data compares equal to key,
+ * otherwise the one before it (or the first node if key is before all the data). */
+ZMapSkipList zmapWindowCanvasSortedIndexFind(ZMapWindowCanvasSortedIndex index,
+                                             GCompareFunc cmp, gconstpointer key)
+{
+  ZMapSkipList node = NULL ;
+
+  if (index && index->n_nodes)
+    {
+      int lo = 0, hi = index->n_nodes ;
+
+      /* Find the first node that is not before key. */
+      while (lo < hi)
+        {
+          int mid = lo + (hi - lo) / 2 ;
+
+          if (cmp(index->nodes[mid].data, key) < 0)
+            lo = mid + 1 ;
+          else
+            hi = mid ;
+        }
+
+      if (lo == index->n_nodes)
+        lo-- ;
+      else if (lo > 0 && cmp(index->nodes[lo].data, key) > 0)
+        lo-- ;
+
+      node = &(index->nodes[lo]) ;
+    }
+
+  return node ;
+}
+
+
+/* Returns the first node that could overlap y1, i.e. no earlier feature ends at or after y1,
+ * or NULL if no feature does. */
+ZMapSkipList zmapWindowCanvasSortedIndexFindOverlap(ZMapWindowCanvasSortedIndex index, double y1)
+{
+  ZMapSkipList node = NULL ;
+
+  if (index && index->n_nodes)
+    {
+      int lo = 0, hi = index->n_nodes ;
+
+      while (lo < hi)
+        {
+          int mid = lo + (hi - lo) / 2 ;
+
+          if (index->max_y2[mid] < y1)
+            lo = mid + 1 ;
+          else
+            hi = mid ;
+        }
+
+      if (lo < index->n_nodes)
+        node = &(index->nodes[lo]) ;
+    }
+
+  return node ;
+}
+
+
+void zmapWindowCanvasSortedIndexDestroy(ZMapWindowCanvasSortedIndex index)
+{
+  if (index)
+    {
+      g_free(index->nodes) ;
+      g_free(index->max_y2) ;
+
+      g_free(index) ;
+    }
+
+  return ;
+}
@@ -661,8 +661,13 @@ static void searchCB(GtkWidget *widget, gpointer cb_data)
   /* Convert to relative coords.... */
   start = search_data->search_start - search_data->block->block_to_sequence.block.x1 ;
   end = search_data->search_end - search_data->block->block_to_sequence.block.x1 ;
-  dna = search_data->block->sequence.sequence ;
-  dna_len = strlen(dna) ;
+
+  /* The block's dna is packed so decode a copy to search, it's freed at the end. */
+  if (!zMapFeatureBlockDNA(search_data->block, NULL, &dna_len, &dna))
+    {
+      dna = g_strdup("") ;
+      dna_len = 0 ;
+    }
 
 
   /* Validate the query string, note that gtk_entry returns "" for no text, _not_ NULL. */
@@ -839,6 +844,8 @@ static void searchCB(GtkWidget *widget, gpointer cb_data)
   if(query_buf)
     g_free(query_buf) ;
 
+  g_free(dna) ;
+
   return ;
 }
 
@@ -612,7 +612,9 @@ int zmapWindowDrawFeatureSet(ZMapWindow window,
   featureset_data.feature_stack.set_features[ZMAPSTRAND_FORWARD] = featureset_data.curr_forward_col;
   featureset_data.feature_stack.set_features[ZMAPSTRAND_REVERSE] = featureset_data.curr_reverse_col;
 
-  /* Now draw all the features in the column. */
+  /* Now draw all the features in the column, they must be the right way round first. */
+  zMapFeatureSetRevCompResolve(feature_set) ;
+
   g_hash_table_foreach(feature_set->features, ProcessFeature, &featureset_data) ;
   {
     char *str = g_strdup_printf("Processed %d features",featureset_data.feature_count);
@@ -765,6 +767,8 @@ void zmapWindowDraw3FrameFeatures(ZMapWindow window)
 
   canvas_data.curr_root_group = zmapWindowContainerGetFeatures(window->feature_root_group) ;
 
+  /* Do any pending revcomps in one go, in parallel, rather than set by set as they are drawn. */
+  zMapFeatureAnyRevCompResolve((ZMapFeatureAny)full_context) ;
 
   zMapFeatureContextExecuteComplete((ZMapFeatureAny)full_context,
                                     ZMAPFEATURE_STRUCT_FEATURESET,
@@ -930,6 +934,9 @@ void zMapWindowDrawContext(ZMapCanvasData     canvas_data,
 
   zMapLogTime(TIMER_DRAW_CONTEXT,TIMER_START,0,"");
 
+  /* Do any pending revcomps in one go, in parallel, rather than set by set as they are drawn. */
+  zMapFeatureAnyRevCompResolve((ZMapFeatureAny)diff_context) ;
+
   /* We iterate through the diff context to draw new data */
   zMapFeatureContextExecuteComplete((ZMapFeatureAny)diff_context,
                                     ZMAPFEATURE_STRUCT_FEATURESET,
@@ -2371,7 +2371,11 @@ gboolean zMapWindowExportFASTA(ZMapWindow window, ZMapFeatureAny feature_in, GEr
       block = (ZMapFeatureBlock)zMapFeatureGetParentGroup(feature, ZMAPFEATURE_STRUCT_BLOCK);
 
       if (zMapFeatureBlockDNA(block, &seq_name, &seq_len, &sequence))
-        result = exportFASTA(window, ZMAPFASTA_SEQTYPE_DNA, sequence, seq_name, seq_len, "DNA", NULL, error) ;
+        {
+          result = exportFASTA(window, ZMAPFASTA_SEQTYPE_DNA, sequence, seq_name, seq_len, "DNA", NULL, error) ;
+
+          g_free(sequence) ;
+        }
       else
         g_set_error(error, g_quark_from_string("ZMap"), 99, "Context contains no DNA") ;
     }
@@ -3070,6 +3074,13 @@ static void developerMenuCB(int menu_item_id, gpointer callback_data)
         g_string_append_printf(session_text, "Total features: %d\n", ZMapFeatureCount::instance().getCount()) ;
         g_string_append_printf(session_text, "Max features: %d\n", ZMapFeatureCount::instance().getLimit()) ;
 
+        for (auto &source : ZMapFeatureCount::instance().getSourceStats())
+          {
+            g_string_append_printf(session_text, "\t%s: %d features (%.0f per second)\n",
+                                   g_quark_to_string(source.first), source.second.num_features,
+                                   (source.second.secs > 0.0 ? source.second.num_features / source.second.secs : 0.0)) ;
+          }
+
         title = zMapGUIMakeTitleString(NULL, "Session Statistics") ;
         zMapGUIShowText(title, session_text->str, FALSE) ;
         g_free(title) ;
@@ -1549,6 +1549,8 @@ void navigatorRunSet(  ZMapFeatureSet set,
   feature_stack.feature = NULL;
   zmapGetFeatureStack(&feature_stack,set,NULL,frame);
 
+  zMapFeatureSetRevCompResolve(set) ;
+
   zMap_g_hash_table_get_data(&l, set->features);
 
   for(; l ; l = l->next)
@@ -83,6 +83,8 @@ ZMapFeature zmapWindowScratchGetFeature(ZMapWindow window)
       GHashTableIter iter;
       gpointer key, value;
 
+      zMapFeatureSetRevCompResolve(feature_set) ;
+
       g_hash_table_iter_init (&iter, feature_any->children);
 
       /* Should only be one, so just get the first */
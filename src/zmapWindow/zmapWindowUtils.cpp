@@ -382,6 +382,34 @@ gboolean zMapWindowGetVisibleSeq(ZMapWindow window, FooCanvasItem *focus, int *t
 }
 
 
+/* Get the sequence coords of the part of the window the user can see, as displayed so they
+ * are reverse strand coords if the window is reverse complemented. Unlike
+ * zMapWindowGetVisibleSeq() this doesn't need an item, world coords are sequence coords.
+ * Returns FALSE if the window hasn't been drawn yet. */
+gboolean zMapWindowGetVisibleSpan(ZMapWindow window, int *start_out, int *end_out)
+{
+  gboolean result = FALSE ;
+  double wx1, wy1, wx2, wy2 ;
+  int start, end ;
+
+  zMapReturnValIfFail(window && window->sequence && start_out && end_out, result) ;
+
+  zmapWindowItemGetVisibleWorld(window, &wx1, &wy1, &wx2, &wy2) ;
+
+  start = MAX((int)floor(wy1 + 0.5), window->sequence->start) ;
+  end = MIN((int)floor(wy2 + 0.5), window->sequence->end) ;
+
+  if (wy2 > wy1 && start <= end)
+    {
+      *start_out = start ;
+      *end_out = end ;
+      result = TRUE ;
+    }
+
+  return result ;
+}
+
+
 
 
 
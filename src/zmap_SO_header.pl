@@ -41,6 +41,19 @@
 #      {1, "name01"},
 #      {2, "name02"}
 #    } ;
+#    static const unsigned int ZMAP_SO_DATA_TABLE01_BY_NAME[ZMAP_SO_DATA_TABLE01_NUM_ITEMS] =
+#    {
+#      0,
+#      1
+#    } ;
+#    static const unsigned int ZMAP_SO_DATA_TABLE01_BY_ID[ZMAP_SO_DATA_TABLE01_NUM_ITEMS] =
+#    {
+#      0,
+#      1
+#    } ;
+#
+# The _BY_NAME and _BY_ID arrays are the indices of the table entries sorted
+# by name and by ID, they let the entries be found by binary search.
 #
 # Where we will have up to three of these, defined by the strings
 #
@@ -403,16 +416,7 @@ sub Convert_Data
   my $mode = "" ;
   my $homol = "" ; 
 
-  $i = 0 ;
-  $id = $SOIDS[$i] ;
-  $nam = $Names[$i] ;
-  $mode  = $so_to_mode_map{$nam} ;
-  $homol = $so_to_homol_map{$nam} ; 
-  if (defined $mode)
-  {
-    $result .= "  \{ $id, \"$nam\", $mode, $homol \}" ;
-  }
-  for ($i=1; $i < $sizeNames ; $i++)
+  for ($i=0; $i < $sizeNames ; $i++)
   {
     $id = $SOIDS[$i] ;
     $nam = $Names[$i] ;
@@ -426,11 +430,33 @@ sub Convert_Data
     {
       $homol = "ZMAPHOMOL_NONE" ; 
     }
-    $result .= ",\n  \{ $id, \"$nam\", $mode, $homol \}" ;
+    if ($i)
+    {
+      $result .= ",\n" ;
+    }
+    $result .= "  \{ $id, \"$nam\", $mode, $homol \}" ;
 
   }
   $result .= "\n\} ;\n\n" ;
 
+  #
+  # Indices into the table sorted by name (as strcmp() orders them) and by
+  # ID, so the parser can binary search rather than scan the table. Ties are
+  # kept in table order so the first entry is still the one found.
+  #
+  my @by_name = sort { $Names[$a] cmp $Names[$b] or $a <=> $b } (0 .. $sizeNames - 1) ;
+  my @by_id = sort { $SOIDS[$a] <=> $SOIDS[$b] or $a <=> $b } (0 .. $sizeNames - 1) ;
+  $result .= "static const unsigned int $arg" ;
+  $result .= "_BY_NAME[$arg" ;
+  $result .= "_NUM_ITEMS] = \n\{\n  " ;
+  $result .= join(",\n  ", @by_name) ;
+  $result .= "\n\} ;\n\n" ;
+  $result .= "static const unsigned int $arg" ;
+  $result .= "_BY_ID[$arg" ;
+  $result .= "_NUM_ITEMS] = \n\{\n  " ;
+  $result .= join(",\n  ", @by_id) ;
+  $result .= "\n\} ;\n\n" ;
+
   return $result ;
 }
 